@@ -1,4 +1,6 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
 
@@ -16,7 +18,9 @@ using Buffer = std::vector<uint8_t>;
 template <typename T>
 void dumpToBuffer(Buffer& buffer, const T& value)
 {
-	const auto startAddress = reinterpret_cast<const uint8_t*>(&value);
-	buffer.insert(buffer.end(), startAddress, startAddress + sizeof(T));
+	// Not an insert of the value's bytes: GCC can't see the buffer grow through one, and warns of an overflow.
+	const size_t oldSize = buffer.size();
+	buffer.resize(oldSize + sizeof(T));
+	std::memcpy(buffer.data() + oldSize, &value, sizeof(T));
 }
 }
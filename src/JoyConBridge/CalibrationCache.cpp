@@ -0,0 +1,114 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "Buffer.h"
+#include "CalibrationCache.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * Cache files start with this header, followed by the fields of RawCalibrationData in order, without padding.
+ * The version must be bumped whenever the layout changes, so stale files are ignored rather than misread.
+ */
+#pragma pack(push, 1)
+struct CacheFileHeader
+{
+	char magic[4];
+	uint16_t version;
+	uint16_t payloadSize;
+};
+#pragma pack(pop)
+
+static const char CACHE_FILE_MAGIC[4] = {'J', 'C', 'C', 'D'};
+static const uint16_t CACHE_FILE_VERSION = 1;
+static const uint16_t CACHE_FILE_PAYLOAD_SIZE = 2 * STICK_CALIBRATION_DATA_SIZE + SENSOR_CALIBRATION_DATA_SIZE +
+	sizeof(RawCalibrationData::userCalibrationMagics);
+
+CalibrationCache::CalibrationCache(std::string directory)
+	: m_directory(std::move(directory))
+{}
+
+std::string CalibrationCache::getKey(const uint8_t* deviceInfo)
+{
+	static const size_t FIRMWARE_VERSION_OFFSET = 0;
+	static const size_t MAC_ADDRESS_OFFSET = 4;
+	static const size_t MAC_ADDRESS_SIZE = 6;
+
+	char key[2 * MAC_ADDRESS_SIZE + 1 + 4 + 1] = {};
+	char* position = key;
+	for (size_t i = 0; i < MAC_ADDRESS_SIZE; ++i) {
+		position += snprintf(position, 3, "%02x", deviceInfo[MAC_ADDRESS_OFFSET + i]);
+	}
+	snprintf(position, 6, "-%02x%02x", deviceInfo[FIRMWARE_VERSION_OFFSET], deviceInfo[FIRMWARE_VERSION_OFFSET + 1]);
+
+	return key;
+}
+
+std::optional<RawCalibrationData> CalibrationCache::load(const std::string& key) const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	std::ifstream file(getPath(key), std::ios::binary);
+	if (!file) {
+		return std::nullopt;
+	}
+	const Buffer contents{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+	if (sizeof(CacheFileHeader) + CACHE_FILE_PAYLOAD_SIZE != contents.size()) {
+		return std::nullopt;
+	}
+
+	CacheFileHeader header{};
+	std::memcpy(&header, contents.data(), sizeof(header));
+	if (0 != std::memcmp(header.magic, CACHE_FILE_MAGIC, sizeof(header.magic)) ||
+		CACHE_FILE_VERSION != header.version ||
+		CACHE_FILE_PAYLOAD_SIZE != header.payloadSize) {
+		return std::nullopt;
+	}
+
+	RawCalibrationData data{};
+	const uint8_t* position = contents.data() + sizeof(header);
+	const auto readField = [&position](void* field, size_t size) {
+		std::memcpy(field, position, size);
+		position += size;
+	};
+	readField(data.leftStick.data(), sizeof(data.leftStick));
+	readField(data.rightStick.data(), sizeof(data.rightStick));
+	readField(data.sensors.data(), sizeof(data.sensors));
+	readField(data.userCalibrationMagics.data(), sizeof(data.userCalibrationMagics));
+
+	return data;
+}
+
+void CalibrationCache::store(const std::string& key, const RawCalibrationData& data)
+{
+	const CacheFileHeader header = {
+		{CACHE_FILE_MAGIC[0], CACHE_FILE_MAGIC[1], CACHE_FILE_MAGIC[2], CACHE_FILE_MAGIC[3]},
+		CACHE_FILE_VERSION,
+		CACHE_FILE_PAYLOAD_SIZE
+	};
+
+	Buffer contents;
+	dumpToBuffer(contents, header);
+	dumpToBuffer(contents, data.leftStick);
+	dumpToBuffer(contents, data.rightStick);
+	dumpToBuffer(contents, data.sensors);
+	dumpToBuffer(contents, data.userCalibrationMagics);
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	std::ofstream file(getPath(key), std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(contents.data()), contents.size());
+}
+
+void CalibrationCache::invalidate(const std::string& key)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	std::remove(getPath(key).data());
+}
+
+std::string CalibrationCache::getPath(const std::string& key) const
+{
+	return m_directory + "/" + key + ".jccal";
+}
+}
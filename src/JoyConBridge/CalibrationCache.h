@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+
+namespace joy_con_bridge
+{
+const size_t STICK_CALIBRATION_DATA_SIZE = 9;
+const size_t SENSOR_CALIBRATION_DATA_SIZE = 24; // Accelerometer, then gyroscope. 12 bytes each.
+
+/*
+ * The calibration blocks of a JoyCon, as they appear in its SPI flash.
+ */
+struct RawCalibrationData
+{
+	std::array<uint8_t, STICK_CALIBRATION_DATA_SIZE> leftStick;
+	std::array<uint8_t, STICK_CALIBRATION_DATA_SIZE> rightStick;
+	std::array<uint8_t, SENSOR_CALIBRATION_DATA_SIZE> sensors;
+
+	// The values in front of the user calibration blocks (left stick, right stick, sensors), which tell if they exist.
+	std::array<uint16_t, 3> userCalibrationMagics;
+};
+
+/**
+	@brief Stores the calibration data of JoyCons on disk, so it does not need to be read from SPI on every connection.
+
+	Each JoyCon gets a small binary file in the cache directory. This class is thread-safe.
+*/
+class CalibrationCache
+{
+public:
+	/**
+		@param[in] directory The directory to keep the cache files in. It must already exist.
+	*/
+	explicit CalibrationCache(std::string directory);
+
+	/**
+		@brief Builds the key that identifies a JoyCon in the cache.
+
+		@param[in] deviceInfo The reply of the JoyCon to SUBCOMMAND_REQUEST_DEVICE_INFO.
+
+		@return The key, made of the JoyCon's MAC address (serial number) and firmware version.
+	*/
+	static std::string getKey(const uint8_t* deviceInfo);
+
+	/**
+		@brief Loads the calibration data of a JoyCon.
+
+		@param[in] key The key of the JoyCon, from `getKey`.
+
+		@return The cached data, if there is a valid cache file for the key.
+	*/
+	std::optional<RawCalibrationData> load(const std::string& key) const;
+
+	/**
+		@brief Stores the calibration data of a JoyCon, replacing what was cached for it.
+		Failing to write the cache is not an error; the data will simply be read from SPI next time.
+
+		@param[in] key The key of the JoyCon, from `getKey`.
+		@param[in] data The data to cache.
+	*/
+	void store(const std::string& key, const RawCalibrationData& data);
+
+	/**
+		@brief Removes the calibration data of a JoyCon from the cache.
+
+		@param[in] key The key of the JoyCon, from `getKey`.
+	*/
+	void invalidate(const std::string& key);
+
+private:
+	std::string getPath(const std::string& key) const;
+
+	std::string m_directory;
+	mutable std::mutex m_lock;
+};
+}
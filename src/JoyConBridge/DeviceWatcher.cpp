@@ -0,0 +1,132 @@
+#include "DeviceWatcher.h"
+
+#ifdef __linux__
+#include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+namespace joy_con_bridge
+{
+#ifdef __linux__
+static const char DEVICE_DIRECTORY[] = "/dev";
+static const char HIDRAW_PREFIX[] = "hidraw";
+
+DeviceWatcher::DeviceWatcher()
+	: m_inotify(-1)
+	, m_wakeEvent(-1)
+	, m_isWakePending(false)
+{
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	m_wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	// IN_ATTRIB is there because udev only makes a new node accessible a moment after creating it.
+	if (-1 == m_inotify || -1 == m_wakeEvent ||
+		-1 == inotify_add_watch(m_inotify, DEVICE_DIRECTORY, IN_CREATE | IN_DELETE | IN_ATTRIB)) {
+		if (-1 != m_inotify) {
+			close(m_inotify);
+		}
+		if (-1 != m_wakeEvent) {
+			close(m_wakeEvent);
+		}
+		m_inotify = -1;
+		m_wakeEvent = -1;
+	}
+}
+
+DeviceWatcher::~DeviceWatcher()
+{
+	if (isWatching()) {
+		close(m_inotify);
+		close(m_wakeEvent);
+	}
+}
+
+bool DeviceWatcher::wait(std::chrono::milliseconds timeout)
+{
+	if (!isWatching()) {
+		waitForWake(timeout);
+		return false;
+	}
+
+	pollfd descriptors[] = {{m_inotify, POLLIN, 0}, {m_wakeEvent, POLLIN, 0}};
+	if (0 >= poll(descriptors, 2, static_cast<int>(timeout.count()))) {
+		return false;
+	}
+
+	if (0 != (descriptors[1].revents & POLLIN)) {
+		uint64_t wakeCount = 0;
+		(void)read(m_wakeEvent, &wakeCount, sizeof(wakeCount));
+		return false;
+	}
+
+	// Drain every pending event, looking for hidraw nodes among them.
+	bool isHidrawChanged = false;
+	alignas(inotify_event) char events[4096];
+	ssize_t eventsSize = 0;
+	while (0 < (eventsSize = read(m_inotify, events, sizeof(events)))) {
+		for (ssize_t position = 0; position < eventsSize;) {
+			const auto event = reinterpret_cast<const inotify_event*>(events + position);
+			if (0 != event->len && 0 == std::strncmp(event->name, HIDRAW_PREFIX, sizeof(HIDRAW_PREFIX) - 1)) {
+				isHidrawChanged = true;
+			}
+			position += sizeof(inotify_event) + event->len;
+		}
+	}
+
+	return isHidrawChanged;
+}
+
+void DeviceWatcher::wake()
+{
+	if (!isWatching()) {
+		notifyWake();
+		return;
+	}
+
+	const uint64_t wakeCount = 1;
+	(void)write(m_wakeEvent, &wakeCount, sizeof(wakeCount));
+}
+#else
+DeviceWatcher::DeviceWatcher()
+	: m_inotify(-1)
+	, m_wakeEvent(-1)
+	, m_isWakePending(false)
+{}
+
+DeviceWatcher::~DeviceWatcher() = default;
+
+bool DeviceWatcher::wait(std::chrono::milliseconds timeout)
+{
+	waitForWake(timeout);
+	return false;
+}
+
+void DeviceWatcher::wake()
+{
+	notifyWake();
+}
+#endif
+
+bool DeviceWatcher::isWatching() const
+{
+	return -1 != m_inotify;
+}
+
+void DeviceWatcher::waitForWake(std::chrono::milliseconds timeout)
+{
+	std::unique_lock<std::mutex> guard(m_lock);
+	m_wakeCondition.wait_for(guard, timeout, [this]() { return m_isWakePending; });
+	m_isWakePending = false;
+}
+
+void DeviceWatcher::notifyWake()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_isWakePending = true;
+	m_wakeCondition.notify_all();
+}
+}
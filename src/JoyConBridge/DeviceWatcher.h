@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Notices when HID devices are added or removed, so they don't have to be enumerated constantly.
+
+	On Linux, this watches /dev for hidraw nodes with inotify. Elsewhere, or if inotify is unavailable, nothing is
+	watched and the caller is expected to fall back to enumerating periodically.
+*/
+class DeviceWatcher
+{
+public:
+	DeviceWatcher();
+
+	~DeviceWatcher();
+
+	DeviceWatcher(const DeviceWatcher&) = delete;
+	DeviceWatcher& operator=(const DeviceWatcher&) = delete;
+
+	/**
+		@brief Waits until HID devices may have been added or removed.
+
+		@param[in] timeout The longest time to wait.
+
+		@return true if devices may have changed, false if the timeout was reached or `wake` was called.
+	*/
+	bool wait(std::chrono::milliseconds timeout);
+
+	/**
+		@brief Makes a current or next call to `wait` return immediately. This may be called from any thread.
+	*/
+	void wake();
+
+	/**
+		@brief Checks if devices are actually watched, rather than only waited for with timeouts.
+	*/
+	bool isWatching() const;
+
+private:
+	/**
+		@brief Waits for `wake` or for the timeout, whichever comes first. Used when not watching.
+	*/
+	void waitForWake(std::chrono::milliseconds timeout);
+
+	void notifyWake();
+
+	int m_inotify; // -1 if not watching.
+	int m_wakeEvent; // -1 if not watching.
+
+	// Used for waking up when not watching.
+	std::mutex m_lock;
+	std::condition_variable m_wakeCondition;
+	bool m_isWakePending;
+};
+}
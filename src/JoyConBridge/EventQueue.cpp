@@ -0,0 +1,46 @@
+#include <iterator>
+#include "EventQueue.h"
+
+
+namespace joy_con_bridge
+{
+void EventQueue::post(std::function<void()> work)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_pending.push_back(std::move(work));
+}
+
+size_t EventQueue::runPending()
+{
+	std::deque<std::function<void()>> pending;
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		pending.swap(m_pending);
+	}
+
+	// The work runs without the lock held, so it may post more work.
+	size_t count = 0;
+	try {
+		for (; count < pending.size(); ++count) {
+			pending[count]();
+		}
+	} catch (...) {
+		// The work after the one that threw runs on the next call, ahead of the work that was posted since.
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_pending.insert(m_pending.begin(), std::make_move_iterator(pending.begin() + count + 1),
+		                 std::make_move_iterator(pending.end()));
+		throw;
+	}
+
+	return count;
+}
+
+Executor EventQueue::getExecutor()
+{
+	return [queue = std::weak_ptr<EventQueue>(shared_from_this())](std::function<void()> work) {
+		if (const auto lockedQueue = queue.lock()) {
+			lockedQueue->post(std::move(work));
+		}
+	};
+}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+
+namespace joy_con_bridge
+{
+/*
+ * Runs a piece of work somewhere else, for example on the thread of a UI loop. An empty executor means "right away,
+ * on the calling thread".
+ */
+using Executor = std::function<void(std::function<void()>)>;
+
+/**
+	@brief Queues work from any thread, to be run later on the consumer's thread.
+
+	This is the simplest consumer executor: events are posted from the thread that polls a JoyCon, and run on the
+	consumer's thread when it calls `runPending`, for example once per frame.
+*/
+class EventQueue : public std::enable_shared_from_this<EventQueue>
+{
+public:
+	/**
+		@brief Queues work to be run by `runPending`. May be called from any thread.
+	*/
+	void post(std::function<void()> work);
+
+	/**
+		@brief Runs all the work that is queued, in the order it was posted, on the calling thread.
+		Work posted while this runs is left for the next call.
+
+		@return The number of pieces of work that ran.
+
+		@throws Whatever a piece of work throws. The work queued after it is kept for the next call.
+	*/
+	size_t runPending();
+
+	/**
+		@brief Gets an executor that posts to this queue. Work posted after the queue is destroyed is dropped.
+		The queue must be owned by a `std::shared_ptr`.
+	*/
+	Executor getExecutor();
+
+private:
+	std::mutex m_lock;
+	std::deque<std::function<void()>> m_pending;
+};
+}
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <cstring>
+#include "command_ids.h"
+#include "exceptions.h"
+#include "FakeJoyCon.h"
+
+using namespace joy_con_bridge::command_ids;
+
+
+namespace joy_con_bridge
+{
+// The factory calibration of an actual JoyCon: sensors, then left stick, then right stick.
+const uint32_t FAKE_FACTORY_CALIBRATION_OFFSET = 0x6020;
+const Buffer FAKE_FACTORY_CALIBRATION = {
+	0xD3, 0xFF, 0xD5, 0xFF, 0x55, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+	0x19, 0x00, 0xDD, 0xFF, 0xDC, 0xFF, 0x3B, 0x34, 0x3B, 0x34, 0x3B, 0x34,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xBA, 0xF5, 0x62, 0x6F, 0xC8, 0x77, 0xED, 0x95, 0x5B,
+	0x16, 0xD8, 0x7D, 0xF2, 0xB5, 0x5F, 0x86, 0x65, 0x5E
+};
+
+// Where the rumble data is in output reports, after the command ID and packet number.
+const size_t RUMBLE_DATA_OFFSET = 2;
+// Where the subcommand ID is in subcommand output reports, after the command ID, packet number and rumble data.
+const size_t SUBCOMMAND_ID_OFFSET = 10;
+
+const std::chrono::microseconds TIMER_TICK(5000);
+
+// Like the HID driver, which keeps at most this many reports for a reader that falls behind.
+const unsigned int MAX_REPORT_BACKLOG = 64;
+
+FakeJoyCon::FakeJoyCon(Hand hand, std::chrono::microseconds reportInterval)
+	: m_hand(hand)
+	, m_start(std::chrono::steady_clock::now())
+	, m_reportInterval(reportInterval)
+	, m_nextReportTime(m_start)
+	, m_replyDelay(0)
+	, m_reportMode(SUBCOMMAND_OPTION_REPORT_MODE_SIMPLE_HID)
+	, m_input{}
+	, m_spiFlash(JoyCon::SPI_FLASH_SIZE, 0xFF)
+	, m_macAddress{0x98, 0xB6, 0xE9, 0x00, 0x00, static_cast<uint8_t>(hand)}
+	, m_rumble(protocol::NEUTRAL_RUMBLE)
+	, m_rumbleReportCount(0)
+{
+	std::copy(FAKE_FACTORY_CALIBRATION.begin(), FAKE_FACTORY_CALIBRATION.end(),
+	          m_spiFlash.begin() + FAKE_FACTORY_CALIBRATION_OFFSET);
+
+	// Full battery, sticks centered, lying still.
+	m_input.connectionInfo = 0xE;
+	m_input.batteryStatus = protocol::BatteryStatus::FULL;
+	for (uint8_t* stick : {m_input.leftAnalogStick, m_input.rightAnalogStick}) {
+		stick[0] = 0x00;
+		stick[1] = 0x08;
+		stick[2] = 0x80;
+	}
+	for (protocol::SensorData& sample : m_input.sensorData) {
+		sample.accelerometer[2] = 0x1000;
+	}
+}
+
+size_t FakeJoyCon::write(const uint8_t* data, size_t size)
+{
+	const bool carriesRumble = size >= RUMBLE_DATA_OFFSET + m_rumble.size() &&
+		(COMMAND_RUMBLE == data[0] || COMMAND_START_SUBCOMMAND == data[0]);
+	if (carriesRumble) {
+		std::lock_guard<std::mutex> guard(m_lock);
+		std::copy_n(data + RUMBLE_DATA_OFFSET, m_rumble.size(), m_rumble.begin());
+		if (COMMAND_RUMBLE == data[0]) {
+			++m_rumbleReportCount;
+		}
+	}
+
+	if (size <= SUBCOMMAND_ID_OFFSET || COMMAND_START_SUBCOMMAND != data[0]) {
+		// Rumble only, or something the fake doesn't simulate.
+		return size;
+	}
+
+	const uint8_t subcommandId = data[SUBCOMMAND_ID_OFFSET];
+	const Buffer parameters(data + SUBCOMMAND_ID_OFFSET + 1, data + size);
+
+	SubcommandHandler handler;
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		++m_subcommandCounts[subcommandId];
+		const auto found = m_handlers.find(subcommandId);
+		if (m_handlers.end() != found) {
+			handler = found->second;
+		}
+	}
+
+	const std::optional<Buffer> replyData = handler ? handler(parameters) : getDefaultReply(subcommandId, parameters);
+	if (!replyData) {
+		return size;
+	}
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	const auto now = std::chrono::steady_clock::now();
+	protocol::StandardInputReport reply{};
+	std::memcpy(&reply, &m_input, sizeof(protocol::InputReport));
+	reply.id = PACKET_TYPE_STANDARD;
+	reply.timer = getTimer(now + m_replyDelay);
+	reply.ack = true;
+	// Replies that carry data are typed by the subcommand they reply to (0x90 for SPI reads, for example).
+	reply.dataType = replyData->empty() ? 0 : (subcommandId & 0x7F);
+	reply.replyToSubcommandId = subcommandId;
+	std::copy_n(replyData->begin(), std::min(replyData->size(), sizeof(reply.data)), reply.data);
+	m_replies.emplace_back(now + m_replyDelay, reply);
+	m_replyQueued.notify_all();
+
+	return size;
+}
+
+size_t FakeJoyCon::readInto(uint8_t* data, size_t size, int milliseconds)
+{
+	auto now = std::chrono::steady_clock::now();
+	const auto deadline = now + std::chrono::milliseconds(milliseconds);
+
+	std::unique_lock<std::mutex> lock(m_lock);
+	while (true) {
+		const size_t read = takeReport(data, size, now);
+		if (0 != read) {
+			return read;
+		}
+		if (now >= deadline) {
+			throw HidTimeoutError(nullptr);
+		}
+
+		const bool isStreaming = SUBCOMMAND_OPTION_REPORT_MODE_FULL == m_reportMode;
+		auto wakeTime = isStreaming ? std::min(deadline, m_nextReportTime) : deadline;
+		const auto nextReply = getNextReply();
+		if (m_replies.end() != nextReply) {
+			wakeTime = std::min(wakeTime, nextReply->first);
+		}
+		m_replyQueued.wait_until(lock, wakeTime);
+		now = std::chrono::steady_clock::now();
+	}
+}
+
+size_t FakeJoyCon::tryReadInto(uint8_t* data, size_t size)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return takeReport(data, size, std::chrono::steady_clock::now());
+}
+
+void FakeJoyCon::setInput(const protocol::StandardFullInputReport& input)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_input = input;
+}
+
+void FakeJoyCon::setReportInterval(std::chrono::microseconds reportInterval)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_reportInterval = reportInterval;
+	m_nextReportTime = std::chrono::steady_clock::now() + reportInterval;
+	m_replyQueued.notify_all();
+}
+
+void FakeJoyCon::setReplyDelay(std::chrono::microseconds replyDelay)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_replyDelay = replyDelay;
+}
+
+void FakeJoyCon::writeSpi(uint32_t offset, const Buffer& data)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (offset >= m_spiFlash.size()) {
+		return;
+	}
+	std::copy_n(data.begin(), std::min(data.size(), m_spiFlash.size() - offset), m_spiFlash.begin() + offset);
+}
+
+void FakeJoyCon::setMacAddress(const std::array<uint8_t, 6>& macAddress)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_macAddress = macAddress;
+}
+
+void FakeJoyCon::setSubcommandHandler(uint8_t subcommandId, SubcommandHandler handler)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (handler) {
+		m_handlers[subcommandId] = std::move(handler);
+	} else {
+		m_handlers.erase(subcommandId);
+	}
+}
+
+std::optional<Buffer> FakeJoyCon::getDefaultReply(uint8_t subcommandId, const Buffer& parameters)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	if (SUBCOMMAND_SPI_READ == subcommandId) {
+		protocol::SpiReadCommandParameters read{};
+		if (parameters.size() < sizeof(read)) {
+			return std::nullopt;
+		}
+		std::memcpy(&read, parameters.data(), sizeof(read));
+
+		// The reply echoes the parameters, followed by the data.
+		Buffer reply(parameters.begin(), parameters.begin() + sizeof(read));
+		const size_t offset = std::min<size_t>(read.readOffset, m_spiFlash.size());
+		const size_t size = std::min<size_t>({read.readSize, JoyCon::MAX_SPI_READ_SIZE, m_spiFlash.size() - offset});
+		reply.insert(reply.end(), m_spiFlash.begin() + offset, m_spiFlash.begin() + offset + size);
+		return reply;
+	}
+
+	if (SUBCOMMAND_REQUEST_DEVICE_INFO == subcommandId) {
+		// Firmware version, JoyCon type, unknown, MAC address, unknown, colors in SPI.
+		Buffer reply = {0x03, 0x48, static_cast<uint8_t>(Hand::RIGHT == m_hand ? 2 : 1), 0x02};
+		reply.insert(reply.end(), m_macAddress.begin(), m_macAddress.end());
+		reply.insert(reply.end(), {0x01, 0x01});
+		return reply;
+	}
+
+	if (SUBCOMMAND_REPORT_MODE == subcommandId && !parameters.empty()) {
+		if (SUBCOMMAND_OPTION_REPORT_MODE_FULL != m_reportMode) {
+			m_nextReportTime = std::chrono::steady_clock::now() + m_reportInterval;
+		}
+		m_reportMode = parameters[0];
+		m_replyQueued.notify_all();
+	}
+
+	return Buffer();
+}
+
+unsigned int FakeJoyCon::getSubcommandCount(uint8_t subcommandId) const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	const auto found = m_subcommandCounts.find(subcommandId);
+	return m_subcommandCounts.end() == found ? 0 : found->second;
+}
+
+uint8_t FakeJoyCon::getReportMode() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_reportMode;
+}
+
+protocol::RumbleData FakeJoyCon::getRumble() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_rumble;
+}
+
+unsigned int FakeJoyCon::getRumbleReportCount() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_rumbleReportCount;
+}
+
+size_t FakeJoyCon::takeReport(uint8_t* data, size_t size, std::chrono::steady_clock::time_point now)
+{
+	const auto nextReply = getNextReply();
+	if (m_replies.end() != nextReply && nextReply->first <= now) {
+		const size_t read = std::min(size, sizeof(protocol::StandardInputReport));
+		std::memcpy(data, &nextReply->second, read);
+		m_replies.erase(nextReply);
+		return read;
+	}
+
+	if (SUBCOMMAND_OPTION_REPORT_MODE_FULL != m_reportMode || m_nextReportTime > now) {
+		return 0;
+	}
+
+	// Reports that would have overflowed the backlog of a reader that fell behind are lost.
+	if (now - m_nextReportTime > MAX_REPORT_BACKLOG * m_reportInterval) {
+		m_nextReportTime = now - MAX_REPORT_BACKLOG * m_reportInterval;
+	}
+
+	protocol::StandardFullInputReport report = m_input;
+	report.id = PACKET_TYPE_BUTTONS_AND_IMU;
+	report.timer = getTimer(m_nextReportTime);
+	m_nextReportTime = std::chrono::microseconds(0) == m_reportInterval ? now : m_nextReportTime + m_reportInterval;
+
+	const size_t read = std::min(size, sizeof(report));
+	std::memcpy(data, &report, read);
+	return read;
+}
+
+FakeJoyCon::Replies::iterator FakeJoyCon::getNextReply()
+{
+	// The first of the earliest, so replies that are due at the same time keep their order.
+	return std::min_element(m_replies.begin(), m_replies.end(), [](const auto& first, const auto& second) {
+		return first.first < second.first;
+	});
+}
+
+uint8_t FakeJoyCon::getTimer(std::chrono::steady_clock::time_point time) const
+{
+	return static_cast<uint8_t>((time - m_start) / TIMER_TICK);
+}
+}
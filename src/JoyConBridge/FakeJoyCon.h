@@ -0,0 +1,160 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include "Buffer.h"
+#include "JoyCon.h"
+#include "protocol.h"
+#include "Transport.h"
+
+
+namespace joy_con_bridge
+{
+const std::chrono::microseconds DEFAULT_FAKE_REPORT_INTERVAL(15000);
+
+/**
+	@brief A transport that simulates a JoyCon in the process, to run JoyCons without hardware.
+
+	The fake answers subcommands like a JoyCon: it replies to SPI reads from its own flash, sends the device info of its
+	hand, switches report modes, and acknowledges the rest. Once switched to the full report mode it streams 0x30
+	reports, with the input that was last scripted. Any subcommand can be scripted to reply differently, or not at all.
+
+	The fake has no file descriptor, so pools wait for it by polling. This class is thread-safe, so it can be scripted
+	while a JoyCon reads from it.
+*/
+class FakeJoyCon : public Transport
+{
+public:
+	/**
+		@brief Gets the data of the reply to a subcommand, given the parameters of the subcommand.
+
+		@return The data of the reply, or an empty buffer for a simple ACK. If empty, the subcommand is not replied to.
+	*/
+	using SubcommandHandler = std::function<std::optional<Buffer>(const Buffer& parameters)>;
+
+	/**
+		@param[in] hand The hand of the simulated JoyCon, which it reports in its device info.
+		@param[in] reportInterval The time between two 0x30 reports. If 0, a report is always waiting to be read.
+	*/
+	explicit FakeJoyCon(Hand hand, std::chrono::microseconds reportInterval = DEFAULT_FAKE_REPORT_INTERVAL);
+
+	size_t write(const uint8_t* data, size_t size) override;
+
+	size_t readInto(uint8_t* data, size_t size, int milliseconds) override;
+
+	size_t tryReadInto(uint8_t* data, size_t size) override;
+
+	/**
+		@brief Sets the input the fake reports from now on.
+
+		@param[in] input The report to send. Its ID and timer are filled by the fake. Sensor data is only sent in 0x30
+		                 reports.
+	*/
+	void setInput(const protocol::StandardFullInputReport& input);
+
+	/**
+		@brief Changes the time between two 0x30 reports.
+	*/
+	void setReportInterval(std::chrono::microseconds reportInterval);
+
+	/**
+		@brief Delays the replies to subcommands that are written from now on, like the round trip over the radio
+		delays the replies of a JoyCon. Replies are not delayed by default. They are read in the order they are due, so
+		a reply that is delayed less overtakes those before it.
+	*/
+	void setReplyDelay(std::chrono::microseconds replyDelay);
+
+	/**
+		@brief Writes to the SPI flash of the fake. The flash starts with the factory calibration of an actual JoyCon,
+		and is erased (0xFF) elsewhere.
+
+		@param[in] offset The offset to write at.
+		@param[in] data The data to write. Data past the end of the flash is dropped.
+	*/
+	void writeSpi(uint32_t offset, const Buffer& data);
+
+	void setMacAddress(const std::array<uint8_t, 6>& macAddress);
+
+	/**
+		@brief Replaces the way the fake replies to a subcommand.
+
+		@param[in] subcommandId The ID of the subcommand.
+		@param[in] handler Replies to the subcommand. It is called without any lock held, and may call
+		                   `getDefaultReply`. If empty, the default reply is restored.
+	*/
+	void setSubcommandHandler(uint8_t subcommandId, SubcommandHandler handler);
+
+	/**
+		@brief Gets the data of the reply that the fake sends to a subcommand by default. Changes the state of the
+		fake as the subcommand would (switching the report mode, for example).
+	*/
+	std::optional<Buffer> getDefaultReply(uint8_t subcommandId, const Buffer& parameters);
+
+	/**
+		@brief Gets the number of times a subcommand was written.
+	*/
+	unsigned int getSubcommandCount(uint8_t subcommandId) const;
+
+	/**
+		@brief Gets the report mode that was last set with SUBCOMMAND_REPORT_MODE.
+	*/
+	uint8_t getReportMode() const;
+
+	/**
+		@brief Gets the rumble data of the latest report that carried it: a rumble report, or a subcommand.
+	*/
+	protocol::RumbleData getRumble() const;
+
+	/**
+		@brief Gets the number of rumble-only reports that were written.
+	*/
+	unsigned int getRumbleReportCount() const;
+
+private:
+	/**
+		@brief Takes the next report that is waiting to be read: a subcommand reply, or else a streamed 0x30 report.
+		Must be called with the lock held.
+
+		@return The number of bytes copied, or 0 if no report is waiting.
+	*/
+	size_t takeReport(uint8_t* data, size_t size, std::chrono::steady_clock::time_point now);
+
+	using Replies = std::deque<std::pair<std::chrono::steady_clock::time_point, protocol::StandardInputReport>>;
+
+	/**
+		@brief Gets the reply that is due first, whether it is due yet or not. Must be called with the lock held.
+
+		@return The reply, or the end of `m_replies` if there is none.
+	*/
+	Replies::iterator getNextReply();
+
+	/**
+		@brief Gets the value of the timer byte at the given time, which counts in steps of 5ms like on a JoyCon.
+	*/
+	uint8_t getTimer(std::chrono::steady_clock::time_point time) const;
+
+	const Hand m_hand;
+	const std::chrono::steady_clock::time_point m_start;
+	std::chrono::microseconds m_reportInterval;
+	std::chrono::steady_clock::time_point m_nextReportTime;
+	std::chrono::microseconds m_replyDelay;
+	uint8_t m_reportMode;
+	protocol::StandardFullInputReport m_input;
+	Buffer m_spiFlash;
+	std::array<uint8_t, 6> m_macAddress;
+	Replies m_replies; // With the time each of them can be read at.
+	std::map<uint8_t, SubcommandHandler> m_handlers;
+	std::map<uint8_t, unsigned int> m_subcommandCounts;
+	protocol::RumbleData m_rumble;
+	unsigned int m_rumbleReportCount;
+	mutable std::mutex m_lock;
+	std::condition_variable m_replyQueued;
+};
+}
@@ -0,0 +1,142 @@
+#include <cmath>
+#include "GyroscopeBiasEstimator.h"
+
+
+namespace joy_con_bridge
+{
+// The accelerometer reads in m/s^2, so this is what it measures at rest.
+static const float GRAVITY = 9.8f;
+
+GyroscopeBiasEstimator::GyroscopeBiasEstimator(const CalibrationData& calibrationData)
+	: m_accelerometerCoeff{}
+	, m_gyroscopeCoeff{}
+	, m_calibratedNeutral{}
+	, m_neutral{}
+	, m_minAccelerationSquared(0)
+	, m_maxAccelerationSquared(0)
+	, m_maxScaledVariances{}
+	, m_window{}
+	, m_nextSample(0)
+	, m_sampleCount(0)
+	, m_sums{}
+	, m_squareSums{}
+	, m_samplesAtGravity(0)
+	, m_confidence(0)
+	, m_isStill(false)
+{
+	setCalibrationData(calibrationData);
+}
+
+void GyroscopeBiasEstimator::update(const protocol::SensorData& sample)
+{
+	const float ax = static_cast<float>(sample.accelerometer[0]) * m_accelerometerCoeff.x;
+	const float ay = static_cast<float>(sample.accelerometer[1]) * m_accelerometerCoeff.y;
+	const float az = static_cast<float>(sample.accelerometer[2]) * m_accelerometerCoeff.z;
+	const float accelerationSquared = ax * ax + ay * ay + az * az;
+	if (accelerationSquared >= m_minAccelerationSquared && accelerationSquared <= m_maxAccelerationSquared) {
+		++m_samplesAtGravity;
+	} else {
+		m_samplesAtGravity = 0;
+	}
+
+	std::array<int16_t, 3>& slot = m_window[m_nextSample];
+	for (size_t axis = 0; axis < 3; ++axis) {
+		const int64_t oldValue = slot[axis];
+		const int64_t newValue = sample.gyroscope[axis];
+		if (m_sampleCount == WINDOW_SIZE) {
+			m_sums[axis] -= oldValue;
+			m_squareSums[axis] -= oldValue * oldValue;
+		}
+		m_sums[axis] += newValue;
+		m_squareSums[axis] += newValue * newValue;
+		slot[axis] = sample.gyroscope[axis];
+	}
+	m_nextSample = (m_nextSample + 1) % WINDOW_SIZE;
+	if (m_sampleCount < WINDOW_SIZE) {
+		++m_sampleCount;
+	}
+
+	m_isStill = isStill();
+	if (m_isStill) {
+		static const float INVERSE_WINDOW_SIZE = 1.0f / WINDOW_SIZE;
+		m_neutral.x += (static_cast<float>(m_sums[0]) * INVERSE_WINDOW_SIZE - m_neutral.x) * NEUTRAL_GAIN;
+		m_neutral.y += (static_cast<float>(m_sums[1]) * INVERSE_WINDOW_SIZE - m_neutral.y) * NEUTRAL_GAIN;
+		m_neutral.z += (static_cast<float>(m_sums[2]) * INVERSE_WINDOW_SIZE - m_neutral.z) * NEUTRAL_GAIN;
+		m_confidence += (1 - m_confidence) * CONFIDENCE_GAIN;
+	} else {
+		m_confidence -= m_confidence * CONFIDENCE_DECAY;
+	}
+}
+
+void GyroscopeBiasEstimator::update(const protocol::StandardFullInputReport& report)
+{
+	for (const protocol::SensorData& sample : report.sensorData) {
+		update(sample);
+	}
+}
+
+void GyroscopeBiasEstimator::setCalibrationData(const CalibrationData& calibrationData)
+{
+	m_accelerometerCoeff = calibrationData.accelerometerCoeff;
+	m_gyroscopeCoeff = calibrationData.gyroscopeCoeff;
+	m_calibratedNeutral = calibrationData.gyroscopeNeutral;
+	m_neutral = calibrationData.gyroscopeNeutral;
+
+	const float minAcceleration = GRAVITY * (1 - STILL_ACCELERATION_TOLERANCE);
+	const float maxAcceleration = GRAVITY * (1 + STILL_ACCELERATION_TOLERANCE);
+	m_minAccelerationSquared = minAcceleration * minAcceleration;
+	m_maxAccelerationSquared = maxAcceleration * maxAcceleration;
+
+	const float coefficients[] = {m_gyroscopeCoeff.x, m_gyroscopeCoeff.y, m_gyroscopeCoeff.z};
+	for (size_t axis = 0; axis < 3; ++axis) {
+		// Without a coefficient the deviation can't be told, so the JoyCon never rests.
+		const double scaledDeviation = 0 != coefficients[axis] ?
+			STILL_ROTATION_DEVIATION / std::fabs(static_cast<double>(coefficients[axis])) * WINDOW_SIZE : 0;
+		m_maxScaledVariances[axis] = static_cast<int64_t>(scaledDeviation * scaledDeviation);
+	}
+
+	m_window = {};
+	m_nextSample = 0;
+	m_sampleCount = 0;
+	m_sums = {};
+	m_squareSums = {};
+	m_samplesAtGravity = 0;
+	m_confidence = 0;
+	m_isStill = false;
+}
+
+const Coefficient& GyroscopeBiasEstimator::getNeutral() const
+{
+	return m_neutral;
+}
+
+GyroscopeBias GyroscopeBiasEstimator::getBias() const
+{
+	GyroscopeBias bias{};
+	bias.bias = {
+		(m_neutral.x - m_calibratedNeutral.x) * m_gyroscopeCoeff.x,
+		(m_neutral.y - m_calibratedNeutral.y) * m_gyroscopeCoeff.y,
+		(m_neutral.z - m_calibratedNeutral.z) * m_gyroscopeCoeff.z
+	};
+	bias.confidence = m_confidence;
+	bias.isStill = m_isStill;
+	return bias;
+}
+
+bool GyroscopeBiasEstimator::isStill() const
+{
+	if (m_samplesAtGravity < WINDOW_SIZE || m_sampleCount < WINDOW_SIZE) {
+		return false;
+	}
+
+	// The variance of the window, times its size squared, which keeps it exact in integers.
+	for (size_t axis = 0; axis < 3; ++axis) {
+		const int64_t scaledVariance = static_cast<int64_t>(WINDOW_SIZE) * m_squareSums[axis] -
+			m_sums[axis] * m_sums[axis];
+		if (scaledVariance > m_maxScaledVariances[axis]) {
+			return false;
+		}
+	}
+	return true;
+}
+}
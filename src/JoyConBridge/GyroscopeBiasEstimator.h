@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "decode.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * What the gyroscope of a JoyCon reads at rest, as learned so far.
+ */
+struct GyroscopeBias
+{
+	ThreeAxesSensor bias; // Beyond the calibrated neutral, in radians per second.
+	float confidence; // In [0, 1]. Grows while the JoyCon rests, and fades while it doesn't, as the bias drifts.
+	bool isStill; // Whether the JoyCon rests as of the latest sample.
+};
+
+/**
+	@brief Learns the neutral of the gyroscope of a JoyCon while it rests, to follow the drift of the gyroscope with
+	temperature over a long session.
+
+	The JoyCon rests once the accelerometer measured nothing but gravity, and the gyroscope barely changed, for a whole
+	window of samples. While it rests, the neutral is pulled towards the mean of the gyroscope over the window. The
+	window is a ring of raw samples with running sums, so every update costs the same and allocates nothing.
+*/
+class GyroscopeBiasEstimator
+{
+public:
+	// The number of IMU samples the JoyCon must rest for, about two thirds of a second.
+	static constexpr size_t WINDOW_SIZE = 128;
+	// The JoyCon rests while the accelerometer measures gravity within this fraction of it...
+	static constexpr float STILL_ACCELERATION_TOLERANCE = 0.05f;
+	// ...and the standard deviation of each axis of the gyroscope over the window is below this, in radians per second.
+	static constexpr float STILL_ROTATION_DEVIATION = 0.02f;
+	// The fraction of the way the neutral moves towards the mean of the window, for each sample the JoyCon rests.
+	static constexpr float NEUTRAL_GAIN = 1.0f / 256;
+	// The fraction of the way the confidence moves towards 1 for each sample the JoyCon rests, and towards 0 for each
+	// sample it doesn't. So resting for a few seconds is enough, and the confidence halves after about a minute.
+	static constexpr float CONFIDENCE_GAIN = 1.0f / 512;
+	static constexpr float CONFIDENCE_DECAY = 1.0f / 16384;
+
+	/**
+		@param[in] calibrationData The calibration data of the JoyCon. The neutral starts from its `gyroscopeNeutral`.
+	*/
+	explicit GyroscopeBiasEstimator(const CalibrationData& calibrationData = {});
+
+	/**
+		@brief Accounts for a raw IMU sample.
+	*/
+	void update(const protocol::SensorData& sample);
+
+	/**
+		@brief Accounts for the raw IMU samples of a report, oldest first.
+	*/
+	void update(const protocol::StandardFullInputReport& report);
+
+	/**
+		@brief Forgets everything that was learned, and starts over from the given calibration data.
+	*/
+	void setCalibrationData(const CalibrationData& calibrationData);
+
+	/**
+		@brief Gets the learned neutral of the gyroscope, in raw units, to decode the gyroscope with instead of the
+		calibrated one. See `decode::decodeSensors`.
+	*/
+	const Coefficient& getNeutral() const;
+
+	/**
+		@brief Gets the learned bias beyond the calibrated neutral, and how much it can be trusted.
+	*/
+	GyroscopeBias getBias() const;
+
+private:
+	bool isStill() const;
+
+	Coefficient m_accelerometerCoeff;
+	Coefficient m_gyroscopeCoeff;
+	Coefficient m_calibratedNeutral;
+	Coefficient m_neutral;
+	// The thresholds for resting. The variances are in raw units, and scaled like in `isStill`.
+	float m_minAccelerationSquared;
+	float m_maxAccelerationSquared;
+	std::array<int64_t, 3> m_maxScaledVariances;
+
+	std::array<std::array<int16_t, 3>, WINDOW_SIZE> m_window;
+	size_t m_nextSample; // In the window.
+	size_t m_sampleCount; // In the window, up to its size.
+	std::array<int64_t, 3> m_sums;
+	std::array<int64_t, 3> m_squareSums;
+	size_t m_samplesAtGravity; // Since the accelerometer last measured more than just gravity.
+	float m_confidence;
+	bool m_isStill;
+};
+}
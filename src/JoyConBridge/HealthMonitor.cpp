@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cmath>
+#include "HealthMonitor.h"
+
+
+namespace joy_con_bridge
+{
+// How much of each report goes into the smoothed period and loss ratio. The loss ratio counts every report that was
+// due, lost or not, so it covers the last few dozens of report periods.
+const double PERIOD_GAIN = 1.0 / 16;
+const double LOSS_GAIN = 1.0 / 32;
+
+HealthMonitor::HealthMonitor()
+	: m_hasReports(false)
+	, m_previousDeviceTicks(0)
+	, m_periodTicks(static_cast<double>(DEFAULT_PERIOD.count()) / ReportClock::TICK.count())
+	, m_lossRatio(0)
+	, m_lastReceiveTime(0)
+	, m_expectedPeriod(DEFAULT_PERIOD.count())
+	, m_recentLossRatio(0)
+	, m_lostReportCount(0)
+{}
+
+void HealthMonitor::update(const ReportTimestamp& timestamp)
+{
+	if (m_hasReports && timestamp.deviceTicks > m_previousDeviceTicks) {
+		const auto ticks = static_cast<double>(timestamp.deviceTicks - m_previousDeviceTicks);
+		const auto lostReports = static_cast<uint64_t>(std::max(0.0, std::round(ticks / m_periodTicks) - 1));
+
+		// The reports that were due in the gap are lost, and this one arrived.
+		if (0 != lostReports) {
+			m_lossRatio = 1 - (1 - m_lossRatio) * std::pow(1 - LOSS_GAIN, static_cast<double>(lostReports));
+			m_lostReportCount.store(m_lostReportCount.load(std::memory_order_relaxed) + lostReports,
+			                        std::memory_order_relaxed);
+		}
+		m_lossRatio *= 1 - LOSS_GAIN;
+
+		// A gap of lost reports only nudges the period, so a single loss barely moves it, but a JoyCon that switched
+		// to a longer period is followed there.
+		m_periodTicks += (std::min(ticks, 2 * m_periodTicks) - m_periodTicks) * PERIOD_GAIN;
+
+		m_recentLossRatio.store(m_lossRatio, std::memory_order_relaxed);
+		m_expectedPeriod.store(static_cast<std::chrono::microseconds::rep>(m_periodTicks * ReportClock::TICK.count()),
+		                       std::memory_order_relaxed);
+	}
+
+	m_hasReports = true;
+	m_previousDeviceTicks = timestamp.deviceTicks;
+	m_lastReceiveTime.store(timestamp.receiveTime.time_since_epoch().count(), std::memory_order_release);
+}
+
+Health HealthMonitor::getHealth(std::chrono::steady_clock::time_point now) const noexcept
+{
+	Health health{};
+	health.expectedPeriod = std::chrono::microseconds(m_expectedPeriod.load(std::memory_order_relaxed));
+	health.recentLossRatio = m_recentLossRatio.load(std::memory_order_relaxed);
+	health.lostReportCount = m_lostReportCount.load(std::memory_order_relaxed);
+
+	const auto lastReceiveTime = m_lastReceiveTime.load(std::memory_order_acquire);
+	if (0 == lastReceiveTime) {
+		health.status = HealthStatus::STALLED;
+		health.timeSinceLastReport = std::chrono::microseconds::max();
+		return health;
+	}
+
+	const std::chrono::steady_clock::time_point lastReport{std::chrono::steady_clock::duration(lastReceiveTime)};
+	health.timeSinceLastReport = std::max(std::chrono::microseconds(0),
+	                                      std::chrono::duration_cast<std::chrono::microseconds>(now - lastReport));
+
+	const double silentPeriods = static_cast<double>(health.timeSinceLastReport.count()) /
+		std::max<std::chrono::microseconds::rep>(1, health.expectedPeriod.count());
+	if (silentPeriods >= STALLED_PERIODS) {
+		health.status = HealthStatus::STALLED;
+	} else if (silentPeriods >= DEGRADED_PERIODS || health.recentLossRatio > DEGRADED_LOSS_RATIO) {
+		health.status = HealthStatus::DEGRADED;
+	} else {
+		health.status = HealthStatus::HEALTHY;
+	}
+	return health;
+}
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "ReportClock.h"
+
+
+namespace joy_con_bridge
+{
+enum class HealthStatus
+{
+	HEALTHY,
+	DEGRADED, // Reports are late, or some of them are lost.
+	STALLED // Reports stopped arriving, or never did.
+};
+
+/*
+ * How well the reports of a JoyCon arrive, at some point in time.
+ */
+struct Health
+{
+	HealthStatus status;
+	std::chrono::microseconds expectedPeriod; // Between reports, as learned from their timers.
+	std::chrono::microseconds timeSinceLastReport; // The maximum, before the first report.
+	double recentLossRatio; // The smoothed part of the reports that were lost lately, in [0, 1].
+	uint64_t lostReportCount; // Since the JoyCon was connected.
+};
+
+/**
+	@brief Notices lost reports and stalls of a JoyCon within a few report periods, long before a read times out.
+
+	The period between reports is learned from the JoyCon's clock, so it is free of the jitter of the connection. A gap
+	in the clock of more than a period means the reports in between were lost. A JoyCon that sent nothing for a couple
+	of periods is degraded, and after a few more it is stalled.
+
+	Reports are fed from the thread that reads them. The health can be checked from any thread, without blocking and
+	without throwing, even while the reading thread waits for a report that doesn't come.
+*/
+class HealthMonitor
+{
+public:
+	// Reports are assumed to be this far apart until they show otherwise. This is the period of the full report mode.
+	static constexpr std::chrono::microseconds DEFAULT_PERIOD{15000};
+	// A JoyCon is degraded once no report arrived for this many periods, and stalled at this many.
+	static constexpr double DEGRADED_PERIODS = 2;
+	static constexpr double STALLED_PERIODS = 4;
+	// A JoyCon that lost more than this part of its recent reports is degraded.
+	static constexpr double DEGRADED_LOSS_RATIO = 0.1;
+
+	HealthMonitor();
+
+	HealthMonitor(const HealthMonitor&) = delete;
+	HealthMonitor& operator=(const HealthMonitor&) = delete;
+
+	/**
+		@brief Accounts for a report that was read.
+
+		@param[in] timestamp The timestamp of the report.
+	*/
+	void update(const ReportTimestamp& timestamp);
+
+	/**
+		@brief Gets the health of the JoyCon.
+
+		@param[in] now The current time, for checking how late the next report is.
+	*/
+	Health getHealth(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const noexcept;
+
+private:
+	// Only touched by the thread that reads the reports.
+	bool m_hasReports;
+	uint64_t m_previousDeviceTicks;
+	double m_periodTicks; // Smoothed.
+	double m_lossRatio; // Smoothed.
+
+	// Published for `getHealth`, in the representation of their types.
+	std::atomic<std::chrono::steady_clock::rep> m_lastReceiveTime; // Since the epoch, or 0 before the first report.
+	std::atomic<std::chrono::microseconds::rep> m_expectedPeriod;
+	std::atomic<double> m_recentLossRatio;
+	std::atomic<uint64_t> m_lostReportCount;
+};
+}
@@ -1,6 +1,10 @@
 #include "HidDevice.h"
 #include "exceptions.h"
 
+#ifdef __linux__
+#include "linux/hidapi_hidraw.h"
+#endif
+
 
 namespace joy_con_bridge
 {
@@ -53,7 +57,12 @@ HidDevice::HidDevicePointer HidDevice::openPath(const std::string& path)
 
 size_t HidDevice::write(const Buffer& buffer)
 {
-	const int writtenBytes = hid_write(m_device.get(), buffer.data(), buffer.size());
+	return write(buffer.data(), buffer.size());
+}
+
+size_t HidDevice::write(const uint8_t* data, size_t size)
+{
+	const int writtenBytes = hid_write(m_device.get(), data, size);
 	if (0 > writtenBytes) {
 		throw HidError(m_device.get());
 	}
@@ -76,15 +85,39 @@ Buffer HidDevice::read(size_t maxReadSize)
 Buffer HidDevice::readTimeout(size_t maxReadSize, int milliseconds)
 {
 	Buffer readData(maxReadSize);
+	readData.resize(readInto(readData.data(), readData.size(), milliseconds));
+	return readData;
+}
 
-	const int readDataLength = hid_read_timeout(m_device.get(), readData.data(), maxReadSize, milliseconds);
+size_t HidDevice::readInto(uint8_t* data, size_t size, int milliseconds)
+{
+	const int readDataLength = hid_read_timeout(m_device.get(), data, size, milliseconds);
 	if (0 == readDataLength) {
 		throw HidTimeoutError(m_device.get());
 	}
 	if (-1 == readDataLength) {
 		throw HidError(m_device.get());
 	}
-	readData.resize(readDataLength);
-	return readData;
+
+	return readDataLength;
+}
+
+size_t HidDevice::tryReadInto(uint8_t* data, size_t size)
+{
+	const int readDataLength = hid_read_timeout(m_device.get(), data, size, 0);
+	if (-1 == readDataLength) {
+		throw HidError(m_device.get());
+	}
+
+	return readDataLength;
+}
+
+int HidDevice::getFileDescriptor() const
+{
+#ifdef __linux__
+	return hid_hidraw_get_fd(m_device.get());
+#else
+	return -1;
+#endif
 }
 }
@@ -3,11 +3,12 @@
 #include <string>
 #include "Buffer.h"
 #include "hidapi/hidapi.h"
+#include "Transport.h"
 
 
 namespace joy_con_bridge
 {
-class HidDevice
+class HidDevice final : public Transport
 {
 	// This class suffers from a severe case of RAS syndrome.
 public:
@@ -56,6 +57,18 @@ public:
 	*/
 	size_t write(const Buffer& buffer);
 
+	/**
+		Writes data to the device, straight from the caller's memory.
+
+		@param[in] data The data to write.
+		@param[in] size The number of bytes to write.
+
+		@return The number of bytes written.
+
+		@throw HidError if writing fails.
+	*/
+	size_t write(const uint8_t* data, size_t size) override;
+
 	/**
 		Reads data from the device.
 
@@ -80,6 +93,41 @@ public:
 	*/
 	Buffer readTimeout(size_t maxReadSize, int milliseconds);
 
+	/**
+		Reads data from the device into the caller's memory, but waits for data no longer than a specific amount of
+		time. Unlike `readTimeout`, nothing is allocated.
+
+		@param[out] data Receives the data read from the device.
+		@param[in] size The size of `data`, which is also the read length limit.
+		@param[in] milliseconds The maximum amount of time, in milliseconds, to wait for data.
+
+		@return The number of bytes read.
+
+		@throw HidError if reading fails.
+		@throw HidTimeoutError if the timeout is reached.
+	*/
+	size_t readInto(uint8_t* data, size_t size, int milliseconds) override;
+
+	/**
+		Reads data from the device into the caller's memory, only if there is data waiting to be read.
+
+		@param[out] data Receives the data read from the device.
+		@param[in] size The size of `data`, which is also the read length limit.
+
+		@return The number of bytes read, or 0 if there was no data to read.
+
+		@throw HidError if reading fails.
+	*/
+	size_t tryReadInto(uint8_t* data, size_t size) override;
+
+	/**
+		Gets the file descriptor of the device, so it can be waited for along with other devices (with epoll, for
+		example). The descriptor belongs to the device and must not be closed or read from directly.
+
+		@return The file descriptor, or -1 if the HID backend doesn't have one (on Windows).
+	*/
+	int getFileDescriptor() const override;
+
 protected:
 	/// RAII wrapper for HID (device) pointers from hidapi.
 	using HidDevicePointer = std::shared_ptr<hid_device>;
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "InputSubscriptions.h"
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Calls a callback right away, or posts the call to an executor along with a copy of its arguments.
+*/
+template <typename Callback, typename... Args>
+static void deliver(const std::shared_ptr<const Callback>& callback, const Executor& executor, const Args&... args)
+{
+	if (!executor) {
+		(*callback)(args...);
+		return;
+	}
+
+	executor([callback, args...]() {
+		(*callback)(args...);
+	});
+}
+
+static float getDistance(const AnalogStick& first, const AnalogStick& second)
+{
+	return std::hypot(first.x - second.x, first.y - second.y);
+}
+
+InputSubscriptions::InputSubscriptions()
+	: m_nextId(1)
+	, m_isPublishing(false)
+	, m_subscribedButtons(0)
+	, m_hasStickSubscriptions(false)
+	, m_hasImuSubscriptions(false)
+	, m_previousLeftStick{}
+	, m_previousRightStick{}
+{}
+
+SubscriptionId InputSubscriptions::subscribeButtons(ButtonMask buttons, ButtonCallback callback, Executor executor)
+{
+	auto subscription = std::make_unique<Subscription>();
+	subscription->type = SubscriptionType::BUTTONS;
+	subscription->executor = std::move(executor);
+	subscription->buttons = buttons;
+	subscription->buttonCallback = std::make_shared<const ButtonCallback>(std::move(callback));
+	return add(std::move(subscription));
+}
+
+SubscriptionId InputSubscriptions::subscribeSticks(float threshold, StickCallback callback, Executor executor)
+{
+	if (!(threshold >= 0)) {
+		throw std::invalid_argument("The stick threshold must not be negative");
+	}
+
+	auto subscription = std::make_unique<Subscription>();
+	subscription->type = SubscriptionType::STICKS;
+	subscription->executor = std::move(executor);
+	subscription->threshold = threshold;
+	subscription->stickCallback = std::make_shared<const StickCallback>(std::move(callback));
+	return add(std::move(subscription));
+}
+
+SubscriptionId InputSubscriptions::subscribeImu(size_t reportsPerBatch, ImuCallback callback, Executor executor)
+{
+	if (0 == reportsPerBatch) {
+		throw std::invalid_argument("An IMU batch must hold at least one report");
+	}
+
+	auto subscription = std::make_unique<Subscription>();
+	subscription->type = SubscriptionType::IMU;
+	subscription->executor = std::move(executor);
+	subscription->samplesPerBatch = reportsPerBatch * IMU_SAMPLES_PER_REPORT;
+	subscription->batch.reserve(subscription->samplesPerBatch);
+	subscription->imuCallback = std::make_shared<const ImuCallback>(std::move(callback));
+	return add(std::move(subscription));
+}
+
+void InputSubscriptions::unsubscribe(SubscriptionId subscription)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_lock);
+
+	const auto found = std::find_if(m_subscriptions.begin(), m_subscriptions.end(),
+	                                [subscription](const auto& current) { return subscription == current->id; });
+	if (m_subscriptions.end() == found) {
+		return;
+	}
+
+	// A publish may be iterating over the subscriptions, further up the stack.
+	if (m_isPublishing) {
+		(*found)->isRemoved = true;
+	} else {
+		m_subscriptions.erase(found);
+	}
+	updateFilters();
+}
+
+void InputSubscriptions::publish(const JoyConState& state, bool hasImuSamples)
+{
+	const ButtonEdges& buttonEdges = state.buttonEdges;
+	const bool hasButtonChanges = 0 != ((buttonEdges.pressed() | buttonEdges.released()) &
+	                                    m_subscribedButtons.load(std::memory_order_relaxed));
+
+	const bool hasStickChanges = state.leftStick.x != m_previousLeftStick.x ||
+		state.leftStick.y != m_previousLeftStick.y ||
+		state.rightStick.x != m_previousRightStick.x ||
+		state.rightStick.y != m_previousRightStick.y;
+	m_previousLeftStick = state.leftStick;
+	m_previousRightStick = state.rightStick;
+
+	hasImuSamples = hasImuSamples && m_hasImuSubscriptions.load(std::memory_order_relaxed);
+	if (!hasButtonChanges && !(hasStickChanges && m_hasStickSubscriptions.load(std::memory_order_relaxed)) &&
+	    !hasImuSamples) {
+		return;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(m_lock);
+	m_isPublishing = true;
+	try {
+		// Subscriptions that are added by the callbacks start with the next report.
+		const size_t count = m_subscriptions.size();
+		for (size_t i = 0; i < count; ++i) {
+			if (!m_subscriptions[i]->isRemoved) {
+				publishTo(*m_subscriptions[i], state, hasButtonChanges, hasStickChanges, hasImuSamples);
+			}
+		}
+	} catch (...) {
+		m_isPublishing = false;
+		eraseRemoved();
+		throw;
+	}
+	m_isPublishing = false;
+	eraseRemoved();
+}
+
+SubscriptionId InputSubscriptions::add(std::unique_ptr<Subscription> subscription)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_lock);
+
+	subscription->id = m_nextId++;
+	const SubscriptionId id = subscription->id;
+	m_subscriptions.push_back(std::move(subscription));
+	updateFilters();
+	return id;
+}
+
+void InputSubscriptions::updateFilters()
+{
+	ButtonMask subscribedButtons = 0;
+	bool hasStickSubscriptions = false;
+	bool hasImuSubscriptions = false;
+	for (const auto& subscription : m_subscriptions) {
+		if (subscription->isRemoved) {
+			continue;
+		}
+
+		switch (subscription->type) {
+		case SubscriptionType::BUTTONS:
+			subscribedButtons |= subscription->buttons;
+			break;
+		case SubscriptionType::STICKS:
+			hasStickSubscriptions = true;
+			break;
+		case SubscriptionType::IMU:
+			hasImuSubscriptions = true;
+			break;
+		}
+	}
+
+	m_subscribedButtons.store(subscribedButtons, std::memory_order_relaxed);
+	m_hasStickSubscriptions.store(hasStickSubscriptions, std::memory_order_relaxed);
+	m_hasImuSubscriptions.store(hasImuSubscriptions, std::memory_order_relaxed);
+}
+
+void InputSubscriptions::publishTo(Subscription& subscription, const JoyConState& state, bool hasButtonChanges,
+                                   bool hasStickChanges, bool hasImuSamples)
+{
+	switch (subscription.type) {
+	case SubscriptionType::BUTTONS: {
+		const ButtonEdges& buttonEdges = state.buttonEdges;
+		if (hasButtonChanges && 0 != ((buttonEdges.pressed() | buttonEdges.released()) & subscription.buttons)) {
+			deliver(subscription.buttonCallback, subscription.executor, buttonEdges);
+		}
+		break;
+	}
+
+	case SubscriptionType::STICKS:
+		if (!hasStickChanges) {
+			break;
+		}
+		if (subscription.hasReportedSticks &&
+		    getDistance(state.leftStick, subscription.reportedLeftStick) <= subscription.threshold &&
+		    getDistance(state.rightStick, subscription.reportedRightStick) <= subscription.threshold) {
+			break;
+		}
+		subscription.hasReportedSticks = true;
+		subscription.reportedLeftStick = state.leftStick;
+		subscription.reportedRightStick = state.rightStick;
+		deliver(subscription.stickCallback, subscription.executor, state.leftStick, state.rightStick);
+		break;
+
+	case SubscriptionType::IMU:
+		if (!hasImuSamples) {
+			break;
+		}
+		subscription.batch.insert(subscription.batch.end(), state.imuSamples.begin(), state.imuSamples.end());
+		if (subscription.batch.size() >= subscription.samplesPerBatch) {
+			deliver(subscription.imuCallback, subscription.executor, subscription.batch);
+			subscription.batch.clear();
+		}
+		break;
+	}
+}
+
+void InputSubscriptions::eraseRemoved()
+{
+	m_subscriptions.erase(std::remove_if(m_subscriptions.begin(), m_subscriptions.end(),
+	                                     [](const auto& subscription) { return subscription->isRemoved; }),
+	                      m_subscriptions.end());
+}
+}
@@ -0,0 +1,159 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "decode.h"
+#include "EventQueue.h"
+
+
+namespace joy_con_bridge
+{
+using SubscriptionId = uint64_t;
+
+// Called with the buttons of a report in which any of the subscribed buttons was pressed or released.
+using ButtonCallback = std::function<void(const ButtonEdges& buttonEdges)>;
+// Called with both sticks, once either of them moved far enough since the previous call.
+using StickCallback = std::function<void(const AnalogStick& leftStick, const AnalogStick& rightStick)>;
+// Called with the IMU samples of a batch of reports, oldest first.
+using ImuCallback = std::function<void(const std::vector<ImuSample>& samples)>;
+
+/**
+	@brief Calls back subscribers when the input of a JoyCon changes, instead of having them compare every report.
+
+	Reports are filtered before anything else is done with them: a report that changes nothing anyone subscribed to
+	costs a mask compare and a stick compare, without taking a lock. Each subscriber is either called right away, on
+	the thread that applies the reports (the one that polls the JoyCon, or the reader thread), or has its calls posted
+	to an executor, like that of an `EventQueue`.
+
+	Subscribing and unsubscribing may be done from any thread, including from a callback.
+*/
+class InputSubscriptions
+{
+public:
+	InputSubscriptions();
+
+	/**
+		@brief Subscribes to presses and releases of buttons.
+
+		@param[in] buttons The buttons to be called back for. See `button_bits`.
+		@param[in] callback Called with the buttons of each report in which any of `buttons` was pressed or released.
+		@param[in] executor Where to call `callback`. If empty, it is called right away, on the polling thread.
+
+		@return The ID of the subscription, for `unsubscribe`.
+	*/
+	SubscriptionId subscribeButtons(ButtonMask buttons, ButtonCallback callback, Executor executor = nullptr);
+
+	/**
+		@brief Subscribes to movements of the analog sticks.
+
+		@param[in] threshold How far either stick must move since the previous call, for another call. In calibrated
+		                     units, where the full range of an axis is [-1, 1].
+		@param[in] callback Called with both sticks. The first call is on the first report in which a stick moved.
+		@param[in] executor See `subscribeButtons`.
+
+		@return The ID of the subscription, for `unsubscribe`.
+
+		@throws std::invalid_argument If the threshold is negative.
+	*/
+	SubscriptionId subscribeSticks(float threshold, StickCallback callback, Executor executor = nullptr);
+
+	/**
+		@brief Subscribes to the IMU samples, in batches.
+
+		@param[in] reportsPerBatch The number of reports whose samples are gathered into each call.
+		@param[in] callback Called with `reportsPerBatch * IMU_SAMPLES_PER_REPORT` samples, oldest first.
+		@param[in] executor See `subscribeButtons`.
+
+		@return The ID of the subscription, for `unsubscribe`.
+
+		@throws std::invalid_argument If `reportsPerBatch` is 0.
+	*/
+	SubscriptionId subscribeImu(size_t reportsPerBatch, ImuCallback callback, Executor executor = nullptr);
+
+	/**
+		@brief Stops calling a subscriber. Calls that were already posted to its executor still run.
+		Unknown IDs are ignored.
+	*/
+	void unsubscribe(SubscriptionId subscription);
+
+	/**
+		@brief Calls back the subscribers that are interested in a report. Called by the JoyCon for each report it
+		applies, from the polling thread.
+
+		@param[in] state The state after the report was applied.
+		@param[in] hasImuSamples Whether the report carried IMU samples.
+	*/
+	void publish(const JoyConState& state, bool hasImuSamples);
+
+private:
+	enum class SubscriptionType
+	{
+		BUTTONS,
+		STICKS,
+		IMU
+	};
+
+	/*
+	 * A subscriber, with whatever it takes to filter the reports for it. Only the fields of its type are used.
+	 * The callbacks are shared with the calls that are posted to the executor.
+	 */
+	struct Subscription
+	{
+		SubscriptionId id;
+		SubscriptionType type;
+		Executor executor;
+		bool isRemoved; // Unsubscribed during a publish. It is erased once the publish is done.
+
+		ButtonMask buttons;
+		std::shared_ptr<const ButtonCallback> buttonCallback;
+
+		float threshold;
+		bool hasReportedSticks;
+		AnalogStick reportedLeftStick; // As of the previous call.
+		AnalogStick reportedRightStick;
+		std::shared_ptr<const StickCallback> stickCallback;
+
+		size_t samplesPerBatch;
+		std::vector<ImuSample> batch;
+		std::shared_ptr<const ImuCallback> imuCallback;
+	};
+
+	/**
+		@brief Adds a subscription and starts publishing to it.
+	*/
+	SubscriptionId add(std::unique_ptr<Subscription> subscription);
+
+	/**
+		@brief Recalculates what the reports are filtered by, from the subscriptions. The lock must be held.
+	*/
+	void updateFilters();
+
+	void publishTo(Subscription& subscription, const JoyConState& state, bool hasButtonChanges, bool hasStickChanges,
+	               bool hasImuSamples);
+
+	/**
+		@brief Erases the subscriptions that were removed during a publish. The lock must be held.
+	*/
+	void eraseRemoved();
+
+	// Recursive, so callbacks that are called right away may subscribe and unsubscribe.
+	std::recursive_mutex m_lock;
+	// Subscriptions are not moved when others are added, so a running callback is never moved.
+	std::vector<std::unique_ptr<Subscription>> m_subscriptions;
+	SubscriptionId m_nextId;
+	bool m_isPublishing;
+
+	// What the reports are filtered by, read without the lock.
+	std::atomic<ButtonMask> m_subscribedButtons;
+	std::atomic<bool> m_hasStickSubscriptions;
+	std::atomic<bool> m_hasImuSubscriptions;
+
+	// The sticks of the previous report. Only touched by the polling thread.
+	AnalogStick m_previousLeftStick;
+	AnalogStick m_previousRightStick;
+};
+}
@@ -1,9 +1,13 @@
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <deque>
 #include "JoyCon.h"
 #include "command_ids.h"
 #include "exceptions.h"
 #include "hidapi.h"
 #include "HidDevice.h"
+#include "MappedFile.h"
 #include "protocol.h"
 
 
@@ -11,17 +15,56 @@ using namespace joy_con_bridge::command_ids;
 
 namespace joy_con_bridge
 {
-const float PI = 3.141592654f;
 
-JoyCon::JoyCon(HidDevice device, Hand hand)
-	: m_device(std::move(device))
-	, m_buttons{}
-	, m_leftStick{}
-	, m_rightStick{}
-	, m_gyroscope{}
-	, m_accelerometer{}
+const uint32_t FACTORY_CALIBRATION_LEFT_STICK_OFFSET  = 0x603D;
+const uint32_t FACTORY_CALIBRATION_RIGHT_STICK_OFFSET = 0x6046;
+const uint32_t FACTORY_CALIBRATION_SENSORS_OFFSET     = 0x6020;
+const uint32_t USER_CALIBRATION_LEFT_STICK_OFFSET     = 0x8012;
+const uint32_t USER_CALIBRATION_RIGHT_STICK_OFFSET    = 0x801D;
+const uint32_t USER_CALIBRATION_SENSORS_OFFSET        = 0x8028;
+const uint16_t USER_CALIBRATION_EXISTS_MAGIC          = 0xA1B2;
+// The magics in front of all the user calibration blocks are covered by a single read of this range.
+const uint32_t USER_CALIBRATION_MAGICS_START =
+	USER_CALIBRATION_LEFT_STICK_OFFSET - sizeof(USER_CALIBRATION_EXISTS_MAGIC);
+const uint8_t USER_CALIBRATION_MAGICS_SIZE   = USER_CALIBRATION_SENSORS_OFFSET - USER_CALIBRATION_MAGICS_START;
+// Each kind of calibration is a single contiguous range, from the sensors block to the right stick block (factory)
+// or from the first magic to the sensors block (user).
+const SpiRange FACTORY_CALIBRATION_RANGE = {
+	FACTORY_CALIBRATION_SENSORS_OFFSET,
+	FACTORY_CALIBRATION_RIGHT_STICK_OFFSET + STICK_CALIBRATION_DATA_SIZE - FACTORY_CALIBRATION_SENSORS_OFFSET
+};
+const SpiRange USER_CALIBRATION_RANGE = {
+	USER_CALIBRATION_MAGICS_START,
+	USER_CALIBRATION_SENSORS_OFFSET + SENSOR_CALIBRATION_DATA_SIZE - USER_CALIBRATION_MAGICS_START
+};
+// A read that keeps getting the reply of another read is given up on after this many attempts.
+const unsigned MAX_SPI_READ_ATTEMPTS = 3;
+
+JoyCon::JoyCon(HidDevice device, Hand hand, std::shared_ptr<CalibrationCache> calibrationCache)
+	: JoyCon(std::make_shared<HidDevice>(std::move(device)), hand, std::move(calibrationCache))
+{}
+
+JoyCon::JoyCon(std::shared_ptr<Transport> transport, Hand hand, std::shared_ptr<CalibrationCache> calibrationCache)
+	: m_transport(std::move(transport))
+	, m_metrics(std::make_shared<JoyConMetrics>())
+	, m_healthMonitor(std::make_shared<HealthMonitor>())
+	, m_subcommands(std::make_shared<SubcommandChannel>(m_transport, m_metrics))
+	, m_inputSubscriptions(std::make_shared<InputSubscriptions>())
+	, m_rumble(std::make_shared<RumbleStreamer>(m_subcommands, m_healthMonitor, m_metrics))
+	, m_reportBuffer{}
+	, m_state{}
 	, m_calibrationData{}
+	, m_leftStickCalibration()
+	, m_rightStickCalibration()
+	, m_rawCalibrationData{}
+	, m_calibrationCache(std::move(calibrationCache))
+	, m_calibrationRereads()
+	, m_calibrationRereadAttempts(0)
 	, m_likelyHand(hand)
+	, m_lastBacklogDepth(0)
+	, m_maxBacklogDepth(0)
+	, m_reportClock()
+	, m_gyroscopeBiasEstimator()
 {
 	sendSubcommand(SUBCOMMAND_REPORT_MODE, {SUBCOMMAND_OPTION_REPORT_MODE_SIMPLE_HID});
 	updateCalibrationData();
@@ -32,50 +75,109 @@ JoyCon::JoyCon(HidDevice device, Hand hand)
 
 void JoyCon::poll()
 {
-	static const auto READ_TIMEOUT = 5000;
+	if (!poll(NOT_RESPONDING_TIMEOUT)) {
+		throw JoyConNotResponding();
+	}
+}
 
-	Buffer reportBuffer;
-	do {
+bool JoyCon::poll(std::chrono::milliseconds timeout)
+{
+	while (true) {
 		try {
-			reportBuffer = m_device.readTimeout(sizeof(protocol::StandardFullInputReport), READ_TIMEOUT);
+			m_transport->readInto(m_reportBuffer.data(), m_reportBuffer.size(), static_cast<int>(timeout.count()));
 		} catch (HidTimeoutError&) {
-			throw JoyConNotResponding();
+			handlePendingWork();
+			return false;
 		}
-	} while (
-		reportBuffer[0] != PACKET_TYPE_STANDARD &&
-		reportBuffer[0] != PACKET_TYPE_BUTTONS_AND_IMU &&
-		reportBuffer[0] != PACKET_TYPE_NFC
-	);
+		if (isInputReportBuffered()) {
+			break;
+		}
+		m_metrics->recordDiscardedPacket();
+	}
+
+	applyBufferedReport();
+	handlePendingWork();
+	return true;
+}
+
+size_t JoyCon::pollAll()
+{
+	return pollAll([](const JoyConState&) {});
+}
+
+size_t JoyCon::getLastBacklogDepth() const
+{
+	return m_lastBacklogDepth;
+}
+
+size_t JoyCon::getMaxBacklogDepth() const
+{
+	return m_maxBacklogDepth;
+}
 
-	auto report = reinterpret_cast<protocol::StandardFullInputReport*>(reportBuffer.data());
-	updateButtons(report);
-	updateAnalogSticks(report);
-	updateSensors(report);
+std::chrono::microseconds JoyCon::getReportJitter() const
+{
+	return m_reportClock.getJitter();
+}
+
+std::chrono::steady_clock::duration JoyCon::getClockOffset() const
+{
+	return m_reportClock.getClockOffset();
+}
+
+std::shared_ptr<const JoyConMetrics> JoyCon::getMetrics() const
+{
+	return m_metrics;
+}
+
+Health JoyCon::getHealth() const noexcept
+{
+	return m_healthMonitor->getHealth();
+}
+
+GyroscopeBias JoyCon::getGyroscopeBias() const
+{
+	return m_gyroscopeBiasEstimator.getBias();
+}
+
+const JoyConState& JoyCon::getState() const
+{
+	return m_state;
 }
 
 ButtonsState JoyCon::getButtonsState() const
 {
-	return m_buttons;
+	return m_state.buttons;
+}
+
+ButtonEdges JoyCon::getButtonEdges() const
+{
+	return m_state.buttonEdges;
 }
 
 AnalogStick JoyCon::getLeftStick() const
 {
-	return m_leftStick;
+	return m_state.leftStick;
 }
 
 AnalogStick JoyCon::getRightStick() const
 {
-	return m_rightStick;
+	return m_state.rightStick;
 }
 
 ThreeAxesSensor JoyCon::getGyroscope() const
 {
-	return m_gyroscope;
+	return m_state.gyroscope;
 }
 
 ThreeAxesSensor JoyCon::getAccelerometer() const
 {
-	return m_accelerometer;
+	return m_state.accelerometer;
+}
+
+const ImuSamples& JoyCon::getImuSamples() const
+{
+	return m_state.imuSamples;
 }
 
 Hand JoyCon::getLikelyHand() const
@@ -83,6 +185,27 @@ Hand JoyCon::getLikelyHand() const
 	return m_likelyHand;
 }
 
+const Transport& JoyCon::getTransport() const
+{
+	return *m_transport;
+}
+
+const RawCalibrationData& JoyCon::getRawCalibrationData() const
+{
+	return m_rawCalibrationData;
+}
+
+void JoyCon::setStickProfile(const StickProfile& profile)
+{
+	m_leftStickCalibration.setProfile(profile);
+	m_rightStickCalibration.setProfile(profile);
+}
+
+const StickProfile& JoyCon::getStickProfile() const
+{
+	return m_leftStickCalibration.getProfile();
+}
+
 void JoyCon::setPlayerLedsByNumber(unsigned int playerNumber)
 {
 	using protocol::LedState;
@@ -124,251 +247,471 @@ void JoyCon::setPlayerLeds(protocol::LedState led1, protocol::LedState led2, pro
 	sendSubcommand(SUBCOMMAND_SET_PLAYER_LED, {ledSequence});
 }
 
-Buffer JoyCon::sendSubcommand(uint8_t subcommandId, const Buffer& commandData)
+std::future<Buffer> JoyCon::sendSubcommandAsync(uint8_t subcommandId, const Buffer& commandData,
+                                                const SubcommandBudget& budget)
 {
-	static const auto PACKET_SKIP_LIMIT = 100; // The limit to the amount of garbage packets that is acceptable.
-	const auto command = protocol::getSubCommandBuffer(COMMAND_START_SUBCOMMAND, subcommandId, commandData);
-	m_device.write(command);
+	return m_subcommands->send(COMMAND_START_SUBCOMMAND, subcommandId, commandData, budget);
+}
 
-	size_t packetsRead = 0;
-	// Wait until receiving an ACK.
-	try {
-		while (PACKET_SKIP_LIMIT > packetsRead) {
-			auto response = m_device.readTimeout(sizeof(protocol::StandardFullInputReport), 500);
-			++packetsRead;
-			auto report = reinterpret_cast<protocol::StandardInputReport*>(response.data());
-			if (PACKET_TYPE_STANDARD == report->id && report->ack && subcommandId == report->replyToSubcommandId) {
-				if (0 == report->dataType) {
-					// simple ACK, no readResult.
-					return Buffer();
-				}
-				return Buffer(report->data, report->data + sizeof(report->data));
-			}
+void JoyCon::setRumble(const Rumble& rumble)
+{
+	m_rumble->set(rumble);
+}
+
+void JoyCon::stopRumble()
+{
+	m_rumble->stop();
+}
+
+SubscriptionId JoyCon::subscribeButtons(ButtonMask buttons, ButtonCallback callback, Executor executor)
+{
+	return m_inputSubscriptions->subscribeButtons(buttons, std::move(callback), std::move(executor));
+}
+
+SubscriptionId JoyCon::subscribeSticks(float threshold, StickCallback callback, Executor executor)
+{
+	return m_inputSubscriptions->subscribeSticks(threshold, std::move(callback), std::move(executor));
+}
+
+SubscriptionId JoyCon::subscribeImu(size_t reportsPerBatch, ImuCallback callback, Executor executor)
+{
+	return m_inputSubscriptions->subscribeImu(reportsPerBatch, std::move(callback), std::move(executor));
+}
+
+void JoyCon::unsubscribe(SubscriptionId subscription)
+{
+	m_inputSubscriptions->unsubscribe(subscription);
+}
+
+Buffer JoyCon::readSpiRange(uint32_t offset, size_t size)
+{
+	return std::move(readSpiRanges({{offset, size}}).front());
+}
+
+std::vector<Buffer> JoyCon::readSpiRanges(const std::vector<SpiRange>& ranges)
+{
+	std::vector<SpiRange> sortedRanges = ranges;
+	std::sort(sortedRanges.begin(), sortedRanges.end(), [](const SpiRange& first, const SpiRange& second) {
+		return first.offset < second.offset;
+	});
+
+	std::vector<SpiRange> mergedRanges;
+	for (const SpiRange& range : sortedRanges) {
+		if (!mergedRanges.empty() && range.offset <= mergedRanges.back().offset + mergedRanges.back().size) {
+			SpiRange& lastRange = mergedRanges.back();
+			lastRange.size = std::max(lastRange.size, range.offset + range.size - lastRange.offset);
+		} else {
+			mergedRanges.push_back(range);
 		}
-	} catch (const HidTimeoutError&) {
-		// intentionally empty
 	}
 
-	throw JoyConNotResponding();
+	std::vector<Buffer> mergedData;
+	std::vector<SpiChunk> chunks;
+	mergedData.reserve(mergedRanges.size());
+	for (const SpiRange& range : mergedRanges) {
+		mergedData.emplace_back(range.size);
+		splitSpiRange(range.offset, range.size, mergedData.back().data(), chunks);
+	}
+	readSpiChunks(chunks);
+
+	std::vector<Buffer> data;
+	data.reserve(ranges.size());
+	for (const SpiRange& range : ranges) {
+		const auto merged = std::find_if(mergedRanges.cbegin(), mergedRanges.cend(), [&range](const SpiRange& merged) {
+			return merged.offset <= range.offset && range.offset + range.size <= merged.offset + merged.size;
+		});
+		const auto rangeStart = mergedData[merged - mergedRanges.cbegin()].cbegin() + (range.offset - merged->offset);
+		data.emplace_back(rangeStart, rangeStart + range.size);
+	}
+
+	return data;
 }
 
-Buffer JoyCon::readSpi(uint32_t offset, uint8_t size)
+SpiDumpStatistics JoyCon::dumpSpiFlash(const std::string& path)
 {
-	const protocol::SpiReadCommandParameters parameters = {offset, size};
-	Buffer parametersBuffer;
-	dumpToBuffer(parametersBuffer, parameters);
+	MappedFile image(path, SPI_FLASH_SIZE);
 
-	const Buffer response = sendSubcommand(SUBCOMMAND_SPI_READ, parametersBuffer);
-	// the response echos the parameter buffer, we're skipping that readResult.
-	const auto actualDataStart = response.cbegin() + parametersBuffer.size();
-	return Buffer(actualDataStart, actualDataStart + size);
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<SpiChunk> chunks;
+	splitSpiRange(0, SPI_FLASH_SIZE, image.data(), chunks);
+	readSpiChunks(chunks);
+	const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start);
+
+	image.flush();
+
+	const double seconds = std::chrono::duration<double>(duration).count();
+	return {SPI_FLASH_SIZE, duration, seconds > 0 ? SPI_FLASH_SIZE / seconds : 0};
 }
 
-void JoyCon::updateButtons(const protocol::StandardFullInputReport* report)
-{
-	m_buttons.a          = report->buttonStatusRight.a;
-	m_buttons.b          = report->buttonStatusRight.b;
-	m_buttons.x          = report->buttonStatusRight.x;
-	m_buttons.y          = report->buttonStatusRight.y;
-	m_buttons.r          = report->buttonStatusRight.r;
-	m_buttons.zr         = report->buttonStatusRight.zr;
-	m_buttons.rightStick = report->buttonStatusShared.rightStick;
-	m_buttons.plus       = report->buttonStatusShared.plus;
-	m_buttons.home       = report->buttonStatusShared.home;
-	m_buttons.srRight    = report->buttonStatusRight.sr;
-	m_buttons.slRight    = report->buttonStatusRight.sl;
-	m_buttons.up         = report->buttonStatusLeft.up;
-	m_buttons.down       = report->buttonStatusLeft.down;
-	m_buttons.left       = report->buttonStatusLeft.left;
-	m_buttons.right      = report->buttonStatusLeft.right;
-	m_buttons.l          = report->buttonStatusLeft.l;
-	m_buttons.zl         = report->buttonStatusLeft.zl;
-	m_buttons.leftStick  = report->buttonStatusShared.leftStick;
-	m_buttons.minus      = report->buttonStatusShared.minus;
-	m_buttons.capture    = report->buttonStatusShared.capture;
-	m_buttons.srLeft     = report->buttonStatusLeft.sr;
-	m_buttons.slLeft     = report->buttonStatusLeft.sl;
+Buffer JoyCon::sendSubcommand(uint8_t subcommandId, const Buffer& commandData)
+{
+	auto reply = sendSubcommandAsync(subcommandId, commandData);
+	waitForReply(reply);
+	return reply.get();
 }
 
-void JoyCon::updateCalibrationData()
+void JoyCon::waitForReply(std::future<Buffer>& reply)
 {
-	static const auto FACTORY_CALIBRATION_LEFT_STICK_OFFSET  = 0x603D;
-	static const auto FACTORY_CALIBRATION_RIGHT_STICK_OFFSET = 0x6046;
-	static const auto FACTORY_CALIBRATION_SENSORS_OFFSET     = 0x6020;
-	static const auto USER_CALIBRATION_LEFT_STICK_OFFSET     = 0x8012;
-	static const auto USER_CALIBRATION_RIGHT_STICK_OFFSET    = 0x801D;
-	static const auto USER_CALIBRATION_SENSORS_OFFSET        = 0x8028;
-	static const auto STICK_CALIBRATION_DATA_SIZE            = 9;
-	static const auto SENSOR_CALIBRATION_DATA_SIZE           = 2 * sizeof(ThreeAxesCalibrationData);
-
-	std::optional<Buffer> optionalUserData = readUserCalibrationData(USER_CALIBRATION_LEFT_STICK_OFFSET,
-	                                                                 STICK_CALIBRATION_DATA_SIZE);
-	Buffer leftStickCalibrationData;
-	if (optionalUserData) {
-		leftStickCalibrationData = std::move(*optionalUserData);
-	} else {
-		leftStickCalibrationData = readSpi(FACTORY_CALIBRATION_LEFT_STICK_OFFSET, STICK_CALIBRATION_DATA_SIZE);
+	static const auto READ_TIMEOUT = 50;
+
+	// Keep applying reports until the reply arrives, or until the channel gives up on it.
+	while (std::future_status::ready != reply.wait_for(std::chrono::seconds(0))) {
+		try {
+			m_transport->readInto(m_reportBuffer.data(), m_reportBuffer.size(), READ_TIMEOUT);
+			if (isInputReportBuffered()) {
+				applyBufferedReport();
+			} else {
+				m_metrics->recordDiscardedPacket();
+			}
+		} catch (const HidTimeoutError&) {
+			// intentionally empty, the channel decides when to give up.
+		}
+		m_subcommands->handleTimeouts();
 	}
+}
 
-	optionalUserData = readUserCalibrationData(USER_CALIBRATION_RIGHT_STICK_OFFSET, STICK_CALIBRATION_DATA_SIZE);
-	Buffer rightStickCalibrationData;
-	if (optionalUserData) {
-		rightStickCalibrationData = std::move(*optionalUserData);
-	} else {
-		rightStickCalibrationData = readSpi(FACTORY_CALIBRATION_RIGHT_STICK_OFFSET, STICK_CALIBRATION_DATA_SIZE);
+void JoyCon::splitSpiRange(uint32_t offset, size_t size, uint8_t* destination, std::vector<SpiChunk>& chunks)
+{
+	for (size_t chunkStart = 0; chunkStart < size; chunkStart += MAX_SPI_READ_SIZE) {
+		const auto chunkSize = static_cast<uint8_t>(std::min(MAX_SPI_READ_SIZE, size - chunkStart));
+		chunks.push_back({static_cast<uint32_t>(offset + chunkStart), chunkSize, destination + chunkStart});
 	}
+}
 
-	optionalUserData = readUserCalibrationData(USER_CALIBRATION_SENSORS_OFFSET, SENSOR_CALIBRATION_DATA_SIZE);
-	Buffer sensorsCalibrationData;
-	if (optionalUserData) {
-		sensorsCalibrationData = std::move(*optionalUserData);
-	} else {
-		sensorsCalibrationData = readSpi(FACTORY_CALIBRATION_SENSORS_OFFSET, SENSOR_CALIBRATION_DATA_SIZE);
+void JoyCon::readSpiChunks(const std::vector<SpiChunk>& chunks)
+{
+	struct PendingRead
+	{
+		size_t chunk;
+		std::future<Buffer> reply;
+	};
+
+	std::deque<size_t> queuedChunks;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		queuedChunks.push_back(i);
 	}
+	std::vector<bool> isChunkDone(chunks.size(), false);
+	size_t doneCount = 0;
+	std::vector<unsigned> attempts(chunks.size(), 0);
+	std::deque<PendingRead> pendingReads;
+
+	// Replies are matched to reads in the order they were sent. Once a reply is lost, the following ones reach the
+	// wrong reads, so each reply's data is placed by the range it echoes, and reads that did not get their own data
+	// are sent again.
+	const auto placeReply = [&](const Buffer& reply) {
+		const auto parameters = getSpiReadReplyParameters(reply);
+		if (!parameters) {
+			return;
+		}
+		const auto chunk = std::lower_bound(chunks.cbegin(), chunks.cend(), parameters->readOffset,
+		                                    [](const SpiChunk& chunk, uint32_t offset) {
+			                                    return chunk.offset < offset;
+		                                    });
+		if (chunks.cend() == chunk || chunk->offset != parameters->readOffset || chunk->size != parameters->readSize ||
+			isChunkDone[chunk - chunks.cbegin()]) {
+			return;
+		}
 
-	const auto factoryCalibrationValuesLeft = protocol::decodeStickCalibrationData(leftStickCalibrationData.data());
-	updateLeftStickCalibrationData(factoryCalibrationValuesLeft);
+		const auto data = reply.cbegin() + sizeof(protocol::SpiReadCommandParameters);
+		std::copy(data, data + chunk->size, chunk->destination);
+		isChunkDone[chunk - chunks.cbegin()] = true;
+		++doneCount;
+	};
 
-	const auto factoryCalibrationValuesRight = protocol::decodeStickCalibrationData(rightStickCalibrationData.data());
-	updateRightStickCalibrationData(factoryCalibrationValuesRight);
+	while (doneCount < chunks.size()) {
+		while (pendingReads.size() < SPI_READS_IN_FLIGHT && !queuedChunks.empty()) {
+			const size_t chunk = queuedChunks.front();
+			queuedChunks.pop_front();
+			if (isChunkDone[chunk]) {
+				continue;
+			}
+			++attempts[chunk];
+			pendingReads.push_back({
+				chunk,
+				sendSubcommandAsync(SUBCOMMAND_SPI_READ,
+				                    getSpiReadCommandData(chunks[chunk].offset, chunks[chunk].size))
+			});
+		}
 
-	const auto rawAccelerometerDataStart = sensorsCalibrationData.data();
-	const auto rawGyroscopeDataStart = rawAccelerometerDataStart + sizeof(ThreeAxesCalibrationData);
-	ThreeAxesCalibrationData data{};
-	std::memcpy(&data, rawAccelerometerDataStart, sizeof(data));
-	updateAccelerometerCalibrationData(data);
-	std::memcpy(&data, rawGyroscopeDataStart, sizeof(data));
-	updateGyroscopeCalibrationData(data);
+		// The oldest read is always the next to complete.
+		PendingRead read = std::move(pendingReads.front());
+		pendingReads.pop_front();
+		waitForReply(read.reply);
+		try {
+			placeReply(read.reply.get());
+		} catch (const JoyConNotResponding&) {
+			// intentionally empty, the chunk may still have been answered out of turn.
+		}
+
+		if (!isChunkDone[read.chunk]) {
+			if (MAX_SPI_READ_ATTEMPTS <= attempts[read.chunk]) {
+				throw JoyConNotResponding();
+			}
+			queuedChunks.push_back(read.chunk);
+		}
+	}
+
+	// Reads that were answered out of turn are still waiting for a reply. Let them complete, so they don't take the
+	// replies of later SPI reads.
+	for (PendingRead& read : pendingReads) {
+		waitForReply(read.reply);
+	}
 }
 
-void JoyCon::updateLeftStickCalibrationData(const std::array<uint16_t, 6>& rawCalibrationValues)
+Buffer JoyCon::getSpiReadCommandData(uint32_t offset, uint8_t size)
 {
-	m_calibrationData.leftStick.x.center         = rawCalibrationValues[2];
-	m_calibrationData.leftStick.x.maxAboveCenter = m_calibrationData.leftStick.x.center + rawCalibrationValues[0];
-	m_calibrationData.leftStick.x.minBelowCenter = m_calibrationData.leftStick.x.center - rawCalibrationValues[4];
-
-	m_calibrationData.leftStick.y.center         = rawCalibrationValues[3];
-	m_calibrationData.leftStick.y.maxAboveCenter = m_calibrationData.leftStick.y.center + rawCalibrationValues[1];
-	m_calibrationData.leftStick.y.minBelowCenter = m_calibrationData.leftStick.y.center - rawCalibrationValues[5];
+	const protocol::SpiReadCommandParameters parameters = {offset, size};
+	Buffer parametersBuffer;
+	dumpToBuffer(parametersBuffer, parameters);
+	return parametersBuffer;
 }
 
-void JoyCon::updateRightStickCalibrationData(const std::array<uint16_t, 6>& rawCalibrationValues)
+Buffer JoyCon::getSpiReadResult(const Buffer& reply, uint32_t offset, uint8_t size)
 {
-	m_calibrationData.rightStick.x.center         = rawCalibrationValues[0];
-	m_calibrationData.rightStick.x.maxAboveCenter = m_calibrationData.rightStick.x.center + rawCalibrationValues[4];
-	m_calibrationData.rightStick.x.minBelowCenter = m_calibrationData.rightStick.x.center - rawCalibrationValues[2];
+	// The reply echoes the range it is for, which tells a reply that reached the wrong read.
+	const auto parameters = getSpiReadReplyParameters(reply);
+	if (!parameters || offset != parameters->readOffset || size != parameters->readSize) {
+		throw JoyConBadReply();
+	}
 
-	m_calibrationData.rightStick.y.center         = rawCalibrationValues[1];
-	m_calibrationData.rightStick.y.maxAboveCenter = m_calibrationData.rightStick.y.center + rawCalibrationValues[5];
-	m_calibrationData.rightStick.y.minBelowCenter = m_calibrationData.rightStick.y.center - rawCalibrationValues[3];
+	// the reply echos the parameters, we're skipping them.
+	const auto actualDataStart = reply.cbegin() + sizeof(protocol::SpiReadCommandParameters);
+	return Buffer(actualDataStart, actualDataStart + size);
 }
 
-void JoyCon::updateAccelerometerCalibrationData(const ThreeAxesCalibrationData& data)
+std::optional<protocol::SpiReadCommandParameters> JoyCon::getSpiReadReplyParameters(const Buffer& reply)
 {
-	static const float G = 9.8f;
+	protocol::SpiReadCommandParameters parameters{};
+	if (reply.size() < sizeof(parameters)) {
+		return std::nullopt;
+	}
 
-	m_calibrationData.accelerometerCoeff = {
-		1.0f / static_cast<float>(data.sensitivityOffset.x - data.neutral.x) * 4 * G,
-		1.0f / static_cast<float>(data.sensitivityOffset.y - data.neutral.y) * 4 * G,
-		1.0f / static_cast<float>(data.sensitivityOffset.z - data.neutral.z) * 4 * G
-	};
+	std::memcpy(&parameters, reply.data(), sizeof(parameters));
+	if (reply.size() < sizeof(parameters) + parameters.readSize) {
+		return std::nullopt;
+	}
+	return parameters;
 }
 
-void JoyCon::updateGyroscopeCalibrationData(const ThreeAxesCalibrationData& data)
+void JoyCon::handlePendingWork()
 {
-	static const float ONE_DEGREE_IN_RADIANS = PI / 180;
+	m_subcommands->handleTimeouts();
+	verifyCachedCalibration();
+}
 
-	m_calibrationData.gyroscopeCoeff = {
-		1.0f / static_cast<float>(data.sensitivityOffset.x - data.neutral.x) * ONE_DEGREE_IN_RADIANS,
-		1.0f / static_cast<float>(data.sensitivityOffset.y - data.neutral.y) * ONE_DEGREE_IN_RADIANS,
-		1.0f / static_cast<float>(data.sensitivityOffset.z - data.neutral.z) * ONE_DEGREE_IN_RADIANS
-	};
+bool JoyCon::pollAvailable()
+{
+	while (0 != m_transport->tryReadInto(m_reportBuffer.data(), m_reportBuffer.size())) {
+		if (isInputReportBuffered()) {
+			applyBufferedReport();
+			return true;
+		}
+		m_metrics->recordDiscardedPacket();
+	}
+
+	return false;
 }
 
-std::optional<Buffer> JoyCon::readUserCalibrationData(uint32_t offset, uint8_t size)
+bool JoyCon::isInputReportBuffered() const
 {
-	static const uint16_t DATA_EXISTS_MAGIC = 0xA1B2;
+	return m_reportBuffer[0] == PACKET_TYPE_STANDARD ||
+		m_reportBuffer[0] == PACKET_TYPE_BUTTONS_AND_IMU ||
+		m_reportBuffer[0] == PACKET_TYPE_NFC;
+}
 
-	auto readResult = readSpi(offset - sizeof(DATA_EXISTS_MAGIC), size + sizeof(DATA_EXISTS_MAGIC));
-	const auto startMagicValue = *(reinterpret_cast<uint16_t*>(readResult.data()));
-	if (DATA_EXISTS_MAGIC != startMagicValue) {
-		return std::nullopt;
+void JoyCon::applyBufferedReport()
+{
+	auto report = reinterpret_cast<const protocol::StandardFullInputReport*>(m_reportBuffer.data());
+	m_state.timer = report->timer;
+	m_state.timestamp = m_reportClock.update(report->timer, std::chrono::steady_clock::now());
+	m_healthMonitor->update(m_state.timestamp);
+	m_state.buttonEdges.update(decode::decodeButtonMask(*report));
+	m_state.buttons = decode::getButtonsState(m_state.buttonEdges.held());
+	decode::decodeAnalogSticks(*report, m_leftStickCalibration, m_rightStickCalibration, m_state);
+	if (PACKET_TYPE_STANDARD == report->id) {
+		// Standard reports carry a subcommand reply instead of sensor data.
+		m_subcommands->handleReply(*reinterpret_cast<const protocol::StandardInputReport*>(m_reportBuffer.data()));
+	} else {
+		// The learned neutral is kept apart, so the calibration data stays as the factory set it.
+		m_gyroscopeBiasEstimator.update(*report);
+		decode::decodeSensors(*report, m_calibrationData, m_gyroscopeBiasEstimator.getNeutral(), m_state);
+		for (ImuSample& sample : m_state.imuSamples) {
+			sample.sampleTime = m_state.timestamp.sampleTime +
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+					std::chrono::duration<float>(sample.timeOffset));
+		}
 	}
 
-	const auto calibrationDataStart = readResult.begin() + sizeof(DATA_EXISTS_MAGIC);
-	const auto calibrationDataEnd = calibrationDataStart + size;
-	return Buffer(calibrationDataStart, calibrationDataEnd);
+	m_inputSubscriptions->publish(m_state, PACKET_TYPE_STANDARD != report->id);
+	m_metrics->recordReport(m_state.timestamp.sampleTime, m_state.timestamp.receiveTime,
+	                        std::chrono::steady_clock::now());
 }
 
-void JoyCon::updateAnalogSticks(const protocol::StandardFullInputReport* report)
+void JoyCon::updateCalibrationData()
 {
-	const auto leftStickValues = protocol::decodeAnalogStick(report->leftAnalogStick);
-	if (isRawAnalogStickDataValid(leftStickValues)) {
-		m_leftStick = getCalibratedStickValues(leftStickValues, m_calibrationData.leftStick);
+	Buffer deviceInfo;
+	if (m_calibrationCache) {
+		deviceInfo = sendSubcommand(SUBCOMMAND_REQUEST_DEVICE_INFO, {});
+	}
+	if (deviceInfo.empty()) {
+		// Either there is no cache, or the JoyCon can't be identified in it.
+		applyCalibrationData(readCalibrationData());
+		return;
 	}
 
-	const auto rightStickValues = protocol::decodeAnalogStick(report->rightAnalogStick);
-	if (isRawAnalogStickDataValid(rightStickValues)) {
-		m_rightStick = getCalibratedStickValues(rightStickValues, m_calibrationData.rightStick);
+	m_calibrationCacheKey = CalibrationCache::getKey(deviceInfo.data());
+
+	const std::optional<RawCalibrationData> cachedData = m_calibrationCache->load(m_calibrationCacheKey);
+	if (!cachedData) {
+		const RawCalibrationData data = readCalibrationData();
+		applyCalibrationData(data);
+		m_calibrationCache->store(m_calibrationCacheKey, data);
+		return;
 	}
+
+	applyCalibrationData(*cachedData);
+	// The user may have recalibrated the JoyCon since it was cached. The reply is checked once it arrives, without
+	// holding anyone up.
+	m_calibrationVerification = sendSubcommandAsync(
+		SUBCOMMAND_SPI_READ, getSpiReadCommandData(USER_CALIBRATION_MAGICS_START, USER_CALIBRATION_MAGICS_SIZE)
+	).share();
 }
 
-void JoyCon::updateSensors(const protocol::StandardFullInputReport* report)
+RawCalibrationData JoyCon::readCalibrationData()
 {
-	m_accelerometer.x = static_cast<float>(report->sensorData[0].accelerometer[0]) * m_calibrationData
-	                                                                                 .accelerometerCoeff.x;
-	m_accelerometer.y = static_cast<float>(report->sensorData[0].accelerometer[1]) * m_calibrationData
-	                                                                                 .accelerometerCoeff.y;
-	m_accelerometer.z = static_cast<float>(report->sensorData[0].accelerometer[2]) * m_calibrationData
-	                                                                                 .accelerometerCoeff.z;
+	const auto calibration = readSpiRanges({FACTORY_CALIBRATION_RANGE, USER_CALIBRATION_RANGE});
+	return getCalibrationData(calibration[0], calibration[1]);
+}
+
+RawCalibrationData JoyCon::getCalibrationData(const Buffer& factoryCalibration, const Buffer& userCalibration)
+{
+	RawCalibrationData data{};
+
+	const auto readBlock = [&](uint32_t userOffset, uint32_t factoryOffset, uint8_t* block, uint8_t size,
+	                           uint16_t& userMagic) {
+		const uint8_t* const userBlock = userCalibration.data() + (userOffset - USER_CALIBRATION_RANGE.offset);
+		std::memcpy(&userMagic, userBlock - sizeof(userMagic), sizeof(userMagic));
+		if (USER_CALIBRATION_EXISTS_MAGIC == userMagic) {
+			std::copy_n(userBlock, size, block);
+		} else {
+			std::copy_n(factoryCalibration.data() + (factoryOffset - FACTORY_CALIBRATION_RANGE.offset), size, block);
+		}
+	};
+
+	readBlock(USER_CALIBRATION_LEFT_STICK_OFFSET, FACTORY_CALIBRATION_LEFT_STICK_OFFSET, data.leftStick.data(),
+	          STICK_CALIBRATION_DATA_SIZE, data.userCalibrationMagics[0]);
+	readBlock(USER_CALIBRATION_RIGHT_STICK_OFFSET, FACTORY_CALIBRATION_RIGHT_STICK_OFFSET, data.rightStick.data(),
+	          STICK_CALIBRATION_DATA_SIZE, data.userCalibrationMagics[1]);
+	readBlock(USER_CALIBRATION_SENSORS_OFFSET, FACTORY_CALIBRATION_SENSORS_OFFSET, data.sensors.data(),
+	          SENSOR_CALIBRATION_DATA_SIZE, data.userCalibrationMagics[2]);
 
-	m_gyroscope.x = static_cast<float>(report->sensorData[0].gyroscope[0]) * m_calibrationData.gyroscopeCoeff.x;
-	m_gyroscope.y = static_cast<float>(report->sensorData[0].gyroscope[1]) * m_calibrationData.gyroscopeCoeff.y;
-	m_gyroscope.z = static_cast<float>(report->sensorData[0].gyroscope[2]) * m_calibrationData.gyroscopeCoeff.z;
+	return data;
 }
 
-AnalogStick JoyCon::getCalibratedStickValues(const std::array<uint16_t, 2>& stickValues,
-                                             const AnalogStickCalibrationData& calibrationData)
+void JoyCon::applyCalibrationData(const RawCalibrationData& data)
 {
-	static const float DEAD_ZONE_CENTER = 0.15f;
-	static const float DEAD_ZONE_OUTER = 0.10f;
-	static const float LEGAL_RANGE = 1.0f - DEAD_ZONE_OUTER - DEAD_ZONE_CENTER;
+	m_calibrationData = decode::decodeCalibrationData(data);
+	m_leftStickCalibration.setCalibrationData(m_calibrationData.leftStick);
+	m_rightStickCalibration.setCalibrationData(m_calibrationData.rightStick);
+	m_gyroscopeBiasEstimator.setCalibrationData(m_calibrationData);
+	m_rawCalibrationData = data;
+}
 
-	float x, y;
+void JoyCon::verifyCachedCalibration()
+{
+	static const std::array<uint32_t, 3> USER_CALIBRATION_MAGIC_OFFSETS = {
+		USER_CALIBRATION_LEFT_STICK_OFFSET - sizeof(USER_CALIBRATION_EXISTS_MAGIC) - USER_CALIBRATION_MAGICS_START,
+		USER_CALIBRATION_RIGHT_STICK_OFFSET - sizeof(USER_CALIBRATION_EXISTS_MAGIC) - USER_CALIBRATION_MAGICS_START,
+		USER_CALIBRATION_SENSORS_OFFSET - sizeof(USER_CALIBRATION_EXISTS_MAGIC) - USER_CALIBRATION_MAGICS_START
+	};
 
-	const uint16_t clampedX = std::clamp(stickValues[0], calibrationData.x.minBelowCenter,
-	                                     calibrationData.x.maxAboveCenter);
-	const uint16_t clampedY = std::clamp(stickValues[1], calibrationData.y.minBelowCenter,
-	                                     calibrationData.y.maxAboveCenter);
+	if (!m_calibrationRereads.empty()) {
+		finishCalibrationReread();
+		return;
+	}
 
-	if (clampedX >= calibrationData.x.center) {
-		x = static_cast<float>(clampedX - calibrationData.x.center) / 
-			static_cast<float>(calibrationData.x.maxAboveCenter - calibrationData.x.center);
-	} else {
-		x = -(static_cast<float>(clampedX - calibrationData.x.center) /
-			  static_cast<float>(calibrationData.x.minBelowCenter - calibrationData.x.center));
+	if (!m_calibrationVerification.valid() ||
+		std::future_status::ready != m_calibrationVerification.wait_for(std::chrono::seconds(0))) {
+		return;
 	}
-	if (clampedY >= calibrationData.y.center) {
-		y = static_cast<float>(clampedY - calibrationData.y.center) / 
-			static_cast<float>(calibrationData.y.maxAboveCenter - calibrationData.y.center);
-	} else {
-		y = -(static_cast<float>(clampedY - calibrationData.y.center) /
-			  static_cast<float>(calibrationData.y.minBelowCenter - calibrationData.y.center));
+
+	const auto verification = std::move(m_calibrationVerification);
+	m_calibrationVerification = {};
+
+	Buffer magics;
+	try {
+		magics = getSpiReadResult(verification.get(), USER_CALIBRATION_MAGICS_START, USER_CALIBRATION_MAGICS_SIZE);
+	} catch (const JoyConError&) {
+		// Keep using the cached data, it is most likely still valid.
+		return;
 	}
 
-	const float magnitude = std::sqrtf(x * x + y * y);
-	if (magnitude > DEAD_ZONE_CENTER) {
-		const float normalizedMagnitude = std::min(1.0f, (magnitude - DEAD_ZONE_CENTER) / LEGAL_RANGE);
-		const float scale = normalizedMagnitude / magnitude;
+	bool isCacheValid = true;
+	for (size_t i = 0; i < USER_CALIBRATION_MAGIC_OFFSETS.size(); ++i) {
+		uint16_t magic = 0;
+		std::memcpy(&magic, magics.data() + USER_CALIBRATION_MAGIC_OFFSETS[i], sizeof(magic));
+		isCacheValid = isCacheValid && magic == m_rawCalibrationData.userCalibrationMagics[i];
+	}
+	if (isCacheValid) {
+		return;
+	}
 
-		return {x * scale, y * scale};
-	} else {
-		return {0, 0};
+	m_calibrationCache->invalidate(m_calibrationCacheKey);
+	m_calibrationRereadAttempts = 0;
+	startCalibrationReread();
+}
+
+void JoyCon::startCalibrationReread()
+{
+	// Both ranges take SPI_READS_IN_FLIGHT reads at most, so they can all be sent at once.
+	++m_calibrationRereadAttempts;
+	for (const SpiRange& range : {FACTORY_CALIBRATION_RANGE, USER_CALIBRATION_RANGE}) {
+		for (size_t chunkStart = 0; chunkStart < range.size; chunkStart += MAX_SPI_READ_SIZE) {
+			const auto offset = static_cast<uint32_t>(range.offset + chunkStart);
+			const auto size = static_cast<uint8_t>(std::min(MAX_SPI_READ_SIZE, range.size - chunkStart));
+			m_calibrationRereads.push_back({
+				offset,
+				size,
+				sendSubcommandAsync(SUBCOMMAND_SPI_READ, getSpiReadCommandData(offset, size)).share()
+			});
+		}
 	}
 }
 
-bool JoyCon::isRawAnalogStickDataValid(const std::array<uint16_t, 2>& stickValues)
+void JoyCon::finishCalibrationReread()
 {
-	return !(0 == stickValues[0] && 0 == stickValues[1]);
+	for (const PendingSpiRead& read : m_calibrationRereads) {
+		if (std::future_status::ready != read.reply.wait_for(std::chrono::seconds(0))) {
+			return;
+		}
+	}
+
+	const auto rereads = std::move(m_calibrationRereads);
+	m_calibrationRereads.clear();
+
+	Buffer factoryCalibration(FACTORY_CALIBRATION_RANGE.size);
+	Buffer userCalibration(USER_CALIBRATION_RANGE.size);
+	try {
+		for (const PendingSpiRead& read : rereads) {
+			const Buffer result = getSpiReadResult(read.reply.get(), read.offset, read.size);
+			const bool isFactory = read.offset < USER_CALIBRATION_RANGE.offset;
+			const SpiRange& range = isFactory ? FACTORY_CALIBRATION_RANGE : USER_CALIBRATION_RANGE;
+			Buffer& destination = isFactory ? factoryCalibration : userCalibration;
+			std::copy(result.begin(), result.end(), destination.begin() + (read.offset - range.offset));
+		}
+	} catch (const JoyConError&) {
+		// A reply was lost, or reached the wrong read. The cache was invalidated already, so if this keeps failing,
+		// the next connection reads the calibration data from SPI anyway.
+		if (m_calibrationRereadAttempts < MAX_SPI_READ_ATTEMPTS) {
+			startCalibrationReread();
+		}
+		return;
+	}
+
+	const RawCalibrationData data = getCalibrationData(factoryCalibration, userCalibration);
+	applyCalibrationData(data);
+	m_calibrationCache->store(m_calibrationCacheKey, data);
 }
+
 }
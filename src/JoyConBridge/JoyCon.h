@@ -1,99 +1,50 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <chrono>
+#include <future>
+#include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 #include "Buffer.h"
+#include "CalibrationCache.h"
+#include "decode.h"
+#include "GyroscopeBiasEstimator.h"
+#include "HealthMonitor.h"
 #include "HidDevice.h"
+#include "InputSubscriptions.h"
+#include "JoyConMetrics.h"
 #include "protocol.h"
+#include "ReportClock.h"
+#include "rumble.h"
+#include "RumbleStreamer.h"
+#include "StickCalibration.h"
+#include "SubcommandChannel.h"
+#include "Transport.h"
 
 
 namespace joy_con_bridge
 {
-struct AnalogStickCalibrationData
+/*
+ * A range of bytes in the JoyCon's SPI flash.
+ */
+struct SpiRange
 {
-	struct
-	{
-		uint16_t maxAboveCenter;
-		uint16_t center;
-		uint16_t minBelowCenter;
-	} x;
-
-	struct
-	{
-		uint16_t maxAboveCenter;
-		uint16_t center;
-		uint16_t minBelowCenter;
-	} y;
-};
-
-struct Position3D
-{
-	int16_t x;
-	int16_t y;
-	int16_t z;
-};
-
-struct Coefficient
-{
-	float x;
-	float y;
-	float z;
-};
-
-struct ThreeAxesCalibrationData
-{
-	Position3D neutral;
-	Position3D sensitivityOffset;
-};
-
-struct CalibrationData
-{
-	AnalogStickCalibrationData leftStick;
-	AnalogStickCalibrationData rightStick;
-	Coefficient accelerometerCoeff;
-	Coefficient gyroscopeCoeff;
+	uint32_t offset;
+	size_t size;
 };
 
-struct AnalogStick
+/*
+ * How a dump of the JoyCon's SPI flash went.
+ */
+struct SpiDumpStatistics
 {
-	float x;
-	float y;
+	size_t size; // In bytes.
+	std::chrono::microseconds duration;
+	double bytesPerSecond;
 };
 
-struct ThreeAxesSensor
-{
-	float x;
-	float y;
-	float z;
-};
-
-struct ButtonsState
-{
-	bool a;
-	bool b;
-	bool x;
-	bool y;
-	bool r;
-	bool zr;
-	bool rightStick;
-	bool plus;
-	bool home;
-	bool srRight; // == SR on right joycon.
-	bool slRight;
-
-	bool up;
-	bool down;
-	bool left;
-	bool right;
-	bool l;
-	bool zl;
-	bool leftStick;
-	bool minus;
-	bool capture;
-	bool srLeft;
-	bool slLeft;
-};
-
-
 enum class ConnectionType
 {
 	BLUETOOTH,
@@ -110,10 +61,37 @@ enum class Hand
 class JoyCon
 {
 public:
+	// The most a single SPI read subcommand can return.
+	static constexpr size_t MAX_SPI_READ_SIZE = 0x1D;
+	// The number of SPI reads that are kept in flight by the bulk SPI functions.
+	static constexpr size_t SPI_READS_IN_FLIGHT = 4;
+	// The size of the JoyCon's SPI flash.
+	static constexpr size_t SPI_FLASH_SIZE = 0x80000;
+	// How long `poll` waits for a report before the JoyCon is considered not responding.
+	static constexpr std::chrono::milliseconds NOT_RESPONDING_TIMEOUT{5000};
+
 	/**
 		@brief Constructs a JoyCon based on data from the given HID device.
+
+		@param[in] device The device of the JoyCon.
+		@param[in] hand The hand the JoyCon is for, if known.
+		@param[in] calibrationCache If given, the calibration data is taken from the cache instead of being read from
+		                            SPI, when possible. It is then verified in the background while the JoyCon is
+		                            polled.
+	*/
+	explicit JoyCon(HidDevice device, Hand hand = Hand::NONE,
+	                std::shared_ptr<CalibrationCache> calibrationCache = nullptr);
+
+	/**
+		@brief Constructs a JoyCon that communicates through the given transport, rather than directly through a HID
+		device.
+
+		@param[in] transport The transport of the JoyCon. Shared with copies of the JoyCon.
+		@param[in] hand See `JoyCon(HidDevice, Hand, std::shared_ptr<CalibrationCache>)`.
+		@param[in] calibrationCache See `JoyCon(HidDevice, Hand, std::shared_ptr<CalibrationCache>)`.
 	*/
-	explicit JoyCon(HidDevice device, Hand hand = Hand::NONE);
+	explicit JoyCon(std::shared_ptr<Transport> transport, Hand hand = Hand::NONE,
+	                std::shared_ptr<CalibrationCache> calibrationCache = nullptr);
 
 	/**
 		@brief Reads data from the joy con and updates buttons and sensors.
@@ -123,18 +101,155 @@ public:
 	*/
 	void poll();
 
+	/**
+		@brief Same as `poll`, but waits for a report no longer than a specific amount of time, so a polling thread
+		can be stopped without waiting for `NOT_RESPONDING_TIMEOUT`.
+
+		@param[in] timeout The maximum amount of time to wait for each read.
+
+		@return false if no report arrived in time. No report is applied then, but the pending work is still done
+		        (see `handlePendingWork`).
+
+		@throws HidError If an internal HID error occurs.
+	*/
+	bool poll(std::chrono::milliseconds timeout);
+
+	/**
+		@brief Reads and applies every report that is waiting to be read, from oldest to newest, without blocking.
+		Use this instead of `poll` to never lag behind the JoyCon, even if the caller stalled for a while.
+
+		@param[in] onReport Called with a `const JoyConState&` after each report is applied, so intermediate reports
+		                    (for example, short button presses) are not lost.
+
+		@return The number of reports that were applied. This may be 0.
+
+		@throws HidError If an internal HID error occurs.
+	*/
+	template <typename Callback>
+	size_t pollAll(Callback&& onReport)
+	{
+		size_t reportsApplied = 0;
+		while (pollAvailable()) {
+			onReport(static_cast<const JoyConState&>(m_state));
+			++reportsApplied;
+		}
+
+		handlePendingWork();
+		m_lastBacklogDepth = reportsApplied;
+		m_maxBacklogDepth = std::max(m_maxBacklogDepth, reportsApplied);
+		return reportsApplied;
+	}
+
+	/**
+		@brief Same as `pollAll(onReport)`, for callers that only care about the latest state.
+	*/
+	size_t pollAll();
+
+	/**
+		@brief Does the work that is due whenever the JoyCon is polled: subcommand timeouts and retries, and
+		calibration verification. `poll` and `pollAll` do it themselves. Call it regularly for a JoyCon that is only
+		polled once it has reports, so that its subcommands still time out when it goes silent.
+
+		@throws HidError If a subcommand can't be resent.
+	*/
+	void handlePendingWork();
+
+	/**
+		@brief Gets the number of reports that were waiting in the last call to `pollAll`.
+		Anything above 1 means reports piled up between calls.
+	*/
+	size_t getLastBacklogDepth() const;
+
+	/**
+		@brief Gets the highest number of reports that were waiting in a single call to `pollAll`.
+	*/
+	size_t getMaxBacklogDepth() const;
+
+	/**
+		@brief Gets the smoothed jitter in the arrival of the reports, beyond what the JoyCon's own clock accounts for.
+	*/
+	std::chrono::microseconds getReportJitter() const;
+
+	/**
+		@brief Gets the estimated offset from the JoyCon's clock to the host's monotonic clock. See `ReportClock`.
+	*/
+	std::chrono::steady_clock::duration getClockOffset() const;
+
+	/**
+		@brief Gets the latency histograms and counters of the JoyCon, which can be read from any thread.
+		See `MetricsExporter` for exporting them.
+	*/
+	std::shared_ptr<const JoyConMetrics> getMetrics() const;
+
+	/**
+		@brief Gets how well the reports arrive, to notice a dying JoyCon within a few report periods rather than when
+		a read times out. May be called from any thread, even while another one polls. See `HealthMonitor`.
+	*/
+	Health getHealth() const noexcept;
+
+	/**
+		@brief Gets the bias of the gyroscope that was learned while the JoyCon rested, beyond its calibration, and how
+		much it can be trusted. The gyroscope values are already corrected for it. See `GyroscopeBiasEstimator`.
+	*/
+	GyroscopeBias getGyroscopeBias() const;
+
+	/**
+		@brief Gets all the decoded input of the latest report at once.
+	*/
+	const JoyConState& getState() const;
+
 	ButtonsState getButtonsState() const;
 
+	/**
+		@brief Gets the buttons held in the latest report, and those that were pressed or released since the report
+		before it. Intermediate reports applied by `pollAll` each get their own edges.
+	*/
+	ButtonEdges getButtonEdges() const;
+
 	AnalogStick getLeftStick() const;
 
 	AnalogStick getRightStick() const;
 
+	/**
+		@brief Gets the rotation rate of the newest IMU sample, in rad/s around the JoyCon's axes.
+	*/
 	ThreeAxesSensor getGyroscope() const;
 
+	/**
+		@brief Gets the acceleration of the newest IMU sample, in m/s^2 along the JoyCon's axes, gravity included.
+	*/
 	ThreeAxesSensor getAccelerometer() const;
 
+	/**
+		@brief Gets all the IMU samples of the latest report, ordered from oldest to newest.
+		The IMU samples at a rate ~3 times higher than the report rate, so these hold motion data that
+		`getGyroscope` and `getAccelerometer` alone miss.
+
+		@return The IMU samples of the latest report.
+	*/
+	const ImuSamples& getImuSamples() const;
+
 	Hand getLikelyHand() const;
 
+	/**
+		@brief Gets the transport of the JoyCon, to wait for its reports along with other JoyCons.
+	*/
+	const Transport& getTransport() const;
+
+	/**
+		@brief Gets the calibration data in use, as it appears in the JoyCon's SPI flash.
+	*/
+	const RawCalibrationData& getRawCalibrationData() const;
+
+	/**
+		@brief Sets the dead zones and response curve of both analog sticks.
+
+		@throws std::invalid_argument If the profile is not valid. See `StickCalibration::setProfile`.
+	*/
+	void setStickProfile(const StickProfile& profile);
+
+	const StickProfile& getStickProfile() const;
+
 	void setPlayerLeds(protocol::LedState led1, protocol::LedState led2, protocol::LedState led3,
 	                   protocol::LedState led4);
 
@@ -145,108 +260,278 @@ public:
 	*/
 	void setPlayerLedsByNumber(unsigned int playerNumber);
 
-private:
 	/**
-		@brief Sends a subcommand to the JoyCon.
+		@brief Sends a subcommand to the JoyCon without waiting for its reply.
+		Several subcommands can be in flight at once. Replies are only received while the JoyCon is being polled
+		(by `poll`, `pollAll` or a `JoyConReader`), and the reports they arrive in are applied like any other.
+		Replies are matched by subcommand ID, and the extra replies of a resent subcommand are dropped rather than
+		taken for the replies of later ones. See `SubcommandChannel`.
+		This may be called from a thread other than the polling one.
 
 		@param[in] subcommandId The ID of the subcommand.
 		@param[in] commandData A buffer containing the command data/parameters.
+		@param[in] budget How long to wait for the reply and how many times to resend the subcommand.
 
-		@return The data the subcommand returned. In case of a simple ACK, an empty buffer is returned.
+		@return The data the subcommand will return. In case of a simple ACK, this is an empty buffer.
+		        If the budget runs out, the future holds JoyConNotResponding instead.
 
-		@throws JoyConNotResponding If an ACK is not received.
+		@throws HidError If the subcommand can't be written.
 	*/
-	Buffer sendSubcommand(uint8_t subcommandId, const Buffer& commandData);
+	std::future<Buffer> sendSubcommandAsync(uint8_t subcommandId, const Buffer& commandData,
+	                                        const SubcommandBudget& budget = DEFAULT_SUBCOMMAND_BUDGET);
 
 	/**
-		@brief Reads SPI data.
+		@brief Rumbles both actuators of the JoyCon until the rumble is changed. The rumble is streamed by a thread
+		of its own, at the rate of the reports, and is shared with copies of the JoyCon. This may be called from any
+		thread. See `RumbleStreamer`.
+
+		@throws HidError If writing the previous rumble failed. See `RumbleStreamer::set`.
+	*/
+	void setRumble(const Rumble& rumble);
+
+	/**
+		@brief Stops the rumble of the JoyCon.
+
+		@throws HidError If writing the previous rumble failed. See `RumbleStreamer::set`.
+	*/
+	void stopRumble();
+
+	/**
+		@brief Subscribes to presses and releases of buttons. See `InputSubscriptions::subscribeButtons`.
+		Subscriptions are shared with copies of the JoyCon, so subscribing may be done after handing a copy to a
+		reader thread, and from any thread.
+	*/
+	SubscriptionId subscribeButtons(ButtonMask buttons, ButtonCallback callback, Executor executor = nullptr);
+
+	/**
+		@brief Subscribes to movements of the analog sticks. See `InputSubscriptions::subscribeSticks`.
+	*/
+	SubscriptionId subscribeSticks(float threshold, StickCallback callback, Executor executor = nullptr);
+
+	/**
+		@brief Subscribes to the IMU samples, in batches. See `InputSubscriptions::subscribeImu`.
+	*/
+	SubscriptionId subscribeImu(size_t reportsPerBatch, ImuCallback callback, Executor executor = nullptr);
+
+	/**
+		@brief Cancels a subscription. See `InputSubscriptions::unsubscribe`.
+	*/
+	void unsubscribe(SubscriptionId subscription);
+
+	/**
+		@brief Reads a range of the JoyCon's SPI flash, of any size. See `readSpiRanges`.
 
 		@param[in] offset The offset to read from.
-		@param[in] size The number of bytes to read. In practice, this is limited to 0x1D bytes.
+		@param[in] size The number of bytes to read.
 
 		@return The data that was read.
 
-		@throws See `JoyCon::sendSubcommand`.
+		@throws See `JoyCon::readSpiRanges`.
 	*/
-	Buffer readSpi(uint32_t offset, uint8_t size);
+	Buffer readSpiRange(uint32_t offset, size_t size);
 
 	/**
-		@brief Updates the state of all buttons based on the report.
+		@brief Reads several ranges of the JoyCon's SPI flash, of any size.
+		Ranges that overlap or touch are merged, and split into as few SPI reads as possible. Up to
+		`SPI_READS_IN_FLIGHT` of the reads are kept in flight at once, instead of waiting for each reply in turn.
+		Reports that arrive in the meantime are applied as usual.
+
+		@param[in] ranges The ranges to read.
+
+		@return The data of each range, in the order of `ranges`.
 
-		@param[in] report The report used to update the buttons.
+		@throws JoyConNotResponding If a read is not answered, or keeps being answered with the wrong range.
 	*/
-	void updateButtons(const protocol::StandardFullInputReport* report);
+	std::vector<Buffer> readSpiRanges(const std::vector<SpiRange>& ranges);
 
 	/**
-		@brief Updates the calibration data of the analog sticks and buttons by reading from the JoyCon's SPI.
+		@brief Dumps the whole SPI flash of the JoyCon into an image file, for offline inspection.
+		The image is written through a memory mapping, so the reads go straight into the file.
+
+		@param[in] path The path of the image file. Overwritten if it exists.
+
+		@return How long the dump took, and its throughput.
+
+		@throws MappedFileError If the image file can't be created.
+		@throws See `JoyCon::readSpiRanges`.
 	*/
-	void updateCalibrationData();
+	SpiDumpStatistics dumpSpiFlash(const std::string& path);
+
+private:
+	/*
+	 * A single SPI read subcommand, and where its data goes.
+	 */
+	struct SpiChunk
+	{
+		uint32_t offset;
+		uint8_t size;
+		uint8_t* destination;
+	};
+
+	/*
+	 * An SPI read subcommand whose reply is handled while the JoyCon is polled, instead of being waited for.
+	 */
+	struct PendingSpiRead
+	{
+		uint32_t offset;
+		uint8_t size;
+		std::shared_future<Buffer> reply;
+	};
+
+	/**
+		@brief Waits for the reply of a subcommand, applying the reports that arrive in the meantime.
 
-	void updateLeftStickCalibrationData(const std::array<uint16_t, 6>& rawCalibrationValues);
+		@param[in] reply The pending reply. It is ready once this returns.
+	*/
+	void waitForReply(std::future<Buffer>& reply);
+
+	/**
+		@brief Sends a subcommand to the JoyCon and waits for its reply.
+		Reports that arrive in the meantime are applied as usual.
+
+		@param[in] subcommandId The ID of the subcommand.
+		@param[in] commandData A buffer containing the command data/parameters.
+
+		@return The data the subcommand returned. In case of a simple ACK, an empty buffer is returned.
 
-	void updateRightStickCalibrationData(const std::array<uint16_t, 6>& rawCalibrationValues);
+		@throws JoyConNotResponding If an ACK is not received.
+	*/
+	Buffer sendSubcommand(uint8_t subcommandId, const Buffer& commandData);
 
-	void updateAccelerometerCalibrationData(const ThreeAxesCalibrationData& data);
+	/**
+		@brief Splits a range of the SPI flash into reads of at most `MAX_SPI_READ_SIZE` bytes.
 
-	void updateGyroscopeCalibrationData(const ThreeAxesCalibrationData& data);
+		@param[in] offset The offset of the range.
+		@param[in] size The size of the range.
+		@param[in] destination Where the data of the range goes.
+		@param[out] chunks Receives the reads.
+	*/
+	static void splitSpiRange(uint32_t offset, size_t size, uint8_t* destination, std::vector<SpiChunk>& chunks);
 
 	/**
-		@brief Attempts to read user calibration data from the given offset. If the user data start magic value is missing, no data is returned.
+		@brief Runs SPI reads, keeping up to `SPI_READS_IN_FLIGHT` of them in flight.
+		Each reply is placed according to the range it echoes, since replies are matched to reads in order, and a lost
+		reply shifts them. Reads that end up without their data are sent again.
 
-		@param offset The offset in SPI that the user calibration data starts in.
-		@param size The number of bytes to read.
+		@param[in] chunks The reads to run, sorted by offset and not overlapping. Each one's data is copied to its
+		                  destination.
 
-		@return The user calibration data as it appears in SPI, if it exists.
+		@throws JoyConNotResponding If a read is not answered, or keeps being answered with the wrong range.
 	*/
-	std::optional<Buffer> readUserCalibrationData(uint32_t offset, uint8_t size);
+	void readSpiChunks(const std::vector<SpiChunk>& chunks);
 
 	/**
-		@brief: Updates analog stick values based on an input report and existing calibration data.
+		@brief Builds the command data of an SPI read.
+	*/
+	static Buffer getSpiReadCommandData(uint32_t offset, uint8_t size);
 
-		@param[in] report The latest input report.
+	/**
+		@brief Extracts the data that was read from the reply to an SPI read.
+
+		@param[in] reply The reply to the SPI read.
+		@param[in] offset The offset that was read.
+		@param[in] size The number of bytes that were read.
+
+		@throws JoyConBadReply If the reply is for another range, or is too short to hold the data.
 	*/
-	void updateAnalogSticks(const protocol::StandardFullInputReport* report);
+	static Buffer getSpiReadResult(const Buffer& reply, uint32_t offset, uint8_t size);
 
 	/**
-		@brief: Updates sensor data based on an input report and existing calibration data.
+		@brief Gets the parameters that a reply to an SPI read echoes, which tell the range it is for.
 
-		@param[in] report The latest input report.
+		@return The parameters, if the reply is well formed.
 	*/
-	void updateSensors(const protocol::StandardFullInputReport* report);
+	static std::optional<protocol::SpiReadCommandParameters> getSpiReadReplyParameters(const Buffer& reply);
 
 	/**
-		@brief Calculates the calibrated values of an analog stick.
+		@brief Reads and applies a single input report, only if one is waiting to be read.
 
-		Credit to Hypersect (Ryan Juckett)
-		http://blog.hypersect.com/interpreting-analog-sticks/
-		Special thanks to CTCaer/jc_toolkit
+		@return true if a report was applied.
 
-		@param[in] stickValues The uncalibrated values of the analog stick.
-		@param[in] calibrationData The calibration data to use.
+		@throws HidError If an internal HID error occurs.
+	*/
+	bool pollAvailable();
 
-		@return Calibrated values.
+	/**
+		@brief Checks if the report in the report buffer is an input report that can be applied.
 	*/
-	static AnalogStick getCalibratedStickValues(const std::array<uint16_t, 2>& stickValues,
-	                                            const AnalogStickCalibrationData& calibrationData);
+	bool isInputReportBuffered() const;
 
 	/**
-		@brief Checks if analog stick values, before calibration, are valid.
+		@brief Updates buttons, analog sticks and sensors based on the report in the report buffer.
+	*/
+	void applyBufferedReport();
 
-		@param[in] stickValues The uncalibrated values.
+	/**
+		@brief Updates the calibration data of the analog sticks and sensors, from the calibration cache if possible
+		and from the JoyCon's SPI otherwise.
+	*/
+	void updateCalibrationData();
 
-		@return True if the values are valid
+	/**
+		@brief Reads the calibration data of the analog sticks and sensors from the JoyCon's SPI.
+		User calibration is preferred over factory calibration, where it exists. Both are read at once, since each is
+		a single contiguous range.
 	*/
-	static bool isRawAnalogStickDataValid(const std::array<uint16_t, 2>& stickValues);
+	RawCalibrationData readCalibrationData();
 
-	HidDevice m_device;
+	/**
+		@brief Picks the calibration data out of the factory and user calibration ranges of the SPI flash.
+
+		@param[in] factoryCalibration The data of `FACTORY_CALIBRATION_RANGE`.
+		@param[in] userCalibration The data of `USER_CALIBRATION_RANGE`.
+	*/
+	static RawCalibrationData getCalibrationData(const Buffer& factoryCalibration, const Buffer& userCalibration);
+
+	/**
+		@brief Decodes calibration data and starts using it.
+	*/
+	void applyCalibrationData(const RawCalibrationData& data);
+
+	/**
+		@brief Checks if the calibration data that was taken from the cache is still up to date, once the JoyCon
+		replies. If it is not, the calibration data is read again from SPI. Nothing here waits for the JoyCon: the
+		reads are sent, and their replies are handled by a later call, once they arrived.
+	*/
+	void verifyCachedCalibration();
+
+	/**
+		@brief Sends the SPI reads of the calibration data, without waiting for their replies.
+	*/
+	void startCalibrationReread();
+
+	/**
+		@brief Starts using the calibration data that was read again, once all of its reads were replied to.
+		If a read failed, they are all sent again, up to `MAX_SPI_READ_ATTEMPTS` times. After that, the cached data
+		is kept.
+	*/
+	void finishCalibrationReread();
+
+	std::shared_ptr<Transport> m_transport;
+	std::shared_ptr<JoyConMetrics> m_metrics; // Shared between copies, since they read from the same transport.
+	std::shared_ptr<HealthMonitor> m_healthMonitor; // Shared between copies too.
+	// Shared between copies, like the transport itself.
+	std::shared_ptr<SubcommandChannel> m_subcommands;
+	std::shared_ptr<InputSubscriptions> m_inputSubscriptions; // Shared between copies too.
+	std::shared_ptr<RumbleStreamer> m_rumble; // Shared between copies too.
+	// Reports are read into this buffer, so reading them does not allocate.
+	alignas(16) std::array<uint8_t, sizeof(protocol::StandardFullInputReport)> m_reportBuffer;
 	ConnectionType m_connectionType = ConnectionType::BLUETOOTH; // Only bluetooth communication is supported.
 
-	ButtonsState m_buttons;
-	AnalogStick m_leftStick;
-	AnalogStick m_rightStick;
-	ThreeAxesSensor m_gyroscope;
-	ThreeAxesSensor m_accelerometer;
+	JoyConState m_state;
 	CalibrationData m_calibrationData;
+	StickCalibration m_leftStickCalibration;
+	StickCalibration m_rightStickCalibration;
+	RawCalibrationData m_rawCalibrationData; // The calibration data in use, before decoding.
+	std::shared_ptr<CalibrationCache> m_calibrationCache;
+	std::string m_calibrationCacheKey;
+	std::shared_future<Buffer> m_calibrationVerification; // The pending read of the user calibration magics.
+	std::vector<PendingSpiRead> m_calibrationRereads; // Of stale cached calibration data.
+	unsigned int m_calibrationRereadAttempts;
 	Hand m_likelyHand;
+	size_t m_lastBacklogDepth;
+	size_t m_maxBacklogDepth;
+	ReportClock m_reportClock;
+	GyroscopeBiasEstimator m_gyroscopeBiasEstimator;
 };
 }
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include "JoyConManager.h"
+
+
+namespace joy_con_bridge
+{
+ManagedJoyCon::ManagedJoyCon(std::wstring serialNumber, Hand hand)
+	: m_serialNumber(std::move(serialNumber))
+	, m_hand(hand)
+	, m_lastState{}
+	, m_reconnectCount(0)
+	, m_lastReconnectLatency(0)
+	, m_wasEverConnected(false)
+	, m_hasConnectionChange(false)
+	, m_isRemoved(false)
+	, m_isConnected(false)
+{}
+
+size_t ManagedJoyCon::pollAll()
+{
+	return pollAll([](const JoyConState&) {});
+}
+
+bool ManagedJoyCon::isConnected() const
+{
+	return m_joyCon.has_value();
+}
+
+const JoyConState& ManagedJoyCon::getState() const
+{
+	return m_joyCon ? m_joyCon->getState() : m_lastState;
+}
+
+JoyCon* ManagedJoyCon::getJoyCon()
+{
+	return m_joyCon ? &*m_joyCon : nullptr;
+}
+
+Hand ManagedJoyCon::getHand() const
+{
+	return m_hand;
+}
+
+const std::wstring& ManagedJoyCon::getSerialNumber() const
+{
+	return m_serialNumber;
+}
+
+size_t ManagedJoyCon::getReconnectCount() const
+{
+	return m_reconnectCount;
+}
+
+std::chrono::microseconds ManagedJoyCon::getLastReconnectLatency() const
+{
+	return m_lastReconnectLatency;
+}
+
+Health ManagedJoyCon::getHealth() const noexcept
+{
+	if (!m_joyCon) {
+		return {HealthStatus::STALLED, HealthMonitor::DEFAULT_PERIOD, std::chrono::microseconds::max(), 0, 0};
+	}
+	return m_joyCon->getHealth();
+}
+
+bool ManagedJoyCon::needsConnection()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return !m_isConnected;
+}
+
+void ManagedJoyCon::publishConnection(JoyCon joyCon, std::chrono::steady_clock::time_point noticedAt)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_pendingJoyCon.emplace(std::move(joyCon));
+	m_pendingNoticedAt = noticedAt;
+	m_isRemoved = false;
+	m_isConnected = true;
+	m_hasConnectionChange.store(true, std::memory_order_release);
+}
+
+void ManagedJoyCon::publishRemoval()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (!m_isConnected) {
+		return;
+	}
+
+	m_pendingJoyCon.reset();
+	m_isRemoved = true;
+	m_isConnected = false;
+	m_hasConnectionChange.store(true, std::memory_order_release);
+}
+
+void ManagedJoyCon::adoptConnectionChange()
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_hasConnectionChange.store(false, std::memory_order_relaxed);
+
+	if (m_joyCon && (m_pendingJoyCon || m_isRemoved)) {
+		m_lastState = m_joyCon->getState();
+		m_joyCon.reset();
+	}
+	m_isRemoved = false;
+
+	if (m_pendingJoyCon) {
+		m_joyCon.emplace(std::move(*m_pendingJoyCon));
+		m_pendingJoyCon.reset();
+
+		if (m_wasEverConnected) {
+			++m_reconnectCount;
+			m_lastReconnectLatency = std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - m_pendingNoticedAt);
+		}
+		m_wasEverConnected = true;
+	}
+}
+
+void ManagedJoyCon::disconnect()
+{
+	m_lastState = m_joyCon->getState();
+	m_joyCon.reset();
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	if (!m_pendingJoyCon) {
+		m_isConnected = false;
+	}
+}
+
+JoyConManager::JoyConManager(std::shared_ptr<CalibrationCache> calibrationCache,
+                             std::chrono::milliseconds enumerationInterval)
+	: JoyConManager(&connect::enumerate,
+	                [calibrationCache](const connect::DeviceDescription& device) {
+		                return JoyCon(HidDevice(device.path), device.hand, calibrationCache);
+	                },
+	                enumerationInterval)
+{}
+
+JoyConManager::JoyConManager(Enumerator enumerator, Connector connector, std::chrono::milliseconds enumerationInterval)
+	: m_enumerator(std::move(enumerator))
+	, m_connector(std::move(connector))
+	, m_enumerationInterval(enumerationInterval)
+	, m_isRefreshRequested(false)
+	, m_running(true)
+	, m_thread(&JoyConManager::manageLoop, this)
+{}
+
+JoyConManager::~JoyConManager()
+{
+	m_running = false;
+	m_watcher.wake();
+	m_thread.join();
+}
+
+std::vector<std::shared_ptr<ManagedJoyCon>> JoyConManager::getJoyCons() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	std::vector<std::shared_ptr<ManagedJoyCon>> joyCons;
+	joyCons.reserve(m_joyCons.size());
+	for (const auto& joyCon : m_joyCons) {
+		joyCons.push_back(joyCon.second);
+	}
+
+	return joyCons;
+}
+
+void JoyConManager::refresh()
+{
+	m_isRefreshRequested = true;
+	m_watcher.wake();
+}
+
+bool JoyConManager::isWatchingDevices() const
+{
+	return m_watcher.isWatching();
+}
+
+void JoyConManager::manageLoop()
+{
+	bool isDeviceChanged = false;
+	auto nextEnumerationTime = std::chrono::steady_clock::now();
+	while (m_running) {
+		publishConnections();
+
+		// Handshakes that finish wake the watcher too, so most rounds don't enumerate.
+		const auto now = std::chrono::steady_clock::now();
+		if (isDeviceChanged || m_isRefreshRequested.exchange(false) || now >= nextEnumerationTime) {
+			updateJoyCons();
+			nextEnumerationTime = now + m_enumerationInterval;
+		}
+
+		const auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+			nextEnumerationTime - std::chrono::steady_clock::now());
+		isDeviceChanged = m_watcher.wait(std::max(timeout, std::chrono::milliseconds(0)));
+	}
+
+	for (PendingConnection& connection : m_connections) {
+		connection.thread.join();
+	}
+	m_connections.clear();
+}
+
+void JoyConManager::updateJoyCons()
+{
+	const auto noticedAt = std::chrono::steady_clock::now();
+
+	std::vector<connect::DeviceDescription> devices;
+	try {
+		devices = m_enumerator();
+	} catch (const std::exception&) {
+		// intentionally empty, enumeration is retried on the next round.
+		return;
+	}
+
+	// Handshakes take a while, so they all run at once, and the manager thread doesn't wait for them.
+	std::vector<std::shared_ptr<ManagedJoyCon>> availableJoyCons;
+	for (const connect::DeviceDescription& device : devices) {
+		const auto joyCon = getJoyCon(device);
+		availableJoyCons.push_back(joyCon);
+		if (!joyCon->needsConnection() || isConnecting(joyCon)) {
+			continue;
+		}
+
+		// The result is ready before the watcher is woken, so the manager thread always finds it.
+		std::promise<JoyCon> handshake;
+		PendingConnection connection{joyCon, noticedAt, handshake.get_future(), {}};
+		connection.thread = std::thread([this, device, handshake = std::move(handshake)]() mutable {
+			try {
+				handshake.set_value(m_connector(device));
+			} catch (...) {
+				handshake.set_exception(std::current_exception());
+			}
+			m_watcher.wake();
+		});
+		m_connections.push_back(std::move(connection));
+	}
+
+	for (const std::shared_ptr<ManagedJoyCon>& joyCon : getJoyCons()) {
+		if (availableJoyCons.cend() == std::find(availableJoyCons.cbegin(), availableJoyCons.cend(), joyCon)) {
+			joyCon->publishRemoval();
+		}
+	}
+}
+
+void JoyConManager::publishConnections()
+{
+	for (auto connection = m_connections.begin(); m_connections.end() != connection;) {
+		if (std::future_status::ready != connection->handshake.wait_for(std::chrono::seconds(0))) {
+			++connection;
+			continue;
+		}
+
+		connection->thread.join();
+		try {
+			connection->joyCon->publishConnection(connection->handshake.get(), connection->noticedAt);
+		} catch (const std::exception&) {
+			// intentionally empty, the JoyCon still needs a connection, so it is retried on the next enumeration.
+		}
+		connection = m_connections.erase(connection);
+	}
+}
+
+bool JoyConManager::isConnecting(const std::shared_ptr<ManagedJoyCon>& joyCon) const
+{
+	return std::any_of(m_connections.cbegin(), m_connections.cend(), [&joyCon](const PendingConnection& connection) {
+		return connection.joyCon == joyCon;
+	});
+}
+
+std::shared_ptr<ManagedJoyCon> JoyConManager::getJoyCon(const connect::DeviceDescription& device)
+{
+	const std::wstring key = getKey(device);
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	const auto joyCon = std::find_if(m_joyCons.cbegin(), m_joyCons.cend(), [&key](const auto& joyCon) {
+		return joyCon.first == key;
+	});
+	if (m_joyCons.cend() != joyCon) {
+		return joyCon->second;
+	}
+
+	// The constructor is private, so make_shared can't be used.
+	m_joyCons.emplace_back(key, std::shared_ptr<ManagedJoyCon>(new ManagedJoyCon(device.serialNumber, device.hand)));
+	return m_joyCons.back().second;
+}
+
+std::wstring JoyConManager::getKey(const connect::DeviceDescription& device)
+{
+	if (!device.serialNumber.empty()) {
+		return device.serialNumber;
+	}
+
+	// Without a serial number, the JoyCon can only be recognized as long as its path stays the same.
+	return std::wstring(device.path.cbegin(), device.path.cend());
+}
+}
@@ -0,0 +1,282 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "CalibrationCache.h"
+#include "connect.h"
+#include "DeviceWatcher.h"
+#include "exceptions.h"
+#include "JoyCon.h"
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief A JoyCon that is kept connected by a `JoyConManager`.
+
+	The same handle stays valid while the JoyCon disconnects and reconnects. While it is disconnected, polling does
+	nothing and the last state is kept. Polling never waits for enumeration or for handshakes, which happen on the
+	manager's thread.
+
+	Except for `getHand` and `getSerialNumber`, the functions must all be called from a single thread.
+*/
+class ManagedJoyCon
+{
+public:
+	ManagedJoyCon(const ManagedJoyCon&) = delete;
+	ManagedJoyCon& operator=(const ManagedJoyCon&) = delete;
+
+	/**
+		@brief Picks up a reconnection if one is ready, then applies every waiting report. See `JoyCon::pollAll`.
+		A JoyCon that fails while being polled is considered disconnected, rather than throwing.
+
+		@param[in] onReport Called with a `const JoyConState&` after each report is applied.
+
+		@return The number of reports that were applied. This is always 0 while disconnected.
+	*/
+	template <typename Callback>
+	size_t pollAll(Callback&& onReport)
+	{
+		if (m_hasConnectionChange.load(std::memory_order_acquire)) {
+			adoptConnectionChange();
+		}
+		if (!m_joyCon) {
+			return 0;
+		}
+
+		try {
+			return m_joyCon->pollAll(onReport);
+		} catch (const HidError&) {
+			disconnect();
+		} catch (const JoyConError&) {
+			disconnect();
+		}
+		return 0;
+	}
+
+	/**
+		@brief Same as `pollAll(onReport)`, for callers that only care about the latest state.
+	*/
+	size_t pollAll();
+
+	/**
+		@brief Checks if the JoyCon is connected, as of the last poll.
+	*/
+	bool isConnected() const;
+
+	/**
+		@brief Gets the state decoded from the latest report. While disconnected, this is the last state before
+		disconnecting.
+	*/
+	const JoyConState& getState() const;
+
+	/**
+		@brief Gets the connected JoyCon itself, for everything other than polling (sending subcommands, for
+		example). It must not be polled directly.
+
+		@return The JoyCon, or nullptr while disconnected. Only valid until the next poll.
+	*/
+	JoyCon* getJoyCon();
+
+	Hand getHand() const;
+
+	/**
+		@brief Gets the serial number that identifies the JoyCon across reconnects.
+	*/
+	const std::wstring& getSerialNumber() const;
+
+	/**
+		@brief Gets the number of times the JoyCon reconnected, not counting the first connection.
+	*/
+	size_t getReconnectCount() const;
+
+	/**
+		@brief Gets how long the last reconnection took, from noticing the JoyCon was back until it was usable by
+		the polling thread.
+	*/
+	std::chrono::microseconds getLastReconnectLatency() const;
+
+	/**
+		@brief Gets how well the reports of the JoyCon arrive, as of now. See `JoyCon::getHealth`. While disconnected,
+		the JoyCon is stalled.
+	*/
+	Health getHealth() const noexcept;
+
+private:
+	friend class JoyConManager;
+
+	ManagedJoyCon(std::wstring serialNumber, Hand hand);
+
+	/**
+		@brief Checks if the manager should (re)connect to the JoyCon. Called by the manager.
+	*/
+	bool needsConnection();
+
+	/**
+		@brief Hands a freshly connected JoyCon over to the polling thread. Called by the manager.
+
+		@param[in] joyCon The connected JoyCon.
+		@param[in] noticedAt When the manager noticed the JoyCon is available.
+	*/
+	void publishConnection(JoyCon joyCon, std::chrono::steady_clock::time_point noticedAt);
+
+	/**
+		@brief Tells the polling thread the JoyCon is gone. Called by the manager.
+	*/
+	void publishRemoval();
+
+	/**
+		@brief Applies what the manager published, on the polling thread.
+	*/
+	void adoptConnectionChange();
+
+	/**
+		@brief Drops the JoyCon after it failed, on the polling thread.
+	*/
+	void disconnect();
+
+	const std::wstring m_serialNumber;
+	const Hand m_hand;
+
+	// Only used by the polling thread.
+	std::optional<JoyCon> m_joyCon;
+	JoyConState m_lastState;
+	size_t m_reconnectCount;
+	std::chrono::microseconds m_lastReconnectLatency;
+	bool m_wasEverConnected;
+
+	// Shared with the manager.
+	std::atomic<bool> m_hasConnectionChange;
+	std::mutex m_lock;
+	std::optional<JoyCon> m_pendingJoyCon;
+	std::chrono::steady_clock::time_point m_pendingNoticedAt;
+	bool m_isRemoved;
+	bool m_isConnected; // As far as the manager is concerned, including a pending connection.
+};
+
+/**
+	@brief Watches for JoyCons being connected and disconnected, and keeps a `ManagedJoyCon` for each one.
+
+	Everything happens on a background thread: devices are watched (see `DeviceWatcher`), and also enumerated
+	periodically in case watching is unavailable or a handshake failed. New JoyCons get a new handle, and JoyCons that
+	return (by serial number) are handshaken again and handed to their existing handle.
+*/
+class JoyConManager
+{
+public:
+	static constexpr std::chrono::milliseconds DEFAULT_ENUMERATION_INTERVAL{1000};
+
+	// Lists the JoyCons that are currently available.
+	using Enumerator = std::function<std::vector<connect::DeviceDescription>()>;
+	// Opens an available JoyCon and runs the handshake on it.
+	using Connector = std::function<JoyCon(const connect::DeviceDescription&)>;
+
+	/**
+		@brief Starts managing the JoyCons among the HID devices.
+
+		@param[in] calibrationCache Shared by all the JoyCons. See `JoyCon::JoyCon`.
+		@param[in] enumerationInterval How often to enumerate, regardless of device changes.
+	*/
+	explicit JoyConManager(std::shared_ptr<CalibrationCache> calibrationCache = nullptr,
+	                       std::chrono::milliseconds enumerationInterval = DEFAULT_ENUMERATION_INTERVAL);
+
+	/**
+		@brief Starts managing the JoyCons found by a custom enumerator, such as simulated devices.
+
+		@param[in] enumerator Lists the available JoyCons.
+		@param[in] connector Connects to an available JoyCon. May throw if it can't.
+		@param[in] enumerationInterval How often to enumerate, regardless of device changes.
+	*/
+	JoyConManager(Enumerator enumerator, Connector connector,
+	              std::chrono::milliseconds enumerationInterval = DEFAULT_ENUMERATION_INTERVAL);
+
+	/**
+		@brief Stops managing. Blocks until the running enumeration and handshakes are done.
+		The handles remain usable, but won't reconnect anymore.
+	*/
+	~JoyConManager();
+
+	JoyConManager(const JoyConManager&) = delete;
+	JoyConManager& operator=(const JoyConManager&) = delete;
+
+	/**
+		@brief Gets a handle for every JoyCon that was ever seen, connected or not. This may be called from any thread.
+	*/
+	std::vector<std::shared_ptr<ManagedJoyCon>> getJoyCons() const;
+
+	/**
+		@brief Makes the manager enumerate now, instead of waiting for a device change or for the interval.
+	*/
+	void refresh();
+
+	/**
+		@brief Checks if device changes are noticed as they happen, rather than only by periodic enumeration.
+	*/
+	bool isWatchingDevices() const;
+
+private:
+	/*
+	 * A handshake that runs on its own thread, while the manager thread keeps watching.
+	 */
+	struct PendingConnection
+	{
+		std::shared_ptr<ManagedJoyCon> joyCon;
+		std::chrono::steady_clock::time_point noticedAt;
+		std::future<JoyCon> handshake;
+		std::thread thread;
+	};
+
+	/**
+		@brief The body of the manager thread. Enumerates when a hidraw device was added or removed, when `refresh`
+		was called, and every `m_enumerationInterval` otherwise.
+	*/
+	void manageLoop();
+
+	/**
+		@brief Enumerates, starts connecting to the JoyCons that need it and notes the ones that are gone.
+		Doesn't wait for the handshakes.
+	*/
+	void updateJoyCons();
+
+	/**
+		@brief Hands the JoyCons whose handshake is done over to their handles.
+	*/
+	void publishConnections();
+
+	/**
+		@brief Checks if a handshake with a JoyCon is already running.
+	*/
+	bool isConnecting(const std::shared_ptr<ManagedJoyCon>& joyCon) const;
+
+	/**
+		@brief Finds the handle of a JoyCon, or creates one if it is new.
+	*/
+	std::shared_ptr<ManagedJoyCon> getJoyCon(const connect::DeviceDescription& device);
+
+	/**
+		@brief Gets the key that identifies a JoyCon across reconnects.
+	*/
+	static std::wstring getKey(const connect::DeviceDescription& device);
+
+	Enumerator m_enumerator;
+	Connector m_connector;
+	std::chrono::milliseconds m_enumerationInterval;
+
+	mutable std::mutex m_lock;
+	std::vector<std::pair<std::wstring, std::shared_ptr<ManagedJoyCon>>> m_joyCons; // By key, in order of arrival.
+
+	DeviceWatcher m_watcher;
+	std::atomic<bool> m_isRefreshRequested;
+	std::vector<PendingConnection> m_connections; // Only used by the manager thread.
+	std::atomic<bool> m_running;
+	std::thread m_thread;
+};
+}
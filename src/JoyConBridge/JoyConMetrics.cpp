@@ -0,0 +1,46 @@
+#include "JoyConMetrics.h"
+
+
+namespace joy_con_bridge
+{
+JoyConMetrics::JoyConMetrics()
+	: m_reportCount(0)
+	, m_discardedPacketCount(0)
+	, m_subcommandRetryCount(0)
+	, m_subcommandTimeoutCount(0)
+	, m_rumbleReportCount(0)
+	, m_previousReceiveTime{}
+{}
+
+void JoyConMetrics::recordReport(std::chrono::steady_clock::time_point sampleTime,
+                                 std::chrono::steady_clock::time_point receiveTime,
+                                 std::chrono::steady_clock::time_point appliedTime)
+{
+	m_reportLatency.record(appliedTime - sampleTime);
+	m_decodeTime.record(appliedTime - receiveTime);
+	const uint64_t reportCount = m_reportCount.load(std::memory_order_relaxed);
+	if (0 != reportCount) {
+		m_reportInterval.record(receiveTime - m_previousReceiveTime);
+	}
+	m_previousReceiveTime = receiveTime;
+	// There is a single writer, so this doesn't have to be a locked increment.
+	m_reportCount.store(reportCount + 1, std::memory_order_relaxed);
+}
+
+JoyConMetricsSnapshot JoyConMetrics::getSnapshot() const
+{
+	return {
+		m_reportLatency.getSnapshot(),
+		m_decodeTime.getSnapshot(),
+		m_reportInterval.getSnapshot(),
+		m_subcommandRoundTrip.getSnapshot(),
+		m_rumbleLatency.getSnapshot(),
+		m_reportCount.load(std::memory_order_relaxed),
+		m_discardedPacketCount.load(std::memory_order_relaxed),
+		m_subcommandRetryCount.load(std::memory_order_relaxed),
+		m_subcommandTimeoutCount.load(std::memory_order_relaxed),
+		m_rumbleReportCount.load(std::memory_order_relaxed),
+		std::chrono::steady_clock::now()
+	};
+}
+}
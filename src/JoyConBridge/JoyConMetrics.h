@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include "LatencyHistogram.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * The metrics of a JoyCon at some point in time.
+ */
+struct JoyConMetricsSnapshot
+{
+	// From when the JoyCon sent a report until it was applied. Measured against the report that took the least time
+	// so far (see `ReportClock`), since the clocks of the JoyCon and the host can't be compared directly.
+	LatencySnapshot reportLatency;
+	LatencySnapshot decodeTime; // From when a report was read until it was decoded and published.
+	LatencySnapshot reportInterval; // Between reading consecutive reports.
+	LatencySnapshot subcommandRoundTrip; // From writing a subcommand until its reply was read.
+	LatencySnapshot rumbleLatency; // From setting a rumble until the first report that carries it was written.
+	uint64_t reportCount;
+	uint64_t discardedPacketCount; // Packets that were read, but were not input reports.
+	uint64_t subcommandRetryCount;
+	uint64_t subcommandTimeoutCount; // Subcommands that ran out of retries.
+	uint64_t rumbleReportCount;
+	std::chrono::steady_clock::time_point time; // When the snapshot was taken.
+};
+
+/**
+	@brief Where the time of a single JoyCon goes, from the radio to the callers of `poll`.
+
+	Each JoyCon records into its own metrics as it reads reports and handles the replies to its subcommands, which
+	costs a few nanoseconds per report. All of that happens on the thread that reads the reports, except for rumble,
+	which is recorded by the thread that streams it. So each metric has a single writer. Snapshots may be taken from
+	any thread, at any time, without blocking the JoyCon.
+*/
+class JoyConMetrics
+{
+public:
+	JoyConMetrics();
+
+	JoyConMetrics(const JoyConMetrics&) = delete;
+	JoyConMetrics& operator=(const JoyConMetrics&) = delete;
+
+	/**
+		@brief Records a report that was applied.
+
+		@param[in] sampleTime When the JoyCon sent the report, on the host's clock.
+		@param[in] receiveTime When the report was read.
+		@param[in] appliedTime When the report was decoded and published.
+	*/
+	void recordReport(std::chrono::steady_clock::time_point sampleTime,
+	                  std::chrono::steady_clock::time_point receiveTime,
+	                  std::chrono::steady_clock::time_point appliedTime);
+
+	void recordDiscardedPacket()
+	{
+		m_discardedPacketCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void recordSubcommandReply(std::chrono::steady_clock::duration roundTrip)
+	{
+		m_subcommandRoundTrip.record(roundTrip);
+	}
+
+	void recordSubcommandRetry()
+	{
+		m_subcommandRetryCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void recordSubcommandTimeout()
+	{
+		m_subcommandTimeoutCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/**
+		@brief Records a rumble report that was written.
+	*/
+	void recordRumbleReport()
+	{
+		// Only the thread that streams the rumble writes this, so it doesn't have to be a locked increment.
+		m_rumbleReportCount.store(m_rumbleReportCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	/**
+		@brief Records how long it took a rumble that was set to be written.
+	*/
+	void recordRumbleLatency(std::chrono::steady_clock::duration latency)
+	{
+		m_rumbleLatency.record(latency);
+	}
+
+	JoyConMetricsSnapshot getSnapshot() const;
+
+private:
+	LatencyHistogram m_reportLatency;
+	LatencyHistogram m_decodeTime;
+	LatencyHistogram m_reportInterval;
+	LatencyHistogram m_subcommandRoundTrip;
+	LatencyHistogram m_rumbleLatency;
+	std::atomic<uint64_t> m_reportCount;
+	std::atomic<uint64_t> m_discardedPacketCount;
+	std::atomic<uint64_t> m_subcommandRetryCount;
+	std::atomic<uint64_t> m_subcommandTimeoutCount;
+	std::atomic<uint64_t> m_rumbleReportCount;
+	std::chrono::steady_clock::time_point m_previousReceiveTime; // Only touched by the thread that reads reports.
+};
+}
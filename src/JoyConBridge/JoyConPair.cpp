@@ -0,0 +1,84 @@
+#include <algorithm>
+#include "JoyConPair.h"
+
+
+namespace joy_con_bridge
+{
+const size_t LEFT_HALF = 0;
+const size_t RIGHT_HALF = 1;
+
+JoyConPair::JoyConPair(JoyCon left, JoyCon right)
+	: m_sampleTimes{}
+	, m_hasReported{}
+	, m_state{}
+{
+	m_pool.add(std::move(left));
+	m_pool.add(std::move(right));
+}
+
+size_t JoyConPair::poll(std::chrono::milliseconds timeout)
+{
+	return poll(timeout, [](const JoyConPairState&) {});
+}
+
+const JoyConPairState& JoyConPair::getState() const
+{
+	return m_state;
+}
+
+JoyCon& JoyConPair::getLeft()
+{
+	return m_pool.getJoyCon(LEFT_HALF);
+}
+
+JoyCon& JoyConPair::getRight()
+{
+	return m_pool.getJoyCon(RIGHT_HALF);
+}
+
+void JoyConPair::collectReports(std::chrono::milliseconds timeout)
+{
+	m_pendingReports.clear();
+	m_pool.poll(timeout, [this](size_t half, const JoyConState& state) {
+		m_pendingReports.push_back({half, state});
+	});
+
+	for (const size_t half : {LEFT_HALF, RIGHT_HALF}) {
+		if (const std::exception_ptr error = m_pool.getError(half)) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	// Reports that were read together arrived together, even though they were sampled apart. Their timestamps are
+	// estimated from the clock of the JoyCon, so they tell the order they were sampled in.
+	std::stable_sort(m_pendingReports.begin(), m_pendingReports.end(),
+	                 [](const PendingReport& first, const PendingReport& second) {
+		                 return first.state.timestamp.sampleTime < second.state.timestamp.sampleTime;
+	                 });
+}
+
+void JoyConPair::mergeReport(const PendingReport& report)
+{
+	if (LEFT_HALF == report.half) {
+		m_state.left = report.state;
+		m_state.leftStick = report.state.leftStick;
+	} else {
+		m_state.right = report.state;
+		m_state.rightStick = report.state.rightStick;
+	}
+
+	// Each half only reports the buttons of its own JoyCon.
+	const ButtonMask half = LEFT_HALF == report.half ? button_bits::LEFT_JOY_CON_BUTTONS :
+		button_bits::RIGHT_JOY_CON_BUTTONS;
+	m_state.buttonEdges.update((m_state.buttonEdges.held() & ~half) | (report.state.buttonEdges.held() & half));
+	m_state.buttons = decode::getButtonsState(m_state.buttonEdges.held());
+
+	m_sampleTimes[report.half] = report.state.timestamp.sampleTime;
+	m_hasReported[report.half] = true;
+	if (m_hasReported[LEFT_HALF] && m_hasReported[RIGHT_HALF]) {
+		const auto skew = m_sampleTimes[LEFT_HALF] - m_sampleTimes[RIGHT_HALF];
+		m_state.skew = std::chrono::duration_cast<std::chrono::microseconds>(
+			skew < skew.zero() ? -skew : skew);
+	}
+}
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <vector>
+#include "JoyCon.h"
+#include "JoyConPool.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * The combined state of a left and a right JoyCon, as if they were a single controller.
+ */
+struct JoyConPairState
+{
+	ButtonsState buttons; // The left JoyCon's half of the buttons, together with the right JoyCon's half.
+	ButtonEdges buttonEdges; // The same as `buttons`, as masks. The previous mask is that of the previous merge.
+	AnalogStick leftStick;
+	AnalogStick rightStick;
+	JoyConState left; // Everything the left JoyCon reported, including its motion.
+	JoyConState right; // Everything the right JoyCon reported, including its motion.
+	std::chrono::microseconds skew; // How far apart the two halves were sampled.
+};
+
+/**
+	@brief Merges a left and a right JoyCon into a single virtual controller.
+
+	Both JoyCons are waited for at once, so polling returns as soon as either half reports. Reports are merged in the
+	order they were sampled, which is estimated from their arrival time and their timer byte.
+*/
+class JoyConPair
+{
+public:
+	/**
+		@brief Takes ownership of both halves.
+
+		@param[in] left The left JoyCon. It must not be used by anyone else from now on.
+		@param[in] right The right JoyCon. It must not be used by anyone else from now on.
+	*/
+	JoyConPair(JoyCon left, JoyCon right);
+
+	/**
+		@brief Waits for reports from either half, and merges every report that is waiting.
+
+		@param[in] timeout The longest time to wait for a report.
+		@param[in] onState Called with a `const JoyConPairState&` after each report is merged, in the order the reports
+		                   were sampled.
+
+		@return The number of reports that were merged. 0 if the timeout was reached.
+
+		@throws Whatever made either half fail. See `JoyCon::pollAll`.
+	*/
+	template <typename Callback>
+	size_t poll(std::chrono::milliseconds timeout, Callback&& onState)
+	{
+		collectReports(timeout);
+		for (const PendingReport& report : m_pendingReports) {
+			mergeReport(report);
+			onState(static_cast<const JoyConPairState&>(m_state));
+		}
+
+		return m_pendingReports.size();
+	}
+
+	/**
+		@brief Same as `poll(timeout, onState)`, for callers that only care about the latest state.
+	*/
+	size_t poll(std::chrono::milliseconds timeout);
+
+	const JoyConPairState& getState() const;
+
+	/**
+		@brief Gets the left JoyCon, to send subcommands to it for example. It must not be polled directly.
+	*/
+	JoyCon& getLeft();
+
+	/**
+		@brief Gets the right JoyCon, to send subcommands to it for example. It must not be polled directly.
+	*/
+	JoyCon& getRight();
+
+private:
+	/*
+	 * A report of either half that was read, but not merged yet.
+	 */
+	struct PendingReport
+	{
+		size_t half; // The index of the JoyCon in the pool.
+		JoyConState state;
+	};
+
+	/**
+		@brief Reads the waiting reports of both halves into `m_pendingReports`, sorted by their sample time.
+	*/
+	void collectReports(std::chrono::milliseconds timeout);
+
+	/**
+		@brief Updates the combined state with a report of either half.
+	*/
+	void mergeReport(const PendingReport& report);
+
+	JoyConPool m_pool;
+	std::vector<PendingReport> m_pendingReports;
+	std::array<std::chrono::steady_clock::time_point, 2> m_sampleTimes; // Of the latest merged report of each half.
+	std::array<bool, 2> m_hasReported;
+	JoyConPairState m_state;
+};
+}
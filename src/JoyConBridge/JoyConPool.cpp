@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <thread>
+#include "exceptions.h"
+#include "JoyConPool.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+
+namespace joy_con_bridge
+{
+// While only round-robin JoyCons are idle, they are read again after this long.
+const std::chrono::milliseconds ROUND_ROBIN_IDLE_INTERVAL(1);
+
+JoyConPool::JoyConPool()
+	: m_nextPendingWorkTime()
+	, m_wasIdle(false)
+	, m_epoll(-1)
+	, m_waitedJoyConCount(0)
+{
+#ifdef __linux__
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+#endif
+}
+
+JoyConPool::~JoyConPool()
+{
+#ifdef __linux__
+	if (-1 != m_epoll) {
+		close(m_epoll);
+	}
+#endif
+}
+
+size_t JoyConPool::add(JoyCon joyCon)
+{
+	const size_t index = m_joyCons.size();
+	m_joyCons.push_back(std::move(joyCon));
+	m_errors.emplace_back();
+	m_addTimes.push_back(std::chrono::steady_clock::now());
+	m_snapshotStates.push_back(m_joyCons.back().getState());
+
+#ifdef __linux__
+	const int descriptor = m_joyCons.back().getTransport().getFileDescriptor();
+	epoll_event event{};
+	event.events = EPOLLIN;
+	event.data.u64 = index;
+	if (-1 != m_epoll && -1 != descriptor && 0 == epoll_ctl(m_epoll, EPOLL_CTL_ADD, descriptor, &event)) {
+		++m_waitedJoyConCount;
+		return index;
+	}
+#endif
+
+	m_roundRobinJoyCons.push_back(index);
+	return index;
+}
+
+size_t JoyConPool::size() const
+{
+	return m_joyCons.size();
+}
+
+size_t JoyConPool::poll(std::chrono::milliseconds timeout)
+{
+	return poll(timeout, [](size_t, const JoyConState&) {});
+}
+
+JoyCon& JoyConPool::getJoyCon(size_t index)
+{
+	return m_joyCons[index];
+}
+
+const JoyConState& JoyConPool::getState(size_t index) const
+{
+	return m_joyCons[index].getState();
+}
+
+std::exception_ptr JoyConPool::getError(size_t index) const
+{
+	return m_errors[index];
+}
+
+bool JoyConPool::getSnapshot(std::vector<JoyConState>& states)
+{
+	return m_snapshot.read(states);
+}
+
+bool JoyConPool::isWaitingForDevices() const
+{
+	return -1 != m_epoll;
+}
+
+void JoyConPool::waitForReports(std::chrono::steady_clock::time_point deadline)
+{
+	m_readyJoyCons.clear();
+	m_hungUpJoyCons.clear();
+
+	// Silent JoyCons are looked after no later than their pending work is due.
+	auto waitTime = std::chrono::ceil<std::chrono::milliseconds>(std::min(deadline, m_nextPendingWorkTime) -
+	                                                             std::chrono::steady_clock::now());
+	waitTime = std::max(waitTime, std::chrono::milliseconds(0));
+	if (!m_roundRobinJoyCons.empty()) {
+		// The round-robin JoyCons are read right away, unless they just turned out to be idle.
+		waitTime = m_wasIdle ? std::min(waitTime, ROUND_ROBIN_IDLE_INTERVAL) : std::chrono::milliseconds(0);
+	}
+
+#ifdef __linux__
+	if (0 != m_waitedJoyConCount) {
+		// Devices that don't fit are still ready on the next wait, since epoll is level-triggered.
+		static const int MAX_EVENTS = 64;
+		epoll_event events[MAX_EVENTS];
+		const int readyCount = epoll_wait(m_epoll, events, MAX_EVENTS, static_cast<int>(waitTime.count()));
+		for (int i = 0; i < readyCount; ++i) {
+			const auto index = static_cast<size_t>(events[i].data.u64);
+			m_readyJoyCons.push_back(index);
+			if (0 != (events[i].events & (EPOLLHUP | EPOLLERR))) {
+				m_hungUpJoyCons.push_back(index);
+			}
+		}
+		waitTime = std::chrono::milliseconds(0);
+	}
+#endif
+
+	if (std::chrono::milliseconds(0) < waitTime) {
+		std::this_thread::sleep_for(waitTime);
+	}
+
+	for (const size_t index : m_roundRobinJoyCons) {
+		if (!m_errors[index]) {
+			m_readyJoyCons.push_back(index);
+		}
+	}
+}
+
+void JoyConPool::fail(size_t index, std::exception_ptr error)
+{
+	m_errors[index] = std::move(error);
+
+#ifdef __linux__
+	const int descriptor = m_joyCons[index].getTransport().getFileDescriptor();
+	if (-1 != m_epoll && -1 != descriptor && 0 == epoll_ctl(m_epoll, EPOLL_CTL_DEL, descriptor, nullptr)) {
+		--m_waitedJoyConCount;
+	}
+#endif
+}
+
+void JoyConPool::failHungUpJoyCons()
+{
+	for (const size_t index : m_hungUpJoyCons) {
+		if (!m_errors[index]) {
+			fail(index, std::make_exception_ptr(JoyConNotResponding()));
+		}
+	}
+}
+
+void JoyConPool::handleSilentJoyCons()
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (now < m_nextPendingWorkTime) {
+		return;
+	}
+	m_nextPendingWorkTime = now + PENDING_WORK_INTERVAL;
+
+	for (size_t index = 0; index < m_joyCons.size(); ++index) {
+		if (m_errors[index]) {
+			continue;
+		}
+
+		try {
+			m_joyCons[index].handlePendingWork();
+		} catch (...) {
+			fail(index, std::current_exception());
+			continue;
+		}
+
+		const Health health = m_joyCons[index].getHealth();
+		if (HealthStatus::STALLED == health.status && health.timeSinceLastReport >= JoyCon::NOT_RESPONDING_TIMEOUT &&
+		    now - m_addTimes[index] >= JoyCon::NOT_RESPONDING_TIMEOUT) {
+			fail(index, std::make_exception_ptr(JoyConNotResponding()));
+		}
+	}
+}
+
+void JoyConPool::publishSnapshot()
+{
+	for (size_t i = 0; i < m_joyCons.size(); ++i) {
+		m_snapshotStates[i] = m_joyCons[i].getState();
+	}
+	m_snapshot.write(m_snapshotStates);
+}
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <chrono>
+#include <exception>
+#include <vector>
+#include "JoyCon.h"
+#include "TripleBuffer.h"
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Serves many JoyCons from a single thread.
+
+	Instead of a blocking `poll` per JoyCon, the devices of all the JoyCons are waited for at once (with epoll on
+	Linux), and each arriving report is applied to its own JoyCon. JoyCons whose devices can't be waited for are read
+	round-robin without blocking.
+
+	All the functions must be called from a single thread, except for `getSnapshot`, which is meant for another one.
+*/
+class JoyConPool
+{
+public:
+	// How often the JoyCons that have no reports get their subcommands timed out, and are checked for a stall.
+	static constexpr std::chrono::milliseconds PENDING_WORK_INTERVAL{50};
+
+	JoyConPool();
+
+	~JoyConPool();
+
+	JoyConPool(const JoyConPool&) = delete;
+	JoyConPool& operator=(const JoyConPool&) = delete;
+
+	/**
+		@brief Takes ownership of a JoyCon and starts serving it.
+
+		@param[in] joyCon The JoyCon. It must not be used by anyone else from now on.
+
+		@return The index of the JoyCon in the pool.
+	*/
+	size_t add(JoyCon joyCon);
+
+	size_t size() const;
+
+	/**
+		@brief Waits for reports from any of the JoyCons, and applies every report that is waiting. See
+		`JoyCon::pollAll`.
+		A JoyCon that fails stops being served, and its error is kept instead of thrown (see `getError`). So does a
+		JoyCon that sent nothing for `JoyCon::NOT_RESPONDING_TIMEOUT`, with `JoyConNotResponding`.
+
+		@param[in] timeout The longest time to wait for a report.
+		@param[in] onReport Called with the index of the JoyCon and a `const JoyConState&` after each report is
+		                    applied.
+
+		@return The number of reports that were applied. 0 if the timeout was reached.
+	*/
+	template <typename Callback>
+	size_t poll(std::chrono::milliseconds timeout, Callback&& onReport)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+		size_t reportsApplied = 0;
+		do {
+			waitForReports(deadline);
+			for (const size_t index : m_readyJoyCons) {
+				try {
+					reportsApplied += m_joyCons[index].pollAll([index, &onReport](const JoyConState& state) {
+						onReport(index, state);
+					});
+				} catch (...) {
+					fail(index, std::current_exception());
+				}
+			}
+			failHungUpJoyCons();
+			handleSilentJoyCons();
+			m_wasIdle = 0 == reportsApplied;
+		} while (m_wasIdle && std::chrono::steady_clock::now() < deadline);
+
+		publishSnapshot();
+		return reportsApplied;
+	}
+
+	/**
+		@brief Same as `poll(timeout, onReport)`, for callers that only care about the latest states.
+	*/
+	size_t poll(std::chrono::milliseconds timeout);
+
+	/**
+		@brief Gets a JoyCon in the pool, to send subcommands to it for example. It must not be polled directly.
+	*/
+	JoyCon& getJoyCon(size_t index);
+
+	/**
+		@brief Gets the state decoded from the latest report of a JoyCon.
+	*/
+	const JoyConState& getState(size_t index) const;
+
+	/**
+		@brief Gets the error that made a JoyCon stop being served.
+
+		@return The error, or nullptr if the JoyCon is still served.
+	*/
+	std::exception_ptr getError(size_t index) const;
+
+	/**
+		@brief Gets the states of all the JoyCons, as they were at the end of the same `poll`.
+		This may be called from a thread other than the polling one (but only from one such thread), and does not
+		block. It only allocates when the pool grew since the last snapshot.
+
+		@param[out] states Receives the state of each JoyCon, by index.
+
+		@return false if `poll` was never called, in which case `states` is left untouched.
+	*/
+	bool getSnapshot(std::vector<JoyConState>& states);
+
+	/**
+		@brief Checks if the devices are waited for, rather than read round-robin.
+		This is false on platforms without epoll.
+	*/
+	bool isWaitingForDevices() const;
+
+private:
+	/**
+		@brief Waits until some JoyCons have reports to read, or until the deadline.
+		Fills `m_readyJoyCons` with their indexes.
+	*/
+	void waitForReports(std::chrono::steady_clock::time_point deadline);
+
+	/**
+		@brief Stops serving a JoyCon.
+	*/
+	void fail(size_t index, std::exception_ptr error);
+
+	/**
+		@brief Stops serving the JoyCons whose devices hung up, once their last reports were applied.
+	*/
+	void failHungUpJoyCons();
+
+	/**
+		@brief Does the pending work of every JoyCon, every `PENDING_WORK_INTERVAL`, since those without reports are
+		not polled. Stops serving those that stalled for `JoyCon::NOT_RESPONDING_TIMEOUT`.
+	*/
+	void handleSilentJoyCons();
+
+	/**
+		@brief Publishes the current states for `getSnapshot`.
+	*/
+	void publishSnapshot();
+
+	std::vector<JoyCon> m_joyCons;
+	std::vector<std::exception_ptr> m_errors;
+	std::vector<std::chrono::steady_clock::time_point> m_addTimes; // A JoyCon is not stalled before it was served.
+	std::chrono::steady_clock::time_point m_nextPendingWorkTime;
+	std::vector<size_t> m_readyJoyCons;
+	std::vector<size_t> m_hungUpJoyCons;
+	bool m_wasIdle; // The last round of reads found no reports.
+
+	int m_epoll; // -1 if the devices can't be waited for.
+	size_t m_waitedJoyConCount; // The number of JoyCons in the epoll set.
+	std::vector<size_t> m_roundRobinJoyCons; // The JoyCons that can't be waited for.
+
+	std::vector<JoyConState> m_snapshotStates;
+	TripleBuffer<std::vector<JoyConState>> m_snapshot;
+};
+}
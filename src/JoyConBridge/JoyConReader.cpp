@@ -0,0 +1,86 @@
+#include "JoyConReader.h"
+#include "exceptions.h"
+
+
+namespace joy_con_bridge
+{
+JoyConReader::JoyConReader(JoyCon joyCon)
+	: m_joyCon(std::move(joyCon))
+	, m_drainedState{}
+	, m_droppedCount(0)
+	, m_running(true)
+	, m_failed(false)
+	, m_thread(&JoyConReader::readLoop, this)
+{}
+
+JoyConReader::~JoyConReader()
+{
+	m_running = false;
+	m_thread.join();
+}
+
+bool JoyConReader::getLatestState(JoyConState& state)
+{
+	throwIfFailed();
+	return m_latest.read(state);
+}
+
+std::future<Buffer> JoyConReader::sendSubcommandAsync(uint8_t subcommandId, const Buffer& commandData,
+                                                      const SubcommandBudget& budget)
+{
+	return m_joyCon.sendSubcommandAsync(subcommandId, commandData, budget);
+}
+
+void JoyConReader::setRumble(const Rumble& rumble)
+{
+	m_joyCon.setRumble(rumble);
+}
+
+void JoyConReader::stopRumble()
+{
+	m_joyCon.stopRumble();
+}
+
+size_t JoyConReader::getDroppedCount() const
+{
+	return m_droppedCount;
+}
+
+Health JoyConReader::getHealth() const noexcept
+{
+	return m_joyCon.getHealth();
+}
+
+void JoyConReader::readLoop()
+{
+	try {
+		// Reads wait no longer than STOP_CHECK_PERIOD, so the destructor doesn't wait for a JoyCon that went silent.
+		auto lastReportTime = std::chrono::steady_clock::now();
+		while (m_running) {
+			if (!m_joyCon.poll(STOP_CHECK_PERIOD)) {
+				if (std::chrono::steady_clock::now() - lastReportTime >= JoyCon::NOT_RESPONDING_TIMEOUT) {
+					throw JoyConNotResponding();
+				}
+				continue;
+			}
+			lastReportTime = std::chrono::steady_clock::now();
+
+			const JoyConState& state = m_joyCon.getState();
+			m_latest.write(state);
+			if (!m_history.tryPush(state)) {
+				++m_droppedCount;
+			}
+		}
+	} catch (...) {
+		m_error = std::current_exception();
+		m_failed.store(true, std::memory_order_release);
+	}
+}
+
+void JoyConReader::throwIfFailed() const
+{
+	if (m_failed.load(std::memory_order_acquire)) {
+		std::rethrow_exception(m_error);
+	}
+}
+}
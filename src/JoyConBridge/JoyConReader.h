@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include "JoyCon.h"
+#include "SpscRing.h"
+#include "TripleBuffer.h"
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Polls a JoyCon on a dedicated thread, so the consuming thread never waits for reports.
+
+	Every decoded report is published both as the latest state and into a fixed-size history, which the consumer can
+	drain. All the consumer functions must be called from a single thread, and none of them block or allocate.
+*/
+class JoyConReader
+{
+public:
+	// The number of reports kept in the history. At ~60 reports per second, this is about a second.
+	static const size_t HISTORY_CAPACITY = 64;
+	// The longest the reader thread waits for a report before it checks whether it should stop.
+	static constexpr std::chrono::milliseconds STOP_CHECK_PERIOD{50};
+
+	/**
+		@brief Takes ownership of a JoyCon and starts reading from it in the background.
+
+		@param[in] joyCon The JoyCon to read from. It must not be used by anyone else from now on.
+	*/
+	explicit JoyConReader(JoyCon joyCon);
+
+	/**
+		@brief Stops reading. Blocks until the reader thread notices, which takes no longer than `STOP_CHECK_PERIOD`
+		(plus the report it may be applying).
+	*/
+	~JoyConReader();
+
+	JoyConReader(const JoyConReader&) = delete;
+	JoyConReader& operator=(const JoyConReader&) = delete;
+
+	/**
+		@brief Gets the state decoded from the newest report.
+
+		@param[out] state Receives the newest state.
+
+		@return false if no report was received yet.
+
+		@throws Whatever `JoyCon::poll` threw on the reader thread, once the reader has stopped because of it.
+	*/
+	bool getLatestState(JoyConState& state);
+
+	/**
+		@brief Hands every state that was decoded since the last drain to a callback, from oldest to newest.
+
+		@param[in] callback Called with a `const JoyConState&` for each state.
+
+		@return The number of states handed to the callback.
+
+		@throws Whatever `JoyCon::poll` threw on the reader thread, once the reader has stopped because of it.
+	*/
+	template <typename Callback>
+	size_t drainHistory(Callback&& callback)
+	{
+		throwIfFailed();
+
+		size_t drained = 0;
+		while (m_history.tryPop(m_drainedState)) {
+			callback(static_cast<const JoyConState&>(m_drainedState));
+			++drained;
+		}
+
+		return drained;
+	}
+
+	/**
+		@brief Sends a subcommand to the JoyCon without waiting for its reply. See `JoyCon::sendSubcommandAsync`.
+	*/
+	std::future<Buffer> sendSubcommandAsync(uint8_t subcommandId, const Buffer& commandData,
+	                                        const SubcommandBudget& budget = DEFAULT_SUBCOMMAND_BUDGET);
+
+	/**
+		@brief Rumbles the JoyCon until the rumble is changed. See `JoyCon::setRumble`.
+	*/
+	void setRumble(const Rumble& rumble);
+
+	/**
+		@brief Stops the rumble of the JoyCon. See `JoyCon::stopRumble`.
+	*/
+	void stopRumble();
+
+	/**
+		@brief Gets the number of states that were dropped from the history because it was not drained in time.
+	*/
+	size_t getDroppedCount() const;
+
+	/**
+		@brief Gets how well the reports of the JoyCon arrive. Unlike the other consumer functions, this may be called
+		from any thread. See `JoyCon::getHealth`.
+	*/
+	Health getHealth() const noexcept;
+
+private:
+	/**
+		@brief The body of the reader thread. Polls until stopped or until the JoyCon fails.
+	*/
+	void readLoop();
+
+	/**
+		@brief Rethrows the error that stopped the reader thread, if any.
+	*/
+	void throwIfFailed() const;
+
+	JoyCon m_joyCon;
+
+	SpscRing<JoyConState, HISTORY_CAPACITY> m_history;
+	TripleBuffer<JoyConState> m_latest;
+	JoyConState m_drainedState;
+	std::atomic<size_t> m_droppedCount;
+
+	std::atomic<bool> m_running;
+	std::atomic<bool> m_failed;
+	std::exception_ptr m_error;
+
+	std::thread m_thread;
+};
+}
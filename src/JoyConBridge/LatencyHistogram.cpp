@@ -0,0 +1,59 @@
+#include <algorithm>
+#include <cmath>
+#include "LatencyHistogram.h"
+
+
+namespace joy_con_bridge
+{
+std::chrono::nanoseconds LatencySnapshot::getQuantile(double quantile) const
+{
+	if (0 == count) {
+		return std::chrono::nanoseconds(0);
+	}
+
+	// The rank of the value, counting from 1.
+	const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * count)));
+	uint64_t seen = 0;
+	for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+		seen += counts[bucket];
+		if (seen >= rank) {
+			return std::chrono::nanoseconds(std::min(getBucketStart(bucket), static_cast<uint64_t>(max.count())));
+		}
+	}
+
+	// The buckets were snapshotted before the count caught up with them.
+	return max;
+}
+
+uint64_t LatencySnapshot::getBucketStart(size_t bucket)
+{
+	if (bucket < SUB_BUCKET_COUNT) {
+		return bucket;
+	}
+
+	const size_t shift = bucket / SUB_BUCKET_COUNT - 1;
+	return static_cast<uint64_t>(SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT) << shift;
+}
+
+LatencyHistogram::LatencyHistogram()
+	: m_count(0)
+	, m_sum(0)
+	, m_max(0)
+{
+	for (auto& count : m_counts) {
+		count.store(0, std::memory_order_relaxed);
+	}
+}
+
+LatencySnapshot LatencyHistogram::getSnapshot() const
+{
+	LatencySnapshot snapshot{};
+	for (size_t bucket = 0; bucket < LatencySnapshot::BUCKET_COUNT; ++bucket) {
+		snapshot.counts[bucket] = m_counts[bucket].load(std::memory_order_relaxed);
+	}
+	snapshot.count = m_count.load(std::memory_order_relaxed);
+	snapshot.sum = std::chrono::nanoseconds(m_sum.load(std::memory_order_relaxed));
+	snapshot.max = std::chrono::nanoseconds(m_max.load(std::memory_order_relaxed));
+	return snapshot;
+}
+}
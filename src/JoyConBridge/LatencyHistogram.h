@@ -0,0 +1,126 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+namespace joy_con_bridge
+{
+/*
+ * The counts of a `LatencyHistogram` at some point in time. Unlike the histogram, it can be copied and kept.
+ */
+struct LatencySnapshot
+{
+	// Buckets are log-linear, like in HdrHistogram: each power of 2 is split into this many buckets of equal width,
+	// so any value is off by less than 1 / SUB_BUCKET_COUNT of itself.
+	static const size_t SUB_BUCKET_BITS = 4;
+	static const size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	// Values of up to 2^40 ns (about 18 minutes) are told apart. Longer ones are counted in the last bucket.
+	static const size_t MAX_VALUE_BITS = 40;
+	static const size_t BUCKET_COUNT = SUB_BUCKET_COUNT * (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2);
+
+	std::array<uint64_t, BUCKET_COUNT> counts;
+	uint64_t count;
+	std::chrono::nanoseconds sum;
+	std::chrono::nanoseconds max;
+
+	/**
+		@brief Gets the value below which a given part of the recorded values are.
+
+		@param[in] quantile In [0, 1], 0.99 for the 99th percentile for example.
+
+		@return The lowest value of the bucket the quantile falls in, or 0 if nothing was recorded.
+	*/
+	std::chrono::nanoseconds getQuantile(double quantile) const;
+
+	/**
+		@brief Gets the index of the bucket a value is counted in.
+	*/
+	static size_t getBucket(uint64_t nanoseconds);
+
+	/**
+		@brief Gets the lowest value that is counted in a bucket.
+	*/
+	static uint64_t getBucketStart(size_t bucket);
+};
+
+/**
+	@brief Counts latencies into buckets of a bounded relative error, without locks.
+
+	Recording is a few relaxed atomic loads and stores, so it is cheap enough to do for every report. Values must be
+	recorded from a single thread at a time, like the one that reads the reports, while any other thread takes
+	snapshots. A snapshot that is taken during a recording may count the value in some of its fields but not others.
+*/
+class LatencyHistogram
+{
+public:
+	LatencyHistogram();
+
+	LatencyHistogram(const LatencyHistogram&) = delete;
+	LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+	/**
+		@brief Counts a latency. Negative latencies are counted as 0.
+	*/
+	void record(std::chrono::nanoseconds latency)
+	{
+		const uint64_t value = latency.count() > 0 ? static_cast<uint64_t>(latency.count()) : 0;
+		increment(m_counts[LatencySnapshot::getBucket(value)], 1);
+		increment(m_count, 1);
+		increment(m_sum, value);
+		if (value > m_max.load(std::memory_order_relaxed)) {
+			m_max.store(value, std::memory_order_relaxed);
+		}
+	}
+
+	LatencySnapshot getSnapshot() const;
+
+private:
+	/**
+		@brief Adds to a counter that only the recording thread writes to. Unlike `fetch_add`, this is not a locked
+		instruction, which would cost more than everything else in `record`.
+	*/
+	static void increment(std::atomic<uint64_t>& counter, uint64_t value)
+	{
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<uint64_t>, LatencySnapshot::BUCKET_COUNT> m_counts;
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_sum; // In nanoseconds.
+	std::atomic<uint64_t> m_max; // In nanoseconds.
+};
+
+inline size_t LatencySnapshot::getBucket(uint64_t nanoseconds)
+{
+	if (nanoseconds < SUB_BUCKET_COUNT) {
+		return static_cast<size_t>(nanoseconds);
+	}
+
+	if (0 != (nanoseconds >> (MAX_VALUE_BITS + 1))) {
+		return BUCKET_COUNT - 1;
+	}
+
+#ifdef _MSC_VER
+	// Values that got here fit in 41 bits, and _BitScanReverse64 is missing from 32 bit builds.
+	unsigned long highestBit;
+	if (!_BitScanReverse(&highestBit, static_cast<unsigned long>(nanoseconds >> 32))) {
+		_BitScanReverse(&highestBit, static_cast<unsigned long>(nanoseconds));
+	} else {
+		highestBit += 32;
+	}
+#else
+	const size_t highestBit = 63 - __builtin_clzll(nanoseconds);
+#endif
+
+	// The bits below the highest one pick the bucket within the power of 2.
+	const size_t shift = highestBit - SUB_BUCKET_BITS;
+	const size_t subBucket = static_cast<size_t>(nanoseconds >> shift) - SUB_BUCKET_COUNT;
+	return SUB_BUCKET_COUNT * (shift + 1) + subBucket;
+}
+}
@@ -0,0 +1,251 @@
+#include "MappedFile.h"
+#include "exceptions.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Builds the error of a failed operation on a mapped file, from the last system error.
+
+	@param[in] operation What was being done, for example "map".
+	@param[in] path The path of the file.
+*/
+static MappedFileError getLastError(const char* operation, const std::string& path)
+{
+#ifdef _WIN32
+	const std::string reason = "error " + std::to_string(GetLastError());
+#else
+	const std::string reason = std::strerror(errno);
+#endif
+	return MappedFileError("Can't " + std::string(operation) + " " + path + ": " + reason);
+}
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string& path, size_t size)
+	: m_path(path)
+	, m_data(nullptr)
+	, m_size(size)
+	, m_isWritable(true)
+	, m_file(INVALID_HANDLE_VALUE)
+	, m_mapping(nullptr)
+{
+	m_file = CreateFileA(path.data(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+	                     FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == m_file) {
+		throw getLastError("create", path);
+	}
+
+	try {
+		map();
+	} catch (const MappedFileError&) {
+		closeFile();
+		throw;
+	}
+}
+
+MappedFile::MappedFile(const std::string& path)
+	: m_path(path)
+	, m_data(nullptr)
+	, m_size(0)
+	, m_isWritable(false)
+	, m_file(INVALID_HANDLE_VALUE)
+	, m_mapping(nullptr)
+{
+	m_file = CreateFileA(path.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+	                     FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == m_file) {
+		throw getLastError("open", path);
+	}
+
+	try {
+		LARGE_INTEGER fileSize = {};
+		if (!GetFileSizeEx(m_file, &fileSize)) {
+			throw getLastError("open", path);
+		}
+		m_size = static_cast<size_t>(fileSize.QuadPart);
+		map();
+	} catch (const MappedFileError&) {
+		closeFile();
+		throw;
+	}
+}
+
+void MappedFile::resize(size_t size)
+{
+	unmap();
+
+	LARGE_INTEGER end = {};
+	end.QuadPart = static_cast<LONGLONG>(size);
+	if (!SetFilePointerEx(m_file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+		throw getLastError("resize", m_path);
+	}
+	m_size = size;
+
+	map();
+}
+
+void MappedFile::flush()
+{
+	if (!FlushViewOfFile(m_data, m_size) || (m_isWritable && !FlushFileBuffers(m_file))) {
+		throw getLastError("flush", m_path);
+	}
+}
+
+void MappedFile::map()
+{
+	const ULARGE_INTEGER mappingSize = {{static_cast<DWORD>(m_size), static_cast<DWORD>(uint64_t(m_size) >> 32)}};
+	m_mapping = CreateFileMappingA(m_file, nullptr, m_isWritable ? PAGE_READWRITE : PAGE_READONLY,
+	                               mappingSize.HighPart, mappingSize.LowPart, nullptr);
+	if (nullptr == m_mapping) {
+		throw getLastError("map", m_path);
+	}
+
+	m_data = static_cast<uint8_t*>(MapViewOfFile(m_mapping, m_isWritable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0,
+	                                             m_size));
+	if (nullptr == m_data) {
+		const auto error = getLastError("map", m_path);
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+		throw error;
+	}
+}
+
+void MappedFile::unmap()
+{
+	if (nullptr != m_data) {
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+	if (nullptr != m_mapping) {
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+}
+
+void MappedFile::closeFile()
+{
+	CloseHandle(m_file);
+}
+#else
+MappedFile::MappedFile(const std::string& path, size_t size)
+	: m_path(path)
+	, m_data(nullptr)
+	, m_size(size)
+	, m_isWritable(true)
+	, m_file(-1)
+{
+	m_file = open(path.data(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (-1 == m_file) {
+		throw getLastError("create", path);
+	}
+
+	try {
+		if (0 != ftruncate(m_file, static_cast<off_t>(size))) {
+			throw getLastError("resize", path);
+		}
+		map();
+	} catch (const MappedFileError&) {
+		closeFile();
+		throw;
+	}
+}
+
+MappedFile::MappedFile(const std::string& path)
+	: m_path(path)
+	, m_data(nullptr)
+	, m_size(0)
+	, m_isWritable(false)
+	, m_file(-1)
+{
+	m_file = open(path.data(), O_RDONLY | O_CLOEXEC);
+	if (-1 == m_file) {
+		throw getLastError("open", path);
+	}
+
+	try {
+		struct stat status = {};
+		if (0 != fstat(m_file, &status)) {
+			throw getLastError("open", path);
+		}
+		m_size = static_cast<size_t>(status.st_size);
+		map();
+	} catch (const MappedFileError&) {
+		closeFile();
+		throw;
+	}
+}
+
+void MappedFile::resize(size_t size)
+{
+	unmap();
+
+	if (0 != ftruncate(m_file, static_cast<off_t>(size))) {
+		throw getLastError("resize", m_path);
+	}
+	m_size = size;
+
+	map();
+}
+
+void MappedFile::flush()
+{
+	if (0 != msync(m_data, m_size, MS_SYNC)) {
+		throw getLastError("flush", m_path);
+	}
+}
+
+void MappedFile::map()
+{
+	void* const data = mmap(nullptr, m_size, PROT_READ | (m_isWritable ? PROT_WRITE : 0), MAP_SHARED, m_file, 0);
+	if (MAP_FAILED == data) {
+		throw getLastError("map", m_path);
+	}
+	m_data = static_cast<uint8_t*>(data);
+}
+
+void MappedFile::unmap()
+{
+	if (nullptr != m_data) {
+		munmap(m_data, m_size);
+		m_data = nullptr;
+	}
+}
+
+void MappedFile::closeFile()
+{
+	close(m_file);
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+	unmap();
+	closeFile();
+}
+
+uint8_t* MappedFile::data()
+{
+	return m_data;
+}
+
+const uint8_t* MappedFile::data() const
+{
+	return m_data;
+}
+
+size_t MappedFile::size() const
+{
+	return m_size;
+}
+}
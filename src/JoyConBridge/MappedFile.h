@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief A file that is mapped into memory.
+
+	Writes to the memory go to the page cache directly, without a system call per write. The contents reach the disk
+	at the latest when the file is unmapped.
+*/
+class MappedFile
+{
+public:
+	/**
+		@brief Creates a file of the given size, or truncates an existing one to it, and maps all of it for writing.
+
+		@param[in] path The path of the file.
+		@param[in] size The size of the file, in bytes. Must not be 0.
+
+		@throws MappedFileError If the file can't be created or mapped.
+	*/
+	MappedFile(const std::string& path, size_t size);
+
+	/**
+		@brief Maps all of an existing file for reading only.
+
+		@param[in] path The path of the file. The file must not be empty.
+
+		@throws MappedFileError If the file can't be opened or mapped.
+	*/
+	explicit MappedFile(const std::string& path);
+
+	/**
+		@brief Unmaps the file, which flushes it.
+	*/
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+		@brief Gets the mapped memory. Must not be written to if the file is mapped for reading only.
+	*/
+	uint8_t* data();
+
+	const uint8_t* data() const;
+
+	size_t size() const;
+
+	/**
+		@brief Grows or shrinks a file that is mapped for writing, and maps all of it again.
+		The contents up to the smaller of the sizes are kept. Pointers to the old mapping are invalidated.
+
+		@param[in] size The new size of the file, in bytes. Must not be 0.
+
+		@throws MappedFileError If the file can't be resized or mapped again. The file is left unmapped.
+	*/
+	void resize(size_t size);
+
+	/**
+		@brief Writes the contents of the memory to the disk, and waits for it to finish.
+
+		@throws MappedFileError If flushing fails.
+	*/
+	void flush();
+
+private:
+	/**
+		@brief Maps the whole file, according to `m_size` and `m_isWritable`.
+	*/
+	void map();
+
+	void unmap();
+
+	void closeFile();
+
+	std::string m_path;
+	uint8_t* m_data;
+	size_t m_size;
+	bool m_isWritable;
+#ifdef _WIN32
+	void* m_file; // HANDLE
+	void* m_mapping; // HANDLE
+#else
+	int m_file;
+#endif
+};
+}
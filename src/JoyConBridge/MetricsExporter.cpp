@@ -0,0 +1,215 @@
+#include <filesystem>
+#include <fstream>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "MetricsExporter.h"
+
+
+namespace joy_con_bridge
+{
+// The quantiles every latency summary is written with.
+const double QUANTILES[] = {0.5, 0.9, 0.99, 0.999};
+
+/*
+ * The metrics of a single JoyCon, as they are written.
+ */
+struct JoyConExport
+{
+	std::string label; // The `joycon` label, escaped.
+	JoyConMetricsSnapshot snapshot;
+	double reportsPerSecond;
+};
+
+static std::string escapeLabelValue(const std::string& value)
+{
+	std::string escaped;
+	for (const char character : value) {
+		switch (character) {
+		case '\\':
+			escaped += "\\\\";
+			break;
+		case '"':
+			escaped += "\\\"";
+			break;
+		case '\n':
+			escaped += "\\n";
+			break;
+		default:
+			escaped += character;
+		}
+	}
+	return escaped;
+}
+
+static double toSeconds(std::chrono::nanoseconds duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+static void writeHeader(std::ostream& output, const char* name, const char* type, const char* help)
+{
+	output << "# HELP " << name << ' ' << help << '\n';
+	output << "# TYPE " << name << ' ' << type << '\n';
+}
+
+static void writeSummary(std::ostream& output, const std::vector<JoyConExport>& joyCons, const char* name,
+                         const char* help, LatencySnapshot JoyConMetricsSnapshot::* latency)
+{
+	writeHeader(output, name, "summary", help);
+	for (const JoyConExport& joyCon : joyCons) {
+		const LatencySnapshot& snapshot = joyCon.snapshot.*latency;
+		for (const double quantile : QUANTILES) {
+			output << name << "{joycon=\"" << joyCon.label << "\",quantile=\"" << quantile << "\"} "
+			       << toSeconds(snapshot.getQuantile(quantile)) << '\n';
+		}
+		output << name << "_sum{joycon=\"" << joyCon.label << "\"} " << toSeconds(snapshot.sum) << '\n';
+		output << name << "_count{joycon=\"" << joyCon.label << "\"} " << snapshot.count << '\n';
+	}
+}
+
+static void writeCounter(std::ostream& output, const std::vector<JoyConExport>& joyCons, const char* name,
+                         const char* help, uint64_t JoyConMetricsSnapshot::* counter)
+{
+	writeHeader(output, name, "counter", help);
+	for (const JoyConExport& joyCon : joyCons) {
+		output << name << "{joycon=\"" << joyCon.label << "\"} " << joyCon.snapshot.*counter << '\n';
+	}
+}
+
+MetricsExporter::MetricsExporter()
+	: m_isStopping(false)
+{}
+
+MetricsExporter::~MetricsExporter()
+{
+	stopDumping();
+}
+
+void MetricsExporter::add(const std::string& name, std::shared_ptr<const JoyConMetrics> metrics)
+{
+	const JoyConMetricsSnapshot snapshot = metrics->getSnapshot();
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_joyCons[name] = {std::move(metrics), snapshot.reportCount, snapshot.time};
+}
+
+void MetricsExporter::remove(const std::string& name)
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_joyCons.erase(name);
+}
+
+void MetricsExporter::write(std::ostream& output)
+{
+	std::vector<JoyConExport> joyCons;
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		for (auto& [name, joyCon] : m_joyCons) {
+			JoyConExport exported{escapeLabelValue(name), joyCon.metrics->getSnapshot(), 0};
+			const double seconds = std::chrono::duration<double>(exported.snapshot.time - joyCon.previousTime).count();
+			if (seconds > 0) {
+				exported.reportsPerSecond = (exported.snapshot.reportCount - joyCon.previousReportCount) / seconds;
+			}
+			joyCon.previousReportCount = exported.snapshot.reportCount;
+			joyCon.previousTime = exported.snapshot.time;
+			joyCons.push_back(std::move(exported));
+		}
+	}
+
+	// The format needs a '.' as the decimal point, whatever the locale of the caller's stream.
+	std::ostringstream text;
+	text.imbue(std::locale::classic());
+
+	writeSummary(text, joyCons, "joyconbridge_report_latency_seconds",
+	             "From when a report was sent until it was applied, above the fastest report.",
+	             &JoyConMetricsSnapshot::reportLatency);
+	writeSummary(text, joyCons, "joyconbridge_decode_seconds",
+	             "From when a report was read until it was decoded and published.",
+	             &JoyConMetricsSnapshot::decodeTime);
+	writeSummary(text, joyCons, "joyconbridge_report_interval_seconds",
+	             "Between reading consecutive reports.",
+	             &JoyConMetricsSnapshot::reportInterval);
+	writeSummary(text, joyCons, "joyconbridge_subcommand_round_trip_seconds",
+	             "From writing a subcommand until its reply was read.",
+	             &JoyConMetricsSnapshot::subcommandRoundTrip);
+	writeSummary(text, joyCons, "joyconbridge_rumble_latency_seconds",
+	             "From setting a rumble until the first report that carries it was written.",
+	             &JoyConMetricsSnapshot::rumbleLatency);
+
+	writeCounter(text, joyCons, "joyconbridge_reports_total", "Input reports applied.",
+	             &JoyConMetricsSnapshot::reportCount);
+	writeCounter(text, joyCons, "joyconbridge_discarded_packets_total", "Packets read that were not input reports.",
+	             &JoyConMetricsSnapshot::discardedPacketCount);
+	writeCounter(text, joyCons, "joyconbridge_subcommand_retries_total", "Subcommands resent after a late reply.",
+	             &JoyConMetricsSnapshot::subcommandRetryCount);
+	writeCounter(text, joyCons, "joyconbridge_subcommand_timeouts_total", "Subcommands that ran out of retries.",
+	             &JoyConMetricsSnapshot::subcommandTimeoutCount);
+	writeCounter(text, joyCons, "joyconbridge_rumble_reports_total", "Rumble reports written.",
+	             &JoyConMetricsSnapshot::rumbleReportCount);
+
+	writeHeader(text, "joyconbridge_reports_per_second", "gauge", "Input reports applied per second, lately.");
+	for (const JoyConExport& joyCon : joyCons) {
+		text << "joyconbridge_reports_per_second{joycon=\"" << joyCon.label << "\"} " << joyCon.reportsPerSecond
+		     << '\n';
+	}
+
+	output << text.str();
+}
+
+void MetricsExporter::dump(const std::string& path)
+{
+	// Written next to the file and renamed over it, so the file is never seen half written.
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::trunc);
+		write(file);
+		if (!file.flush()) {
+			throw std::runtime_error("Can't write the metrics to " + temporaryPath);
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error) {
+		throw std::runtime_error("Can't replace " + path + ": " + error.message());
+	}
+}
+
+void MetricsExporter::startDumping(const std::string& path, std::chrono::milliseconds period)
+{
+	stopDumping();
+
+	std::lock_guard<std::mutex> guard(m_dumpLock);
+	m_isStopping = false;
+	m_dumpThread = std::thread(&MetricsExporter::dumpLoop, this, path, period);
+}
+
+void MetricsExporter::stopDumping()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_dumpLock);
+		m_isStopping = true;
+	}
+	m_stopCondition.notify_all();
+
+	if (m_dumpThread.joinable()) {
+		m_dumpThread.join();
+	}
+}
+
+void MetricsExporter::dumpLoop(std::string path, std::chrono::milliseconds period)
+{
+	std::unique_lock<std::mutex> lock(m_dumpLock);
+	while (!m_stopCondition.wait_for(lock, period, [this]() { return m_isStopping; })) {
+		lock.unlock();
+		try {
+			dump(path);
+		} catch (const std::exception&) {
+			// intentionally empty, the next period tries again.
+		}
+		lock.lock();
+	}
+}
+}
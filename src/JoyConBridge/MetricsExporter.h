@@ -0,0 +1,95 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include "JoyConMetrics.h"
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Writes the metrics of JoyCons in the Prometheus text format, on demand or periodically to a file.
+
+	The file is replaced as a whole on every dump, so it can be scraped at any time, by the textfile collector of
+	the node exporter for example. Latencies are written as summaries, in seconds, labeled by the name each JoyCon
+	was added with. This class is thread-safe, except that dumping must be started and stopped from a single thread.
+*/
+class MetricsExporter
+{
+public:
+	MetricsExporter();
+
+	/**
+		@brief Stops dumping, if it was started.
+	*/
+	~MetricsExporter();
+
+	MetricsExporter(const MetricsExporter&) = delete;
+	MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+	/**
+		@brief Starts exporting the metrics of a JoyCon, under a name. A JoyCon that was already added under the
+		same name is replaced.
+
+		@param[in] name The value of the `joycon` label of the JoyCon.
+		@param[in] metrics The metrics of the JoyCon. See `JoyCon::getMetrics`.
+	*/
+	void add(const std::string& name, std::shared_ptr<const JoyConMetrics> metrics);
+
+	/**
+		@brief Stops exporting the metrics of a JoyCon. Unknown names are ignored.
+	*/
+	void remove(const std::string& name);
+
+	/**
+		@brief Writes the current metrics of all the JoyCons.
+
+		The report rate is measured since the previous write, or since the JoyCon was added.
+	*/
+	void write(std::ostream& output);
+
+	/**
+		@brief Writes the current metrics of all the JoyCons to a file, replacing it.
+
+		@throws std::runtime_error If the file can't be written.
+	*/
+	void dump(const std::string& path);
+
+	/**
+		@brief Dumps the metrics periodically, on a background thread, until stopped. Starting again replaces the
+		previous path and period. Failed dumps are retried on the next period.
+	*/
+	void startDumping(const std::string& path, std::chrono::milliseconds period);
+
+	/**
+		@brief Stops dumping periodically. Blocks until a dump in progress is done.
+	*/
+	void stopDumping();
+
+private:
+	/*
+	 * A JoyCon whose metrics are exported, with what is needed to measure its report rate.
+	 */
+	struct ExportedJoyCon
+	{
+		std::shared_ptr<const JoyConMetrics> metrics;
+		uint64_t previousReportCount;
+		std::chrono::steady_clock::time_point previousTime;
+	};
+
+	void dumpLoop(std::string path, std::chrono::milliseconds period);
+
+	std::mutex m_lock;
+	std::map<std::string, ExportedJoyCon> m_joyCons; // Sorted by name, so dumps are in a stable order.
+
+	std::mutex m_dumpLock;
+	std::condition_variable m_stopCondition;
+	bool m_isStopping;
+	std::thread m_dumpThread;
+};
+}
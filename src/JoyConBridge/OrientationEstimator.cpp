@@ -0,0 +1,131 @@
+#include <cmath>
+#include <stdexcept>
+#include "OrientationEstimator.h"
+
+
+namespace joy_con_bridge
+{
+static float getLength(const ThreeAxesSensor& vector)
+{
+	return std::sqrt(vector.x * vector.x + vector.y * vector.y + vector.z * vector.z);
+}
+
+OrientationEstimator::OrientationEstimator(float beta)
+	: m_beta(beta)
+	, m_hasSamples(false)
+	, m_orientation{}
+{
+	if (!(beta >= 0)) {
+		throw std::invalid_argument("The beta of the orientation estimator must not be negative");
+	}
+	reset();
+}
+
+const Orientation& OrientationEstimator::update(const ImuSamples& samples)
+{
+	for (const ImuSample& sample : samples) {
+		update(sample, IMU_SAMPLE_PERIOD);
+	}
+	return m_orientation;
+}
+
+void OrientationEstimator::update(const ImuSample& sample, float period)
+{
+	const ThreeAxesSensor& gyroscope = sample.gyroscope;
+	const float accelerometerLength = getLength(sample.accelerometer);
+	if (!m_hasSamples) {
+		if (0 == accelerometerLength) {
+			return;
+		}
+		startFrom(sample.accelerometer);
+		m_hasSamples = true;
+	}
+
+	float w = m_orientation.rotation.w;
+	float x = m_orientation.rotation.x;
+	float y = m_orientation.rotation.y;
+	float z = m_orientation.rotation.z;
+
+	// The rate of change of the rotation, according to the gyroscope.
+	float dw = 0.5f * (-x * gyroscope.x - y * gyroscope.y - z * gyroscope.z);
+	float dx = 0.5f * (w * gyroscope.x + y * gyroscope.z - z * gyroscope.y);
+	float dy = 0.5f * (w * gyroscope.y - x * gyroscope.z + z * gyroscope.x);
+	float dz = 0.5f * (w * gyroscope.z + x * gyroscope.y - y * gyroscope.x);
+
+	// A free falling JoyCon (or a broken sample) tells nothing about the tilt.
+	if (0 != accelerometerLength) {
+		const float inverseAccelerometerLength = 1 / accelerometerLength;
+		const float ax = sample.accelerometer.x * inverseAccelerometerLength;
+		const float ay = sample.accelerometer.y * inverseAccelerometerLength;
+		const float az = sample.accelerometer.z * inverseAccelerometerLength;
+
+		// The gradient of the distance between the measured "up" and the one the rotation expects.
+		const float ww = w * w;
+		const float xx = x * x;
+		const float yy = y * y;
+		const float zz = z * z;
+		float sw = 4 * w * yy + 2 * y * ax + 4 * w * xx - 2 * x * ay;
+		float sx = 4 * x * zz - 2 * z * ax + 4 * ww * x - 2 * w * ay - 4 * x + 8 * x * xx + 8 * x * yy + 4 * x * az;
+		float sy = 4 * ww * y + 2 * w * ax + 4 * y * zz - 2 * z * ay - 4 * y + 8 * y * xx + 8 * y * yy + 4 * y * az;
+		float sz = 4 * xx * z - 2 * x * ax + 4 * yy * z - 2 * y * ay;
+		const float gradientLength = std::sqrt(sw * sw + sx * sx + sy * sy + sz * sz);
+		if (0 != gradientLength) {
+			const float step = m_beta / gradientLength;
+			dw -= step * sw;
+			dx -= step * sx;
+			dy -= step * sy;
+			dz -= step * sz;
+		}
+	}
+
+	w += dw * period;
+	x += dx * period;
+	y += dy * period;
+	z += dz * period;
+	const float inverseLength = 1 / std::sqrt(w * w + x * x + y * y + z * z);
+	m_orientation.rotation = {w * inverseLength, x * inverseLength, y * inverseLength, z * inverseLength};
+	updateGravity();
+}
+
+const Orientation& OrientationEstimator::getOrientation() const
+{
+	return m_orientation;
+}
+
+void OrientationEstimator::reset()
+{
+	m_hasSamples = false;
+	m_orientation.rotation = {1, 0, 0, 0};
+	updateGravity();
+}
+
+void OrientationEstimator::startFrom(const ThreeAxesSensor& accelerometer)
+{
+	const float length = getLength(accelerometer);
+	const float ax = accelerometer.x / length;
+	const float ay = accelerometer.y / length;
+	const float az = accelerometer.z / length;
+
+	// The shortest rotation from the measured "up" to the world's Z axis. It is undefined for a JoyCon that is upside
+	// down, which is turned around its X axis instead.
+	if (az < -0.9999f) {
+		m_orientation.rotation = {0, 1, 0, 0};
+	} else {
+		const float w = 1 + az;
+		const float inverseLength = 1 / std::sqrt(2 * w);
+		m_orientation.rotation = {w * inverseLength, ay * inverseLength, -ax * inverseLength, 0};
+	}
+	updateGravity();
+}
+
+void OrientationEstimator::updateGravity()
+{
+	// The world's Z axis, in the axes of the JoyCon, reversed.
+	const Quaternion& q = m_orientation.rotation;
+	m_orientation.gravity = {
+		-2 * (q.x * q.z - q.w * q.y),
+		-2 * (q.w * q.x + q.y * q.z),
+		-(q.w * q.w - q.x * q.x - q.y * q.y + q.z * q.z)
+	};
+}
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include "decode.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * A rotation, as a unit quaternion.
+ */
+struct Quaternion
+{
+	float w;
+	float x;
+	float y;
+	float z;
+};
+
+/*
+ * Where a JoyCon is facing, relative to the world. The world's Z axis points up, and its heading is wherever the
+ * JoyCon faced when the estimation started, since there is no magnetometer to tell north.
+ */
+struct Orientation
+{
+	Quaternion rotation; // From the axes of the JoyCon to the axes of the world.
+	ThreeAxesSensor gravity; // The direction gravity pulls, in the axes of the JoyCon, in G (so its length is 1).
+};
+
+/**
+	@brief Fuses the gyroscope and accelerometer samples of a JoyCon into its orientation, with Madgwick's filter.
+
+	The gyroscope is integrated, and the result is pulled towards the tilt that the accelerometer measures, by a step
+	of `beta` (in radians per second) along the gradient of the error. A higher `beta` corrects gyroscope drift faster,
+	but lets more of the accelerometer noise and of the motion of the JoyCon into the orientation.
+
+	Every update costs the same and allocates nothing, so it can run for every report on the polling thread.
+*/
+class OrientationEstimator
+{
+public:
+	// Suits a JoyCon held in the hand: drift is corrected within seconds, and shakes barely tilt the orientation.
+	static constexpr float DEFAULT_BETA = 0.1f;
+
+	/**
+		@param[in] beta How strongly the accelerometer corrects the gyroscope. See the class documentation.
+
+		@throws std::invalid_argument If `beta` is negative.
+	*/
+	explicit OrientationEstimator(float beta = DEFAULT_BETA);
+
+	/**
+		@brief Updates the orientation with the IMU samples of a report, oldest first.
+
+		@return The orientation as of the newest sample.
+	*/
+	const Orientation& update(const ImuSamples& samples);
+
+	/**
+		@brief Updates the orientation with a single IMU sample.
+
+		@param[in] sample The sample. Only its accelerometer and gyroscope are used.
+		@param[in] period The time since the previous sample, in seconds.
+	*/
+	void update(const ImuSample& sample, float period);
+
+	/**
+		@brief Gets the orientation as of the latest sample.
+	*/
+	const Orientation& getOrientation() const;
+
+	/**
+		@brief Forgets the orientation. The next sample starts over from the tilt its accelerometer measures.
+	*/
+	void reset();
+
+private:
+	/**
+		@brief Sets the orientation to the tilt the accelerometer measures, with no turn around the vertical.
+	*/
+	void startFrom(const ThreeAxesSensor& accelerometer);
+
+	/**
+		@brief Updates the gravity vector from the rotation.
+	*/
+	void updateGravity();
+
+	float m_beta;
+	bool m_hasSamples;
+	Orientation m_orientation;
+};
+}
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "exceptions.h"
+#include "ReplayTransport.h"
+
+
+namespace joy_con_bridge
+{
+ReplayTransport::ReplayTransport(const std::string& path, ReplaySpeed speed)
+	: m_reader(path)
+	, m_speed(speed)
+	, m_isFinished(false)
+	, m_hasStarted(false)
+{}
+
+size_t ReplayTransport::write(const uint8_t*, size_t size)
+{
+	return size;
+}
+
+size_t ReplayTransport::readInto(uint8_t* data, size_t size, int milliseconds)
+{
+	if (!findNextInputReport()) {
+		throw HidTimeoutError(nullptr);
+	}
+
+	const auto dueTime = getDueTime();
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds);
+	if (dueTime > deadline) {
+		std::this_thread::sleep_until(deadline);
+		throw HidTimeoutError(nullptr);
+	}
+	std::this_thread::sleep_until(dueTime);
+
+	return takeNextInputReport(data, size);
+}
+
+size_t ReplayTransport::tryReadInto(uint8_t* data, size_t size)
+{
+	if (!findNextInputReport() || getDueTime() > std::chrono::steady_clock::now()) {
+		return 0;
+	}
+
+	return takeNextInputReport(data, size);
+}
+
+Hand ReplayTransport::getHand() const
+{
+	return m_reader.getHand();
+}
+
+const std::wstring& ReplayTransport::getSerialNumber() const
+{
+	return m_reader.getSerialNumber();
+}
+
+const std::optional<RawCalibrationData>& ReplayTransport::getCalibrationData() const
+{
+	return m_reader.getCalibrationData();
+}
+
+bool ReplayTransport::isFinished() const
+{
+	return m_isFinished;
+}
+
+bool ReplayTransport::findNextInputReport()
+{
+	CaptureRecord record{};
+	while (!m_nextInputReport && !m_isFinished) {
+		if (!m_reader.next(record)) {
+			m_isFinished = true;
+		} else if (CaptureRecordType::INPUT_REPORT == record.type) {
+			m_nextInputReport = record;
+		}
+	}
+
+	return m_nextInputReport.has_value();
+}
+
+std::chrono::steady_clock::time_point ReplayTransport::getDueTime()
+{
+	if (ReplaySpeed::AS_FAST_AS_POSSIBLE == m_speed) {
+		return std::chrono::steady_clock::time_point::min();
+	}
+
+	// The capture starts playing back when it is first read, with the first input report readable right away.
+	if (!m_hasStarted) {
+		m_start = std::chrono::steady_clock::now() - m_nextInputReport->timestamp;
+		m_hasStarted = true;
+	}
+	return m_start + m_nextInputReport->timestamp;
+}
+
+size_t ReplayTransport::takeNextInputReport(uint8_t* data, size_t size)
+{
+	const size_t read = std::min(size, m_nextInputReport->size);
+	std::memcpy(data, m_nextInputReport->data, read);
+	m_nextInputReport.reset();
+
+	// Looking ahead lets isFinished tell as soon as the last report was taken.
+	findNextInputReport();
+
+	return read;
+}
+}
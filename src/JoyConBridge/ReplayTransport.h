@@ -0,0 +1,86 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <string>
+#include "ReportCapture.h"
+#include "Transport.h"
+
+
+namespace joy_con_bridge
+{
+enum class ReplaySpeed
+{
+	ORIGINAL_TIMING,    // Each input report becomes readable when it was read in the capture.
+	AS_FAST_AS_POSSIBLE // Each input report is readable as soon as the one before it was read.
+};
+
+/**
+	@brief A transport that plays back the input reports of a capture file, in place of the captured JoyCon.
+
+	Written reports are dropped, so a JoyCon that is constructed on this transport sees exactly the replies it saw in
+	the capture, as long as it sends the same subcommands (it must not use a calibration cache if the captured one
+	didn't, for example). Once the capture runs out, the transport acts like a JoyCon that stopped responding.
+*/
+class ReplayTransport : public Transport
+{
+public:
+	/**
+		@param[in] path The path of the capture file.
+		@param[in] speed How fast to play the input reports back.
+
+		@throws MappedFileError If the file can't be opened, or is not a capture file.
+	*/
+	explicit ReplayTransport(const std::string& path, ReplaySpeed speed = ReplaySpeed::ORIGINAL_TIMING);
+
+	size_t write(const uint8_t* data, size_t size) override;
+
+	size_t readInto(uint8_t* data, size_t size, int milliseconds) override;
+
+	size_t tryReadInto(uint8_t* data, size_t size) override;
+
+	/**
+		@brief Gets the hand of the captured JoyCon.
+	*/
+	Hand getHand() const;
+
+	/**
+		@brief Gets the serial number of the captured JoyCon.
+	*/
+	const std::wstring& getSerialNumber() const;
+
+	/**
+		@brief Gets the calibration data of the captured JoyCon, if the capture has it.
+	*/
+	const std::optional<RawCalibrationData>& getCalibrationData() const;
+
+	/**
+		@brief Checks if all the input reports were played back.
+	*/
+	bool isFinished() const;
+
+private:
+	/**
+		@brief Finds the next input report of the capture, if it wasn't found already.
+
+		@return Whether there is one.
+	*/
+	bool findNextInputReport();
+
+	/**
+		@brief Gets the time the next input report becomes readable. Starts the playback clock on the first call.
+	*/
+	std::chrono::steady_clock::time_point getDueTime();
+
+	/**
+		@brief Copies the next input report, and moves past it.
+	*/
+	size_t takeNextInputReport(uint8_t* data, size_t size);
+
+	ReportCaptureReader m_reader;
+	ReplaySpeed m_speed;
+	std::optional<CaptureRecord> m_nextInputReport;
+	bool m_isFinished;
+	bool m_hasStarted;
+	std::chrono::steady_clock::time_point m_start; // The time the capture started, on the playback clock.
+};
+}
@@ -0,0 +1,260 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include "Buffer.h"
+#include "exceptions.h"
+#include "ReportCapture.h"
+
+
+namespace joy_con_bridge
+{
+#pragma pack(push, 1)
+struct CaptureFileHeader
+{
+	char magic[4];
+	uint16_t version;
+	uint16_t headerSize; // Newer versions may append fields; readers skip to the first record by this size.
+	uint8_t hand;
+	char serialNumber[32]; // Padded with zeroes.
+	uint64_t recordsSize; // Of the complete records that follow the header, in bytes.
+};
+
+struct CaptureRecordHeader
+{
+	uint32_t timestampDelta; // Microseconds since the previous record.
+	uint8_t type;
+	uint16_t size; // Of the data that follows.
+};
+
+// The record header of version 1, which couldn't hold reports over 255 bytes (those of the NFC/IR mode).
+struct CaptureRecordHeaderV1
+{
+	uint32_t timestampDelta;
+	uint8_t type;
+	uint8_t size;
+};
+#pragma pack(pop)
+
+static const char CAPTURE_FILE_MAGIC[4] = {'J', 'C', 'R', 'C'};
+static const uint16_t CAPTURE_FILE_VERSION = 2;
+static const uint16_t CAPTURE_FILE_VERSION_1 = 1;
+static const size_t INITIAL_CAPTURE_FILE_SIZE = 1 << 20;
+
+ReportCaptureWriter::ReportCaptureWriter(const std::string& path, Hand hand, const std::wstring& serialNumber)
+	: m_file(path, INITIAL_CAPTURE_FILE_SIZE)
+	, m_size(sizeof(CaptureFileHeader))
+	, m_start(std::chrono::steady_clock::now())
+	, m_lastTimestamp(0)
+{
+	CaptureFileHeader header = {
+		{CAPTURE_FILE_MAGIC[0], CAPTURE_FILE_MAGIC[1], CAPTURE_FILE_MAGIC[2], CAPTURE_FILE_MAGIC[3]},
+		CAPTURE_FILE_VERSION,
+		sizeof(CaptureFileHeader),
+		static_cast<uint8_t>(hand),
+		{},
+		0
+	};
+	// Serial numbers are MAC addresses, so narrowing them loses nothing in practice.
+	const size_t serialNumberSize = std::min(serialNumber.size(), sizeof(header.serialNumber));
+	for (size_t i = 0; i < serialNumberSize; ++i) {
+		header.serialNumber[i] = serialNumber[i] < 0x80 ? static_cast<char>(serialNumber[i]) : '?';
+	}
+	std::memcpy(m_file.data(), &header, sizeof(header));
+}
+
+ReportCaptureWriter::~ReportCaptureWriter()
+{
+	try {
+		m_file.resize(m_size);
+	} catch (const MappedFileError&) {
+		// The header tells where the records end, so the extra space at the end of the file does no harm.
+	}
+}
+
+void ReportCaptureWriter::write(CaptureRecordType type, const uint8_t* data, size_t size)
+{
+	if (size > std::numeric_limits<uint16_t>::max()) {
+		throw std::invalid_argument("A capture record must not be over 65535 bytes");
+	}
+
+	std::lock_guard<std::mutex> guard(m_lock);
+
+	// Under the lock, so that the records of concurrent writers are in the order of their timestamps.
+	const auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start);
+
+	const size_t recordSize = sizeof(CaptureRecordHeader) + size;
+	if (m_size + recordSize > m_file.size()) {
+		m_file.resize(std::max(2 * m_file.size(), m_size + recordSize));
+	}
+
+	// Long gaps are shortened rather than wrapped, so the timestamps never go back.
+	const auto delta = std::clamp<std::chrono::microseconds::rep>((now - m_lastTimestamp).count(), 0,
+	                                                              std::numeric_limits<uint32_t>::max());
+	m_lastTimestamp += std::chrono::microseconds(delta);
+
+	const CaptureRecordHeader recordHeader = {
+		static_cast<uint32_t>(delta),
+		static_cast<uint8_t>(type),
+		static_cast<uint16_t>(size)
+	};
+	uint8_t* const record = m_file.data() + m_size;
+	std::memcpy(record, &recordHeader, sizeof(recordHeader));
+	std::memcpy(record + sizeof(recordHeader), data, size);
+	m_size += recordSize;
+
+	// Only now is the record complete.
+	const uint64_t recordsSize = m_size - sizeof(CaptureFileHeader);
+	std::memcpy(m_file.data() + offsetof(CaptureFileHeader, recordsSize), &recordsSize, sizeof(recordsSize));
+}
+
+void ReportCaptureWriter::writeCalibration(const RawCalibrationData& data)
+{
+	Buffer contents;
+	dumpToBuffer(contents, data.leftStick);
+	dumpToBuffer(contents, data.rightStick);
+	dumpToBuffer(contents, data.sensors);
+	dumpToBuffer(contents, data.userCalibrationMagics);
+	write(CaptureRecordType::CALIBRATION, contents.data(), contents.size());
+}
+
+ReportCaptureReader::ReportCaptureReader(const std::string& path)
+	: m_file(path)
+	, m_end(0)
+	, m_position(0)
+	, m_timestamp(0)
+	, m_version(0)
+	, m_hand(Hand::NONE)
+{
+	CaptureFileHeader header{};
+	if (m_file.size() < sizeof(header)) {
+		throw MappedFileError(path + " is not a capture file");
+	}
+	std::memcpy(&header, m_file.data(), sizeof(header));
+	if (0 != std::memcmp(header.magic, CAPTURE_FILE_MAGIC, sizeof(header.magic)) ||
+		(CAPTURE_FILE_VERSION != header.version && CAPTURE_FILE_VERSION_1 != header.version) ||
+		header.headerSize < sizeof(header) ||
+		header.headerSize > m_file.size()) {
+		throw MappedFileError(path + " is not a capture file of a supported version");
+	}
+
+	m_version = header.version;
+	m_position = header.headerSize;
+	m_end = header.headerSize + static_cast<size_t>(std::min<uint64_t>(header.recordsSize,
+	                                                                  m_file.size() - header.headerSize));
+	m_hand = static_cast<Hand>(header.hand);
+	const char* const serialNumber = header.serialNumber;
+	m_serialNumber.assign(serialNumber, std::find(serialNumber, serialNumber + sizeof(header.serialNumber), '\0'));
+
+	CaptureRecord record{};
+	while (next(record)) {
+		static const size_t CALIBRATION_RECORD_SIZE = 2 * STICK_CALIBRATION_DATA_SIZE +
+			SENSOR_CALIBRATION_DATA_SIZE + sizeof(RawCalibrationData::userCalibrationMagics);
+		if (CaptureRecordType::CALIBRATION != record.type || CALIBRATION_RECORD_SIZE != record.size) {
+			continue;
+		}
+
+		RawCalibrationData data{};
+		const uint8_t* position = record.data;
+		const auto readField = [&position](void* field, size_t size) {
+			std::memcpy(field, position, size);
+			position += size;
+		};
+		readField(data.leftStick.data(), sizeof(data.leftStick));
+		readField(data.rightStick.data(), sizeof(data.rightStick));
+		readField(data.sensors.data(), sizeof(data.sensors));
+		readField(data.userCalibrationMagics.data(), sizeof(data.userCalibrationMagics));
+		m_calibrationData = data;
+	}
+	rewind();
+}
+
+Hand ReportCaptureReader::getHand() const
+{
+	return m_hand;
+}
+
+const std::wstring& ReportCaptureReader::getSerialNumber() const
+{
+	return m_serialNumber;
+}
+
+const std::optional<RawCalibrationData>& ReportCaptureReader::getCalibrationData() const
+{
+	return m_calibrationData;
+}
+
+bool ReportCaptureReader::next(CaptureRecord& record)
+{
+	CaptureRecordHeader header{};
+	size_t headerSize = sizeof(header);
+	if (CAPTURE_FILE_VERSION_1 == m_version) {
+		CaptureRecordHeaderV1 headerV1{};
+		headerSize = sizeof(headerV1);
+		if (m_position + headerSize > m_end) {
+			return false;
+		}
+		std::memcpy(&headerV1, m_file.data() + m_position, headerSize);
+		header = {headerV1.timestampDelta, headerV1.type, headerV1.size};
+	} else {
+		if (m_position + headerSize > m_end) {
+			return false;
+		}
+		std::memcpy(&header, m_file.data() + m_position, headerSize);
+	}
+	if (m_position + headerSize + header.size > m_end) {
+		return false;
+	}
+
+	m_timestamp += std::chrono::microseconds(header.timestampDelta);
+	record.type = static_cast<CaptureRecordType>(header.type);
+	record.timestamp = m_timestamp;
+	record.data = m_file.data() + m_position + headerSize;
+	record.size = header.size;
+
+	m_position += headerSize + header.size;
+	return true;
+}
+
+void ReportCaptureReader::rewind()
+{
+	CaptureFileHeader header{};
+	std::memcpy(&header, m_file.data(), sizeof(header));
+	m_position = header.headerSize;
+	m_timestamp = std::chrono::microseconds(0);
+}
+
+CapturingTransport::CapturingTransport(std::shared_ptr<Transport> transport,
+                                       std::shared_ptr<ReportCaptureWriter> writer)
+	: m_transport(std::move(transport))
+	, m_writer(std::move(writer))
+{}
+
+size_t CapturingTransport::write(const uint8_t* data, size_t size)
+{
+	const size_t written = m_transport->write(data, size);
+	m_writer->write(CaptureRecordType::OUTPUT_REPORT, data, size);
+	return written;
+}
+
+size_t CapturingTransport::readInto(uint8_t* data, size_t size, int milliseconds)
+{
+	const size_t read = m_transport->readInto(data, size, milliseconds);
+	m_writer->write(CaptureRecordType::INPUT_REPORT, data, read);
+	return read;
+}
+
+size_t CapturingTransport::tryReadInto(uint8_t* data, size_t size)
+{
+	const size_t read = m_transport->tryReadInto(data, size);
+	if (0 != read) {
+		m_writer->write(CaptureRecordType::INPUT_REPORT, data, read);
+	}
+	return read;
+}
+
+int CapturingTransport::getFileDescriptor() const
+{
+	return m_transport->getFileDescriptor();
+}
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include "CalibrationCache.h"
+#include "JoyCon.h"
+#include "MappedFile.h"
+#include "Transport.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * A capture file holds the reports that went between a JoyCon and the host, so the session can be replayed without
+ * the JoyCon. It starts with a header that identifies the JoyCon, followed by records. Each record is a record header
+ * followed by its data. All the fields are little endian, without padding.
+ */
+enum class CaptureRecordType : uint8_t
+{
+	INPUT_REPORT = 1,  // A report that was read from the JoyCon.
+	OUTPUT_REPORT = 2, // A report that was written to the JoyCon.
+	CALIBRATION = 3    // The fields of RawCalibrationData in order, like in the calibration cache.
+};
+
+struct CaptureRecord
+{
+	CaptureRecordType type;
+	std::chrono::microseconds timestamp; // Since the capture started.
+	const uint8_t* data;
+	size_t size;
+};
+
+/**
+	@brief Appends the reports of a JoyCon to a capture file.
+
+	The file is memory mapped, so writing a record doesn't cost a system call, and can be done from the read path.
+	The header is kept up to date after every record, so the file can be read even if the writer is never destroyed
+	(when the process crashes, for example). This class is thread-safe.
+*/
+class ReportCaptureWriter
+{
+public:
+	/**
+		@brief Creates a capture file, replacing an existing one.
+
+		@param[in] path The path of the file.
+		@param[in] hand The hand of the captured JoyCon.
+		@param[in] serialNumber The serial number of the captured JoyCon. Only its first 32 characters are kept.
+
+		@throws MappedFileError If the file can't be created.
+	*/
+	ReportCaptureWriter(const std::string& path, Hand hand, const std::wstring& serialNumber);
+
+	/**
+		@brief Trims the file to the records that were written.
+	*/
+	~ReportCaptureWriter();
+
+	ReportCaptureWriter(const ReportCaptureWriter&) = delete;
+	ReportCaptureWriter& operator=(const ReportCaptureWriter&) = delete;
+
+	/**
+		@brief Appends a record, timestamped with the current time.
+
+		@param[in] type The type of the record.
+		@param[in] data The data of the record.
+		@param[in] size The size of the data, in bytes. At most 65535.
+
+		@throws std::invalid_argument If the data is too big for a record.
+		@throws MappedFileError If the file can't be grown to fit the record.
+	*/
+	void write(CaptureRecordType type, const uint8_t* data, size_t size);
+
+	/**
+		@brief Appends the calibration data of the JoyCon, so the capture can be decoded without it.
+
+		@throws MappedFileError If the file can't be grown to fit the record.
+	*/
+	void writeCalibration(const RawCalibrationData& data);
+
+private:
+	MappedFile m_file;
+	size_t m_size; // Of the header and the records written so far.
+	std::chrono::steady_clock::time_point m_start;
+	std::chrono::microseconds m_lastTimestamp;
+	std::mutex m_lock;
+};
+
+/**
+	@brief Reads the records of a capture file, in the order they were written.
+*/
+class ReportCaptureReader
+{
+public:
+	/**
+		@param[in] path The path of the file.
+
+		@throws MappedFileError If the file can't be opened, or is not a capture file.
+	*/
+	explicit ReportCaptureReader(const std::string& path);
+
+	Hand getHand() const;
+
+	const std::wstring& getSerialNumber() const;
+
+	/**
+		@brief Gets the calibration data of the captured JoyCon, if the capture has it.
+	*/
+	const std::optional<RawCalibrationData>& getCalibrationData() const;
+
+	/**
+		@brief Reads the next record.
+
+		@param[out] record Receives the record. Its data points into the file, and stays valid as long as the reader.
+
+		@return Whether there was a record to read.
+	*/
+	bool next(CaptureRecord& record);
+
+	/**
+		@brief Goes back to the first record.
+	*/
+	void rewind();
+
+private:
+	MappedFile m_file;
+	size_t m_end; // Of the last complete record.
+	size_t m_position;
+	std::chrono::microseconds m_timestamp;
+	uint16_t m_version; // Of the file. Version 1 files are still read.
+	Hand m_hand;
+	std::wstring m_serialNumber;
+	std::optional<RawCalibrationData> m_calibrationData;
+};
+
+/**
+	@brief A transport that captures the reports that go through another transport.
+
+	To capture a session from its start, construct the JoyCon on this transport. Capture without a calibration cache,
+	so the replies to the calibration reads are in the capture, and the session can be replayed.
+*/
+class CapturingTransport : public Transport
+{
+public:
+	/**
+		@param[in] transport The transport to capture.
+		@param[in] writer Receives the reports.
+	*/
+	CapturingTransport(std::shared_ptr<Transport> transport, std::shared_ptr<ReportCaptureWriter> writer);
+
+	size_t write(const uint8_t* data, size_t size) override;
+
+	size_t readInto(uint8_t* data, size_t size, int milliseconds) override;
+
+	size_t tryReadInto(uint8_t* data, size_t size) override;
+
+	int getFileDescriptor() const override;
+
+private:
+	std::shared_ptr<Transport> m_transport;
+	std::shared_ptr<ReportCaptureWriter> m_writer;
+};
+}
@@ -0,0 +1,66 @@
+#include <cmath>
+#include "ReportClock.h"
+
+
+namespace joy_con_bridge
+{
+const int64_t TIMER_WRAP = 0x100;
+// How much of the way back up the clock offset creeps in each report, when the report waited longer than the best
+// one so far. Slow enough to ignore the latency of single reports, fast enough to follow the drift of the clocks.
+const int64_t CLOCK_OFFSET_RECOVERY = 128;
+// How much of the jitter of each report goes into the smoothed jitter, as in RTP (RFC 3550).
+const double JITTER_GAIN = 1.0 / 16;
+
+ReportClock::ReportClock()
+	: m_hasReports(false)
+	, m_previousTimer(0)
+	, m_deviceTicks(0)
+	, m_previousReceiveTime{}
+	, m_clockOffset{}
+	, m_jitter(0)
+{}
+
+ReportTimestamp ReportClock::update(uint8_t timer, std::chrono::steady_clock::time_point receiveTime)
+{
+	if (m_hasReports) {
+		// The time since the previous report was received is the ticks that passed, give or take how much longer one
+		// of the two reports waited to be read. So the timer is unwrapped by the number of whole wraps closest to
+		// it. This only goes wrong if the waits of the two reports differ by more than half a wrap.
+		const auto elapsed = receiveTime - m_previousReceiveTime;
+		const auto wrappedTicks = static_cast<uint8_t>(timer - m_previousTimer);
+		const int64_t elapsedTicks = elapsed / TICK;
+		const int64_t wraps = elapsedTicks > wrappedTicks ?
+			(elapsedTicks - wrappedTicks + TIMER_WRAP / 2) / TIMER_WRAP : 0;
+		const auto ticks = static_cast<int64_t>(wrappedTicks + wraps * TIMER_WRAP);
+		m_deviceTicks += ticks;
+
+		const double difference = std::chrono::duration<double, std::micro>(elapsed - ticks * TICK).count();
+		m_jitter += (std::abs(difference) - m_jitter) * JITTER_GAIN;
+	}
+
+	const auto deviceTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		static_cast<int64_t>(m_deviceTicks) * TICK);
+	const auto clockOffset = receiveTime.time_since_epoch() - deviceTime;
+	if (!m_hasReports || clockOffset < m_clockOffset) {
+		m_clockOffset = clockOffset;
+	} else {
+		m_clockOffset += (clockOffset - m_clockOffset) / CLOCK_OFFSET_RECOVERY;
+	}
+
+	m_hasReports = true;
+	m_previousTimer = timer;
+	m_previousReceiveTime = receiveTime;
+
+	return {receiveTime, std::chrono::steady_clock::time_point(deviceTime + m_clockOffset), m_deviceTicks};
+}
+
+std::chrono::microseconds ReportClock::getJitter() const
+{
+	return std::chrono::microseconds(static_cast<int64_t>(m_jitter));
+}
+
+std::chrono::steady_clock::duration ReportClock::getClockOffset() const
+{
+	return m_clockOffset;
+}
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+
+namespace joy_con_bridge
+{
+/*
+ * When a report was sent and received, on the host's monotonic clock.
+ */
+struct ReportTimestamp
+{
+	std::chrono::steady_clock::time_point receiveTime; // When the report was read.
+	// When the JoyCon sent the report. Estimated from the JoyCon's clock, so it is free of the jitter of the
+	// connection and of the reader.
+	std::chrono::steady_clock::time_point sampleTime;
+	uint64_t deviceTicks; // The timer byte of the report, unwrapped. Counts from 0 in the first report.
+};
+
+/**
+	@brief Reconstructs the JoyCon's clock from the 8 bit timer of its reports, and maps it to the host's clock.
+
+	The timer wraps around every 256 ticks, so it is unwrapped using the time between the reports: a gap of dropped
+	reports that is longer than a wrap is still counted right. The offset between the clocks is the smallest seen
+	between the time a report was received and the time the JoyCon says it was sent, since that is the report that
+	waited the least on its way. It is allowed to creep back up slowly, to follow the drift between the clocks.
+*/
+class ReportClock
+{
+public:
+	// The timer byte of input reports counts in steps of roughly this long.
+	static constexpr std::chrono::microseconds TICK{5000};
+
+	ReportClock();
+
+	/**
+		@brief Timestamps the next report.
+
+		@param[in] timer The timer byte of the report.
+		@param[in] receiveTime When the report was read.
+
+		@return The timestamp of the report.
+	*/
+	ReportTimestamp update(uint8_t timer, std::chrono::steady_clock::time_point receiveTime);
+
+	/**
+		@brief Gets the smoothed jitter between the reports: how much the time between receiving them differs from
+		the time between sending them. Dropped reports don't count as jitter, since the JoyCon's clock covers them.
+	*/
+	std::chrono::microseconds getJitter() const;
+
+	/**
+		@brief Gets the estimated offset from the JoyCon's clock to the host's clock. A device time in ticks is at
+		`deviceTicks * TICK + offset` on the host's clock.
+	*/
+	std::chrono::steady_clock::duration getClockOffset() const;
+
+private:
+	bool m_hasReports;
+	uint8_t m_previousTimer;
+	uint64_t m_deviceTicks;
+	std::chrono::steady_clock::time_point m_previousReceiveTime;
+	std::chrono::steady_clock::duration m_clockOffset; // Since the epoch of the steady clock.
+	double m_jitter; // In microseconds.
+};
+}
@@ -0,0 +1,116 @@
+#include "RumbleStreamer.h"
+#include "exceptions.h"
+
+
+namespace joy_con_bridge
+{
+RumbleStreamer::RumbleStreamer(std::shared_ptr<SubcommandChannel> subcommands,
+                               std::shared_ptr<const HealthMonitor> healthMonitor,
+                               std::shared_ptr<JoyConMetrics> metrics)
+	: m_subcommands(std::move(subcommands))
+	, m_healthMonitor(std::move(healthMonitor))
+	, m_metrics(std::move(metrics))
+	, m_rumble(protocol::NEUTRAL_RUMBLE)
+	, m_isChanged(false)
+	, m_changeTime{}
+	, m_error()
+	, m_isStopping(false)
+{}
+
+RumbleStreamer::~RumbleStreamer()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_isStopping = true;
+	}
+	m_changed.notify_all();
+
+	if (m_thread.joinable()) {
+		m_thread.join();
+	}
+}
+
+void RumbleStreamer::set(const Rumble& rumble)
+{
+	set(rumble::encodeBoth(rumble));
+}
+
+void RumbleStreamer::set(const protocol::RumbleData& rumble)
+{
+	const auto now = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		if (m_error) {
+			const std::exception_ptr error = m_error;
+			m_error = nullptr;
+			std::rethrow_exception(error);
+		}
+
+		m_rumble = rumble;
+		m_isChanged = true;
+		m_changeTime = now;
+		if (!m_thread.joinable()) {
+			m_thread = std::thread(&RumbleStreamer::sendLoop, this);
+		}
+	}
+	m_changed.notify_all();
+}
+
+void RumbleStreamer::stop()
+{
+	set(protocol::NEUTRAL_RUMBLE);
+}
+
+protocol::RumbleData RumbleStreamer::get() const
+{
+	std::lock_guard<std::mutex> guard(m_lock);
+	return m_rumble;
+}
+
+void RumbleStreamer::sendLoop()
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	auto nextSendTime = std::chrono::steady_clock::now();
+	while (true) {
+		const auto isWoken = [this]() { return m_isStopping || m_isChanged; };
+		if (m_error || rumble::isSilent(m_rumble)) {
+			// Nothing to stream until the next rumble.
+			m_changed.wait(lock, isWoken);
+		} else {
+			m_changed.wait_until(lock, nextSendTime, isWoken);
+		}
+		if (m_isStopping) {
+			return;
+		}
+
+		const protocol::RumbleData rumble = m_rumble;
+		const bool isChanged = m_isChanged;
+		const auto changeTime = m_changeTime;
+		m_isChanged = false;
+		lock.unlock();
+
+		std::exception_ptr error;
+		try {
+			m_subcommands->sendRumble(rumble);
+		} catch (const HidError&) {
+			error = std::current_exception();
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		if (!error && m_metrics) {
+			m_metrics->recordRumbleReport();
+			if (isChanged) {
+				m_metrics->recordRumbleLatency(now - changeTime);
+			}
+		}
+		const std::chrono::microseconds period = m_healthMonitor ?
+			m_healthMonitor->getHealth(now).expectedPeriod : HealthMonitor::DEFAULT_PERIOD;
+		nextSendTime = now + period;
+
+		lock.lock();
+		if (error && !m_isChanged) {
+			m_error = error;
+		}
+	}
+}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "HealthMonitor.h"
+#include "JoyConMetrics.h"
+#include "protocol.h"
+#include "rumble.h"
+#include "SubcommandChannel.h"
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Streams the rumble of a JoyCon on rumble-only reports, from a thread of its own.
+
+	A rumble that isn't silent is written again every report period, like the JoyCon's reports arrive, for as long as
+	it lasts. Setting a rumble wakes the thread, which writes it right away instead of at the next period, so the
+	latency of a rumble is that of a single write. A silent rumble is written once, and then the thread sleeps until
+	the next rumble. The thread starts with the first rumble, and is stopped when the streamer is destroyed.
+
+	This class is thread-safe.
+*/
+class RumbleStreamer
+{
+public:
+	/**
+		@param[in] subcommands The channel to write the rumble reports through, which also shares the rumble with the
+		                       subcommands.
+		@param[in] healthMonitor Where to take the period of the reports from. Optional, the period is
+		                         `HealthMonitor::DEFAULT_PERIOD` without it.
+		@param[in] metrics Where to record the rumble reports and their latency. Optional.
+	*/
+	explicit RumbleStreamer(std::shared_ptr<SubcommandChannel> subcommands,
+	                        std::shared_ptr<const HealthMonitor> healthMonitor = nullptr,
+	                        std::shared_ptr<JoyConMetrics> metrics = nullptr);
+
+	/**
+		@brief Stops the thread. The rumble is left as it is, which stops it shortly, since it isn't written again.
+	*/
+	~RumbleStreamer();
+
+	RumbleStreamer(const RumbleStreamer&) = delete;
+	RumbleStreamer& operator=(const RumbleStreamer&) = delete;
+
+	/**
+		@brief Sets the rumble of both actuators, replacing the current one.
+
+		@throws HidError If writing the previous rumble failed, which stopped the streaming. The rumble is not set
+		                 then, and setting it again resumes the streaming.
+	*/
+	void set(const Rumble& rumble);
+
+	/**
+		@brief Sets the rumble data to stream as is, for rumble that was encoded in advance. See `rumble::encode`.
+
+		@throws HidError Like `set(const Rumble&)`.
+	*/
+	void set(const protocol::RumbleData& rumble);
+
+	/**
+		@brief Silences both actuators.
+
+		@throws HidError Like `set(const Rumble&)`.
+	*/
+	void stop();
+
+	/**
+		@brief Gets the rumble data that is streamed.
+	*/
+	protocol::RumbleData get() const;
+
+private:
+	/**
+		@brief Writes the rumble as it changes, and every report period while it isn't silent, until stopped.
+	*/
+	void sendLoop();
+
+	std::shared_ptr<SubcommandChannel> m_subcommands;
+	std::shared_ptr<const HealthMonitor> m_healthMonitor;
+	std::shared_ptr<JoyConMetrics> m_metrics;
+
+	protocol::RumbleData m_rumble;
+	bool m_isChanged; // The rumble wasn't written since it was set.
+	std::chrono::steady_clock::time_point m_changeTime;
+	std::exception_ptr m_error; // Of the write that stopped the streaming.
+	bool m_isStopping;
+	mutable std::mutex m_lock;
+	std::condition_variable m_changed;
+	std::thread m_thread;
+};
+}
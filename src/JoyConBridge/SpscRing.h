@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief A fixed-capacity, lock-free, single-producer/single-consumer queue.
+
+	Exactly one thread may push and exactly one (other) thread may pop. Neither side ever blocks or allocates.
+
+	@tparam T The type of the stored values. Values are copied in and out.
+	@tparam Capacity The maximal number of values in the queue. Must be a power of 2.
+*/
+template <typename T, size_t Capacity>
+class SpscRing
+{
+	static_assert(0 != Capacity && 0 == (Capacity & (Capacity - 1)), "The capacity must be a power of 2");
+
+public:
+	/**
+		@brief Pushes a value to the queue. May only be called by the producer.
+
+		@param[in] value The value to push.
+
+		@return false if the queue is full, in which case the value is not pushed.
+	*/
+	bool tryPush(const T& value)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (Capacity == head - m_cachedTail) {
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (Capacity == head - m_cachedTail) {
+				return false;
+			}
+		}
+
+		m_slots[head & INDEX_MASK] = value;
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+		@brief Pops the oldest value from the queue. May only be called by the consumer.
+
+		@param[out] value Receives the popped value.
+
+		@return false if the queue is empty, in which case `value` is left untouched.
+	*/
+	bool tryPop(T& value)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail == m_cachedHead) {
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail == m_cachedHead) {
+				return false;
+			}
+		}
+
+		value = m_slots[tail & INDEX_MASK];
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	static const size_t INDEX_MASK = Capacity - 1;
+
+	std::array<T, Capacity> m_slots{};
+
+	// The producer and consumer indices are kept on separate cache lines so the two threads don't fight over them.
+	alignas(64) std::atomic<size_t> m_head{0};
+	size_t m_cachedTail = 0; // Producer's last known value of m_tail.
+
+	alignas(64) std::atomic<size_t> m_tail{0};
+	size_t m_cachedHead = 0; // Consumer's last known value of m_head.
+};
+}
@@ -0,0 +1,68 @@
+#include <stdexcept>
+#include "StickCalibration.h"
+
+
+namespace joy_con_bridge
+{
+StickCalibration::StickCalibration(const AnalogStickCalibrationData& calibrationData, const StickProfile& profile)
+	: m_calibrationData{}
+	, m_profile{}
+	, m_horizontal(AXIS_TABLE_SIZE)
+	, m_vertical(AXIS_TABLE_SIZE)
+	, m_response{}
+	, m_deadZoneCenterSquared(0)
+	, m_inverseLegalRange(0)
+{
+	setCalibrationData(calibrationData);
+	setProfile(profile);
+}
+
+void StickCalibration::setCalibrationData(const AnalogStickCalibrationData& calibrationData)
+{
+	m_calibrationData = calibrationData;
+	buildAxisTable(calibrationData.x.minBelowCenter, calibrationData.x.center, calibrationData.x.maxAboveCenter,
+	               m_horizontal);
+	buildAxisTable(calibrationData.y.minBelowCenter, calibrationData.y.center, calibrationData.y.maxAboveCenter,
+	               m_vertical);
+}
+
+const AnalogStickCalibrationData& StickCalibration::getCalibrationData() const
+{
+	return m_calibrationData;
+}
+
+void StickCalibration::setProfile(const StickProfile& profile)
+{
+	if (!(profile.deadZoneCenter >= 0) || !(profile.deadZoneOuter >= 0) ||
+	    !(profile.deadZoneCenter + profile.deadZoneOuter < 1) || !(profile.responseExponent > 0)) {
+		throw std::invalid_argument("Invalid stick profile");
+	}
+
+	m_profile = profile;
+	m_deadZoneCenterSquared = profile.deadZoneCenter * profile.deadZoneCenter;
+	m_inverseLegalRange = 1.0f / (1.0f - profile.deadZoneOuter - profile.deadZoneCenter);
+	for (size_t i = 0; i < m_response.size(); ++i) {
+		const float deflection = static_cast<float>(i) / RESPONSE_TABLE_SIZE;
+		m_response[i] = std::pow(deflection, profile.responseExponent);
+	}
+}
+
+const StickProfile& StickCalibration::getProfile() const
+{
+	return m_profile;
+}
+
+void StickCalibration::buildAxisTable(uint16_t minBelowCenter, uint16_t center, uint16_t maxAboveCenter,
+                                      std::vector<float>& table)
+{
+	// The same as decode::getCalibratedStickValues, for every raw value.
+	for (size_t i = 0; i < table.size(); ++i) {
+		const uint16_t clamped = std::min(std::max(static_cast<uint16_t>(i), minBelowCenter), maxAboveCenter);
+		if (clamped >= center) {
+			table[i] = static_cast<float>(clamped - center) / static_cast<float>(maxAboveCenter - center);
+		} else {
+			table[i] = -(static_cast<float>(clamped - center) / static_cast<float>(minBelowCenter - center));
+		}
+	}
+}
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "decode.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * How calibrated analog stick values are shaped.
+ */
+struct StickProfile
+{
+	float deadZoneCenter;   // Deflections up to this fraction of the full range read as 0.
+	float deadZoneOuter;    // Deflections within this fraction of the edge read as full.
+	float responseExponent; // Deflections between the dead zones are raised to this power. 1 is linear.
+};
+
+const StickProfile DEFAULT_STICK_PROFILE = {decode::STICK_DEAD_ZONE_CENTER, decode::STICK_DEAD_ZONE_OUTER, 1.0f};
+
+/**
+	@brief Calibrates the raw values of an analog stick, like `decode::getCalibratedStickValues` does, but with lookup
+	tables and a configurable profile.
+
+	Each axis has a table of its calibrated value for every possible raw value, which is built once, when the
+	calibration data is set. Calibrating a sample is then two table loads and a radial step for the dead zones and
+	the response curve, instead of clamps and divisions per axis.
+*/
+class StickCalibration
+{
+public:
+	// Raw stick values are 12 bit.
+	static constexpr size_t AXIS_TABLE_SIZE = 0x1000;
+	// The number of segments the response curve is approximated with.
+	static constexpr size_t RESPONSE_TABLE_SIZE = 256;
+
+	/**
+		@param[in] calibrationData The calibration data of the stick.
+		@param[in] profile The dead zones and response curve to apply.
+
+		@throws std::invalid_argument If the profile is not valid. See `setProfile`.
+	*/
+	explicit StickCalibration(const AnalogStickCalibrationData& calibrationData = {},
+	                          const StickProfile& profile = DEFAULT_STICK_PROFILE);
+
+	/**
+		@brief Calibrates the raw values of the stick.
+
+		@param[in] stickValues The uncalibrated values of the stick. They should be valid, see
+		                       `decode::isRawAnalogStickDataValid`.
+
+		@return Calibrated values.
+	*/
+	AnalogStick apply(const std::array<uint16_t, 2>& stickValues) const;
+
+	/**
+		@brief Sets the calibration data of the stick, and rebuilds the axis tables.
+	*/
+	void setCalibrationData(const AnalogStickCalibrationData& calibrationData);
+
+	const AnalogStickCalibrationData& getCalibrationData() const;
+
+	/**
+		@brief Sets the dead zones and response curve to apply, and rebuilds the response table.
+
+		@throws std::invalid_argument If a dead zone is negative, the dead zones leave nothing between them, or the
+		                              response exponent is not positive.
+	*/
+	void setProfile(const StickProfile& profile);
+
+	const StickProfile& getProfile() const;
+
+private:
+	static void buildAxisTable(uint16_t minBelowCenter, uint16_t center, uint16_t maxAboveCenter,
+	                           std::vector<float>& table);
+
+	AnalogStickCalibrationData m_calibrationData;
+	StickProfile m_profile;
+	std::vector<float> m_horizontal;
+	std::vector<float> m_vertical;
+	// The response curve at the ends of its segments, so there are RESPONSE_TABLE_SIZE + 1 entries.
+	std::array<float, RESPONSE_TABLE_SIZE + 1> m_response;
+	float m_deadZoneCenterSquared;
+	float m_inverseLegalRange; // The inverse of the range between the dead zones.
+};
+
+// Defined here, so it inlines into the decoding of each report.
+inline AnalogStick StickCalibration::apply(const std::array<uint16_t, 2>& stickValues) const
+{
+	const float x = m_horizontal[stickValues[0] % AXIS_TABLE_SIZE];
+	const float y = m_vertical[stickValues[1] % AXIS_TABLE_SIZE];
+
+	const float magnitudeSquared = x * x + y * y;
+	if (!(magnitudeSquared > m_deadZoneCenterSquared)) {
+		return {0, 0};
+	}
+
+	const float magnitude = std::sqrt(magnitudeSquared);
+	const float deflection = std::max(0.0f, (magnitude - m_profile.deadZoneCenter) * m_inverseLegalRange);
+	float response = 1.0f;
+	if (deflection < 1.0f) {
+		const float position = deflection * RESPONSE_TABLE_SIZE;
+		const size_t segment = static_cast<size_t>(position);
+		const float fraction = position - static_cast<float>(segment);
+		response = m_response[segment] + fraction * (m_response[segment + 1] - m_response[segment]);
+	}
+
+	const float scale = response / magnitude;
+	return {x * scale, y * scale};
+}
+}
@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <array>
+#include "SubcommandChannel.h"
+#include "command_ids.h"
+#include "exceptions.h"
+
+
+using namespace joy_con_bridge::command_ids;
+
+namespace joy_con_bridge
+{
+SubcommandChannel::SubcommandChannel(std::shared_ptr<Transport> transport, std::shared_ptr<JoyConMetrics> metrics)
+	: m_transport(std::move(transport))
+	, m_metrics(std::move(metrics))
+	, m_packetNumber(0)
+	, m_rumble(protocol::NEUTRAL_RUMBLE)
+	, m_inFlightCount(0)
+	, m_staleReplies()
+	, m_staleReplyCount(0)
+{}
+
+std::future<Buffer> SubcommandChannel::send(uint8_t commandId, uint8_t subcommandId, const Buffer& commandData,
+                                            const SubcommandBudget& budget)
+{
+	InFlightSubcommand subcommand{commandId, subcommandId, commandData, budget.timeout, budget.retries, {}, {}, {}, 0};
+	auto reply = subcommand.reply.get_future();
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	write(subcommand);
+	m_inFlight.push_back(std::move(subcommand));
+	m_inFlightCount = m_inFlight.size();
+
+	return reply;
+}
+
+void SubcommandChannel::sendRumble(const protocol::RumbleData& rumble)
+{
+	// Built in place rather than with `protocol::getCommandBuffer`, since rumble is streamed and shouldn't allocate.
+	std::array<uint8_t, 2 + std::tuple_size<protocol::RumbleData>::value> report{};
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	m_rumble = rumble;
+	report[0] = COMMAND_RUMBLE;
+	report[1] = static_cast<uint8_t>(m_packetNumber++ % 0x10);
+	std::copy(rumble.begin(), rumble.end(), report.begin() + 2);
+	m_transport->write(report.data(), report.size());
+}
+
+void SubcommandChannel::handleReply(const protocol::StandardInputReport& report)
+{
+	if (PACKET_TYPE_STANDARD != report.id || !report.ack || (0 == m_inFlightCount && 0 == m_staleReplyCount)) {
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	StaleReplies& staleReplies = m_staleReplies[report.replyToSubcommandId];
+	if (0 != staleReplies.count) {
+		if (now < staleReplies.expiry) {
+			// Another reply to a subcommand that is already complete.
+			--staleReplies.count;
+			--m_staleReplyCount;
+			return;
+		}
+		// The replies that were still expected were lost.
+		m_staleReplyCount -= staleReplies.count;
+		staleReplies.count = 0;
+	}
+
+	const auto subcommand = std::find_if(m_inFlight.begin(), m_inFlight.end(),
+	                                     [&report](const InFlightSubcommand& inFlight) {
+		                                     return inFlight.subcommandId == report.replyToSubcommandId;
+	                                     });
+	if (m_inFlight.end() == subcommand) {
+		return;
+	}
+
+	if (m_metrics) {
+		m_metrics->recordSubcommandReply(now - subcommand->sendTime);
+	}
+
+	if (1 < subcommand->attemptCount) {
+		staleReplies.count += subcommand->attemptCount - 1;
+		staleReplies.expiry = std::max(staleReplies.expiry, subcommand->deadline);
+		m_staleReplyCount += subcommand->attemptCount - 1;
+	}
+
+	if (0 == report.dataType) {
+		// simple ACK, no data.
+		subcommand->reply.set_value(Buffer());
+	} else {
+		subcommand->reply.set_value(Buffer(report.data, report.data + sizeof(report.data)));
+	}
+
+	m_inFlight.erase(subcommand);
+	m_inFlightCount = m_inFlight.size();
+}
+
+void SubcommandChannel::handleTimeouts()
+{
+	if (0 == m_inFlightCount) {
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> guard(m_lock);
+	auto subcommand = m_inFlight.begin();
+	while (m_inFlight.end() != subcommand) {
+		if (now < subcommand->deadline) {
+			++subcommand;
+			continue;
+		}
+
+		if (0 < subcommand->retriesLeft) {
+			--subcommand->retriesLeft;
+			if (m_metrics) {
+				m_metrics->recordSubcommandRetry();
+			}
+			try {
+				write(*subcommand);
+				++subcommand;
+				continue;
+			} catch (const HidError&) {
+				subcommand->reply.set_exception(std::current_exception());
+			}
+		} else {
+			if (m_metrics) {
+				m_metrics->recordSubcommandTimeout();
+			}
+			subcommand->reply.set_exception(std::make_exception_ptr(JoyConNotResponding()));
+		}
+
+		subcommand = m_inFlight.erase(subcommand);
+	}
+
+	m_inFlightCount = m_inFlight.size();
+}
+
+size_t SubcommandChannel::getInFlightCount() const
+{
+	return m_inFlightCount;
+}
+
+void SubcommandChannel::write(InFlightSubcommand& subcommand)
+{
+	const auto command = protocol::getSubCommandBuffer(subcommand.commandId, m_packetNumber++, subcommand.subcommandId,
+	                                                   subcommand.commandData, true, m_rumble);
+	m_transport->write(command);
+	++subcommand.attemptCount;
+	subcommand.sendTime = std::chrono::steady_clock::now();
+	subcommand.deadline = subcommand.sendTime + subcommand.timeout;
+}
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include "Buffer.h"
+#include "JoyConMetrics.h"
+#include "protocol.h"
+#include "Transport.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * How long to wait for the reply of a subcommand, and how many times to resend it before giving up.
+ */
+struct SubcommandBudget
+{
+	std::chrono::milliseconds timeout; // Per attempt.
+	unsigned int retries;
+};
+
+const SubcommandBudget DEFAULT_SUBCOMMAND_BUDGET = {std::chrono::milliseconds(500), 2};
+
+/**
+	@brief Tracks subcommands that were sent to a JoyCon and routes the replies back to their senders.
+
+	Several subcommands can be in flight at once. Replies are matched to them by subcommand ID, oldest first, since
+	a reply says nothing else about what it replies to. A subcommand that was resent may be replied to once per
+	attempt: once it is complete, that many of the replies with its ID that come before its last deadline are dropped,
+	so they don't complete a later subcommand with the same ID. If those replies were lost, the later subcommand is
+	resent instead.
+	The channel does not read from the device itself: whoever reads the input reports hands the replies to
+	`handleReply`, and calls `handleTimeouts` regularly. This class is thread-safe.
+*/
+class SubcommandChannel
+{
+public:
+	/**
+		@param[in] transport The transport to send subcommands through.
+		@param[in] metrics Where to record round trips, retries and timeouts. Optional.
+	*/
+	explicit SubcommandChannel(std::shared_ptr<Transport> transport, std::shared_ptr<JoyConMetrics> metrics = nullptr);
+
+	/**
+		@brief Sends a subcommand without waiting for its reply.
+
+		@param[in] commandId The ID of the command that carries the subcommand.
+		@param[in] subcommandId The ID of the subcommand.
+		@param[in] commandData A buffer containing the command data/parameters.
+		@param[in] budget How long to wait for the reply and how many times to resend the subcommand.
+
+		@return The data the subcommand will return. In case of a simple ACK, this is an empty buffer.
+		        If the budget runs out, the future holds JoyConNotResponding instead.
+
+		@throws HidError If the subcommand can't be written.
+	*/
+	std::future<Buffer> send(uint8_t commandId, uint8_t subcommandId, const Buffer& commandData,
+	                         const SubcommandBudget& budget);
+
+	/**
+		@brief Writes a report that carries only rumble data. Subcommands carry the same rumble data from now on, so
+		they don't interrupt the rumble.
+
+		@param[in] rumble The rumble data.
+
+		@throws HidError If the report can't be written.
+	*/
+	void sendRumble(const protocol::RumbleData& rumble);
+
+	/**
+		@brief Completes the oldest in-flight subcommand that the given report replies to, if any.
+
+		@param[in] report A standard (0x21) input report.
+	*/
+	void handleReply(const protocol::StandardInputReport& report);
+
+	/**
+		@brief Resends subcommands whose reply is late, and fails those that have no retries left.
+	*/
+	void handleTimeouts();
+
+	/**
+		@brief Gets the number of subcommands that are waiting for a reply.
+	*/
+	size_t getInFlightCount() const;
+
+private:
+	struct InFlightSubcommand
+	{
+		uint8_t commandId;
+		uint8_t subcommandId;
+		Buffer commandData;
+		std::chrono::milliseconds timeout;
+		unsigned int retriesLeft;
+		std::chrono::steady_clock::time_point sendTime; // Of the latest attempt.
+		std::chrono::steady_clock::time_point deadline;
+		std::promise<Buffer> reply;
+		unsigned int attemptCount;
+	};
+
+	/*
+	 * The replies still expected for the earlier attempts of completed subcommands, by subcommand ID.
+	 */
+	struct StaleReplies
+	{
+		unsigned int count;
+		std::chrono::steady_clock::time_point expiry; // Replies that come later were lost.
+	};
+
+	/**
+		@brief Writes a subcommand to the device, using the next packet number. Must be called with the lock held.
+
+		@param[in, out] subcommand The subcommand to write. Its send time and deadline are updated.
+	*/
+	void write(InFlightSubcommand& subcommand);
+
+	std::shared_ptr<Transport> m_transport;
+	std::shared_ptr<JoyConMetrics> m_metrics;
+	uint8_t m_packetNumber; // Shared by subcommands and rumble reports.
+	protocol::RumbleData m_rumble; // The latest rumble data, which every subcommand carries.
+	std::deque<InFlightSubcommand> m_inFlight;
+	std::atomic<size_t> m_inFlightCount; // Lets readers skip the lock when nothing is in flight.
+	std::array<StaleReplies, 0x100> m_staleReplies;
+	std::atomic<size_t> m_staleReplyCount; // Likewise, for the sum of the stale replies.
+	mutable std::mutex m_lock;
+};
+}
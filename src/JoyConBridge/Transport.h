@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Buffer.h"
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Carries reports between a JoyCon and the host.
+
+	`HidDevice` is the transport of actual JoyCons. Other transports stand in for them, to record or replay their
+	reports for example.
+*/
+class Transport
+{
+public:
+	virtual ~Transport() = default;
+
+	/**
+		Writes a report to the JoyCon.
+
+		@param[in] data The report.
+		@param[in] size The size of the report, in bytes.
+
+		@return The number of bytes written.
+
+		@throw HidError if writing fails.
+	*/
+	virtual size_t write(const uint8_t* data, size_t size) = 0;
+
+	/**
+		Writes a report to the JoyCon.
+
+		@param[in] buffer The report.
+
+		@return The number of bytes written.
+
+		@throw HidError if writing fails.
+	*/
+	size_t write(const Buffer& buffer)
+	{
+		return write(buffer.data(), buffer.size());
+	}
+
+	/**
+		Reads a report from the JoyCon, but waits for it no longer than a specific amount of time.
+
+		@param[out] data Receives the report.
+		@param[in] size The size of `data`, which is also the read length limit.
+		@param[in] milliseconds The maximum amount of time, in milliseconds, to wait for a report.
+
+		@return The number of bytes read.
+
+		@throw HidError if reading fails.
+		@throw HidTimeoutError if the timeout is reached.
+	*/
+	virtual size_t readInto(uint8_t* data, size_t size, int milliseconds) = 0;
+
+	/**
+		Reads a report from the JoyCon, only if there is one waiting to be read.
+
+		@param[out] data Receives the report.
+		@param[in] size The size of `data`, which is also the read length limit.
+
+		@return The number of bytes read, or 0 if there was no report to read.
+
+		@throw HidError if reading fails.
+	*/
+	virtual size_t tryReadInto(uint8_t* data, size_t size) = 0;
+
+	/**
+		Gets a file descriptor that becomes readable when a report is waiting, so the transport can be waited for
+		along with others (with epoll, for example). It must not be closed or read from directly.
+
+		@return The file descriptor, or -1 if the transport doesn't have one.
+	*/
+	virtual int getFileDescriptor() const
+	{
+		return -1;
+	}
+};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+namespace joy_con_bridge
+{
+/**
+	@brief Passes the latest value of something from one thread to another, without locks or allocations.
+
+	The producer can overwrite the value as often as it wants; the consumer always sees the newest complete value.
+	Exactly one thread may write and exactly one (other) thread may read.
+
+	@tparam T The type of the passed value.
+*/
+template <typename T>
+class TripleBuffer
+{
+public:
+	/**
+		@brief Publishes a new value. May only be called by the producer.
+
+		@param[in] value The new value.
+	*/
+	void write(const T& value)
+	{
+		m_slots[m_backIndex] = value;
+		const uint8_t previousMiddle = m_middle.exchange(m_backIndex | NEW_VALUE_FLAG, std::memory_order_acq_rel);
+		m_backIndex = previousMiddle & INDEX_MASK;
+	}
+
+	/**
+		@brief Reads the newest published value. May only be called by the consumer.
+
+		@param[out] value Receives the newest value.
+
+		@return false if no value was ever published, in which case `value` is left untouched.
+	*/
+	bool read(T& value)
+	{
+		if (0 != (m_middle.load(std::memory_order_relaxed) & NEW_VALUE_FLAG)) {
+			const uint8_t previousMiddle = m_middle.exchange(m_frontIndex, std::memory_order_acq_rel);
+			m_frontIndex = previousMiddle & INDEX_MASK;
+			m_hasValue = true;
+		}
+
+		if (!m_hasValue) {
+			return false;
+		}
+
+		value = m_slots[m_frontIndex];
+		return true;
+	}
+
+private:
+	static const uint8_t INDEX_MASK = 0x3;
+	static const uint8_t NEW_VALUE_FLAG = 0x4;
+
+	// At any time, one slot belongs to the producer (back), one to the consumer (front) and one is in the middle.
+	std::array<T, 3> m_slots{};
+
+	alignas(64) std::atomic<uint8_t> m_middle{1};
+
+	alignas(64) uint8_t m_backIndex = 0; // Producer only.
+
+	alignas(64) uint8_t m_frontIndex = 2; // Consumer only.
+	bool m_hasValue = false;
+};
+}
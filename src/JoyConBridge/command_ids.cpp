@@ -4,6 +4,7 @@
 namespace joy_con_bridge::command_ids
 {
 const uint8_t COMMAND_START_SUBCOMMAND = 0x1;
+const uint8_t COMMAND_RUMBLE           = 0x10;
 
 const uint8_t SUBCOMMAND_RUMBLE_CONTROL       = 0x48;
 const uint8_t SUBCOMMAND_OPTION_RUMBLE_ENABLE = 0x1;
@@ -18,6 +19,8 @@ const uint8_t SUBCOMMAND_OPTION_REPORT_MODE_SIMPLE_HID = 0x3F;
 
 const uint8_t SUBCOMMAND_SET_PLAYER_LED = 0x30;
 
+const uint8_t SUBCOMMAND_REQUEST_DEVICE_INFO = 0x2;
+
 const uint8_t SUBCOMMAND_SPI_READ = 0x10;
 
 const uint8_t PACKET_TYPE_STANDARD        = 0x21;
@@ -6,6 +6,8 @@ namespace joy_con_bridge::command_ids
 {
 // Controls the JoyCon/alters its behavior.
 extern const uint8_t COMMAND_START_SUBCOMMAND;
+// Sends rumble data only. It carries the packet number and the rumble data, like COMMAND_START_SUBCOMMAND.
+extern const uint8_t COMMAND_RUMBLE;
 
 // Enables/disables rumble. Used with COMMAND_START_SUBCOMMAND.
 extern const uint8_t SUBCOMMAND_RUMBLE_CONTROL;
@@ -29,6 +31,9 @@ extern const uint8_t SUBCOMMAND_OPTION_REPORT_MODE_SIMPLE_HID;
 // Sets the JoyCon's player LED state. 
 extern const uint8_t SUBCOMMAND_SET_PLAYER_LED;
 
+// Requests the firmware version, type and MAC address of the JoyCon.
+extern const uint8_t SUBCOMMAND_REQUEST_DEVICE_INFO;
+
 // Reads SPI data. Parameters are size (uint32) and bytes (uint8)
 extern const uint8_t SUBCOMMAND_SPI_READ;
 
@@ -1,5 +1,8 @@
+#include <functional>
+#include <future>
 #include "connect.h"
 #include "exceptions.h"
+#include "hidapi.h"
 
 
 namespace joy_con_bridge::connect
@@ -17,4 +20,80 @@ JoyCon getRightJoyCon()
 {
 	return JoyCon(HidDevice(JOYCON_VENDOR_ID, JOYCON_R_PRODUCT_ID), Hand::RIGHT);
 }
+
+/**
+	@brief Opens the transport of a device and runs the JoyCon handshake on it.
+
+	@param[in] device The device.
+	@param[in] openTransport Opens the transport of the device.
+	@param[in] calibrationCache See `JoyCon::JoyCon`.
+
+	@return The result of the connection. Errors are captured in it rather than thrown.
+*/
+static ConnectionResult handshake(const DeviceDescription& device, const TransportOpener& openTransport,
+                                  const std::shared_ptr<CalibrationCache>& calibrationCache)
+{
+	ConnectionResult result{device.path, device.hand, std::nullopt, nullptr, {}};
+
+	const auto start = std::chrono::steady_clock::now();
+	try {
+		result.joyCon.emplace(openTransport(device), device.hand, calibrationCache);
+	} catch (...) {
+		result.error = std::current_exception();
+	}
+	result.handshakeLatency = std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start);
+
+	return result;
+}
+
+std::vector<DeviceDescription> enumerate()
+{
+	std::vector<DeviceDescription> descriptions;
+
+	hid_device_info* const devices = hid_enumerate(JOYCON_VENDOR_ID, 0);
+	for (const hid_device_info* device = devices; nullptr != device; device = device->next) {
+		Hand hand;
+		if (JOYCON_L_PRODUCT_ID == device->product_id) {
+			hand = Hand::LEFT;
+		} else if (JOYCON_R_PRODUCT_ID == device->product_id) {
+			hand = Hand::RIGHT;
+		} else {
+			continue;
+		}
+
+		const wchar_t* const serialNumber = nullptr != device->serial_number ? device->serial_number : L"";
+		descriptions.push_back({device->path, serialNumber, hand});
+	}
+	hid_free_enumeration(devices);
+
+	return descriptions;
+}
+
+std::vector<ConnectionResult> connectAll(std::shared_ptr<CalibrationCache> calibrationCache)
+{
+	const TransportOpener openHidDevice = [](const DeviceDescription& device) {
+		return std::make_shared<HidDevice>(device.path);
+	};
+	return connectAll(enumerate(), openHidDevice, std::move(calibrationCache));
+}
+
+std::vector<ConnectionResult> connectAll(const std::vector<DeviceDescription>& devices,
+                                         const TransportOpener& openTransport,
+                                         std::shared_ptr<CalibrationCache> calibrationCache)
+{
+	std::vector<std::future<ConnectionResult>> connections;
+	for (const DeviceDescription& device : devices) {
+		connections.push_back(std::async(std::launch::async, &handshake, std::cref(device), std::cref(openTransport),
+		                                 std::cref(calibrationCache)));
+	}
+
+	std::vector<ConnectionResult> results;
+	results.reserve(connections.size());
+	for (auto& connection : connections) {
+		results.push_back(connection.get());
+	}
+
+	return results;
+}
 }
@@ -1,9 +1,45 @@
 #pragma once
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 #include "JoyCon.h"
 
 
 namespace joy_con_bridge::connect
 {
+/*
+ * A JoyCon that was found among the HID devices, but not necessarily connected to.
+ */
+struct DeviceDescription
+{
+	std::string path; // The HID path of the device. May change when the JoyCon reconnects.
+	std::wstring serialNumber; // The MAC address of the JoyCon, on Bluetooth. Stays the same across reconnects.
+	Hand hand;
+};
+
+/*
+ * The outcome of connecting to a single JoyCon.
+ */
+struct ConnectionResult
+{
+	std::string path; // The HID path of the device.
+	Hand hand;
+	std::optional<JoyCon> joyCon; // Empty if the handshake failed.
+	std::exception_ptr error; // Why the handshake failed, if it did.
+	std::chrono::microseconds handshakeLatency; // How long opening the device and the handshake took.
+};
+
+/**
+	@brief Opens the transport of a device that was found: a `HidDevice`, except in simulations.
+
+	@throw HidOpenError if the device can't be opened.
+*/
+using TransportOpener = std::function<std::shared_ptr<Transport>(const DeviceDescription& device)>;
+
 /**
 	@brief Gets the left JoyCon if it is available.
 
@@ -22,4 +58,37 @@ JoyCon getLeftJoyCon();
 	@throw HidOpenError if the right JoyCon can't be opened.
 */
 JoyCon getRightJoyCon();
+
+
+/**
+	@brief Lists every available JoyCon (L and R), without connecting to them.
+*/
+std::vector<DeviceDescription> enumerate();
+
+
+/**
+	@brief Connects to every available JoyCon (L and R).
+	The handshakes of all the devices run concurrently, so connecting many JoyCons takes about as long as connecting
+	one.
+
+	@param[in] calibrationCache Shared by all the JoyCons. See `JoyCon::JoyCon`.
+
+	@return A result for each JoyCon that was found, including those that failed to connect.
+*/
+std::vector<ConnectionResult> connectAll(std::shared_ptr<CalibrationCache> calibrationCache = nullptr);
+
+
+/**
+	@brief Connects to the given devices, concurrently, through transports that are opened by the caller. This is
+	what `connectAll()` does with the devices it finds, and lets it run against simulated devices.
+
+	@param[in] devices The devices to connect to.
+	@param[in] openTransport Opens the transport of each device. Called concurrently, from the handshake threads.
+	@param[in] calibrationCache Shared by all the JoyCons. See `JoyCon::JoyCon`.
+
+	@return A result for each device, in the same order.
+*/
+std::vector<ConnectionResult> connectAll(const std::vector<DeviceDescription>& devices,
+                                         const TransportOpener& openTransport,
+                                         std::shared_ptr<CalibrationCache> calibrationCache = nullptr);
 }
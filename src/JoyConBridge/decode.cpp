@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "decode.h"
+#include "StickCalibration.h"
+
+
+namespace joy_con_bridge::decode
+{
+const float PI = 3.141592654f;
+
+static void updateLeftStickCalibrationData(const std::array<uint16_t, 6>& rawCalibrationValues,
+                                           CalibrationData& calibrationData)
+{
+	calibrationData.leftStick.x.center         = rawCalibrationValues[2];
+	calibrationData.leftStick.x.maxAboveCenter = calibrationData.leftStick.x.center + rawCalibrationValues[0];
+	calibrationData.leftStick.x.minBelowCenter = calibrationData.leftStick.x.center - rawCalibrationValues[4];
+
+	calibrationData.leftStick.y.center         = rawCalibrationValues[3];
+	calibrationData.leftStick.y.maxAboveCenter = calibrationData.leftStick.y.center + rawCalibrationValues[1];
+	calibrationData.leftStick.y.minBelowCenter = calibrationData.leftStick.y.center - rawCalibrationValues[5];
+}
+
+static void updateRightStickCalibrationData(const std::array<uint16_t, 6>& rawCalibrationValues,
+                                            CalibrationData& calibrationData)
+{
+	calibrationData.rightStick.x.center         = rawCalibrationValues[0];
+	calibrationData.rightStick.x.maxAboveCenter = calibrationData.rightStick.x.center + rawCalibrationValues[4];
+	calibrationData.rightStick.x.minBelowCenter = calibrationData.rightStick.x.center - rawCalibrationValues[2];
+
+	calibrationData.rightStick.y.center         = rawCalibrationValues[1];
+	calibrationData.rightStick.y.maxAboveCenter = calibrationData.rightStick.y.center + rawCalibrationValues[5];
+	calibrationData.rightStick.y.minBelowCenter = calibrationData.rightStick.y.center - rawCalibrationValues[3];
+}
+
+static void updateAccelerometerCalibrationData(const ThreeAxesCalibrationData& data,
+                                               CalibrationData& calibrationData)
+{
+	static const float G = 9.8f;
+
+	calibrationData.accelerometerCoeff = {
+		1.0f / static_cast<float>(data.sensitivityOffset.x - data.neutral.x) * 4 * G,
+		1.0f / static_cast<float>(data.sensitivityOffset.y - data.neutral.y) * 4 * G,
+		1.0f / static_cast<float>(data.sensitivityOffset.z - data.neutral.z) * 4 * G
+	};
+}
+
+static void updateGyroscopeCalibrationData(const ThreeAxesCalibrationData& data,
+                                           CalibrationData& calibrationData)
+{
+	static const float ONE_DEGREE_IN_RADIANS = PI / 180;
+	// The sensitivity is the reading at this rate, in degrees per second.
+	static const float SENSITIVITY_RATE = 936;
+
+	calibrationData.gyroscopeCoeff = {
+		SENSITIVITY_RATE / static_cast<float>(data.sensitivityOffset.x - data.neutral.x) * ONE_DEGREE_IN_RADIANS,
+		SENSITIVITY_RATE / static_cast<float>(data.sensitivityOffset.y - data.neutral.y) * ONE_DEGREE_IN_RADIANS,
+		SENSITIVITY_RATE / static_cast<float>(data.sensitivityOffset.z - data.neutral.z) * ONE_DEGREE_IN_RADIANS
+	};
+	calibrationData.gyroscopeNeutral = {
+		static_cast<float>(data.neutral.x),
+		static_cast<float>(data.neutral.y),
+		static_cast<float>(data.neutral.z)
+	};
+}
+
+CalibrationData decodeCalibrationData(const RawCalibrationData& data)
+{
+	CalibrationData calibrationData{};
+
+	const auto factoryCalibrationValuesLeft = protocol::decodeStickCalibrationData(data.leftStick.data());
+	updateLeftStickCalibrationData(factoryCalibrationValuesLeft, calibrationData);
+
+	const auto factoryCalibrationValuesRight = protocol::decodeStickCalibrationData(data.rightStick.data());
+	updateRightStickCalibrationData(factoryCalibrationValuesRight, calibrationData);
+
+	const auto rawAccelerometerDataStart = data.sensors.data();
+	const auto rawGyroscopeDataStart = rawAccelerometerDataStart + sizeof(ThreeAxesCalibrationData);
+	ThreeAxesCalibrationData sensorData{};
+	std::memcpy(&sensorData, rawAccelerometerDataStart, sizeof(sensorData));
+	updateAccelerometerCalibrationData(sensorData, calibrationData);
+	std::memcpy(&sensorData, rawGyroscopeDataStart, sizeof(sensorData));
+	updateGyroscopeCalibrationData(sensorData, calibrationData);
+
+	return calibrationData;
+}
+
+ButtonMask decodeButtonMask(const protocol::InputReport& report)
+{
+	const auto bytes = reinterpret_cast<const uint8_t*>(&report.buttonStatusRight);
+	const ButtonMask buttons = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+	return buttons & button_bits::ALL_BUTTONS;
+}
+
+ButtonsState getButtonsState(ButtonMask buttons)
+{
+	ButtonsState state{};
+
+	state.a          = 0 != (buttons & button_bits::A);
+	state.b          = 0 != (buttons & button_bits::B);
+	state.x          = 0 != (buttons & button_bits::X);
+	state.y          = 0 != (buttons & button_bits::Y);
+	state.r          = 0 != (buttons & button_bits::R);
+	state.zr         = 0 != (buttons & button_bits::ZR);
+	state.rightStick = 0 != (buttons & button_bits::RIGHT_STICK);
+	state.plus       = 0 != (buttons & button_bits::PLUS);
+	state.home       = 0 != (buttons & button_bits::HOME);
+	state.srRight    = 0 != (buttons & button_bits::SR_RIGHT);
+	state.slRight    = 0 != (buttons & button_bits::SL_RIGHT);
+	state.up         = 0 != (buttons & button_bits::UP);
+	state.down       = 0 != (buttons & button_bits::DOWN);
+	state.left       = 0 != (buttons & button_bits::LEFT);
+	state.right      = 0 != (buttons & button_bits::RIGHT);
+	state.l          = 0 != (buttons & button_bits::L);
+	state.zl         = 0 != (buttons & button_bits::ZL);
+	state.leftStick  = 0 != (buttons & button_bits::LEFT_STICK);
+	state.minus      = 0 != (buttons & button_bits::MINUS);
+	state.capture    = 0 != (buttons & button_bits::CAPTURE);
+	state.srLeft     = 0 != (buttons & button_bits::SR_LEFT);
+	state.slLeft     = 0 != (buttons & button_bits::SL_LEFT);
+
+	return state;
+}
+
+void decodeButtons(const protocol::InputReport& report, ButtonsState& buttons)
+{
+	buttons = getButtonsState(decodeButtonMask(report));
+}
+
+bool isRawAnalogStickDataValid(const std::array<uint16_t, 2>& stickValues)
+{
+	return !(0 == stickValues[0] && 0 == stickValues[1]);
+}
+
+AnalogStick getCalibratedStickValues(const std::array<uint16_t, 2>& stickValues,
+                                     const AnalogStickCalibrationData& calibrationData)
+{
+	static const float LEGAL_RANGE = 1.0f - STICK_DEAD_ZONE_OUTER - STICK_DEAD_ZONE_CENTER;
+
+	float x, y;
+
+	// Not std::clamp, whose result is unspecified when the calibration data is bogus and the minimum is above the
+	// maximum. The batch decoder clamps the same way.
+	const uint16_t clampedX = std::min(std::max(stickValues[0], calibrationData.x.minBelowCenter),
+	                                   calibrationData.x.maxAboveCenter);
+	const uint16_t clampedY = std::min(std::max(stickValues[1], calibrationData.y.minBelowCenter),
+	                                   calibrationData.y.maxAboveCenter);
+
+	if (clampedX >= calibrationData.x.center) {
+		x = static_cast<float>(clampedX - calibrationData.x.center) / 
+			static_cast<float>(calibrationData.x.maxAboveCenter - calibrationData.x.center);
+	} else {
+		x = -(static_cast<float>(clampedX - calibrationData.x.center) /
+			  static_cast<float>(calibrationData.x.minBelowCenter - calibrationData.x.center));
+	}
+	if (clampedY >= calibrationData.y.center) {
+		y = static_cast<float>(clampedY - calibrationData.y.center) / 
+			static_cast<float>(calibrationData.y.maxAboveCenter - calibrationData.y.center);
+	} else {
+		y = -(static_cast<float>(clampedY - calibrationData.y.center) /
+			  static_cast<float>(calibrationData.y.minBelowCenter - calibrationData.y.center));
+	}
+
+	const float magnitude = std::sqrt(x * x + y * y);
+	if (magnitude > STICK_DEAD_ZONE_CENTER) {
+		const float normalizedMagnitude = std::min(1.0f, (magnitude - STICK_DEAD_ZONE_CENTER) / LEGAL_RANGE);
+		const float scale = normalizedMagnitude / magnitude;
+
+		return {x * scale, y * scale};
+	} else {
+		return {0, 0};
+	}
+}
+
+void decodeAnalogSticks(const protocol::InputReport& report, const CalibrationData& calibrationData,
+                        JoyConState& state)
+{
+	const auto leftStickValues = protocol::decodeAnalogStick(report.leftAnalogStick);
+	if (isRawAnalogStickDataValid(leftStickValues)) {
+		state.leftStick = getCalibratedStickValues(leftStickValues, calibrationData.leftStick);
+	}
+
+	const auto rightStickValues = protocol::decodeAnalogStick(report.rightAnalogStick);
+	if (isRawAnalogStickDataValid(rightStickValues)) {
+		state.rightStick = getCalibratedStickValues(rightStickValues, calibrationData.rightStick);
+	}
+}
+
+void decodeAnalogSticks(const protocol::InputReport& report, const StickCalibration& leftStick,
+                        const StickCalibration& rightStick, JoyConState& state)
+{
+	const auto leftStickValues = protocol::decodeAnalogStick(report.leftAnalogStick);
+	if (isRawAnalogStickDataValid(leftStickValues)) {
+		state.leftStick = leftStick.apply(leftStickValues);
+	}
+
+	const auto rightStickValues = protocol::decodeAnalogStick(report.rightAnalogStick);
+	if (isRawAnalogStickDataValid(rightStickValues)) {
+		state.rightStick = rightStick.apply(rightStickValues);
+	}
+}
+
+void decodeSensors(const protocol::StandardFullInputReport& report, const CalibrationData& calibrationData,
+                   JoyConState& state)
+{
+	decodeSensors(report, calibrationData, calibrationData.gyroscopeNeutral, state);
+}
+
+void decodeSensors(const protocol::StandardFullInputReport& report, const CalibrationData& calibrationData,
+                   const Coefficient& gyroscopeNeutral, JoyConState& state)
+{
+	const Coefficient& accelerometerCoeff = calibrationData.accelerometerCoeff;
+	const Coefficient& gyroscopeCoeff = calibrationData.gyroscopeCoeff;
+
+	// The samples are ordered from oldest to newest.
+	for (size_t i = 0; i < IMU_SAMPLES_PER_REPORT; ++i) {
+		const protocol::SensorData& rawSample = report.sensorData[i];
+		ImuSample& sample = state.imuSamples[i];
+
+		sample.accelerometer.x = static_cast<float>(rawSample.accelerometer[0]) * accelerometerCoeff.x;
+		sample.accelerometer.y = static_cast<float>(rawSample.accelerometer[1]) * accelerometerCoeff.y;
+		sample.accelerometer.z = static_cast<float>(rawSample.accelerometer[2]) * accelerometerCoeff.z;
+
+		sample.gyroscope.x = (static_cast<float>(rawSample.gyroscope[0]) - gyroscopeNeutral.x) * gyroscopeCoeff.x;
+		sample.gyroscope.y = (static_cast<float>(rawSample.gyroscope[1]) - gyroscopeNeutral.y) * gyroscopeCoeff.y;
+		sample.gyroscope.z = (static_cast<float>(rawSample.gyroscope[2]) - gyroscopeNeutral.z) * gyroscopeCoeff.z;
+
+		sample.timeOffset = -static_cast<float>(IMU_SAMPLES_PER_REPORT - 1 - i) * IMU_SAMPLE_PERIOD;
+	}
+
+	// The newest sample, so the single values are as fresh as the report.
+	state.accelerometer = state.imuSamples[IMU_SAMPLES_PER_REPORT - 1].accelerometer;
+	state.gyroscope = state.imuSamples[IMU_SAMPLES_PER_REPORT - 1].gyroscope;
+}
+}
@@ -0,0 +1,325 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "CalibrationCache.h"
+#include "protocol.h"
+#include "ReportClock.h"
+
+
+namespace joy_con_bridge
+{
+struct AnalogStickCalibrationData
+{
+	struct
+	{
+		uint16_t maxAboveCenter;
+		uint16_t center;
+		uint16_t minBelowCenter;
+	} x;
+
+	struct
+	{
+		uint16_t maxAboveCenter;
+		uint16_t center;
+		uint16_t minBelowCenter;
+	} y;
+};
+
+struct Position3D
+{
+	int16_t x;
+	int16_t y;
+	int16_t z;
+};
+
+struct Coefficient
+{
+	float x;
+	float y;
+	float z;
+};
+
+struct ThreeAxesCalibrationData
+{
+	Position3D neutral;
+	Position3D sensitivityOffset;
+};
+
+struct CalibrationData
+{
+	AnalogStickCalibrationData leftStick;
+	AnalogStickCalibrationData rightStick;
+	Coefficient accelerometerCoeff;
+	Coefficient gyroscopeCoeff;
+	// The gyroscope reading at rest, in raw units, as calibrated in the factory. It is subtracted before the
+	// coefficient is applied, unless `decodeSensors` is given a neutral learned since (see `GyroscopeBiasEstimator`).
+	Coefficient gyroscopeNeutral;
+};
+
+struct AnalogStick
+{
+	float x;
+	float y;
+};
+
+struct ThreeAxesSensor
+{
+	float x;
+	float y;
+	float z;
+};
+
+/*
+ * A single calibrated IMU sample. Full input reports carry several of these, taken at a higher rate than the reports.
+ */
+struct ImuSample
+{
+	ThreeAxesSensor accelerometer; // In m/s^2, gravity included.
+	ThreeAxesSensor gyroscope; // In rad/s.
+	float timeOffset; // In seconds, relative to the newest sample in the same report (always <= 0).
+	std::chrono::steady_clock::time_point sampleTime; // Estimated, see `ReportTimestamp`. Set by the JoyCon.
+};
+
+// The number of IMU samples in every full input report.
+const size_t IMU_SAMPLES_PER_REPORT = 3;
+// The time between the IMU samples of a report, in seconds. The IMU samples at ~200Hz.
+const float IMU_SAMPLE_PERIOD = 0.005f;
+
+using ImuSamples = std::array<ImuSample, IMU_SAMPLES_PER_REPORT>;
+
+struct ButtonsState
+{
+	bool a;
+	bool b;
+	bool x;
+	bool y;
+	bool r;
+	bool zr;
+	bool rightStick;
+	bool plus;
+	bool home;
+	bool srRight; // == SR on right joycon.
+	bool slRight;
+
+	bool up;
+	bool down;
+	bool left;
+	bool right;
+	bool l;
+	bool zl;
+	bool leftStick;
+	bool minus;
+	bool capture;
+	bool srLeft;
+	bool slLeft;
+};
+
+/*
+ * The buttons as bits, in the order of the button bytes of input reports: right, shared, then left.
+ * See `button_bits`.
+ */
+using ButtonMask = uint32_t;
+
+namespace button_bits
+{
+const ButtonMask Y           = 1u << 0;
+const ButtonMask X           = 1u << 1;
+const ButtonMask B           = 1u << 2;
+const ButtonMask A           = 1u << 3;
+const ButtonMask SR_RIGHT    = 1u << 4;
+const ButtonMask SL_RIGHT    = 1u << 5;
+const ButtonMask R           = 1u << 6;
+const ButtonMask ZR          = 1u << 7;
+const ButtonMask MINUS       = 1u << 8;
+const ButtonMask PLUS        = 1u << 9;
+const ButtonMask RIGHT_STICK = 1u << 10;
+const ButtonMask LEFT_STICK  = 1u << 11;
+const ButtonMask HOME        = 1u << 12;
+const ButtonMask CAPTURE     = 1u << 13;
+const ButtonMask DOWN        = 1u << 16;
+const ButtonMask UP          = 1u << 17;
+const ButtonMask RIGHT       = 1u << 18;
+const ButtonMask LEFT        = 1u << 19;
+const ButtonMask SR_LEFT     = 1u << 20;
+const ButtonMask SL_LEFT     = 1u << 21;
+const ButtonMask L           = 1u << 22;
+const ButtonMask ZL          = 1u << 23;
+
+// The buttons of each JoyCon. The shared byte is split between them.
+const ButtonMask RIGHT_JOY_CON_BUTTONS = Y | X | B | A | SR_RIGHT | SL_RIGHT | R | ZR | PLUS | RIGHT_STICK | HOME;
+const ButtonMask LEFT_JOY_CON_BUTTONS = DOWN | UP | RIGHT | LEFT | SR_LEFT | SL_LEFT | L | ZL | MINUS | LEFT_STICK |
+	CAPTURE;
+const ButtonMask ALL_BUTTONS = RIGHT_JOY_CON_BUTTONS | LEFT_JOY_CON_BUTTONS;
+}
+
+/*
+ * The buttons held in a report and in the one before it, which tell the buttons that were pressed or released
+ * between them.
+ */
+struct ButtonEdges
+{
+	ButtonMask current;
+	ButtonMask previous;
+
+	/**
+		@brief Gets the buttons that are down in this report.
+	*/
+	ButtonMask held() const
+	{
+		return current;
+	}
+
+	/**
+		@brief Gets the buttons that are down in this report, but were up in the previous one.
+	*/
+	ButtonMask pressed() const
+	{
+		return current & ~previous;
+	}
+
+	/**
+		@brief Gets the buttons that are up in this report, but were down in the previous one.
+	*/
+	ButtonMask released() const
+	{
+		return previous & ~current;
+	}
+
+	/**
+		@brief Moves on to the next report.
+
+		@param[in] buttons The buttons that are down in the next report.
+	*/
+	void update(ButtonMask buttons)
+	{
+		previous = current;
+		current = buttons;
+	}
+};
+
+/*
+ * A snapshot of everything decoded from the JoyCon's input reports.
+ */
+struct JoyConState
+{
+	ButtonsState buttons; // The same as `buttonEdges.held()`, one field per button.
+	ButtonEdges buttonEdges;
+	AnalogStick leftStick;
+	AnalogStick rightStick;
+	ThreeAxesSensor gyroscope; // Of the newest IMU sample.
+	ThreeAxesSensor accelerometer; // Of the newest IMU sample.
+	ImuSamples imuSamples;
+	uint8_t timer; // Counts up on the JoyCon as reports are sent, and wraps around.
+	ReportTimestamp timestamp; // Of the report the state was last updated by. Set by the JoyCon.
+};
+}
+
+/*
+ * Decoding of input reports into a JoyConState. The functions are pure: they depend only on their parameters, so they
+ * can run on any thread, and be measured on their own.
+ */
+namespace joy_con_bridge
+{
+class StickCalibration;
+}
+
+namespace joy_con_bridge::decode
+{
+// The dead zones of calibrated analog sticks, in the middle and at the edge, as fractions of the full range.
+const float STICK_DEAD_ZONE_CENTER = 0.15f;
+const float STICK_DEAD_ZONE_OUTER = 0.10f;
+
+/**
+	@brief Decodes the calibration data of a JoyCon, as it appears in its SPI flash.
+*/
+CalibrationData decodeCalibrationData(const RawCalibrationData& data);
+
+/**
+	@brief Gets the buttons that are down in a report.
+*/
+ButtonMask decodeButtonMask(const protocol::InputReport& report);
+
+/**
+	@brief Spreads a button mask into one field per button.
+*/
+ButtonsState getButtonsState(ButtonMask buttons);
+
+/**
+	@brief Updates the state of all buttons based on the report.
+
+	@param[in] report The report used to update the buttons.
+	@param[out] buttons Receives the state of the buttons.
+*/
+void decodeButtons(const protocol::InputReport& report, ButtonsState& buttons);
+
+/**
+	@brief Checks if analog stick values, before calibration, are valid.
+
+	@param[in] stickValues The uncalibrated values.
+
+	@return True if the values are valid
+*/
+bool isRawAnalogStickDataValid(const std::array<uint16_t, 2>& stickValues);
+
+/**
+	@brief Calculates the calibrated values of an analog stick.
+
+	Credit to Hypersect (Ryan Juckett)
+	http://blog.hypersect.com/interpreting-analog-sticks/
+	Special thanks to CTCaer/jc_toolkit
+
+	@param[in] stickValues The uncalibrated values of the analog stick.
+	@param[in] calibrationData The calibration data to use.
+
+	@return Calibrated values.
+*/
+AnalogStick getCalibratedStickValues(const std::array<uint16_t, 2>& stickValues,
+                                     const AnalogStickCalibrationData& calibrationData);
+
+/**
+	@brief Updates analog stick values based on an input report and calibration data.
+	Sticks with invalid values keep their previous values.
+
+	@param[in] report The report used to update the analog sticks.
+	@param[in] calibrationData The calibration data of the JoyCon.
+	@param[in, out] state Receives the values of the analog sticks.
+*/
+void decodeAnalogSticks(const protocol::InputReport& report, const CalibrationData& calibrationData,
+                        JoyConState& state);
+
+/**
+	@brief Same as `decodeAnalogSticks(const protocol::InputReport&, const CalibrationData&, JoyConState&)`, with the
+	lookup tables and profiles of each stick.
+
+	@param[in] report The report used to update the analog sticks.
+	@param[in] leftStick The calibration of the left stick.
+	@param[in] rightStick The calibration of the right stick.
+	@param[in, out] state Receives the values of the analog sticks.
+*/
+void decodeAnalogSticks(const protocol::InputReport& report, const StickCalibration& leftStick,
+                        const StickCalibration& rightStick, JoyConState& state);
+
+/**
+	@brief Updates sensor data based on a full input report and calibration data.
+
+	The gyroscope values are the raw readings less the neutral of the calibration data, times its coefficient, so a
+	JoyCon at rest reads about 0.
+
+	@param[in] report The report used to update the sensors.
+	@param[in] calibrationData The calibration data of the JoyCon.
+	@param[in, out] state Receives the IMU samples, and the accelerometer and gyroscope values of the newest one.
+*/
+void decodeSensors(const protocol::StandardFullInputReport& report, const CalibrationData& calibrationData,
+                   JoyConState& state);
+
+/**
+	@brief Same as `decodeSensors(report, calibrationData, state)`, but subtracts another gyroscope neutral than the
+	calibrated one, such as the one `GyroscopeBiasEstimator` learned as the gyroscope drifted.
+
+	@param[in] gyroscopeNeutral The gyroscope reading at rest, in raw units.
+*/
+void decodeSensors(const protocol::StandardFullInputReport& report, const CalibrationData& calibrationData,
+                   const Coefficient& gyroscopeNeutral, JoyConState& state);
+}
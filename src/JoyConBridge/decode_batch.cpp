@@ -0,0 +1,143 @@
+#include "decode_batch.h"
+#include "decode_batch_kernels.h"
+
+#if defined(JOYCONBRIDGE_X86_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace joy_con_bridge::decode
+{
+static DecodeKernel detectBestDecodeKernel()
+{
+#ifdef JOYCONBRIDGE_X86_KERNELS
+#ifdef _MSC_VER
+	static const int SSE41_BIT = 1 << 19;    // Of ECX, in leaf 1.
+	static const int OSXSAVE_BIT = 1 << 27;  // Of ECX, in leaf 1.
+	static const int AVX_BIT = 1 << 28;      // Of ECX, in leaf 1.
+	static const int AVX2_BIT = 1 << 5;      // Of EBX, in leaf 7.
+	static const unsigned long long AVX_STATE = 6; // XMM and YMM registers, in XCR0.
+
+	int registers[4] = {};
+	__cpuid(registers, 0);
+	const int maxLeaf = registers[0];
+	__cpuid(registers, 1);
+	const bool hasSse41 = 0 != (registers[2] & SSE41_BIT);
+	// The OS must also save the AVX registers on context switches.
+	const bool hasAvx = 0 != (registers[2] & OSXSAVE_BIT) && 0 != (registers[2] & AVX_BIT) &&
+		AVX_STATE == (_xgetbv(0) & AVX_STATE);
+	bool hasAvx2 = false;
+	if (hasAvx && maxLeaf >= 7) {
+		__cpuidex(registers, 7, 0);
+		hasAvx2 = 0 != (registers[1] & AVX2_BIT);
+	}
+#else
+	__builtin_cpu_init();
+	const bool hasSse41 = __builtin_cpu_supports("sse4.1");
+	const bool hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	if (hasAvx2) {
+		return DecodeKernel::AVX2;
+	}
+	if (hasSse41) {
+		return DecodeKernel::SSE41;
+	}
+#endif
+
+	return DecodeKernel::SCALAR;
+}
+
+DecodeKernel getBestDecodeKernel()
+{
+	static const DecodeKernel bestKernel = detectBestDecodeKernel();
+	return bestKernel;
+}
+
+void decodeReports(const protocol::StandardFullInputReport* reports, size_t count,
+                   const CalibrationData& calibrationData, DecodedReports& decoded, DecodeKernel kernel)
+{
+	decoded.buttons.resize(count);
+	for (auto stick : {&decoded.leftStickX, &decoded.leftStickY, &decoded.rightStickX, &decoded.rightStickY}) {
+		stick->resize(count);
+	}
+	for (auto axis : {&decoded.accelerometerX, &decoded.accelerometerY, &decoded.accelerometerZ,
+	                  &decoded.gyroscopeX, &decoded.gyroscopeY, &decoded.gyroscopeZ}) {
+		axis->resize(count * IMU_SAMPLES_PER_REPORT);
+	}
+
+	const kernels::Output output = {
+		decoded.buttons.data(),
+		decoded.leftStickX.data(),
+		decoded.leftStickY.data(),
+		decoded.rightStickX.data(),
+		decoded.rightStickY.data(),
+		decoded.accelerometerX.data(),
+		decoded.accelerometerY.data(),
+		decoded.accelerometerZ.data(),
+		decoded.gyroscopeX.data(),
+		decoded.gyroscopeY.data(),
+		decoded.gyroscopeZ.data()
+	};
+
+	if (kernel > getBestDecodeKernel()) {
+		kernel = getBestDecodeKernel();
+	}
+
+	size_t decodedCount = 0;
+#ifdef JOYCONBRIDGE_X86_KERNELS
+	if (DecodeKernel::AVX2 == kernel) {
+		decodedCount = kernels::decodeReportsAvx2(reports, count, calibrationData, output);
+	} else if (DecodeKernel::SSE41 == kernel) {
+		decodedCount = kernels::decodeReportsSse41(reports, count, calibrationData, output);
+	}
+#endif
+	kernels::decodeReportsScalar(reports, decodedCount, count, calibrationData, output);
+}
+}
+
+namespace joy_con_bridge::decode::kernels
+{
+void decodeReportsScalar(const protocol::StandardFullInputReport* reports, size_t start, size_t count,
+                         const CalibrationData& calibrationData, const Output& output)
+{
+	JoyConState state{};
+	if (0 != start) {
+		state.leftStick = {output.leftStickX[start - 1], output.leftStickY[start - 1]};
+		state.rightStick = {output.rightStickX[start - 1], output.rightStickY[start - 1]};
+	}
+
+	for (size_t i = start; i < count; ++i) {
+		const protocol::StandardFullInputReport& report = reports[i];
+
+		output.buttons[i] = decodeButtonMask(report);
+
+		decodeAnalogSticks(report, calibrationData, state);
+		output.leftStickX[i] = state.leftStick.x;
+		output.leftStickY[i] = state.leftStick.y;
+		output.rightStickX[i] = state.rightStick.x;
+		output.rightStickY[i] = state.rightStick.y;
+
+		decodeSensors(report, calibrationData, state);
+		for (size_t j = 0; j < IMU_SAMPLES_PER_REPORT; ++j) {
+			const size_t sample = i * IMU_SAMPLES_PER_REPORT + j;
+			output.accelerometerX[sample] = state.imuSamples[j].accelerometer.x;
+			output.accelerometerY[sample] = state.imuSamples[j].accelerometer.y;
+			output.accelerometerZ[sample] = state.imuSamples[j].accelerometer.z;
+			output.gyroscopeX[sample] = state.imuSamples[j].gyroscope.x;
+			output.gyroscopeY[sample] = state.imuSamples[j].gyroscope.y;
+			output.gyroscopeZ[sample] = state.imuSamples[j].gyroscope.z;
+		}
+	}
+}
+
+void keepInvalidStickValues(float* x, float* y, size_t start, unsigned int invalidReports)
+{
+	for (size_t i = start; 0 != invalidReports; ++i, invalidReports >>= 1) {
+		if (0 != (invalidReports & 1)) {
+			x[i] = 0 == i ? 0.0f : x[i - 1];
+			y[i] = 0 == i ? 0.0f : y[i - 1];
+		}
+	}
+}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "decode.h"
+#include "protocol.h"
+
+
+namespace joy_con_bridge::decode
+{
+/*
+ * Decoded full input reports, as a structure of arrays: element i of each array belongs to report i.
+ */
+struct DecodedReports
+{
+	std::vector<ButtonMask> buttons; // See button_bits.
+
+	std::vector<float> leftStickX;
+	std::vector<float> leftStickY;
+	std::vector<float> rightStickX;
+	std::vector<float> rightStickY;
+
+	// These hold IMU_SAMPLES_PER_REPORT elements per report, oldest first, so sample j of report i is at
+	// `i * IMU_SAMPLES_PER_REPORT + j`.
+	std::vector<float> accelerometerX;
+	std::vector<float> accelerometerY;
+	std::vector<float> accelerometerZ;
+	std::vector<float> gyroscopeX;
+	std::vector<float> gyroscopeY;
+	std::vector<float> gyroscopeZ;
+};
+
+/*
+ * The implementations of `decodeReports`, from the slowest to the fastest.
+ */
+enum class DecodeKernel
+{
+	SCALAR,
+	SSE41,
+	AVX2
+};
+
+/**
+	@brief Gets the fastest decode kernel that the CPU supports. Checked once, on the first call.
+*/
+DecodeKernel getBestDecodeKernel();
+
+/**
+	@brief Decodes many full (0x30) input reports at once, much faster than one by one.
+
+	The results are exactly those of `decodeButtons`, `decodeAnalogSticks` and `decodeSensors`, with the default
+	stick profile. Like there, a stick with invalid values keeps the values it had in the previous report (0 in the
+	first one).
+
+	@param[in] reports The reports, in the order they were read.
+	@param[in] count The number of reports.
+	@param[in] calibrationData The calibration data of the JoyCon that sent the reports.
+	@param[out] decoded Receives the decoded reports. Its arrays are resized to fit them.
+	@param[in] kernel The implementation to use. If the CPU doesn't support it, the best one it supports is used.
+*/
+void decodeReports(const protocol::StandardFullInputReport* reports, size_t count,
+                   const CalibrationData& calibrationData, DecodedReports& decoded,
+                   DecodeKernel kernel = getBestDecodeKernel());
+}
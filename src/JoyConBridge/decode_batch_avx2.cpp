@@ -0,0 +1,157 @@
+#include "decode_batch_kernels.h"
+
+#ifdef JOYCONBRIDGE_X86_KERNELS
+#include <immintrin.h>
+
+
+namespace joy_con_bridge::decode::kernels
+{
+const size_t AVX2_BLOCK_SIZE = 8;
+const int REPORT_SIZE = sizeof(protocol::StandardFullInputReport);
+const int SENSOR_SAMPLE_SIZE = sizeof(protocol::SensorData);
+
+/**
+	@brief Loads 4 bytes from each of 8 addresses.
+*/
+static __m256i gather(const uint8_t* base, __m256i offsets)
+{
+	return _mm256_i32gather_epi32(reinterpret_cast<const int*>(base), offsets, 1);
+}
+
+/**
+	@brief Calibrates one axis of a stick, like `getCalibratedStickValues` does before it applies the dead zone.
+*/
+static __m256 calibrateAxis(__m256i values, int minBelowCenter, int center, int maxAboveCenter)
+{
+	const __m256i minimum = _mm256_set1_epi32(minBelowCenter);
+	const __m256i middle = _mm256_set1_epi32(center);
+	const __m256i maximum = _mm256_set1_epi32(maxAboveCenter);
+
+	const __m256i clamped = _mm256_min_epi32(_mm256_max_epi32(values, minimum), maximum);
+
+	const __m256i isBelowCenter = _mm256_cmpgt_epi32(middle, clamped);
+	const __m256 distance = _mm256_cvtepi32_ps(_mm256_sub_epi32(clamped, middle));
+	const __m256 range = _mm256_cvtepi32_ps(_mm256_blendv_epi8(_mm256_sub_epi32(maximum, middle),
+	                                                           _mm256_sub_epi32(middle, minimum), isBelowCenter));
+	return _mm256_div_ps(distance, range);
+}
+
+/**
+	@brief Decodes and calibrates a stick, like `decodeAnalogSticks` does.
+
+	@return A bit mask of the reports in which the values of the stick are invalid.
+*/
+static unsigned int decodeStick(__m256i raw, const AnalogStickCalibrationData& calibrationData, float* x, float* y)
+{
+	const __m256i twelveBits = _mm256_set1_epi32(0xFFF);
+	const __m256 deadZone = _mm256_set1_ps(STICK_DEAD_ZONE_CENTER);
+
+	__m256 horizontal = calibrateAxis(_mm256_and_si256(raw, twelveBits), calibrationData.x.minBelowCenter,
+	                                  calibrationData.x.center, calibrationData.x.maxAboveCenter);
+	__m256 vertical = calibrateAxis(_mm256_and_si256(_mm256_srli_epi32(raw, 12), twelveBits),
+	                                calibrationData.y.minBelowCenter, calibrationData.y.center,
+	                                calibrationData.y.maxAboveCenter);
+
+	const __m256 magnitude = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(horizontal, horizontal),
+	                                                      _mm256_mul_ps(vertical, vertical)));
+	const __m256 normalizedMagnitude = _mm256_min_ps(
+		_mm256_div_ps(_mm256_sub_ps(magnitude, deadZone), _mm256_set1_ps(STICK_LEGAL_RANGE)), _mm256_set1_ps(1.0f));
+	const __m256 scale = _mm256_div_ps(normalizedMagnitude, magnitude);
+	const __m256 isOutsideDeadZone = _mm256_cmp_ps(magnitude, deadZone, _CMP_GT_OQ);
+	horizontal = _mm256_and_ps(_mm256_mul_ps(horizontal, scale), isOutsideDeadZone);
+	vertical = _mm256_and_ps(_mm256_mul_ps(vertical, scale), isOutsideDeadZone);
+
+	_mm256_storeu_ps(x, horizontal);
+	_mm256_storeu_ps(y, vertical);
+
+	const __m256i isInvalid = _mm256_cmpeq_epi32(_mm256_and_si256(raw, _mm256_set1_epi32(0xFFFFFF)),
+	                                             _mm256_setzero_si256());
+	return static_cast<unsigned int>(_mm256_movemask_ps(_mm256_castsi256_ps(isInvalid)));
+}
+
+size_t decodeReportsAvx2(const protocol::StandardFullInputReport* reports, size_t count,
+                         const CalibrationData& calibrationData, const Output& output)
+{
+	const __m256i reportOffsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+	                                                 _mm256_set1_epi32(REPORT_SIZE));
+
+	// The IMU samples of a block fill 3 vectors. These are the offsets of the samples of each vector, in the block.
+	__m256i sampleOffsets[IMU_SAMPLES_PER_REPORT];
+	for (size_t vector = 0; vector < IMU_SAMPLES_PER_REPORT; ++vector) {
+		alignas(32) int offsets[AVX2_BLOCK_SIZE];
+		for (size_t lane = 0; lane < AVX2_BLOCK_SIZE; ++lane) {
+			const size_t sample = vector * AVX2_BLOCK_SIZE + lane;
+			offsets[lane] = static_cast<int>(sample / IMU_SAMPLES_PER_REPORT) * REPORT_SIZE +
+				static_cast<int>(sample % IMU_SAMPLES_PER_REPORT) * SENSOR_SAMPLE_SIZE;
+		}
+		sampleOffsets[vector] = _mm256_load_si256(reinterpret_cast<const __m256i*>(offsets));
+	}
+
+	const float* const coefficients[] = {
+		&calibrationData.accelerometerCoeff.x,
+		&calibrationData.accelerometerCoeff.y,
+		&calibrationData.accelerometerCoeff.z,
+		&calibrationData.gyroscopeCoeff.x,
+		&calibrationData.gyroscopeCoeff.y,
+		&calibrationData.gyroscopeCoeff.z
+	};
+	// Subtracted before the coefficients are applied. The accelerometer has none.
+	const float neutrals[] = {
+		0,
+		0,
+		0,
+		calibrationData.gyroscopeNeutral.x,
+		calibrationData.gyroscopeNeutral.y,
+		calibrationData.gyroscopeNeutral.z
+	};
+	float* const axes[] = {
+		output.accelerometerX,
+		output.accelerometerY,
+		output.accelerometerZ,
+		output.gyroscopeX,
+		output.gyroscopeY,
+		output.gyroscopeZ
+	};
+
+	size_t i = 0;
+	for (; i + AVX2_BLOCK_SIZE <= count; i += AVX2_BLOCK_SIZE) {
+		const uint8_t* const block = reinterpret_cast<const uint8_t*>(reports + i);
+
+		const __m256i buttons = _mm256_and_si256(gather(block + BUTTONS_OFFSET, reportOffsets),
+		                                         _mm256_set1_epi32(button_bits::ALL_BUTTONS));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(output.buttons + i), buttons);
+
+		const unsigned int invalidLeft = decodeStick(gather(block + LEFT_STICK_OFFSET, reportOffsets),
+		                                             calibrationData.leftStick, output.leftStickX + i,
+		                                             output.leftStickY + i);
+		keepInvalidStickValues(output.leftStickX, output.leftStickY, i, invalidLeft);
+		const unsigned int invalidRight = decodeStick(gather(block + RIGHT_STICK_OFFSET, reportOffsets),
+		                                              calibrationData.rightStick, output.rightStickX + i,
+		                                              output.rightStickY + i);
+		keepInvalidStickValues(output.rightStickX, output.rightStickY, i, invalidRight);
+
+		// The axes are loaded in pairs, the first one in the low half of 32 bits and the second in the high half. The
+		// shifts extend their signs.
+		for (size_t axis = 0; axis < 6; axis += 2) {
+			const uint8_t* const values = block + SENSOR_DATA_OFFSET + 2 * axis;
+			const __m256 firstCoefficient = _mm256_set1_ps(*coefficients[axis]);
+			const __m256 secondCoefficient = _mm256_set1_ps(*coefficients[axis + 1]);
+			const __m256 firstNeutral = _mm256_set1_ps(neutrals[axis]);
+			const __m256 secondNeutral = _mm256_set1_ps(neutrals[axis + 1]);
+			for (size_t vector = 0; vector < IMU_SAMPLES_PER_REPORT; ++vector) {
+				const __m256i raw = gather(values, sampleOffsets[vector]);
+				const size_t sample = i * IMU_SAMPLES_PER_REPORT + vector * AVX2_BLOCK_SIZE;
+				const __m256i first = _mm256_srai_epi32(_mm256_slli_epi32(raw, 16), 16);
+				const __m256i second = _mm256_srai_epi32(raw, 16);
+				const __m256 firstValues = _mm256_sub_ps(_mm256_cvtepi32_ps(first), firstNeutral);
+				const __m256 secondValues = _mm256_sub_ps(_mm256_cvtepi32_ps(second), secondNeutral);
+				_mm256_storeu_ps(axes[axis] + sample, _mm256_mul_ps(firstValues, firstCoefficient));
+				_mm256_storeu_ps(axes[axis + 1] + sample, _mm256_mul_ps(secondValues, secondCoefficient));
+			}
+		}
+	}
+
+	return i;
+}
+}
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "decode.h"
+#include "protocol.h"
+
+/*
+ * The kernels of decode::decodeReports. Each SIMD kernel is in its own file, which is compiled for its instruction
+ * set, and is only called once the CPU is known to support it.
+ */
+#if defined(__x86_64__) || defined(_M_X64)
+#define JOYCONBRIDGE_X86_KERNELS
+#endif
+
+
+namespace joy_con_bridge::decode::kernels
+{
+// The offsets of the fields of full input reports, which the SIMD kernels load by address.
+const int BUTTONS_OFFSET = 3;
+const int LEFT_STICK_OFFSET = 6;
+const int RIGHT_STICK_OFFSET = 9;
+const int SENSOR_DATA_OFFSET = 13;
+
+const float STICK_LEGAL_RANGE = 1.0f - STICK_DEAD_ZONE_OUTER - STICK_DEAD_ZONE_CENTER;
+
+/*
+ * Where the kernels write the decoded reports, at the index of each report (of each IMU sample, for the sensors).
+ */
+struct Output
+{
+	ButtonMask* buttons;
+	float* leftStickX;
+	float* leftStickY;
+	float* rightStickX;
+	float* rightStickY;
+	float* accelerometerX;
+	float* accelerometerY;
+	float* accelerometerZ;
+	float* gyroscopeX;
+	float* gyroscopeY;
+	float* gyroscopeZ;
+};
+
+/**
+	@brief Decodes the reports from `start` to `count`, one by one.
+*/
+void decodeReportsScalar(const protocol::StandardFullInputReport* reports, size_t start, size_t count,
+                         const CalibrationData& calibrationData, const Output& output);
+
+#ifdef JOYCONBRIDGE_X86_KERNELS
+/**
+	@brief Decodes the reports in blocks of 4, from the first one.
+
+	@return The number of reports decoded. The rest don't fill a block, and are left for the scalar kernel.
+*/
+size_t decodeReportsSse41(const protocol::StandardFullInputReport* reports, size_t count,
+                          const CalibrationData& calibrationData, const Output& output);
+
+/**
+	@brief Decodes the reports in blocks of 8, from the first one.
+
+	@return The number of reports decoded. The rest don't fill a block, and are left for the scalar kernel.
+*/
+size_t decodeReportsAvx2(const protocol::StandardFullInputReport* reports, size_t count,
+                         const CalibrationData& calibrationData, const Output& output);
+#endif
+
+/**
+	@brief Gives a stick the values it had in the previous report, in the reports of a block where its values are
+	invalid. This keeps the values like `decodeAnalogSticks` does.
+
+	@param[in, out] x The horizontal values of the stick, of all the reports.
+	@param[in, out] y The vertical values of the stick, of all the reports.
+	@param[in] start The index of the first report of the block.
+	@param[in] invalidReports A bit mask of the reports in the block whose values are invalid.
+
+	@note Not inline, since a copy of it that is compiled for a SIMD kernel could end up called on any CPU.
+*/
+void keepInvalidStickValues(float* x, float* y, size_t start, unsigned int invalidReports);
+}
@@ -0,0 +1,158 @@
+#include <cstring>
+#include "decode_batch_kernels.h"
+
+#ifdef JOYCONBRIDGE_X86_KERNELS
+#include <smmintrin.h>
+
+
+namespace joy_con_bridge::decode::kernels
+{
+const size_t SSE41_BLOCK_SIZE = 4;
+const int REPORT_SIZE = sizeof(protocol::StandardFullInputReport);
+const int SENSOR_SAMPLE_SIZE = sizeof(protocol::SensorData);
+
+/**
+	@brief Loads 4 bytes from each of 4 addresses. SSE has no gather instruction, so this is done one by one.
+*/
+static __m128i gather(const uint8_t* base, const int* offsets)
+{
+	int values[SSE41_BLOCK_SIZE];
+	for (size_t lane = 0; lane < SSE41_BLOCK_SIZE; ++lane) {
+		std::memcpy(&values[lane], base + offsets[lane], sizeof(values[lane]));
+	}
+	return _mm_setr_epi32(values[0], values[1], values[2], values[3]);
+}
+
+/**
+	@brief Calibrates one axis of a stick, like `getCalibratedStickValues` does before it applies the dead zone.
+*/
+static __m128 calibrateAxis(__m128i values, int minBelowCenter, int center, int maxAboveCenter)
+{
+	const __m128i minimum = _mm_set1_epi32(minBelowCenter);
+	const __m128i middle = _mm_set1_epi32(center);
+	const __m128i maximum = _mm_set1_epi32(maxAboveCenter);
+
+	const __m128i clamped = _mm_min_epi32(_mm_max_epi32(values, minimum), maximum);
+
+	const __m128i isBelowCenter = _mm_cmpgt_epi32(middle, clamped);
+	const __m128 distance = _mm_cvtepi32_ps(_mm_sub_epi32(clamped, middle));
+	const __m128 range = _mm_cvtepi32_ps(_mm_blendv_epi8(_mm_sub_epi32(maximum, middle),
+	                                                     _mm_sub_epi32(middle, minimum), isBelowCenter));
+	return _mm_div_ps(distance, range);
+}
+
+/**
+	@brief Decodes and calibrates a stick, like `decodeAnalogSticks` does.
+
+	@return A bit mask of the reports in which the values of the stick are invalid.
+*/
+static unsigned int decodeStick(__m128i raw, const AnalogStickCalibrationData& calibrationData, float* x, float* y)
+{
+	const __m128i twelveBits = _mm_set1_epi32(0xFFF);
+	const __m128 deadZone = _mm_set1_ps(STICK_DEAD_ZONE_CENTER);
+
+	__m128 horizontal = calibrateAxis(_mm_and_si128(raw, twelveBits), calibrationData.x.minBelowCenter,
+	                                  calibrationData.x.center, calibrationData.x.maxAboveCenter);
+	__m128 vertical = calibrateAxis(_mm_and_si128(_mm_srli_epi32(raw, 12), twelveBits),
+	                                calibrationData.y.minBelowCenter, calibrationData.y.center,
+	                                calibrationData.y.maxAboveCenter);
+
+	const __m128 magnitude = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(horizontal, horizontal),
+	                                                _mm_mul_ps(vertical, vertical)));
+	const __m128 normalizedMagnitude = _mm_min_ps(
+		_mm_div_ps(_mm_sub_ps(magnitude, deadZone), _mm_set1_ps(STICK_LEGAL_RANGE)), _mm_set1_ps(1.0f));
+	const __m128 scale = _mm_div_ps(normalizedMagnitude, magnitude);
+	const __m128 isOutsideDeadZone = _mm_cmpgt_ps(magnitude, deadZone);
+	horizontal = _mm_and_ps(_mm_mul_ps(horizontal, scale), isOutsideDeadZone);
+	vertical = _mm_and_ps(_mm_mul_ps(vertical, scale), isOutsideDeadZone);
+
+	_mm_storeu_ps(x, horizontal);
+	_mm_storeu_ps(y, vertical);
+
+	const __m128i isInvalid = _mm_cmpeq_epi32(_mm_and_si128(raw, _mm_set1_epi32(0xFFFFFF)), _mm_setzero_si128());
+	return static_cast<unsigned int>(_mm_movemask_ps(_mm_castsi128_ps(isInvalid)));
+}
+
+size_t decodeReportsSse41(const protocol::StandardFullInputReport* reports, size_t count,
+                          const CalibrationData& calibrationData, const Output& output)
+{
+	const int reportOffsets[SSE41_BLOCK_SIZE] = {0, REPORT_SIZE, 2 * REPORT_SIZE, 3 * REPORT_SIZE};
+
+	// The IMU samples of a block fill 3 vectors. These are the offsets of the samples of each vector, in the block.
+	int sampleOffsets[IMU_SAMPLES_PER_REPORT][SSE41_BLOCK_SIZE];
+	for (size_t vector = 0; vector < IMU_SAMPLES_PER_REPORT; ++vector) {
+		for (size_t lane = 0; lane < SSE41_BLOCK_SIZE; ++lane) {
+			const size_t sample = vector * SSE41_BLOCK_SIZE + lane;
+			sampleOffsets[vector][lane] = static_cast<int>(sample / IMU_SAMPLES_PER_REPORT) * REPORT_SIZE +
+				static_cast<int>(sample % IMU_SAMPLES_PER_REPORT) * SENSOR_SAMPLE_SIZE;
+		}
+	}
+
+	const float* const coefficients[] = {
+		&calibrationData.accelerometerCoeff.x,
+		&calibrationData.accelerometerCoeff.y,
+		&calibrationData.accelerometerCoeff.z,
+		&calibrationData.gyroscopeCoeff.x,
+		&calibrationData.gyroscopeCoeff.y,
+		&calibrationData.gyroscopeCoeff.z
+	};
+	// Subtracted before the coefficients are applied. The accelerometer has none.
+	const float neutrals[] = {
+		0,
+		0,
+		0,
+		calibrationData.gyroscopeNeutral.x,
+		calibrationData.gyroscopeNeutral.y,
+		calibrationData.gyroscopeNeutral.z
+	};
+	float* const axes[] = {
+		output.accelerometerX,
+		output.accelerometerY,
+		output.accelerometerZ,
+		output.gyroscopeX,
+		output.gyroscopeY,
+		output.gyroscopeZ
+	};
+
+	size_t i = 0;
+	for (; i + SSE41_BLOCK_SIZE <= count; i += SSE41_BLOCK_SIZE) {
+		const uint8_t* const block = reinterpret_cast<const uint8_t*>(reports + i);
+
+		const __m128i buttons = _mm_and_si128(gather(block + BUTTONS_OFFSET, reportOffsets),
+		                                      _mm_set1_epi32(button_bits::ALL_BUTTONS));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output.buttons + i), buttons);
+
+		const unsigned int invalidLeft = decodeStick(gather(block + LEFT_STICK_OFFSET, reportOffsets),
+		                                             calibrationData.leftStick, output.leftStickX + i,
+		                                             output.leftStickY + i);
+		keepInvalidStickValues(output.leftStickX, output.leftStickY, i, invalidLeft);
+		const unsigned int invalidRight = decodeStick(gather(block + RIGHT_STICK_OFFSET, reportOffsets),
+		                                              calibrationData.rightStick, output.rightStickX + i,
+		                                              output.rightStickY + i);
+		keepInvalidStickValues(output.rightStickX, output.rightStickY, i, invalidRight);
+
+		// The axes are loaded in pairs, the first one in the low half of 32 bits and the second in the high half. The
+		// shifts extend their signs.
+		for (size_t axis = 0; axis < 6; axis += 2) {
+			const uint8_t* const values = block + SENSOR_DATA_OFFSET + 2 * axis;
+			const __m128 firstCoefficient = _mm_set1_ps(*coefficients[axis]);
+			const __m128 secondCoefficient = _mm_set1_ps(*coefficients[axis + 1]);
+			const __m128 firstNeutral = _mm_set1_ps(neutrals[axis]);
+			const __m128 secondNeutral = _mm_set1_ps(neutrals[axis + 1]);
+			for (size_t vector = 0; vector < IMU_SAMPLES_PER_REPORT; ++vector) {
+				const __m128i raw = gather(values, sampleOffsets[vector]);
+				const size_t sample = i * IMU_SAMPLES_PER_REPORT + vector * SSE41_BLOCK_SIZE;
+				const __m128i first = _mm_srai_epi32(_mm_slli_epi32(raw, 16), 16);
+				const __m128i second = _mm_srai_epi32(raw, 16);
+				const __m128 firstValues = _mm_sub_ps(_mm_cvtepi32_ps(first), firstNeutral);
+				const __m128 secondValues = _mm_sub_ps(_mm_cvtepi32_ps(second), secondNeutral);
+				_mm_storeu_ps(axes[axis] + sample, _mm_mul_ps(firstValues, firstCoefficient));
+				_mm_storeu_ps(axes[axis + 1] + sample, _mm_mul_ps(secondValues, secondCoefficient));
+			}
+		}
+	}
+
+	return i;
+}
+}
+#endif
@@ -11,7 +11,12 @@ class JoyConError : public std::exception
 
 class JoyConNotResponding : public JoyConError
 {
-	char const* what() const override;
+	char const* what() const noexcept override;
+};
+
+class JoyConBadReply : public JoyConError
+{
+	char const* what() const noexcept override;
 };
 
 class HidError : public std::exception
@@ -19,7 +24,7 @@ class HidError : public std::exception
 public:
 	explicit HidError(hid_device* device);
 
-	char const* what() const override;
+	char const* what() const noexcept override;
 
 protected:
 	std::string m_error;
@@ -36,6 +41,17 @@ class HidOpenError : public HidError
 public:
 	HidOpenError();
 
-	char const* what() const override;
+	char const* what() const noexcept override;
+};
+
+class MappedFileError : public std::exception
+{
+public:
+	explicit MappedFileError(std::string error);
+
+	char const* what() const noexcept override;
+
+private:
+	std::string m_error;
 };
 }
@@ -0,0 +1,547 @@
+/*******************************************************
+ HIDAPI - Multi-Platform library for
+ communication with HID devices.
+
+ Linux hidraw backend.
+
+ Talks to /dev/hidraw* directly, using non-blocking file
+ descriptors and poll() for readiness. Devices are
+ enumerated through sysfs, so libudev is not required.
+
+ At the discretion of the user of this library,
+ this software may be licensed under the terms of the
+ GNU General Public License v3, a BSD-Style license, or the
+ original HIDAPI license as outlined in the LICENSE.txt,
+ LICENSE-gpl3.txt, LICENSE-bsd.txt, and LICENSE-orig.txt
+ files located at the root of the source distribution.
+********************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wchar.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <linux/hidraw.h>
+
+#include "../hidapi.h"
+#include "hidapi_hidraw.h"
+
+#define HIDRAW_CLASS_PATH "/sys/class/hidraw"
+
+/* The maximum amount of time a write waits for the device to become writable. */
+#define WRITE_TIMEOUT_MS 1000
+/* The maximum length of an error message, terminator included. */
+#define ERROR_STR_SIZE 256
+
+/*
+ * A device is read by one thread while others write to it, so either may fail at any time. Its error message is
+ * only written and copied under error_mutex.
+ */
+struct hid_device_ {
+	int device_handle;
+	int blocking;
+	pthread_mutex_t error_mutex;
+	wchar_t last_error_str[ERROR_STR_SIZE];
+};
+
+/*
+ * Errors that are not related to a specific device (for example, failing to open one). Devices are opened from
+ * several threads at once, so each thread keeps its own.
+ */
+static _Thread_local wchar_t global_last_error_str[ERROR_STR_SIZE];
+
+static hid_device *new_hid_device(int fd)
+{
+	hid_device *dev = (hid_device*) calloc(1, sizeof(hid_device));
+	if (dev == NULL)
+		return NULL;
+
+	dev->device_handle = fd;
+	dev->blocking = 1;
+	pthread_mutex_init(&dev->error_mutex, NULL);
+	dev->last_error_str[0] = L'\0';
+
+	return dev;
+}
+
+static wchar_t *utf8_to_wchar_t(const char *utf8)
+{
+	wchar_t *ret = NULL;
+	size_t wlen;
+
+	if (utf8 == NULL)
+		return NULL;
+
+	wlen = mbstowcs(NULL, utf8, 0);
+	if (wlen == (size_t) -1)
+		return wcsdup(L"");
+
+	ret = (wchar_t*) calloc(wlen + 1, sizeof(wchar_t));
+	if (ret == NULL)
+		return NULL;
+
+	mbstowcs(ret, utf8, wlen + 1);
+	ret[wlen] = L'\0';
+	return ret;
+}
+
+static void register_error_str(wchar_t *error_str, const char *operation, int error_number)
+{
+	char msg[ERROR_STR_SIZE];
+	char error_buffer[128];
+
+	/* strerror is not thread-safe. This is the GNU strerror_r, which may return a static string instead. */
+	snprintf(msg, sizeof(msg), "%s: %s", operation, strerror_r(error_number, error_buffer, sizeof(error_buffer)));
+	if (mbstowcs(error_str, msg, ERROR_STR_SIZE - 1) == (size_t) -1)
+		swprintf(error_str, ERROR_STR_SIZE, L"%s", operation);
+	error_str[ERROR_STR_SIZE - 1] = L'\0';
+}
+
+static void register_device_error(hid_device *dev, const char *operation)
+{
+	int error_number = errno;
+
+	pthread_mutex_lock(&dev->error_mutex);
+	register_error_str(dev->last_error_str, operation, error_number);
+	pthread_mutex_unlock(&dev->error_mutex);
+}
+
+static void register_global_error(const char *operation)
+{
+	register_error_str(global_last_error_str, operation, errno);
+}
+
+/*
+ * Parsed contents of a hidraw node's "device/uevent" file in sysfs, for example:
+ *   HID_ID=0005:0000057E:00002006
+ *   HID_NAME=Joy-Con (L)
+ *   HID_UNIQ=98:b6:e9:00:00:00
+ */
+struct uevent_info {
+	unsigned int bus_type;
+	unsigned short vendor_id;
+	unsigned short product_id;
+	char name[128];
+	char uniq[64];
+};
+
+static int parse_uevent(const char *uevent_path, struct uevent_info *info)
+{
+	char line[256];
+	int found_id = 0;
+	FILE *file = fopen(uevent_path, "r");
+
+	if (file == NULL)
+		return -1;
+
+	memset(info, 0, sizeof(*info));
+	while (fgets(line, sizeof(line), file) != NULL) {
+		unsigned int vendor_id, product_id;
+
+		line[strcspn(line, "\n")] = '\0';
+		if (sscanf(line, "HID_ID=%x:%x:%x", &info->bus_type, &vendor_id, &product_id) == 3) {
+			info->vendor_id = (unsigned short) vendor_id;
+			info->product_id = (unsigned short) product_id;
+			found_id = 1;
+		} else if (strncmp(line, "HID_NAME=", 9) == 0) {
+			/* Longer values are cut short on purpose; the precision tells the compiler so. */
+			snprintf(info->name, sizeof(info->name), "%.*s", (int) sizeof(info->name) - 1, line + 9);
+		} else if (strncmp(line, "HID_UNIQ=", 9) == 0) {
+			snprintf(info->uniq, sizeof(info->uniq), "%.*s", (int) sizeof(info->uniq) - 1, line + 9);
+		}
+	}
+
+	fclose(file);
+	return found_id ? 0 : -1;
+}
+
+static int parse_uevent_of_fd(int fd, struct uevent_info *info)
+{
+	char uevent_path[128];
+	struct stat st;
+
+	if (fstat(fd, &st) == -1 || !S_ISCHR(st.st_mode))
+		return -1;
+
+	snprintf(uevent_path, sizeof(uevent_path), "/sys/dev/char/%u:%u/device/uevent",
+	         major(st.st_rdev), minor(st.st_rdev));
+	return parse_uevent(uevent_path, info);
+}
+
+static int copy_wide_string(const char *source, wchar_t *string, size_t maxlen)
+{
+	size_t written;
+
+	if (maxlen == 0)
+		return -1;
+
+	written = mbstowcs(string, source, maxlen);
+	if (written == (size_t) -1)
+		return -1;
+
+	string[maxlen - 1] = L'\0';
+	return 0;
+}
+
+int HID_API_EXPORT hid_init(void)
+{
+	return 0;
+}
+
+int HID_API_EXPORT hid_exit(void)
+{
+	global_last_error_str[0] = L'\0';
+	return 0;
+}
+
+struct hid_device_info HID_API_EXPORT * HID_API_CALL hid_enumerate(unsigned short vendor_id, unsigned short product_id)
+{
+	struct hid_device_info *root = NULL;
+	struct hid_device_info *cur_dev = NULL;
+	struct dirent *entry;
+	DIR *class_dir = opendir(HIDRAW_CLASS_PATH);
+
+	if (class_dir == NULL) {
+		register_global_error("opendir " HIDRAW_CLASS_PATH);
+		return NULL;
+	}
+
+	while ((entry = readdir(class_dir)) != NULL) {
+		char uevent_path[300];
+		char device_path[300];
+		struct uevent_info info;
+		struct hid_device_info *tmp;
+
+		if (strncmp(entry->d_name, "hidraw", 6) != 0)
+			continue;
+
+		snprintf(uevent_path, sizeof(uevent_path), HIDRAW_CLASS_PATH "/%s/device/uevent", entry->d_name);
+		if (parse_uevent(uevent_path, &info) == -1)
+			continue;
+
+		if ((vendor_id != 0x0 && vendor_id != info.vendor_id) ||
+		    (product_id != 0x0 && product_id != info.product_id))
+			continue;
+
+		tmp = (struct hid_device_info*) calloc(1, sizeof(struct hid_device_info));
+		if (tmp == NULL)
+			break;
+
+		if (cur_dev)
+			cur_dev->next = tmp;
+		else
+			root = tmp;
+		cur_dev = tmp;
+
+		snprintf(device_path, sizeof(device_path), "/dev/%s", entry->d_name);
+		cur_dev->path = strdup(device_path);
+		cur_dev->vendor_id = info.vendor_id;
+		cur_dev->product_id = info.product_id;
+		cur_dev->serial_number = utf8_to_wchar_t(info.uniq);
+		cur_dev->release_number = 0;
+		cur_dev->manufacturer_string = utf8_to_wchar_t("");
+		cur_dev->product_string = utf8_to_wchar_t(info.name);
+		cur_dev->usage_page = 0;
+		cur_dev->usage = 0;
+		cur_dev->interface_number = -1;
+		cur_dev->next = NULL;
+	}
+
+	closedir(class_dir);
+	return root;
+}
+
+void  HID_API_EXPORT HID_API_CALL hid_free_enumeration(struct hid_device_info *devs)
+{
+	struct hid_device_info *d = devs;
+	while (d) {
+		struct hid_device_info *next = d->next;
+		free(d->path);
+		free(d->serial_number);
+		free(d->manufacturer_string);
+		free(d->product_string);
+		free(d);
+		d = next;
+	}
+}
+
+HID_API_EXPORT hid_device * HID_API_CALL hid_open(unsigned short vendor_id, unsigned short product_id, const wchar_t *serial_number)
+{
+	struct hid_device_info *devs, *cur_dev;
+	const char *path_to_open = NULL;
+	hid_device *handle = NULL;
+
+	devs = hid_enumerate(vendor_id, product_id);
+	cur_dev = devs;
+	while (cur_dev) {
+		if (cur_dev->vendor_id == vendor_id &&
+		    cur_dev->product_id == product_id) {
+			if (serial_number) {
+				if (cur_dev->serial_number && wcscmp(serial_number, cur_dev->serial_number) == 0) {
+					path_to_open = cur_dev->path;
+					break;
+				}
+			}
+			else {
+				path_to_open = cur_dev->path;
+				break;
+			}
+		}
+		cur_dev = cur_dev->next;
+	}
+
+	if (path_to_open) {
+		handle = hid_open_path(path_to_open);
+	}
+
+	hid_free_enumeration(devs);
+
+	return handle;
+}
+
+HID_API_EXPORT hid_device * HID_API_CALL hid_open_path(const char *path)
+{
+	hid_device *dev;
+	int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+	if (fd == -1) {
+		register_global_error("open");
+		return NULL;
+	}
+
+	dev = new_hid_device(fd);
+	if (dev == NULL)
+		close(fd);
+
+	return dev;
+}
+
+HID_API_EXPORT hid_device * HID_API_CALL hid_hidraw_open_fd(int fd)
+{
+	int flags = fcntl(fd, F_GETFL);
+
+	if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+		register_global_error("fcntl");
+		return NULL;
+	}
+
+	return new_hid_device(fd);
+}
+
+int HID_API_EXPORT HID_API_CALL hid_hidraw_get_fd(hid_device *dev)
+{
+	return dev->device_handle;
+}
+
+/*
+ * Waits until the device is ready for the given poll events.
+ * Returns 1 if it is, 0 on timeout and -1 on error (including the device being removed).
+ */
+static int wait_for_device(hid_device *dev, short events, int milliseconds)
+{
+	struct pollfd fds;
+	int ret;
+
+	fds.fd = dev->device_handle;
+	fds.events = events;
+	fds.revents = 0;
+
+	do {
+		ret = poll(&fds, 1, milliseconds);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret == -1) {
+		register_device_error(dev, "poll");
+		return -1;
+	}
+	if (ret == 0)
+		return 0;
+
+	/* A device that hung up may still have reports queued; those are read before the hang up is reported. */
+	if (fds.revents & events)
+		return 1;
+
+	if (fds.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+		errno = ENODEV;
+		register_device_error(dev, "poll");
+		return -1;
+	}
+
+	return 1;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_write(hid_device *dev, const unsigned char *data, size_t length)
+{
+	ssize_t bytes_written;
+
+	for (;;) {
+		bytes_written = write(dev->device_handle, data, length);
+		if (bytes_written >= 0)
+			return (int) bytes_written;
+
+		if (errno == EINTR)
+			continue;
+
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			register_device_error(dev, "write");
+			return -1;
+		}
+
+		/* The device is busy, wait until it can take more output. */
+		switch (wait_for_device(dev, POLLOUT, WRITE_TIMEOUT_MS)) {
+		case 1:
+			break;
+		case 0:
+			errno = ETIMEDOUT;
+			register_device_error(dev, "write");
+			return -1;
+		default:
+			return -1;
+		}
+	}
+}
+
+int HID_API_EXPORT HID_API_CALL hid_read_timeout(hid_device *dev, unsigned char *data, size_t length, int milliseconds)
+{
+	ssize_t bytes_read;
+
+	if (milliseconds != 0) {
+		const int ready = wait_for_device(dev, POLLIN, milliseconds);
+		if (ready <= 0)
+			return ready;
+	}
+
+	do {
+		bytes_read = read(dev->device_handle, data, length);
+	} while (bytes_read == -1 && errno == EINTR);
+
+	if (bytes_read == -1) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return 0;
+
+		register_device_error(dev, "read");
+		return -1;
+	}
+	if (bytes_read == 0 && length > 0) {
+		/* hidraw never reads an empty report, so this is the end of the file: the device hung up. */
+		errno = ENODEV;
+		register_device_error(dev, "read");
+		return -1;
+	}
+
+	return (int) bytes_read;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_read(hid_device *dev, unsigned char *data, size_t length)
+{
+	return hid_read_timeout(dev, data, length, dev->blocking ? -1 : 0);
+}
+
+int HID_API_EXPORT HID_API_CALL hid_set_nonblocking(hid_device *dev, int nonblock)
+{
+	/* The descriptor is always non-blocking; blocking reads wait with poll(). */
+	dev->blocking = !nonblock;
+	return 0;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_send_feature_report(hid_device *dev, const unsigned char *data, size_t length)
+{
+	int res = ioctl(dev->device_handle, HIDIOCSFEATURE(length), data);
+	if (res < 0)
+		register_device_error(dev, "ioctl (SFEATURE)");
+
+	return res;
+}
+
+int HID_API_EXPORT HID_API_CALL hid_get_feature_report(hid_device *dev, unsigned char *data, size_t length)
+{
+	int res = ioctl(dev->device_handle, HIDIOCGFEATURE(length), data);
+	if (res < 0)
+		register_device_error(dev, "ioctl (GFEATURE)");
+
+	return res;
+}
+
+void HID_API_EXPORT HID_API_CALL hid_close(hid_device *dev)
+{
+	if (!dev)
+		return;
+
+	close(dev->device_handle);
+	pthread_mutex_destroy(&dev->error_mutex);
+	free(dev);
+}
+
+int HID_API_EXPORT_CALL hid_get_manufacturer_string(hid_device *dev, wchar_t *string, size_t maxlen)
+{
+	/* hidraw does not expose the manufacturer of Bluetooth devices. */
+	(void) dev;
+	return copy_wide_string("", string, maxlen);
+}
+
+int HID_API_EXPORT_CALL hid_get_product_string(hid_device *dev, wchar_t *string, size_t maxlen)
+{
+	struct uevent_info info;
+
+	if (parse_uevent_of_fd(dev->device_handle, &info) == -1) {
+		register_device_error(dev, "uevent");
+		return -1;
+	}
+
+	return copy_wide_string(info.name, string, maxlen);
+}
+
+int HID_API_EXPORT_CALL hid_get_serial_number_string(hid_device *dev, wchar_t *string, size_t maxlen)
+{
+	struct uevent_info info;
+
+	if (parse_uevent_of_fd(dev->device_handle, &info) == -1) {
+		register_device_error(dev, "uevent");
+		return -1;
+	}
+
+	return copy_wide_string(info.uniq, string, maxlen);
+}
+
+int HID_API_EXPORT_CALL hid_get_indexed_string(hid_device *dev, int string_index, wchar_t *string, size_t maxlen)
+{
+	(void) string_index;
+	(void) string;
+	(void) maxlen;
+
+	errno = ENOSYS;
+	register_device_error(dev, "hid_get_indexed_string");
+	return -1;
+}
+
+HID_API_EXPORT const wchar_t * HID_API_CALL hid_error(hid_device *dev)
+{
+	/* A copy, so the message stays whole while another thread registers a new error on the same device. It is valid
+	   until this thread calls hid_error again. */
+	static _Thread_local wchar_t error_copy[ERROR_STR_SIZE];
+
+	if (dev) {
+		pthread_mutex_lock(&dev->error_mutex);
+		wcscpy(error_copy, dev->last_error_str);
+		pthread_mutex_unlock(&dev->error_mutex);
+	} else {
+		wcscpy(error_copy, global_last_error_str);
+	}
+
+	if (error_copy[0] == L'\0')
+		return L"Success";
+
+	return error_copy;
+}
@@ -0,0 +1,48 @@
+/*******************************************************
+ HIDAPI - Multi-Platform library for
+ communication with HID devices.
+
+ Extensions specific to the Linux hidraw backend.
+********************************************************/
+
+#ifndef HIDAPI_HIDRAW_H__
+#define HIDAPI_HIDRAW_H__
+
+#include "../hidapi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+		/** @brief Wraps an already open, hidraw-like file descriptor.
+
+			Anything that delivers one report per read() works, so a
+			socketpair(AF_UNIX, SOCK_SEQPACKET) can stand in for a real
+			device. The descriptor is switched to non-blocking mode.
+
+			@ingroup API
+			@param fd The file descriptor. The returned device takes
+				ownership of it and closes it in hid_close().
+
+			@returns
+				This function returns a pointer to a #hid_device object on
+				success or NULL on failure.
+		*/
+		HID_API_EXPORT hid_device * HID_API_CALL hid_hidraw_open_fd(int fd);
+
+		/** @brief Gets the file descriptor of a device, for use with poll()/epoll.
+
+			The descriptor is owned by the device and must not be closed.
+
+			@ingroup API
+			@param dev A device handle returned from hid_open().
+
+			@returns
+				The file descriptor of the device.
+		*/
+		int HID_API_EXPORT HID_API_CALL hid_hidraw_get_fd(hid_device *dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "protocol.h"
 
 
@@ -17,24 +18,16 @@ Buffer getCommandBuffer(uint8_t commandId, const Buffer& commandData, bool isBlu
 	return commandBuffer;
 }
 
-Buffer getSubCommandBuffer(uint8_t commandId, uint8_t subCommandId, const Buffer& commandData, bool isBluetooth)
+Buffer getSubCommandBuffer(uint8_t commandId, uint8_t packetNumber, uint8_t subCommandId, const Buffer& commandData,
+                           bool isBluetooth, const RumbleData& rumble)
 {
-	static int globalTimer = 0;
-
-	Buffer subCommandBuffer = {
-		static_cast<uint8_t>((++globalTimer) % 0x10),
-		0,
-		1,
-		0x40,
-		0x40,
-		0,
-		1,
-		0x40,
-		0x40
-	}; // Rumble data is required for each subcommand.
-
-	subCommandBuffer.push_back(subCommandId);
-	subCommandBuffer.insert(subCommandBuffer.end(), commandData.begin(), commandData.end());
+	// Sized up front and filled in place, since GCC warns of overflows when the rumble data is inserted.
+	Buffer subCommandBuffer(1 + rumble.size() + 1 + commandData.size());
+	subCommandBuffer[0] = static_cast<uint8_t>(packetNumber % 0x10);
+	// Rumble data is required for each subcommand.
+	const auto subCommandIdPosition = std::copy(rumble.begin(), rumble.end(), subCommandBuffer.begin() + 1);
+	*subCommandIdPosition = subCommandId;
+	std::copy(commandData.begin(), commandData.end(), subCommandIdPosition + 1);
 
 	return getCommandBuffer(commandId, subCommandBuffer, isBluetooth);
 }
@@ -66,11 +59,11 @@ std::array<uint16_t, 6> decodeStickCalibrationData(const uint8_t* calibrationDat
 {
 	std::array<uint16_t, 6> result{};
 
-	result[0] = (calibrationDataArray[1] << 8) & (0xF00 | calibrationDataArray[0]);
+	result[0] = ((calibrationDataArray[1] << 8) & 0xF00) | calibrationDataArray[0];
 	result[1] = (calibrationDataArray[2] << 4) | (calibrationDataArray[1] >> 4);
-	result[2] = (calibrationDataArray[4] << 8) & (0xF00 | calibrationDataArray[3]);
+	result[2] = ((calibrationDataArray[4] << 8) & 0xF00) | calibrationDataArray[3];
 	result[3] = (calibrationDataArray[5] << 4) | (calibrationDataArray[4] >> 4);
-	result[4] = (calibrationDataArray[7] << 8) & (0xF00 | calibrationDataArray[6]);
+	result[4] = ((calibrationDataArray[7] << 8) & 0xF00) | calibrationDataArray[6];
 	result[5] = (calibrationDataArray[8] << 4) | (calibrationDataArray[7] >> 4);
 
 	return result;
@@ -1,10 +1,17 @@
 #pragma once
 #include <array>
+#include <cstddef>
 #include "Buffer.h"
 
 
 namespace joy_con_bridge::protocol
 {
+// The rumble data of an output report: 4 bytes for the left actuator, then 4 for the right one.
+using RumbleData = std::array<uint8_t, 8>;
+
+// Both actuators still, at the default frequencies (320Hz high, 160Hz low).
+const RumbleData NEUTRAL_RUMBLE = {0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40};
+
 enum class LedState
 {
 	OFF,
@@ -144,14 +151,18 @@ Buffer getCommandBuffer(uint8_t commandId, const Buffer& commandData = {}, bool
 	@brief Builds a buffer in the structure of a command + sub command for a JoyCon.
 
 	@param[in] commandId The ID of the command.
+	@param[in] packetNumber The rolling packet counter of the JoyCon the command is sent to. Only the lower 4 bits are
+	                        used.
 	@param[in] subCommandId The ID of the sub command.
 	@param[in, optional] commandData Additional data of the command.
 	@param[in, optional] isBluetooth true if the connection is Bluetooth based.
+	@param[in, optional] rumble The rumble data, which every command that carries a sub command carries too.
 
 	@return A buffer that represents the command.
 */
-Buffer getSubCommandBuffer(uint8_t commandId, uint8_t subCommandId, const Buffer& commandData = {},
-                           bool isBluetooth = true);
+Buffer getSubCommandBuffer(uint8_t commandId, uint8_t packetNumber, uint8_t subCommandId,
+                           const Buffer& commandData = {}, bool isBluetooth = true,
+                           const RumbleData& rumble = NEUTRAL_RUMBLE);
 
 /**
 	@brief Builds the LED sequence that corresponds to the given input.
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <limits>
+#include "rumble.h"
+
+
+namespace joy_con_bridge::rumble
+{
+// Frequencies are encoded as round(32 * log2(frequency / 10)). The bands store that less their offset, in 7 bits.
+const int HIGH_BAND_OFFSET = 0x60;
+const int LOW_BAND_OFFSET = 0x40;
+const int MAX_ENCODED_FREQUENCY = 0x7F;
+// The lowest encoded frequency of the low band is 1.
+const int MIN_LOW_FREQUENCY = LOW_BAND_OFFSET + 1;
+
+// The table covers both bands, from the bottom of the low band to the top of the high band.
+const int FREQUENCY_TABLE_START = LOW_BAND_OFFSET;
+const size_t FREQUENCY_TABLE_SIZE = HIGH_BAND_OFFSET + MAX_ENCODED_FREQUENCY - LOW_BAND_OFFSET + 1;
+
+const size_t MAX_ENCODED_AMPLITUDE = 100;
+
+// The sizes of the boundary tables: the powers of 2 above the number of boundaries between encoded values.
+const size_t FREQUENCY_BOUNDARY_COUNT = 256;
+const size_t AMPLITUDE_BOUNDARY_COUNT = 128;
+
+// The low amplitude is stored above this.
+const uint8_t LOW_AMPLITUDE_OFFSET = 0x40;
+
+// 2^(1/32), the step between encoded frequencies.
+constexpr double FREQUENCY_STEP = 1.0218971486541166;
+
+/**
+	@brief Calculates 2^(n/32) at compile time, where the standard math functions are not available.
+*/
+constexpr double exp2InThirtySeconds(int n)
+{
+	double result = 1;
+	for (int i = 0; i < n; ++i) {
+		result *= FREQUENCY_STEP;
+	}
+	return result;
+}
+
+constexpr std::array<float, FREQUENCY_TABLE_SIZE> makeFrequencies()
+{
+	std::array<float, FREQUENCY_TABLE_SIZE> frequencies{};
+	for (size_t i = 0; i < FREQUENCY_TABLE_SIZE; ++i) {
+		frequencies[i] = static_cast<float>(10 * exp2InThirtySeconds(FREQUENCY_TABLE_START + static_cast<int>(i)));
+	}
+	return frequencies;
+}
+
+/**
+	@brief The amplitude of each encoded amplitude. The JoyCon's table is made of three logarithmic ranges, each
+	finer than the one below it.
+*/
+constexpr std::array<float, MAX_ENCODED_AMPLITUDE + 1> makeAmplitudes()
+{
+	std::array<float, MAX_ENCODED_AMPLITUDE + 1> amplitudes{};
+	for (int i = 1; i <= static_cast<int>(MAX_ENCODED_AMPLITUDE); ++i) {
+		double amplitude = 0;
+		if (i < 16) {
+			amplitude = 0.01 * exp2InThirtySeconds(8 * (i - 1)); // 0.01 * 2^((i - 1) / 4)
+		} else if (i < 32) {
+			amplitude = exp2InThirtySeconds(2 * i) / 17; // 2^(i / 16) / 17
+		} else {
+			amplitude = exp2InThirtySeconds(i) / 8.7; // 2^(i / 32) / 8.7
+		}
+		amplitudes[i] = static_cast<float>(amplitude);
+	}
+	return amplitudes;
+}
+
+/**
+	@brief The values halfway between consecutive values of a table, so that counting the ones below a value rounds it
+	to the nearest one in the table. The boundaries are padded with infinities up to a power of 2, for `lookUp`.
+*/
+template <size_t BoundaryCount, size_t Size>
+constexpr std::array<float, BoundaryCount> makeBoundaries(const std::array<float, Size>& values)
+{
+	static_assert(0 == (BoundaryCount & (BoundaryCount - 1)) && BoundaryCount >= Size,
+	              "The boundaries must be padded to a power of 2");
+
+	std::array<float, BoundaryCount> boundaries{};
+	for (size_t i = 0; i < BoundaryCount; ++i) {
+		boundaries[i] = i + 1 < Size ? (values[i] + values[i + 1]) / 2 : std::numeric_limits<float>::infinity();
+	}
+	return boundaries;
+}
+
+constexpr std::array<float, FREQUENCY_TABLE_SIZE> FREQUENCIES = makeFrequencies();
+constexpr std::array<float, FREQUENCY_BOUNDARY_COUNT> FREQUENCY_BOUNDARIES =
+	makeBoundaries<FREQUENCY_BOUNDARY_COUNT>(FREQUENCIES);
+constexpr std::array<float, MAX_ENCODED_AMPLITUDE + 1> AMPLITUDES = makeAmplitudes();
+constexpr std::array<float, AMPLITUDE_BOUNDARY_COUNT> AMPLITUDE_BOUNDARIES =
+	makeBoundaries<AMPLITUDE_BOUNDARY_COUNT>(AMPLITUDES);
+
+static_assert(FREQUENCIES[HIGH_BAND_OFFSET + 0x40 - FREQUENCY_TABLE_START] > 319.99f &&
+              FREQUENCIES[HIGH_BAND_OFFSET + 0x40 - FREQUENCY_TABLE_START] < 320.01f,
+              "The frequency table is off - rumble can't be encoded");
+
+/**
+	@brief Counts the boundaries that are not above a value, which is the index of the nearest value of their table.
+	This is a binary search with a fixed number of steps and no branches, since the values that are encoded are
+	arbitrary and branches on them would be mispredicted half of the time.
+*/
+template <size_t Size>
+static int lookUp(const std::array<float, Size>& boundaries, float value)
+{
+	size_t index = 0;
+	for (size_t step = Size / 2; step > 0; step /= 2) {
+		index += boundaries[index + step - 1] <= value ? step : 0;
+	}
+	return static_cast<int>(index);
+}
+
+/**
+	@brief Encodes a frequency in the given range of encoded frequencies, which is also what it is clamped to.
+*/
+static unsigned int encodeFrequency(float frequency, int minEncoded, int maxEncoded)
+{
+	const int encoded = FREQUENCY_TABLE_START + lookUp(FREQUENCY_BOUNDARIES, frequency);
+	return static_cast<unsigned int>(std::min(std::max(encoded, minEncoded), maxEncoded));
+}
+
+static unsigned int encodeAmplitude(float amplitude)
+{
+	return static_cast<unsigned int>(lookUp(AMPLITUDE_BOUNDARIES, amplitude));
+}
+
+std::array<uint8_t, 4> encode(const Rumble& rumble)
+{
+	const unsigned int highFrequency = encodeFrequency(rumble.high.frequency, HIGH_BAND_OFFSET,
+	                                                   HIGH_BAND_OFFSET + MAX_ENCODED_FREQUENCY) - HIGH_BAND_OFFSET;
+	const unsigned int lowFrequency = encodeFrequency(rumble.low.frequency, MIN_LOW_FREQUENCY,
+	                                                  LOW_BAND_OFFSET + MAX_ENCODED_FREQUENCY) - LOW_BAND_OFFSET;
+	const unsigned int highAmplitude = encodeAmplitude(rumble.high.amplitude);
+	const unsigned int lowAmplitude = encodeAmplitude(rumble.low.amplitude);
+
+	// The high frequency is shifted left by 2, over the first two bytes, and shares the second one with the high
+	// amplitude, which is shifted left by 1. The low amplitude is split: its lowest bit is above the low frequency,
+	// and the rest of it is in the last byte.
+	return {
+		static_cast<uint8_t>(highFrequency << 2),
+		static_cast<uint8_t>((highAmplitude << 1) | (highFrequency >> 6)),
+		static_cast<uint8_t>(lowFrequency | ((lowAmplitude & 1) << 7)),
+		static_cast<uint8_t>(LOW_AMPLITUDE_OFFSET + (lowAmplitude >> 1))
+	};
+}
+
+protocol::RumbleData encodeBoth(const Rumble& rumble)
+{
+	const std::array<uint8_t, 4> actuator = encode(rumble);
+	return {actuator[0], actuator[1], actuator[2], actuator[3], actuator[0], actuator[1], actuator[2], actuator[3]};
+}
+
+bool isSilent(const protocol::RumbleData& rumble)
+{
+	for (size_t actuator = 0; actuator < rumble.size(); actuator += 4) {
+		// Both amplitudes are 0, whatever the frequencies.
+		if (0 != (rumble[actuator + 1] >> 1) || 0 != (rumble[actuator + 2] >> 7) ||
+		    LOW_AMPLITUDE_OFFSET != rumble[actuator + 3]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+float getFrequency(bool isHighBand, uint8_t encodedFrequency)
+{
+	const int offset = isHighBand ? HIGH_BAND_OFFSET : LOW_BAND_OFFSET;
+	return FREQUENCIES[offset + (encodedFrequency & MAX_ENCODED_FREQUENCY) - FREQUENCY_TABLE_START];
+}
+
+float getAmplitude(uint8_t encodedAmplitude)
+{
+	return AMPLITUDES[std::min<size_t>(encodedAmplitude, MAX_ENCODED_AMPLITUDE)];
+}
+}
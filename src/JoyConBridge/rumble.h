@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "protocol.h"
+
+
+namespace joy_con_bridge
+{
+/*
+ * A vibration of one band of an actuator.
+ */
+struct RumbleBand
+{
+	// In Hz. Clamped to the range of the band: 80Hz to 1253Hz for the high band, and 41Hz to 626Hz for the low one.
+	float frequency;
+	float amplitude; // In [0, 1]. Clamped.
+};
+
+/*
+ * A vibration of an actuator. Each actuator vibrates in a high band and a low band at once.
+ */
+struct Rumble
+{
+	RumbleBand high;
+	RumbleBand low;
+};
+
+// An actuator that is still, at its default frequencies.
+const Rumble SILENT_RUMBLE = {{320, 0}, {160, 0}};
+
+namespace rumble
+{
+/**
+	@brief Encodes the vibration of an actuator, in the format of the JoyCon's rumble data.
+
+	Frequencies are encoded logarithmically, in steps of 2^(1/32), and amplitudes in the steps of the JoyCon's own
+	amplitude table. Both are looked up in tables that are built at compile time, so encoding costs a few
+	comparisons per value and no math functions.
+
+	@param[in] rumble The vibration.
+
+	@return The 4 bytes of rumble data of a single actuator.
+*/
+std::array<uint8_t, 4> encode(const Rumble& rumble);
+
+/**
+	@brief Encodes the same vibration for both actuators, so it works for left and right JoyCons alike.
+*/
+protocol::RumbleData encodeBoth(const Rumble& rumble);
+
+/**
+	@brief Checks whether rumble data keeps both actuators still, whatever the frequencies.
+*/
+bool isSilent(const protocol::RumbleData& rumble);
+
+/**
+	@brief Gets the frequency that an encoded frequency of a band stands for, in Hz. Mostly useful to know what
+	`encode` rounds a frequency to.
+
+	@param[in] isHighBand Whether the encoded frequency is of the high band.
+	@param[in] encodedFrequency The encoded frequency, in [0, 127] (for the low band, 0 is not used).
+*/
+float getFrequency(bool isHighBand, uint8_t encodedFrequency);
+
+/**
+	@brief Gets the amplitude that an encoded amplitude stands for, in [0, 1].
+
+	@param[in] encodedAmplitude The encoded amplitude, in [0, 100].
+*/
+float getAmplitude(uint8_t encodedAmplitude);
+}
+}
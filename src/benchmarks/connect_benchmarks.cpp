@@ -0,0 +1,153 @@
+/*
+ * Benchmarks of bringing up JoyCons: the handshake of a number of simulated JoyCons (the argument), one after the other
+ * and through connect::connectAll, and the reconnection of a JoyCon that comes back to a JoyConManager.
+ *
+ * The fakes delay their replies like a round trip over the radio would, so the time is mostly spent waiting for
+ * replies, as it is with actual JoyCons. The handshake_ms counters are over all the handshakes of the run.
+ */
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "connect.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "JoyConManager.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// Somewhat below the round trip of an actual JoyCon, to keep the benchmarks short.
+const std::chrono::microseconds REPLY_DELAY(2000);
+
+std::shared_ptr<Transport> openFakeJoyCon(const connect::DeviceDescription& device)
+{
+	auto fake = std::make_shared<FakeJoyCon>(device.hand);
+	fake->setReplyDelay(REPLY_DELAY);
+	return fake;
+}
+
+std::vector<connect::DeviceDescription> describeFakeJoyCons(size_t count)
+{
+	std::vector<connect::DeviceDescription> devices;
+	for (size_t i = 0; i < count; ++i) {
+		devices.push_back({"fake" + std::to_string(i), L"", 0 == i % 2 ? Hand::LEFT : Hand::RIGHT});
+	}
+	return devices;
+}
+
+void setHandshakeCounters(benchmark::State& state, const std::vector<std::chrono::microseconds>& handshakeLatencies)
+{
+	if (handshakeLatencies.empty()) {
+		return;
+	}
+
+	std::chrono::microseconds total(0);
+	for (const auto latency : handshakeLatencies) {
+		total += latency;
+	}
+	const double count = static_cast<double>(handshakeLatencies.size());
+	state.counters["handshake_ms"] = std::chrono::duration<double, std::milli>(total).count() / count;
+	state.counters["max_handshake_ms"] = std::chrono::duration<double, std::milli>(
+		*std::max_element(handshakeLatencies.begin(), handshakeLatencies.end())).count();
+}
+
+/*
+ * The baseline: one handshake after the other, like calling connect::getLeftJoyCon for each JoyCon.
+ */
+void BM_ConnectSequentially(benchmark::State& state)
+{
+	const auto devices = describeFakeJoyCons(static_cast<size_t>(state.range(0)));
+	std::vector<std::chrono::microseconds> handshakeLatencies;
+	for (auto _ : state) {
+		for (const connect::DeviceDescription& device : devices) {
+			const auto start = std::chrono::steady_clock::now();
+			JoyCon joyCon(openFakeJoyCon(device), device.hand);
+			handshakeLatencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start));
+			benchmark::DoNotOptimize(joyCon.getRawCalibrationData());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * devices.size());
+	setHandshakeCounters(state, handshakeLatencies);
+}
+BENCHMARK(BM_ConnectSequentially)->Arg(1)->Arg(8)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_ConnectAll(benchmark::State& state)
+{
+	const auto devices = describeFakeJoyCons(static_cast<size_t>(state.range(0)));
+	std::vector<std::chrono::microseconds> handshakeLatencies;
+	for (auto _ : state) {
+		for (const connect::ConnectionResult& result : connect::connectAll(devices, openFakeJoyCon)) {
+			if (!result.joyCon) {
+				state.SkipWithError("A handshake failed");
+				return;
+			}
+			handshakeLatencies.push_back(result.handshakeLatency);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * devices.size());
+	setHandshakeCounters(state, handshakeLatencies);
+}
+BENCHMARK(BM_ConnectAll)->Arg(1)->Arg(8)->Arg(32)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+/*
+ * The time from a JoyCon coming back until its handle is connected again, as seen by the polling thread. The device
+ * change is signaled with JoyConManager::refresh, as the device watcher would. The reconnect_ms counter is the
+ * latency that the handle reports itself.
+ */
+void BM_Reconnect(benchmark::State& state)
+{
+	const auto device = describeFakeJoyCons(1)[0];
+	std::mutex lock;
+	bool isAvailable = true;
+	const auto enumerator = [&lock, &isAvailable, &device]() {
+		std::lock_guard<std::mutex> guard(lock);
+		return isAvailable ?
+			std::vector<connect::DeviceDescription>{device} : std::vector<connect::DeviceDescription>{};
+	};
+	const auto connector = [](const connect::DeviceDescription& availableDevice) {
+		return JoyCon(openFakeJoyCon(availableDevice), availableDevice.hand);
+	};
+	const auto setAvailable = [&lock, &isAvailable](bool isNowAvailable) {
+		std::lock_guard<std::mutex> guard(lock);
+		isAvailable = isNowAvailable;
+	};
+
+	JoyConManager manager(enumerator, connector, std::chrono::milliseconds(10000));
+	const auto pollUntil = [&manager](bool isConnected) {
+		std::shared_ptr<ManagedJoyCon> joyCon;
+		while (!joyCon || isConnected != joyCon->isConnected()) {
+			const auto joyCons = manager.getJoyCons();
+			joyCon = joyCons.empty() ? nullptr : joyCons[0];
+			if (joyCon) {
+				joyCon->pollAll();
+			}
+		}
+		return joyCon;
+	};
+	pollUntil(true);
+
+	std::chrono::microseconds totalLatency(0);
+	for (auto _ : state) {
+		setAvailable(false);
+		manager.refresh();
+		pollUntil(false);
+
+		const auto start = std::chrono::steady_clock::now();
+		setAvailable(true);
+		manager.refresh();
+		const auto joyCon = pollUntil(true);
+		state.SetIterationTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		totalLatency += joyCon->getLastReconnectLatency();
+	}
+	state.counters["reconnect_ms"] = std::chrono::duration<double, std::milli>(totalLatency).count() /
+		static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_Reconnect)->Unit(benchmark::kMillisecond)->UseManualTime();
+}
@@ -0,0 +1,370 @@
+/*
+ * Benchmarks of the input report decode pipeline, from single decode steps up to a full JoyCon::poll.
+ *
+ * items_per_second is the number of reports a single core decodes per second. Every iteration decodes a single report,
+ * except in the batch benchmarks, where it decodes all the canned reports at once. The reports are canned: generated
+ * once, with a fixed seed, so runs are comparable with each other.
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "allocations.h"
+#include "command_ids.h"
+#include "decode.h"
+#include "decode_batch.h"
+#include "FakeJoyCon.h"
+#include "InputSubscriptions.h"
+#include "JoyCon.h"
+#include "LatencyHistogram.h"
+#include "StickCalibration.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// A power of 2, so cycling through the reports is a mask. Large enough to defeat the branch predictor, small enough
+// to stay in the cache.
+const size_t CANNED_REPORT_COUNT = 1024;
+
+std::vector<protocol::StandardFullInputReport> makeCannedReports()
+{
+	std::mt19937 random(0x4A6F79);
+	std::uniform_int_distribution<int> byte(0, 0xFF);
+	std::uniform_int_distribution<int> stick(0x100, 0xF00);
+	std::uniform_int_distribution<int> sensor(-0x1000, 0x1000);
+
+	std::vector<protocol::StandardFullInputReport> reports(CANNED_REPORT_COUNT);
+	for (size_t i = 0; i < reports.size(); ++i) {
+		protocol::StandardFullInputReport& report = reports[i];
+		report.id = command_ids::PACKET_TYPE_BUTTONS_AND_IMU;
+		report.timer = static_cast<uint8_t>(3 * i);
+		report.connectionInfo = 0xE;
+		report.batteryStatus = protocol::BatteryStatus::FULL;
+
+		// Buttons are rarely held, so most reports have none or one of them down.
+		uint8_t* const buttons = reinterpret_cast<uint8_t*>(&report.buttonStatusRight);
+		for (size_t j = 0; j < 3; ++j) {
+			buttons[j] = static_cast<uint8_t>(byte(random) & byte(random) & byte(random));
+		}
+
+		for (uint8_t* rawStick : {report.leftAnalogStick, report.rightAnalogStick}) {
+			const int horizontal = stick(random);
+			const int vertical = stick(random);
+			rawStick[0] = static_cast<uint8_t>(horizontal & 0xFF);
+			rawStick[1] = static_cast<uint8_t>((horizontal >> 8) | ((vertical & 0xF) << 4));
+			rawStick[2] = static_cast<uint8_t>(vertical >> 4);
+		}
+
+		for (protocol::SensorData& sample : report.sensorData) {
+			for (size_t axis = 0; axis < 3; ++axis) {
+				sample.accelerometer[axis] = static_cast<int16_t>(sensor(random));
+				sample.gyroscope[axis] = static_cast<int16_t>(sensor(random));
+			}
+		}
+	}
+
+	return reports;
+}
+
+const std::vector<protocol::StandardFullInputReport>& getCannedReports()
+{
+	static const std::vector<protocol::StandardFullInputReport> reports = makeCannedReports();
+	return reports;
+}
+
+/*
+ * Plays the handshake of a fake JoyCon, then returns the canned reports, over and over.
+ */
+class CannedTransport : public Transport
+{
+public:
+	CannedTransport()
+		: m_fake(Hand::LEFT, std::chrono::microseconds(0))
+		, m_isCanned(false)
+		, m_next(0)
+	{}
+
+	size_t write(const uint8_t* data, size_t size) override
+	{
+		return m_isCanned ? size : m_fake.write(data, size);
+	}
+
+	size_t readInto(uint8_t* data, size_t size, int milliseconds) override
+	{
+		if (!m_isCanned) {
+			return m_fake.readInto(data, size, milliseconds);
+		}
+		return tryReadInto(data, size);
+	}
+
+	size_t tryReadInto(uint8_t* data, size_t size) override
+	{
+		if (!m_isCanned) {
+			return m_fake.tryReadInto(data, size);
+		}
+
+		const auto& report = getCannedReports()[m_next++ % CANNED_REPORT_COUNT];
+		const size_t read = std::min(size, sizeof(report));
+		std::memcpy(data, &report, read);
+		return read;
+	}
+
+	void startCannedReports()
+	{
+		m_isCanned = true;
+	}
+
+private:
+	FakeJoyCon m_fake;
+	bool m_isCanned;
+	size_t m_next;
+};
+
+/*
+ * The calibration of the fake JoyCon, which is that of an actual JoyCon.
+ */
+const RawCalibrationData& getRawCalibrationData()
+{
+	static const RawCalibrationData data = JoyCon(std::make_shared<FakeJoyCon>(Hand::LEFT)).getRawCalibrationData();
+	return data;
+}
+
+void BM_DecodeAnalogStick(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(protocol::decodeAnalogStick(reports[i++ % CANNED_REPORT_COUNT].leftAnalogStick));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeAnalogStick);
+
+void BM_DecodeStickCalibrationData(benchmark::State& state)
+{
+	const RawCalibrationData& data = getRawCalibrationData();
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(protocol::decodeStickCalibrationData(data.leftStick.data()));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeStickCalibrationData);
+
+void BM_GetCalibratedStickValues(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	const CalibrationData calibrationData = decode::decodeCalibrationData(getRawCalibrationData());
+	std::vector<std::array<uint16_t, 2>> stickValues;
+	for (const auto& report : reports) {
+		stickValues.push_back(protocol::decodeAnalogStick(report.leftAnalogStick));
+	}
+
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(decode::getCalibratedStickValues(stickValues[i++ % CANNED_REPORT_COUNT],
+		                                                          calibrationData.leftStick));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_GetCalibratedStickValues);
+
+/*
+ * The lookup table version of BM_GetCalibratedStickValues. The max_error counter is the largest difference between the
+ * two, over the canned reports.
+ */
+void BM_StickCalibrationApply(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	const CalibrationData calibrationData = decode::decodeCalibrationData(getRawCalibrationData());
+	const StickCalibration stickCalibration(calibrationData.leftStick);
+	std::vector<std::array<uint16_t, 2>> stickValues;
+	float maxError = 0;
+	for (const auto& report : reports) {
+		stickValues.push_back(protocol::decodeAnalogStick(report.leftAnalogStick));
+		const AnalogStick expected = decode::getCalibratedStickValues(stickValues.back(), calibrationData.leftStick);
+		const AnalogStick actual = stickCalibration.apply(stickValues.back());
+		maxError = std::max({maxError, std::abs(expected.x - actual.x), std::abs(expected.y - actual.y)});
+	}
+
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(stickCalibration.apply(stickValues[i++ % CANNED_REPORT_COUNT]));
+	}
+	state.SetItemsProcessed(state.iterations());
+	state.counters["max_error"] = maxError;
+}
+BENCHMARK(BM_StickCalibrationApply);
+
+void BM_DecodeButtons(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	ButtonsState buttons{};
+	size_t i = 0;
+	for (auto _ : state) {
+		decode::decodeButtons(reports[i++ % CANNED_REPORT_COUNT], buttons);
+		benchmark::DoNotOptimize(buttons);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeButtons);
+
+void BM_DecodeButtonMask(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	ButtonEdges buttonEdges{};
+	size_t i = 0;
+	for (auto _ : state) {
+		buttonEdges.update(decode::decodeButtonMask(reports[i++ % CANNED_REPORT_COUNT]));
+		benchmark::DoNotOptimize(buttonEdges);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeButtonMask);
+
+void BM_DecodeAnalogSticks(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	const CalibrationData calibrationData = decode::decodeCalibrationData(getRawCalibrationData());
+	JoyConState joyConState{};
+	size_t i = 0;
+	for (auto _ : state) {
+		decode::decodeAnalogSticks(reports[i++ % CANNED_REPORT_COUNT], calibrationData, joyConState);
+		benchmark::DoNotOptimize(joyConState);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeAnalogSticks);
+
+void BM_DecodeSensors(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	const CalibrationData calibrationData = decode::decodeCalibrationData(getRawCalibrationData());
+	JoyConState joyConState{};
+	size_t i = 0;
+	for (auto _ : state) {
+		decode::decodeSensors(reports[i++ % CANNED_REPORT_COUNT], calibrationData, joyConState);
+		benchmark::DoNotOptimize(joyConState);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DecodeSensors);
+
+/*
+ * The allocations counter is the number of heap allocations per poll, which should be 0: a poll decodes every IMU
+ * sample of the report into the state in place.
+ */
+void BM_JoyConPoll(benchmark::State& state)
+{
+	const auto transport = std::make_shared<CannedTransport>();
+	JoyCon joyCon(transport, Hand::LEFT);
+	transport->startCannedReports();
+
+	const size_t allocationsBefore = allocations::getCount();
+	for (auto _ : state) {
+		joyCon.poll();
+		benchmark::DoNotOptimize(joyCon.getState());
+		benchmark::DoNotOptimize(joyCon.getImuSamples());
+	}
+	const size_t allocationCount = allocations::getCount() - allocationsBefore;
+	state.SetItemsProcessed(state.iterations());
+	state.counters["allocations"] = benchmark::Counter(static_cast<double>(allocationCount),
+	                                                   benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_JoyConPoll);
+
+/*
+ * What subscriptions cost a report that changes nothing they subscribed to, like those of an idle JoyCon.
+ */
+void BM_PublishUnchangedReport(benchmark::State& state)
+{
+	InputSubscriptions subscriptions;
+	subscriptions.subscribeButtons(button_bits::ALL_BUTTONS, [](const ButtonEdges&) {});
+	subscriptions.subscribeSticks(0.05f, [](const AnalogStick&, const AnalogStick&) {});
+
+	JoyConState joyConState{};
+	for (auto _ : state) {
+		subscriptions.publish(joyConState, true);
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PublishUnchangedReport);
+
+/*
+ * What recording a latency costs every report, for latencies spread over a few powers of 2.
+ */
+void BM_LatencyHistogramRecord(benchmark::State& state)
+{
+	LatencyHistogram histogram;
+	std::vector<std::chrono::nanoseconds> latencies(CANNED_REPORT_COUNT);
+	std::mt19937 random(0);
+	std::uniform_int_distribution<int64_t> latencyDistribution(1000, 20000000);
+	for (auto& latency : latencies) {
+		latency = std::chrono::nanoseconds(latencyDistribution(random));
+	}
+
+	size_t i = 0;
+	for (auto _ : state) {
+		histogram.record(latencies[i++ & (CANNED_REPORT_COUNT - 1)]);
+	}
+	benchmark::DoNotOptimize(histogram.getSnapshot().count);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LatencyHistogramRecord);
+
+/*
+ * What the batch decoder does, one report at a time. The baseline of BM_DecodeReports.
+ */
+void BM_DecodeReportsOneByOne(benchmark::State& state)
+{
+	const auto& reports = getCannedReports();
+	const CalibrationData calibrationData = decode::decodeCalibrationData(getRawCalibrationData());
+	std::vector<JoyConState> decoded(reports.size());
+	for (auto _ : state) {
+		JoyConState joyConState{};
+		for (size_t i = 0; i < reports.size(); ++i) {
+			decode::decodeButtons(reports[i], joyConState.buttons);
+			decode::decodeAnalogSticks(reports[i], calibrationData, joyConState);
+			decode::decodeSensors(reports[i], calibrationData, joyConState);
+			decoded[i] = joyConState;
+		}
+		benchmark::DoNotOptimize(decoded.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * reports.size());
+}
+BENCHMARK(BM_DecodeReportsOneByOne);
+
+/*
+ * The argument is the decode::DecodeKernel to use.
+ */
+void BM_DecodeReports(benchmark::State& state)
+{
+	const auto kernel = static_cast<decode::DecodeKernel>(state.range(0));
+	if (kernel > decode::getBestDecodeKernel()) {
+		state.SkipWithError("The CPU doesn't support this kernel");
+		return;
+	}
+
+	const auto& reports = getCannedReports();
+	const CalibrationData calibrationData = decode::decodeCalibrationData(getRawCalibrationData());
+	decode::DecodedReports decoded;
+	for (auto _ : state) {
+		decode::decodeReports(reports.data(), reports.size(), calibrationData, decoded, kernel);
+		benchmark::DoNotOptimize(decoded.buttons.data());
+		benchmark::ClobberMemory();
+	}
+	state.SetItemsProcessed(state.iterations() * reports.size());
+}
+BENCHMARK(BM_DecodeReports)
+	->Arg(static_cast<int>(decode::DecodeKernel::SCALAR))
+	->Arg(static_cast<int>(decode::DecodeKernel::SSE41))
+	->Arg(static_cast<int>(decode::DecodeKernel::AVX2));
+}
+
+BENCHMARK_MAIN();
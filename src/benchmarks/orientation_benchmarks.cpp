@@ -0,0 +1,150 @@
+/*
+ * Benchmarks of the orientation estimator: what it costs per IMU sample, and how far off it is. Also what learning the
+ * bias of the gyroscope costs per IMU sample.
+ *
+ * The accuracy is measured by replaying a capture of a JoyCon that is waved around along a known path. The capture
+ * is synthesized, with sensor noise, and written to a temporary file like a real capture would be. The reports go
+ * through the same decoding as those of a JoyCon, and the estimated gravity is compared to the true one.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "decode.h"
+#include "GyroscopeBiasEstimator.h"
+#include "orientation_capture.h"
+#include "OrientationEstimator.h"
+#include "ReportCapture.h"
+
+using namespace joy_con_bridge;
+using namespace orientation_capture;
+
+
+namespace
+{
+const float SECONDS_PER_REPORT = IMU_SAMPLES_PER_REPORT * IMU_SAMPLE_PERIOD;
+// A minute of waving the JoyCon around.
+const size_t CAPTURE_REPORT_COUNT = static_cast<size_t>(60 / SECONDS_PER_REPORT);
+
+/*
+ * A synthesized capture, and the true gravity of each of its IMU samples.
+ */
+struct Capture
+{
+	std::string path;
+	std::vector<ThreeAxesSensor> gravity;
+
+	~Capture()
+	{
+		std::remove(path.data());
+	}
+};
+
+const Capture& getCapture()
+{
+	static const Capture capture = []() {
+		Capture capture;
+		capture.path = (std::filesystem::temp_directory_path() / "joyconbridge_orientation.jccap").string();
+		capture.gravity = writeCapture(capture.path, CAPTURE_REPORT_COUNT);
+		return capture;
+	}();
+	return capture;
+}
+
+void BM_OrientationUpdate(benchmark::State& state)
+{
+	const Capture& capture = getCapture();
+	ReportCaptureReader reader(capture.path);
+	const CalibrationData calibrationData = decode::decodeCalibrationData(*reader.getCalibrationData());
+
+	std::vector<ImuSamples> reports;
+	CaptureRecord record;
+	while (reader.next(record)) {
+		if (CaptureRecordType::INPUT_REPORT == record.type) {
+			JoyConState joyConState{};
+			decode::decodeSensors(*reinterpret_cast<const protocol::StandardFullInputReport*>(record.data),
+			                      calibrationData, joyConState);
+			reports.push_back(joyConState.imuSamples);
+		}
+	}
+
+	OrientationEstimator estimator;
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(estimator.update(reports[i++ % reports.size()]));
+	}
+	state.SetItemsProcessed(state.iterations() * IMU_SAMPLES_PER_REPORT);
+}
+BENCHMARK(BM_OrientationUpdate);
+
+/*
+ * Replays the capture through the estimator. The counters are the error of the estimated gravity, in degrees.
+ * The argument is the beta of the estimator, in thousandths.
+ */
+void BM_OrientationAccuracy(benchmark::State& state)
+{
+	const Capture& capture = getCapture();
+	ReportCaptureReader reader(capture.path);
+	const CalibrationData calibrationData = decode::decodeCalibrationData(*reader.getCalibrationData());
+	const float beta = static_cast<float>(state.range(0)) / 1000;
+
+	double errorSum = 0;
+	float maxError = 0;
+	size_t errorCount = 0;
+	for (auto _ : state) {
+		reader.rewind();
+		OrientationEstimator estimator(beta);
+		JoyConState joyConState{};
+		size_t sample = 0;
+		CaptureRecord record;
+		while (reader.next(record)) {
+			if (CaptureRecordType::INPUT_REPORT != record.type) {
+				continue;
+			}
+
+			decode::decodeSensors(*reinterpret_cast<const protocol::StandardFullInputReport*>(record.data),
+			                      calibrationData, joyConState);
+			for (const ImuSample& imuSample : joyConState.imuSamples) {
+				estimator.update(imuSample, IMU_SAMPLE_PERIOD);
+				if (sample >= SETTLE_SAMPLE_COUNT) {
+					const float error = getAngleInDegrees(estimator.getOrientation().gravity, capture.gravity[sample]);
+					errorSum += error;
+					maxError = std::max(maxError, error);
+					++errorCount;
+				}
+				++sample;
+			}
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * capture.gravity.size());
+	state.counters["mean_error_deg"] = errorSum / std::max<size_t>(1, errorCount);
+	state.counters["max_error_deg"] = maxError;
+}
+BENCHMARK(BM_OrientationAccuracy)->Arg(0)->Arg(33)->Arg(100)->Arg(300);
+
+void BM_GyroscopeBiasUpdate(benchmark::State& state)
+{
+	const Capture& capture = getCapture();
+	ReportCaptureReader reader(capture.path);
+	const CalibrationData calibrationData = decode::decodeCalibrationData(*reader.getCalibrationData());
+
+	std::vector<protocol::StandardFullInputReport> reports;
+	CaptureRecord record;
+	while (reader.next(record)) {
+		if (CaptureRecordType::INPUT_REPORT == record.type) {
+			reports.push_back(*reinterpret_cast<const protocol::StandardFullInputReport*>(record.data));
+		}
+	}
+
+	GyroscopeBiasEstimator estimator(calibrationData);
+	size_t i = 0;
+	for (auto _ : state) {
+		estimator.update(reports[i++ % reports.size()]);
+		benchmark::DoNotOptimize(estimator.getNeutral());
+	}
+	state.SetItemsProcessed(state.iterations() * IMU_SAMPLES_PER_REPORT);
+}
+BENCHMARK(BM_GyroscopeBiasUpdate);
+}
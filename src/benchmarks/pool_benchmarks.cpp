@@ -0,0 +1,68 @@
+/*
+ * Benchmarks of serving many JoyCons from one thread with a JoyConPool: a number of simulated JoyCons (the argument),
+ * each streaming reports at the rate of an actual JoyCon.
+ *
+ * The counters are what it costs to serve each JoyCon, and how late its reports are applied:
+ * - cpu_percent_per_joycon: the CPU time of the process, over the time that passed, per JoyCon.
+ * - p99_latency_ms and max_latency_ms: from when the fake sent a report until the pool applied it, as estimated from
+ *   the timer of the reports (see ReportTimestamp::sampleTime).
+ *
+ * The fakes have no file descriptors, so this measures the round-robin path of the pool, not epoll.
+ */
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <benchmark/benchmark.h>
+#include "FakeJoyCon.h"
+#include "JoyConPool.h"
+#include "LatencyHistogram.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+void BM_JoyConPoolScaling(benchmark::State& state)
+{
+	const size_t joyConCount = static_cast<size_t>(state.range(0));
+	JoyConPool pool;
+	for (size_t i = 0; i < joyConCount; ++i) {
+		const Hand hand = 0 == i % 2 ? Hand::LEFT : Hand::RIGHT;
+		pool.add(JoyCon(std::make_shared<FakeJoyCon>(hand), hand));
+	}
+
+	LatencyHistogram latencies;
+	const auto onReport = [&latencies](size_t, const JoyConState& joyConState) {
+		latencies.record(std::chrono::steady_clock::now() - joyConState.timestamp.sampleTime);
+	};
+	// The first reports of each JoyCon set up its clock, so they are left out.
+	const auto warmUpEnd = std::chrono::steady_clock::now() + 4 * DEFAULT_FAKE_REPORT_INTERVAL;
+	while (std::chrono::steady_clock::now() < warmUpEnd) {
+		pool.poll(std::chrono::milliseconds(1));
+	}
+
+	size_t reportCount = 0;
+	const auto start = std::chrono::steady_clock::now();
+	const std::clock_t cpuStart = std::clock();
+	for (auto _ : state) {
+		reportCount += pool.poll(std::chrono::duration_cast<std::chrono::milliseconds>(DEFAULT_FAKE_REPORT_INTERVAL),
+		                         onReport);
+	}
+	const double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	for (size_t i = 0; i < joyConCount; ++i) {
+		if (pool.getError(i)) {
+			state.SkipWithError("A JoyCon failed");
+			return;
+		}
+	}
+
+	const LatencySnapshot latency = latencies.getSnapshot();
+	state.SetItemsProcessed(static_cast<int64_t>(reportCount));
+	state.counters["cpu_percent_per_joycon"] = 100 * cpuSeconds / seconds / static_cast<double>(joyConCount);
+	state.counters["p99_latency_ms"] = std::chrono::duration<double, std::milli>(latency.getQuantile(0.99)).count();
+	state.counters["max_latency_ms"] = std::chrono::duration<double, std::milli>(latency.max).count();
+}
+BENCHMARK(BM_JoyConPoolScaling)->Arg(1)->Arg(8)->Arg(32)->Arg(128)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
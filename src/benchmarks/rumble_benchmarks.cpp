@@ -0,0 +1,80 @@
+/*
+ * Benchmarks of rumble: what encoding a rumble costs, and how long it takes a rumble that was set to be written.
+ *
+ * The latency is measured against a fake JoyCon, so it is that of the streaming thread waking up and writing, without
+ * the radio. Its counters are quantiles of the rumble latency of the JoyCon's metrics, in microseconds.
+ */
+#include <chrono>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "rumble.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// A power of 2, so cycling through the rumbles is a mask.
+const size_t CANNED_RUMBLE_COUNT = 1024;
+
+const std::vector<Rumble>& getCannedRumbles()
+{
+	static const std::vector<Rumble> rumbles = []() {
+		std::mt19937 random(0x52554D);
+		std::uniform_real_distribution<float> highFrequency(80, 1253);
+		std::uniform_real_distribution<float> lowFrequency(41, 626);
+		std::uniform_real_distribution<float> amplitude(0, 1);
+
+		std::vector<Rumble> rumbles(CANNED_RUMBLE_COUNT);
+		for (Rumble& rumble : rumbles) {
+			rumble = {{highFrequency(random), amplitude(random)}, {lowFrequency(random), amplitude(random)}};
+		}
+		return rumbles;
+	}();
+	return rumbles;
+}
+
+void BM_RumbleEncode(benchmark::State& state)
+{
+	const std::vector<Rumble>& rumbles = getCannedRumbles();
+
+	size_t i = 0;
+	for (auto _ : state) {
+		benchmark::DoNotOptimize(rumble::encodeBoth(rumbles[i++ % CANNED_RUMBLE_COUNT]));
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RumbleEncode);
+
+/*
+ * Sets a rumble and waits until it was written, over and over.
+ */
+void BM_RumbleLatency(benchmark::State& state)
+{
+	const std::vector<Rumble>& rumbles = getCannedRumbles();
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	JoyCon joyCon(fake);
+
+	size_t i = 0;
+	for (auto _ : state) {
+		const unsigned int reportCount = fake->getRumbleReportCount();
+		joyCon.setRumble(rumbles[i++ % CANNED_RUMBLE_COUNT]);
+		while (fake->getRumbleReportCount() == reportCount) {
+			std::this_thread::yield();
+		}
+	}
+	joyCon.stopRumble();
+
+	const LatencySnapshot latency = joyCon.getMetrics()->getSnapshot().rumbleLatency;
+	for (const auto& [name, quantile] : {std::make_pair("p50_us", 0.5), std::make_pair("p99_us", 0.99)}) {
+		state.counters[name] = std::chrono::duration<double, std::micro>(latency.getQuantile(quantile)).count();
+	}
+	state.counters["max_us"] = std::chrono::duration<double, std::micro>(latency.max).count();
+}
+BENCHMARK(BM_RumbleLatency)->UseRealTime();
+}
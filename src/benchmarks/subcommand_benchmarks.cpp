@@ -0,0 +1,75 @@
+/*
+ * Benchmarks of the subcommand channel: how many LED updates a JoyCon takes per second, one at a time and pipelined.
+ *
+ * The JoyCon is a fake that delays its replies like a round trip over the radio would, and streams 0x30 reports
+ * meanwhile. With no delay (the 0 variants), what is left is the cost on the host of sending a subcommand, routing
+ * its reply and applying the reports around it.
+ */
+#include <chrono>
+#include <future>
+#include <memory>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "command_ids.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+
+using namespace joy_con_bridge;
+using namespace joy_con_bridge::command_ids;
+
+
+namespace
+{
+// Somewhat below the round trip of an actual JoyCon, to keep the benchmarks short.
+const std::chrono::microseconds REPLY_DELAY(2000);
+
+std::shared_ptr<FakeJoyCon> makeFakeJoyCon(bool isDelayed)
+{
+	auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT, std::chrono::milliseconds(1));
+	if (isDelayed) {
+		fake->setReplyDelay(REPLY_DELAY);
+	}
+	return fake;
+}
+
+/*
+ * Sets the LEDs and waits for the reply, over and over. The argument is whether replies are delayed.
+ */
+void BM_SetPlayerLeds(benchmark::State& state)
+{
+	JoyCon joyCon(makeFakeJoyCon(0 != state.range(0)), Hand::LEFT);
+
+	unsigned int playerNumber = 0;
+	for (auto _ : state) {
+		joyCon.setPlayerLedsByNumber(playerNumber++ % 8 + 1);
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SetPlayerLeds)->Arg(0)->Arg(1)->UseRealTime();
+
+/*
+ * Keeps a number of LED updates in flight (the first argument), and polls until they are all replied to. The second
+ * argument is whether replies are delayed. items_per_second counts LED updates.
+ */
+void BM_SetPlayerLedsPipelined(benchmark::State& state)
+{
+	const auto inFlight = static_cast<size_t>(state.range(0));
+	JoyCon joyCon(makeFakeJoyCon(0 != state.range(1)), Hand::LEFT);
+
+	std::vector<std::future<Buffer>> replies(inFlight);
+	uint8_t ledSequence = 0;
+	for (auto _ : state) {
+		for (auto& reply : replies) {
+			reply = joyCon.sendSubcommandAsync(SUBCOMMAND_SET_PLAYER_LED, {ledSequence++});
+		}
+		for (auto& reply : replies) {
+			while (std::future_status::ready != reply.wait_for(std::chrono::seconds(0))) {
+				joyCon.poll();
+			}
+			benchmark::DoNotOptimize(reply.get());
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * inFlight);
+}
+BENCHMARK(BM_SetPlayerLedsPipelined)->ArgsProduct({{1, 4, 16}, {0, 1}})->UseRealTime();
+}
@@ -52,4 +52,56 @@ boost::python::dict threeAxesSensorToDict(const ThreeAxesSensor& sensor)
 
 	return result;
 }
+
+boost::python::list imuSamplesToList(const ImuSamples& samples)
+{
+	boost::python::list result;
+
+	for (const ImuSample& sample : samples) {
+		boost::python::dict sampleDict;
+		sampleDict["accelerometer"] = threeAxesSensorToDict(sample.accelerometer);
+		sampleDict["gyroscope"]     = threeAxesSensorToDict(sample.gyroscope);
+		sampleDict["timeOffset"]    = sample.timeOffset;
+		result.append(sampleDict);
+	}
+
+	return result;
+}
+
+boost::python::list connectionResultsToList(const std::vector<connect::ConnectionResult>& results)
+{
+	boost::python::list result;
+
+	for (const connect::ConnectionResult& connection : results) {
+		boost::python::dict connectionDict;
+		connectionDict["path"]             = connection.path;
+		connectionDict["hand"]             = connection.hand;
+		connectionDict["handshakeLatency"] = std::chrono::duration<double>(connection.handshakeLatency).count();
+		if (connection.joyCon) {
+			connectionDict["joyCon"] = *connection.joyCon;
+			connectionDict["error"]  = boost::python::object();
+		} else {
+			connectionDict["joyCon"] = boost::python::object();
+			try {
+				std::rethrow_exception(connection.error);
+			} catch (const std::exception& e) {
+				connectionDict["error"] = std::string(e.what());
+			}
+		}
+		result.append(connectionDict);
+	}
+
+	return result;
+}
+
+boost::python::dict spiDumpStatisticsToDict(const SpiDumpStatistics& statistics)
+{
+	boost::python::dict result;
+
+	result["size"]           = statistics.size;
+	result["duration"]       = std::chrono::duration<double>(statistics.duration).count();
+	result["bytesPerSecond"] = statistics.bytesPerSecond;
+
+	return result;
+}
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/python.hpp>
+#include "connect.h"
 #include "JoyCon.h"
 
 /*
@@ -25,4 +26,10 @@ boost::python::dict buttonsStateToDict(const ButtonsState& state);
 boost::python::dict analogStickToDict(const AnalogStick& stick);
 
 boost::python::dict threeAxesSensorToDict(const ThreeAxesSensor& sensor);
+
+boost::python::list imuSamplesToList(const ImuSamples& samples);
+
+boost::python::list connectionResultsToList(const std::vector<connect::ConnectionResult>& results);
+
+boost::python::dict spiDumpStatisticsToDict(const SpiDumpStatistics& statistics);
 }
@@ -10,6 +10,17 @@ CONVERTER_HOOK_DEFINITION(JoyCon, getLeftStick, python::analogStickToDict)
 CONVERTER_HOOK_DEFINITION(JoyCon, getRightStick, python::analogStickToDict)
 CONVERTER_HOOK_DEFINITION(JoyCon, getAccelerometer, python::threeAxesSensorToDict)
 CONVERTER_HOOK_DEFINITION(JoyCon, getGyroscope, python::threeAxesSensorToDict)
+CONVERTER_HOOK_DEFINITION(JoyCon, getImuSamples, python::imuSamplesToList)
+
+boost::python::list connectAll()
+{
+	return python::connectionResultsToList(connect::connectAll());
+}
+
+boost::python::dict dumpSpiFlash(JoyCon& joyCon, const std::string& path)
+{
+	return python::spiDumpStatisticsToDict(joyCon.dumpSpiFlash(path));
+}
 
 BOOST_PYTHON_MODULE(pyjoyconbridge)
 {
@@ -32,16 +43,22 @@ BOOST_PYTHON_MODULE(pyjoyconbridge)
 
 	def("get_left_joy_con", &connect::getLeftJoyCon);
 	def("get_right_joy_con", &connect::getRightJoyCon);
+	def("connect_all", &connectAll, "Connects to every available JoyCon concurrently.");
 
 	class_<JoyCon>("JoyCon", init<HidDevice>("Creates a new JoyCon from the given HID device."))
 		.def(init<HidDevice, Hand>("Creates a new JoyCon from the given HID device."))
-		.def("poll", &JoyCon::poll)
+		.def("poll", static_cast<void (JoyCon::*)()>(&JoyCon::poll))
+		.def("poll_all", static_cast<size_t (JoyCon::*)()>(&JoyCon::pollAll))
+		.add_property("last_backlog_depth", &JoyCon::getLastBacklogDepth)
+		.add_property("max_backlog_depth", &JoyCon::getMaxBacklogDepth)
 		.add_property("buttons_state", &CONVERTER_HOOK_NAME(getButtonsState))
 		.add_property("left_stick", &CONVERTER_HOOK_NAME(getLeftStick))
 		.add_property("right_stick", &CONVERTER_HOOK_NAME(getRightStick))
 		.add_property("gyroscope", &CONVERTER_HOOK_NAME(getGyroscope))
 		.add_property("accelerometer", &CONVERTER_HOOK_NAME(getAccelerometer))
+		.add_property("imu_samples", &CONVERTER_HOOK_NAME(getImuSamples))
 		.add_property("likely_hand", &JoyCon::getLikelyHand)
 		.def("set_player_leds_by_number", &JoyCon::setPlayerLedsByNumber)
-		.def("set_player_leds", &JoyCon::setPlayerLeds);
+		.def("set_player_leds", &JoyCon::setPlayerLeds)
+		.def("dump_spi_flash", &dumpSpiFlash, "Dumps the whole SPI flash of the JoyCon into an image file.");
 }
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include "allocations.h"
+
+
+namespace
+{
+std::atomic<size_t> g_count(0);
+
+void* allocate(size_t size, size_t alignment)
+{
+	g_count.fetch_add(1, std::memory_order_relaxed);
+
+	// aligned_alloc wants the size to be a multiple of the alignment, and neither of them 0.
+	const size_t roundedSize = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+	void* const memory = alignment > alignof(std::max_align_t) ?
+		std::aligned_alloc(alignment, roundedSize) : std::malloc(roundedSize);
+	if (nullptr == memory) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+}
+
+namespace allocations
+{
+size_t getCount()
+{
+	return g_count.load(std::memory_order_relaxed);
+}
+}
+
+// The array and nothrow forms call these.
+void* operator new(size_t size)
+{
+	return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	return allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+	std::free(memory);
+}
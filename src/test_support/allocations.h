@@ -0,0 +1,14 @@
+/*
+ * Counts the heap allocations of the tests and the benchmarks, by replacing the global operator new.
+ */
+#pragma once
+#include <cstddef>
+
+
+namespace allocations
+{
+/**
+	@brief Gets the number of allocations made so far, by any thread.
+*/
+size_t getCount();
+}
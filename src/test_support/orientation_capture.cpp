@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include "command_ids.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "orientation_capture.h"
+#include "ReportCapture.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+const float PI = 3.14159265358979f;
+
+int16_t toRaw(float value, float coefficient, float neutral = 0)
+{
+	return static_cast<int16_t>(std::clamp(std::lround(value / coefficient + neutral), -0x8000L, 0x7FFFL));
+}
+}
+
+namespace orientation_capture
+{
+Quaternion multiply(const Quaternion& a, const Quaternion& b)
+{
+	return {
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+	};
+}
+
+ThreeAxesSensor getGravity(const Quaternion& q)
+{
+	return {
+		-2 * (q.x * q.z - q.w * q.y),
+		-2 * (q.w * q.x + q.y * q.z),
+		-(q.w * q.w - q.x * q.x - q.y * q.y + q.z * q.z)
+	};
+}
+
+float getAngleInDegrees(const ThreeAxesSensor& first, const ThreeAxesSensor& second)
+{
+	const float dot = first.x * second.x + first.y * second.y + first.z * second.z;
+	const float firstLength = std::sqrt(first.x * first.x + first.y * first.y + first.z * first.z);
+	const float secondLength = std::sqrt(second.x * second.x + second.y * second.y + second.z * second.z);
+	return std::acos(std::clamp(dot / (firstLength * secondLength), -1.0f, 1.0f)) * 180 / PI;
+}
+
+ImuSample makeRestingSample(const ThreeAxesSensor& gravity)
+{
+	ImuSample sample{};
+	// The accelerometer measures the opposite of gravity.
+	sample.accelerometer = {-gravity.x * G, -gravity.y * G, -gravity.z * G};
+	return sample;
+}
+
+WavedJoyCon::WavedJoyCon()
+	: m_random(0x4A6F79)
+	, m_gyroscopeNoise(0, 0.02f)
+	, m_accelerometerNoise(0, 0.05f)
+	, m_truth{std::cos(0.3f), std::sin(0.3f), 0, 0}
+	, m_time(0)
+{}
+
+ImuSample WavedJoyCon::next()
+{
+	const ThreeAxesSensor rate = {
+		6 * std::sin(1.3f * m_time),
+		4 * std::sin(0.7f * m_time + 1),
+		3 * std::cos(0.9f * m_time)
+	};
+
+	// Turn the true orientation by the rate, over the sample period, in the axes of the JoyCon.
+	const float halfAngle = 0.5f * IMU_SAMPLE_PERIOD;
+	m_truth = multiply(m_truth, {1, rate.x * halfAngle, rate.y * halfAngle, rate.z * halfAngle});
+	const float inverseLength = 1 / std::sqrt(m_truth.w * m_truth.w + m_truth.x * m_truth.x +
+	                                          m_truth.y * m_truth.y + m_truth.z * m_truth.z);
+	m_truth = {m_truth.w * inverseLength, m_truth.x * inverseLength, m_truth.y * inverseLength,
+	           m_truth.z * inverseLength};
+	m_time += IMU_SAMPLE_PERIOD;
+
+	const ThreeAxesSensor gravity = getGravity();
+	ImuSample sample = makeRestingSample({gravity.x + m_accelerometerNoise(m_random),
+	                                      gravity.y + m_accelerometerNoise(m_random),
+	                                      gravity.z + m_accelerometerNoise(m_random)});
+	sample.gyroscope = {rate.x + m_gyroscopeNoise(m_random), rate.y + m_gyroscopeNoise(m_random),
+	                    rate.z + m_gyroscopeNoise(m_random)};
+	return sample;
+}
+
+ThreeAxesSensor WavedJoyCon::getGravity() const
+{
+	return orientation_capture::getGravity(m_truth);
+}
+
+const RawCalibrationData& getRawCalibrationData()
+{
+	static const RawCalibrationData data = JoyCon(std::make_shared<FakeJoyCon>(Hand::RIGHT)).getRawCalibrationData();
+	return data;
+}
+
+std::vector<ThreeAxesSensor> writeCapture(const std::string& path, size_t reportCount)
+{
+	const RawCalibrationData& rawCalibrationData = getRawCalibrationData();
+	const CalibrationData calibrationData = decode::decodeCalibrationData(rawCalibrationData);
+	ReportCaptureWriter writer(path, Hand::RIGHT, L"SYNTHESIZED");
+	writer.writeCalibration(rawCalibrationData);
+
+	WavedJoyCon joyCon;
+	std::vector<ThreeAxesSensor> gravity;
+	gravity.reserve(reportCount * IMU_SAMPLES_PER_REPORT);
+	for (size_t i = 0; i < reportCount; ++i) {
+		protocol::StandardFullInputReport report{};
+		report.id = command_ids::PACKET_TYPE_BUTTONS_AND_IMU;
+		report.timer = static_cast<uint8_t>(3 * i);
+
+		for (protocol::SensorData& rawSample : report.sensorData) {
+			const ImuSample sample = joyCon.next();
+			gravity.push_back(joyCon.getGravity());
+
+			rawSample.accelerometer[0] = toRaw(sample.accelerometer.x, calibrationData.accelerometerCoeff.x);
+			rawSample.accelerometer[1] = toRaw(sample.accelerometer.y, calibrationData.accelerometerCoeff.y);
+			rawSample.accelerometer[2] = toRaw(sample.accelerometer.z, calibrationData.accelerometerCoeff.z);
+			rawSample.gyroscope[0] = toRaw(sample.gyroscope.x, calibrationData.gyroscopeCoeff.x,
+			                               calibrationData.gyroscopeNeutral.x);
+			rawSample.gyroscope[1] = toRaw(sample.gyroscope.y, calibrationData.gyroscopeCoeff.y,
+			                               calibrationData.gyroscopeNeutral.y);
+			rawSample.gyroscope[2] = toRaw(sample.gyroscope.z, calibrationData.gyroscopeCoeff.z,
+			                               calibrationData.gyroscopeNeutral.z);
+		}
+
+		writer.write(CaptureRecordType::INPUT_REPORT, reinterpret_cast<const uint8_t*>(&report), sizeof(report));
+	}
+
+	return gravity;
+}
+}
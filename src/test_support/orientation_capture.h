@@ -0,0 +1,78 @@
+/*
+ * A JoyCon that is waved around along a known path, synthesized for measuring the orientation estimator, and the
+ * math to compare orientations with.
+ */
+#pragma once
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+#include "decode.h"
+#include "OrientationEstimator.h"
+
+
+namespace orientation_capture
+{
+const float G = 9.8f; // The accelerometer reads in m/s^2.
+// The estimator starts from a single accelerometer sample, so the first second is left out of the error.
+const size_t SETTLE_SAMPLE_COUNT = static_cast<size_t>(1 / joy_con_bridge::IMU_SAMPLE_PERIOD);
+
+joy_con_bridge::Quaternion multiply(const joy_con_bridge::Quaternion& a, const joy_con_bridge::Quaternion& b);
+
+/**
+	@brief Gets the direction gravity pulls, in the axes of a JoyCon with the given orientation.
+*/
+joy_con_bridge::ThreeAxesSensor getGravity(const joy_con_bridge::Quaternion& q);
+
+float getAngleInDegrees(const joy_con_bridge::ThreeAxesSensor& first, const joy_con_bridge::ThreeAxesSensor& second);
+
+/**
+	@brief Makes the sample of a JoyCon at rest, with gravity pulling in the given direction.
+*/
+joy_con_bridge::ImuSample makeRestingSample(const joy_con_bridge::ThreeAxesSensor& gravity);
+
+/*
+ * A JoyCon that turns around all its axes at once, at up to a couple of turns per second, starting tilted. Its IMU
+ * samples are noisy like those of a JoyCon in hand. The noise is seeded, so the path is the same every time.
+ */
+class WavedJoyCon
+{
+public:
+	WavedJoyCon();
+
+	/**
+		@brief Moves the JoyCon on by an IMU sample period.
+
+		@return The IMU sample it measures there.
+	*/
+	joy_con_bridge::ImuSample next();
+
+	/**
+		@brief Gets the true direction of gravity, as of the latest sample.
+	*/
+	joy_con_bridge::ThreeAxesSensor getGravity() const;
+
+private:
+	std::mt19937 m_random;
+	std::normal_distribution<float> m_gyroscopeNoise; // rad/s
+	std::normal_distribution<float> m_accelerometerNoise; // In G. Hand tremor, mostly.
+	joy_con_bridge::Quaternion m_truth;
+	float m_time;
+};
+
+/**
+	@brief Gets the calibration data of the fake JoyCon, which the captures are encoded with.
+*/
+const joy_con_bridge::RawCalibrationData& getRawCalibrationData();
+
+/**
+	@brief Writes a capture of a `WavedJoyCon`, in full input reports, as a right JoyCon with the calibration of the
+	fake would send them.
+
+	@param[in] path The path of the capture file. Overwritten if it exists.
+	@param[in] reportCount The number of reports to capture.
+
+	@return The true direction of gravity at each IMU sample of the capture.
+*/
+std::vector<joy_con_bridge::ThreeAxesSensor> writeCapture(const std::string& path, size_t reportCount);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+
+/*
+ * A directory that is removed with everything in it once the test is done.
+ */
+class TemporaryDirectory
+{
+public:
+	explicit TemporaryDirectory(const std::string& name)
+		: m_path(std::filesystem::temp_directory_path() /
+		         (name + "_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count())))
+	{
+		std::filesystem::create_directories(m_path);
+	}
+
+	~TemporaryDirectory()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(m_path, error);
+	}
+
+	TemporaryDirectory(const TemporaryDirectory&) = delete;
+	TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+	std::string getPath() const
+	{
+		return m_path.string();
+	}
+
+	/**
+		@brief Gets the path of a file in the directory.
+	*/
+	std::string getPath(const std::string& fileName) const
+	{
+		return (m_path / fileName).string();
+	}
+
+private:
+	std::filesystem::path m_path;
+};
@@ -0,0 +1,77 @@
+/*
+ * Tests of the calibration cache of JoyCon, against fake JoyCons.
+ */
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <catch2/catch.hpp>
+#include "CalibrationCache.h"
+#include "command_ids.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "TemporaryDirectory.h"
+
+using namespace joy_con_bridge;
+using namespace joy_con_bridge::command_ids;
+
+
+namespace
+{
+// Where the user calibration of the left stick is, after its magic.
+const uint32_t USER_LEFT_STICK_MAGIC_OFFSET = 0x8010;
+const Buffer USER_LEFT_STICK_CALIBRATION = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99};
+
+bool hasUserLeftStickCalibration(const JoyCon& joyCon)
+{
+	const auto& leftStick = joyCon.getRawCalibrationData().leftStick;
+	return std::equal(leftStick.begin(), leftStick.end(), USER_LEFT_STICK_CALIBRATION.begin());
+}
+}
+
+TEST_CASE("A cached calibration is used without reading it from SPI", "[CalibrationCache]")
+{
+	const TemporaryDirectory directory("joyconbridge_calibration_cache");
+	const auto cache = std::make_shared<CalibrationCache>(directory.getPath());
+	const JoyCon first(std::make_shared<FakeJoyCon>(Hand::LEFT), Hand::LEFT, cache);
+
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	const JoyCon second(fake, Hand::LEFT, cache);
+
+	// Only the read that verifies the cached data.
+	CHECK(1 == fake->getSubcommandCount(SUBCOMMAND_SPI_READ));
+	CHECK(first.getRawCalibrationData().sensors == second.getRawCalibrationData().sensors);
+}
+
+TEST_CASE("A stale cached calibration is read again without blocking the polls", "[CalibrationCache]")
+{
+	const TemporaryDirectory directory("joyconbridge_calibration_cache");
+	const auto cache = std::make_shared<CalibrationCache>(directory.getPath());
+	JoyCon(std::make_shared<FakeJoyCon>(Hand::LEFT), Hand::LEFT, cache);
+
+	// The JoyCon was recalibrated since it was cached.
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	fake->writeSpi(USER_LEFT_STICK_MAGIC_OFFSET, {0xB2, 0xA1});
+	fake->writeSpi(USER_LEFT_STICK_MAGIC_OFFSET + 2, USER_LEFT_STICK_CALIBRATION);
+	const auto replyDelay = std::chrono::milliseconds(20);
+	fake->setReplyDelay(replyDelay);
+
+	JoyCon joyCon(fake, Hand::LEFT, cache);
+	REQUIRE_FALSE(hasUserLeftStickCalibration(joyCon));
+
+	std::chrono::steady_clock::duration longestPoll(0);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!hasUserLeftStickCalibration(joyCon) && std::chrono::steady_clock::now() < deadline) {
+		const auto start = std::chrono::steady_clock::now();
+		joyCon.pollAll();
+		longestPoll = std::max(longestPoll, std::chrono::steady_clock::now() - start);
+	}
+
+	CHECK(hasUserLeftStickCalibration(joyCon));
+	CHECK(0xA1B2 == joyCon.getRawCalibrationData().userCalibrationMagics[0]);
+	CHECK(longestPoll < replyDelay / 2);
+
+	// The cache was updated too.
+	fake->setReplyDelay(std::chrono::microseconds(0));
+	const JoyCon reconnected(fake, Hand::LEFT, cache);
+	CHECK(hasUserLeftStickCalibration(reconnected));
+}
@@ -0,0 +1,39 @@
+/*
+ * Tests of connect::connectAll, against fake JoyCons.
+ */
+#include <memory>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "connect.h"
+#include "exceptions.h"
+#include "FakeJoyCon.h"
+
+using namespace joy_con_bridge;
+
+
+TEST_CASE("connectAll connects every device", "[connect]")
+{
+	const std::vector<connect::DeviceDescription> devices = {
+		{"left", L"", Hand::LEFT},
+		{"right", L"", Hand::RIGHT},
+		{"missing", L"", Hand::LEFT},
+	};
+	const connect::TransportOpener openTransport = [](const connect::DeviceDescription& device) {
+		if ("missing" == device.path) {
+			throw HidOpenError();
+		}
+		return std::make_shared<FakeJoyCon>(device.hand);
+	};
+
+	const auto results = connect::connectAll(devices, openTransport);
+
+	REQUIRE(3 == results.size());
+	for (size_t i = 0; i < 2; ++i) {
+		CHECK(devices[i].path == results[i].path);
+		REQUIRE(results[i].joyCon);
+		CHECK(devices[i].hand == results[i].joyCon->getLikelyHand());
+		CHECK(results[i].handshakeLatency.count() > 0);
+	}
+	CHECK_FALSE(results[2].joyCon);
+	CHECK_THROWS_AS(std::rethrow_exception(results[2].error), HidOpenError);
+}
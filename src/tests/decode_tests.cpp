@@ -0,0 +1,208 @@
+/*
+ * Tests of the decoding of reports and calibration data.
+ */
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "CalibrationCache.h"
+#include "command_ids.h"
+#include "decode.h"
+#include "decode_batch.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "protocol.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+const float PI = 3.14159265358979f;
+
+// The factory calibration of the left stick of an actual JoyCon.
+const std::array<uint8_t, 9> LEFT_STICK_CALIBRATION = {0xBA, 0xF5, 0x62, 0x6F, 0xC8, 0x77, 0xED, 0x95, 0x5B};
+
+// The factory calibration of the sensors of an actual JoyCon, like the fake's. The accelerometer neutral is
+// (-45, -43, 341) with a sensitivity of 0x4000, and the gyroscope neutral is (25, -35, -36) with a sensitivity of
+// 0x343B.
+const std::array<uint8_t, 24> SENSOR_CALIBRATION = {
+	0xD3, 0xFF, 0xD5, 0xFF, 0x55, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+	0x19, 0x00, 0xDD, 0xFF, 0xDC, 0xFF, 0x3B, 0x34, 0x3B, 0x34, 0x3B, 0x34
+};
+
+CalibrationData getSensorCalibrationData()
+{
+	RawCalibrationData data{};
+	std::copy(LEFT_STICK_CALIBRATION.begin(), LEFT_STICK_CALIBRATION.end(), data.leftStick.begin());
+	std::copy(LEFT_STICK_CALIBRATION.begin(), LEFT_STICK_CALIBRATION.end(), data.rightStick.begin());
+	std::copy(SENSOR_CALIBRATION.begin(), SENSOR_CALIBRATION.end(), data.sensors.begin());
+	return decode::decodeCalibrationData(data);
+}
+
+/**
+	@brief Makes reports with random input, in which the sticks are sometimes invalid (all zeros).
+
+	@param[in] count The number of reports.
+	@param[in] invalidLeftStick The indices of the reports in which the left stick is invalid.
+	@param[in] invalidRightStick Likewise, for the right stick.
+*/
+std::vector<protocol::StandardFullInputReport> makeReports(size_t count, const std::vector<size_t>& invalidLeftStick,
+                                                           const std::vector<size_t>& invalidRightStick)
+{
+	std::mt19937 random(0x4A6F79);
+	std::uniform_int_distribution<int> byte(0, 0xFF);
+	std::uniform_int_distribution<int> stick(0, 0xFFF);
+	std::uniform_int_distribution<int> sensor(-0x8000, 0x7FFF);
+
+	std::vector<protocol::StandardFullInputReport> reports(count);
+	for (protocol::StandardFullInputReport& report : reports) {
+		report.id = command_ids::PACKET_TYPE_BUTTONS_AND_IMU;
+		uint8_t* const buttons = reinterpret_cast<uint8_t*>(&report.buttonStatusRight);
+		for (size_t j = 0; j < 3; ++j) {
+			buttons[j] = static_cast<uint8_t>(byte(random));
+		}
+
+		for (uint8_t* rawStick : {report.leftAnalogStick, report.rightAnalogStick}) {
+			// Values of 0 on one axis only are still valid.
+			const int horizontal = 0 == byte(random) % 8 ? 0 : stick(random);
+			const int vertical = stick(random);
+			rawStick[0] = static_cast<uint8_t>(horizontal & 0xFF);
+			rawStick[1] = static_cast<uint8_t>((horizontal >> 8) | ((vertical & 0xF) << 4));
+			rawStick[2] = static_cast<uint8_t>(vertical >> 4);
+		}
+
+		for (protocol::SensorData& sample : report.sensorData) {
+			for (size_t axis = 0; axis < 3; ++axis) {
+				sample.accelerometer[axis] = static_cast<int16_t>(sensor(random));
+				sample.gyroscope[axis] = static_cast<int16_t>(sensor(random));
+			}
+		}
+	}
+
+	for (size_t i : invalidLeftStick) {
+		std::fill_n(reports.at(i).leftAnalogStick, 3, 0);
+	}
+	for (size_t i : invalidRightStick) {
+		std::fill_n(reports.at(i).rightAnalogStick, 3, 0);
+	}
+	return reports;
+}
+}
+
+TEST_CASE("Stick calibration data decodes to six 12 bit values", "[decode]")
+{
+	const std::array<uint16_t, 6> expected = {0x5BA, 0x62F, 0x86F, 0x77C, 0x5ED, 0x5B9};
+	CHECK(expected == protocol::decodeStickCalibrationData(LEFT_STICK_CALIBRATION.data()));
+}
+
+TEST_CASE("The sticks of a JoyCon at rest read 0", "[decode]")
+{
+	// The fake reports raw values of 0x800, which are within the center dead zone of its calibration.
+	for (const Hand hand : {Hand::LEFT, Hand::RIGHT}) {
+		JoyCon joyCon(std::make_shared<FakeJoyCon>(hand), hand);
+		joyCon.poll();
+
+		CHECK(0 == joyCon.getState().leftStick.x);
+		CHECK(0 == joyCon.getState().leftStick.y);
+		CHECK(0 == joyCon.getState().rightStick.x);
+		CHECK(0 == joyCon.getState().rightStick.y);
+	}
+}
+
+TEST_CASE("The gyroscope reads in rad/s", "[decode]")
+{
+	const CalibrationData calibrationData = getSensorCalibrationData();
+
+	// A reading of the sensitivity above the neutral is a rotation of 936 degrees per second.
+	protocol::StandardFullInputReport report{};
+	for (protocol::SensorData& sample : report.sensorData) {
+		sample.gyroscope[0] = 25 + 0x343B;
+		sample.gyroscope[1] = -35;
+		sample.gyroscope[2] = -36 - 0x343B / 2;
+	}
+	JoyConState state{};
+	decode::decodeSensors(report, calibrationData, state);
+
+	const float fullRate = 936 * PI / 180;
+	CHECK(state.gyroscope.x == Approx(fullRate).epsilon(0.01));
+	CHECK(state.gyroscope.y == Approx(0).margin(1e-6));
+	CHECK(state.gyroscope.z == Approx(-fullRate / 2).epsilon(0.01));
+}
+
+TEST_CASE("The accelerometer reads in m/s^2", "[decode]")
+{
+	const CalibrationData calibrationData = getSensorCalibrationData();
+
+	// The span from the neutral to the sensitivity stands for 4G.
+	protocol::StandardFullInputReport report{};
+	for (protocol::SensorData& sample : report.sensorData) {
+		sample.accelerometer[2] = 0x4000 - 341;
+	}
+	JoyConState state{};
+	decode::decodeSensors(report, calibrationData, state);
+
+	CHECK(state.accelerometer.x == 0);
+	CHECK(state.accelerometer.y == 0);
+	CHECK(state.accelerometer.z == Approx(4 * 9.8).epsilon(0.001));
+}
+
+TEST_CASE("The gyroscope is decoded around the given neutral", "[decode]")
+{
+	const CalibrationData calibrationData = getSensorCalibrationData();
+
+	// A neutral learned while resting replaces the calibrated one, which is left as it was.
+	protocol::StandardFullInputReport report{};
+	for (protocol::SensorData& sample : report.sensorData) {
+		sample.gyroscope[0] = 65;
+		sample.gyroscope[1] = -35;
+		sample.gyroscope[2] = -36;
+	}
+	JoyConState state{};
+	decode::decodeSensors(report, calibrationData, {65, -35, -36}, state);
+
+	CHECK(state.gyroscope.x == Approx(0).margin(1e-6));
+	CHECK(state.gyroscope.y == Approx(0).margin(1e-6));
+	CHECK(state.gyroscope.z == Approx(0).margin(1e-6));
+	CHECK(calibrationData.gyroscopeNeutral.x == 25);
+}
+
+TEST_CASE("Every decode kernel the CPU supports decodes like the scalar one", "[decode]")
+{
+	const CalibrationData calibrationData = getSensorCalibrationData();
+
+	// Not a whole number of blocks of 4 or 8, so the scalar kernel finishes what the SIMD kernels leave. The invalid
+	// sticks start the reports, cross the boundaries of blocks, and end the reports.
+	const size_t reportCount = 29;
+	const auto reports = makeReports(reportCount, {0, 1, 7, 8, 9, 15, 16, 27, 28}, {3, 4, 5, 6, 7, 8, 23, 24, 25});
+
+	decode::DecodedReports expected;
+	decode::decodeReports(reports.data(), reports.size(), calibrationData, expected, decode::DecodeKernel::SCALAR);
+	CHECK(0 == expected.leftStickX[0]);
+	CHECK(expected.leftStickX[6] == expected.leftStickX[9]);
+	CHECK(expected.rightStickY[2] == expected.rightStickY[8]);
+
+	for (auto kernel : {decode::DecodeKernel::SSE41, decode::DecodeKernel::AVX2}) {
+		if (kernel > decode::getBestDecodeKernel()) {
+			continue;
+		}
+
+		INFO("Kernel " << static_cast<int>(kernel));
+		decode::DecodedReports decoded;
+		decode::decodeReports(reports.data(), reports.size(), calibrationData, decoded, kernel);
+		CHECK(expected.buttons == decoded.buttons);
+		CHECK(expected.leftStickX == decoded.leftStickX);
+		CHECK(expected.leftStickY == decoded.leftStickY);
+		CHECK(expected.rightStickX == decoded.rightStickX);
+		CHECK(expected.rightStickY == decoded.rightStickY);
+		CHECK(expected.accelerometerX == decoded.accelerometerX);
+		CHECK(expected.accelerometerY == decoded.accelerometerY);
+		CHECK(expected.accelerometerZ == decoded.accelerometerZ);
+		CHECK(expected.gyroscopeX == decoded.gyroscopeX);
+		CHECK(expected.gyroscopeY == decoded.gyroscopeY);
+		CHECK(expected.gyroscopeZ == decoded.gyroscopeZ);
+	}
+}
@@ -0,0 +1,98 @@
+/*
+ * Tests of learning the gyroscope bias while a JoyCon rests, on its own and through a JoyCon.
+ */
+#include <cmath>
+#include <memory>
+#include <catch2/catch.hpp>
+#include "decode.h"
+#include "FakeJoyCon.h"
+#include "GyroscopeBiasEstimator.h"
+#include "JoyCon.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// How far the gyroscope drifted from its calibrated neutral, in raw units, on every axis.
+const int16_t DRIFT = 40;
+// Enough reports for the JoyCon to be found resting, and the neutral to settle: about 10 seconds.
+const size_t RESTING_REPORT_COUNT = 700;
+
+const CalibrationData& getCalibrationData()
+{
+	static const CalibrationData calibrationData =
+		decode::decodeCalibrationData(JoyCon(std::make_shared<FakeJoyCon>(Hand::LEFT)).getRawCalibrationData());
+	return calibrationData;
+}
+
+/**
+	@brief Makes the report of a JoyCon lying flat, whose gyroscope drifted.
+*/
+protocol::StandardFullInputReport makeDriftedReport()
+{
+	const Coefficient& neutral = getCalibrationData().gyroscopeNeutral;
+	protocol::StandardFullInputReport report{};
+	report.connectionInfo = 0xE;
+	report.batteryStatus = protocol::BatteryStatus::FULL;
+	for (uint8_t* stick : {report.leftAnalogStick, report.rightAnalogStick}) {
+		stick[0] = 0x00;
+		stick[1] = 0x08;
+		stick[2] = 0x80;
+	}
+	for (protocol::SensorData& sample : report.sensorData) {
+		sample.accelerometer[2] = 0x1000;
+		sample.gyroscope[0] = static_cast<int16_t>(std::lround(neutral.x) + DRIFT);
+		sample.gyroscope[1] = static_cast<int16_t>(std::lround(neutral.y) + DRIFT);
+		sample.gyroscope[2] = static_cast<int16_t>(std::lround(neutral.z) + DRIFT);
+	}
+	return report;
+}
+}
+
+TEST_CASE("The neutral follows the drift of a resting gyroscope", "[GyroscopeBiasEstimator]")
+{
+	const CalibrationData& calibrationData = getCalibrationData();
+	GyroscopeBiasEstimator estimator(calibrationData);
+	const protocol::StandardFullInputReport report = makeDriftedReport();
+	for (size_t i = 0; i < RESTING_REPORT_COUNT; ++i) {
+		estimator.update(report);
+	}
+
+	const Coefficient& neutral = estimator.getNeutral();
+	CHECK(neutral.x == Approx(std::lround(calibrationData.gyroscopeNeutral.x) + DRIFT).margin(1));
+	CHECK(neutral.y == Approx(std::lround(calibrationData.gyroscopeNeutral.y) + DRIFT).margin(1));
+	CHECK(neutral.z == Approx(std::lround(calibrationData.gyroscopeNeutral.z) + DRIFT).margin(1));
+
+	const GyroscopeBias bias = estimator.getBias();
+	CHECK(bias.isStill);
+	CHECK(bias.confidence > 0.9f);
+	CHECK(bias.bias.x == Approx(DRIFT * calibrationData.gyroscopeCoeff.x).epsilon(0.05));
+
+	// Starting over forgets what was learned.
+	estimator.setCalibrationData(calibrationData);
+	CHECK(estimator.getNeutral().x == calibrationData.gyroscopeNeutral.x);
+	CHECK(0 == estimator.getBias().confidence);
+}
+
+TEST_CASE("A JoyCon corrects its gyroscope for the learned drift", "[GyroscopeBiasEstimator]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT, std::chrono::microseconds(0));
+	fake->setInput(makeDriftedReport());
+	JoyCon joyCon(fake, Hand::LEFT);
+
+	joyCon.poll();
+	// Before anything was learned, the drift reads as rotation.
+	const float driftRate = DRIFT * getCalibrationData().gyroscopeCoeff.x;
+	CHECK(joyCon.getGyroscope().x == Approx(driftRate).epsilon(0.05));
+
+	for (size_t i = 0; i < RESTING_REPORT_COUNT; ++i) {
+		joyCon.poll();
+	}
+	CHECK(joyCon.getGyroscope().x == Approx(0).margin(0.05 * driftRate));
+	CHECK(joyCon.getGyroscopeBias().bias.x == Approx(driftRate).epsilon(0.05));
+
+	// The bias is learned on top of the factory calibration, which is left as it was read.
+	const CalibrationData factoryCalibration = decode::decodeCalibrationData(joyCon.getRawCalibrationData());
+	CHECK(factoryCalibration.gyroscopeNeutral.x == getCalibrationData().gyroscopeNeutral.x);
+}
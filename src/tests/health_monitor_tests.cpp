@@ -0,0 +1,144 @@
+/*
+ * Tests of HealthMonitor, fed with synthetic reports timestamped by a ReportClock.
+ */
+#include <chrono>
+#include <cstdint>
+#include <catch2/catch.hpp>
+#include "HealthMonitor.h"
+#include "ReportClock.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// In full report mode, a JoyCon sends a report every 3 ticks: 15ms.
+const uint64_t REPORT_TICKS = 3;
+const std::chrono::milliseconds LATENCY(2);
+
+const std::chrono::steady_clock::time_point START(std::chrono::seconds(1000));
+
+/*
+ * A JoyCon that sends reports to a health monitor, through a report clock.
+ */
+class SyntheticJoyCon
+{
+public:
+	SyntheticJoyCon()
+		: m_tick(0)
+	{}
+
+	/**
+		@brief Sends reports at the steady cadence.
+
+		@return When the last one was received.
+	*/
+	std::chrono::steady_clock::time_point sendReports(size_t count)
+	{
+		std::chrono::steady_clock::time_point receiveTime;
+		for (size_t i = 0; i < count; ++i) {
+			receiveTime = sendReport(REPORT_TICKS);
+		}
+		return receiveTime;
+	}
+
+	/**
+		@brief Sends a report, some ticks after the previous one.
+
+		@return When it was received.
+	*/
+	std::chrono::steady_clock::time_point sendReport(uint64_t ticks)
+	{
+		m_tick += ticks;
+		const auto receiveTime = START + static_cast<int64_t>(m_tick) * ReportClock::TICK + LATENCY;
+		monitor.update(m_clock.update(static_cast<uint8_t>(m_tick), receiveTime));
+		return receiveTime;
+	}
+
+	HealthMonitor monitor;
+
+private:
+	ReportClock m_clock;
+	uint64_t m_tick;
+};
+}
+
+TEST_CASE("A JoyCon is stalled until its first report", "[HealthMonitor]")
+{
+	const HealthMonitor monitor;
+	const Health health = monitor.getHealth(START);
+	CHECK(HealthStatus::STALLED == health.status);
+	CHECK(std::chrono::microseconds::max() == health.timeSinceLastReport);
+	CHECK(HealthMonitor::DEFAULT_PERIOD == health.expectedPeriod);
+	CHECK(0 == health.lostReportCount);
+}
+
+TEST_CASE("A JoyCon whose reports arrive steadily is healthy", "[HealthMonitor]")
+{
+	SyntheticJoyCon joyCon;
+	const auto lastReceiveTime = joyCon.sendReports(100);
+
+	const Health health = joyCon.monitor.getHealth(lastReceiveTime + std::chrono::milliseconds(5));
+	CHECK(HealthStatus::HEALTHY == health.status);
+	CHECK(std::chrono::milliseconds(15) == health.expectedPeriod);
+	CHECK(std::chrono::milliseconds(5) == health.timeSinceLastReport);
+	CHECK(0 == health.recentLossRatio);
+	CHECK(0 == health.lostReportCount);
+}
+
+TEST_CASE("Reports that are lost are counted, and degrade a JoyCon that loses many", "[HealthMonitor]")
+{
+	SyntheticJoyCon joyCon;
+	joyCon.sendReports(100);
+
+	// A gap of 45ms: the 2 reports in between were lost.
+	auto lastReceiveTime = joyCon.sendReport(3 * REPORT_TICKS);
+	Health health = joyCon.monitor.getHealth(lastReceiveTime);
+	CHECK(2 == health.lostReportCount);
+	CHECK(health.recentLossRatio == Approx(0.06).margin(0.005));
+	CHECK(HealthStatus::HEALTHY == health.status);
+	// A single gap barely moves the period.
+	CHECK(health.expectedPeriod < std::chrono::milliseconds(16));
+
+	// 2 more, right after.
+	lastReceiveTime = joyCon.sendReport(3 * REPORT_TICKS);
+	health = joyCon.monitor.getHealth(lastReceiveTime);
+	CHECK(4 == health.lostReportCount);
+	CHECK(health.recentLossRatio > HealthMonitor::DEGRADED_LOSS_RATIO);
+	CHECK(HealthStatus::DEGRADED == health.status);
+
+	// The losses are forgotten as reports keep arriving, but still counted.
+	lastReceiveTime = joyCon.sendReports(100);
+	health = joyCon.monitor.getHealth(lastReceiveTime);
+	CHECK(4 == health.lostReportCount);
+	CHECK(health.recentLossRatio < 0.01);
+	CHECK(HealthStatus::HEALTHY == health.status);
+}
+
+TEST_CASE("A silent JoyCon is degraded, then stalled, until its next report", "[HealthMonitor]")
+{
+	SyntheticJoyCon joyCon;
+	const auto lastReceiveTime = joyCon.sendReports(100);
+	const auto getStatus = [&joyCon, lastReceiveTime](std::chrono::milliseconds silence) {
+		return joyCon.monitor.getHealth(lastReceiveTime + silence).status;
+	};
+
+	// Degraded after 2 periods of silence, and stalled after 4.
+	CHECK(HealthStatus::HEALTHY == getStatus(std::chrono::milliseconds(29)));
+	CHECK(HealthStatus::DEGRADED == getStatus(std::chrono::milliseconds(30)));
+	CHECK(HealthStatus::DEGRADED == getStatus(std::chrono::milliseconds(59)));
+	CHECK(HealthStatus::STALLED == getStatus(std::chrono::milliseconds(60)));
+	CHECK(HealthStatus::STALLED == getStatus(std::chrono::milliseconds(100)));
+	CHECK(std::chrono::milliseconds(100) ==
+	      joyCon.monitor.getHealth(lastReceiveTime + std::chrono::milliseconds(100)).timeSinceLastReport);
+
+	// The reports in the silence were lost, but 7 of them don't degrade the JoyCon for long.
+	const auto receiveTime = joyCon.sendReport(8 * REPORT_TICKS);
+	Health health = joyCon.monitor.getHealth(receiveTime);
+	CHECK(7 == health.lostReportCount);
+	CHECK(HealthStatus::DEGRADED == health.status);
+
+	health = joyCon.monitor.getHealth(joyCon.sendReports(50));
+	CHECK(HealthStatus::HEALTHY == health.status);
+	CHECK(std::chrono::microseconds(0) == health.timeSinceLastReport);
+}
@@ -0,0 +1,201 @@
+/*
+ * Tests of the Linux hidraw backend, through HidDevice. A SOCK_SEQPACKET socketpair stands in for /dev/hidraw*: like
+ * hidraw, it delivers one report per read.
+ */
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <catch2/catch.hpp>
+#include "exceptions.h"
+#include "hidapi/hidapi.h"
+#include "hidapi/linux/hidapi_hidraw.h"
+#include "HidDevice.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+/*
+ * A HidDevice on one end of a socketpair, and the other end, which plays the device.
+ */
+class FakeHidraw
+{
+public:
+	FakeHidraw()
+		: m_rawDevice(nullptr), m_peer(-1)
+	{
+		int fds[2] = {-1, -1};
+		REQUIRE(0 == socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds));
+		m_peer = fds[1];
+
+		m_rawDevice = hid_hidraw_open_fd(fds[0]);
+		REQUIRE(nullptr != m_rawDevice);
+		m_device = std::make_unique<HidDevice>(m_rawDevice);
+	}
+
+	~FakeHidraw()
+	{
+		hangUp();
+	}
+
+	FakeHidraw(const FakeHidraw&) = delete;
+	FakeHidraw& operator=(const FakeHidraw&) = delete;
+
+	HidDevice& device()
+	{
+		return *m_device;
+	}
+
+	// The device under the HidDevice, which still owns it.
+	hid_device* rawDevice()
+	{
+		return m_rawDevice;
+	}
+
+	void sendReport(const Buffer& report)
+	{
+		REQUIRE(static_cast<ssize_t>(report.size()) == ::write(m_peer, report.data(), report.size()));
+	}
+
+	ssize_t receiveReport(Buffer& report)
+	{
+		return ::read(m_peer, report.data(), report.size());
+	}
+
+	void hangUp()
+	{
+		if (-1 != m_peer) {
+			close(m_peer);
+			m_peer = -1;
+		}
+	}
+
+private:
+	std::unique_ptr<HidDevice> m_device;
+	hid_device* m_rawDevice;
+	int m_peer;
+};
+
+const size_t THREAD_COUNT = 4;
+const size_t FAILURES_PER_THREAD = 2000;
+
+bool startsWith(const std::wstring& string, const std::wstring& prefix)
+{
+	return 0 == string.compare(0, prefix.size(), prefix);
+}
+}
+
+TEST_CASE("hidraw reads one report at a time", "[hidraw]")
+{
+	FakeHidraw hidraw;
+	hidraw.sendReport({0x30, 1, 2});
+	hidraw.sendReport({0x21, 3});
+
+	std::array<uint8_t, 0x31> report{};
+	REQUIRE(3 == hidraw.device().readInto(report.data(), report.size(), 100));
+	CHECK(0x30 == report[0]);
+	CHECK(2 == report[2]);
+	REQUIRE(2 == hidraw.device().readInto(report.data(), report.size(), 100));
+	CHECK(0x21 == report[0]);
+}
+
+TEST_CASE("hidraw writes reach the device", "[hidraw]")
+{
+	FakeHidraw hidraw;
+	const Buffer command = {0x01, 0x00, 0x40};
+	CHECK(command.size() == hidraw.device().write(command));
+
+	Buffer written(16);
+	REQUIRE(static_cast<ssize_t>(command.size()) == hidraw.receiveReport(written));
+	CHECK(0x40 == written[2]);
+}
+
+TEST_CASE("hidraw reads time out without reports", "[hidraw]")
+{
+	FakeHidraw hidraw;
+	std::array<uint8_t, 0x31> report{};
+	CHECK_THROWS_AS(hidraw.device().readInto(report.data(), report.size(), 10), HidTimeoutError);
+	CHECK(0 == hidraw.device().tryReadInto(report.data(), report.size()));
+}
+
+TEST_CASE("hidraw reads the reports that were queued before a hang up", "[hidraw]")
+{
+	FakeHidraw hidraw;
+	hidraw.sendReport({0x30, 1});
+	hidraw.sendReport({0x30, 2});
+	hidraw.hangUp();
+
+	std::array<uint8_t, 0x31> report{};
+	REQUIRE(2 == hidraw.device().readInto(report.data(), report.size(), 100));
+	CHECK(1 == report[1]);
+	REQUIRE(2 == hidraw.device().readInto(report.data(), report.size(), 100));
+	CHECK(2 == report[1]);
+
+	CHECK_THROWS_AS(hidraw.device().readInto(report.data(), report.size(), 100), HidError);
+	CHECK_THROWS_AS(hidraw.device().tryReadInto(report.data(), report.size()), HidError);
+}
+
+TEST_CASE("hidraw keeps the open errors of each thread apart", "[hidraw]")
+{
+	// Each thread fails in its own way, and must only ever read its own error back.
+	const char* const paths[THREAD_COUNT] = {"/nonexistent/hidraw0", "/", "/nonexistent/hidraw1", "/proc"};
+	std::vector<std::thread> threads;
+	std::vector<size_t> mismatchCounts(THREAD_COUNT, 0);
+	for (size_t i = 0; i < THREAD_COUNT; ++i) {
+		threads.emplace_back([&paths, &mismatchCounts, i]() {
+			const std::wstring expected = i % 2 ? L"open: Is a directory" : L"open: No such file or directory";
+			for (size_t j = 0; j < FAILURES_PER_THREAD; ++j) {
+				if (nullptr != hid_open_path(paths[i]) || expected != hid_error(nullptr)) {
+					++mismatchCounts[i];
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	CHECK(std::vector<size_t>(THREAD_COUNT, 0) == mismatchCounts);
+}
+
+TEST_CASE("hidraw errors of a device stay whole while several threads fail on it", "[hidraw]")
+{
+	FakeHidraw hidraw;
+	hidraw.hangUp();
+	hid_device* const device = hidraw.rawDevice();
+
+	// Failing reads and failing requests register their errors on the same device at once.
+	std::vector<std::thread> threads;
+	std::vector<size_t> mismatchCounts(THREAD_COUNT, 0);
+	for (size_t i = 0; i < THREAD_COUNT; ++i) {
+		threads.emplace_back([&hidraw, &mismatchCounts, device, i]() {
+			std::array<uint8_t, 0x31> report{};
+			for (size_t j = 0; j < FAILURES_PER_THREAD; ++j) {
+				std::wstring error;
+				if (i % 2) {
+					try {
+						hidraw.device().tryReadInto(report.data(), report.size());
+					} catch (const HidError&) {
+					}
+					error = hid_error(device);
+				} else {
+					hid_get_indexed_string(device, 0, nullptr, 0);
+					error = hid_error(device);
+				}
+				if (!startsWith(error, L"read: ") && !startsWith(error, L"poll: ") &&
+				    !startsWith(error, L"hid_get_indexed_string: ")) {
+					++mismatchCounts[i];
+				}
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	CHECK(std::vector<size_t>(THREAD_COUNT, 0) == mismatchCounts);
+}
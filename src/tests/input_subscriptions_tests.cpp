@@ -0,0 +1,214 @@
+/*
+ * Tests of InputSubscriptions, and of posting its calls through an EventQueue.
+ */
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "decode.h"
+#include "EventQueue.h"
+#include "InputSubscriptions.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+/**
+	@brief Makes the state after a report in which the buttons went from `previous` to `current`.
+*/
+JoyConState makeButtonState(ButtonMask previous, ButtonMask current)
+{
+	JoyConState state{};
+	state.buttonEdges = {current, previous};
+	return state;
+}
+
+JoyConState makeStickState(AnalogStick leftStick, AnalogStick rightStick = {})
+{
+	JoyConState state{};
+	state.leftStick = leftStick;
+	state.rightStick = rightStick;
+	return state;
+}
+
+/**
+	@brief Makes the state after the given report, whose IMU samples are numbered by their accelerometer X, from
+	`report * IMU_SAMPLES_PER_REPORT` up.
+*/
+JoyConState makeImuState(size_t report)
+{
+	JoyConState state{};
+	for (size_t i = 0; i < IMU_SAMPLES_PER_REPORT; ++i) {
+		state.imuSamples[i].accelerometer.x = static_cast<float>(report * IMU_SAMPLES_PER_REPORT + i);
+	}
+	return state;
+}
+}
+
+TEST_CASE("Button subscribers are only called for their own buttons", "[InputSubscriptions]")
+{
+	InputSubscriptions subscriptions;
+	std::vector<ButtonEdges> calls;
+	subscriptions.subscribeButtons(button_bits::A | button_bits::B, [&calls](const ButtonEdges& buttonEdges) {
+		calls.push_back(buttonEdges);
+	});
+
+	subscriptions.publish(makeButtonState(0, button_bits::X), false);
+	subscriptions.publish(makeButtonState(button_bits::X, button_bits::X), false);
+	CHECK(calls.empty());
+
+	subscriptions.publish(makeButtonState(button_bits::X, button_bits::X | button_bits::A), false);
+	subscriptions.publish(makeButtonState(button_bits::X | button_bits::A, button_bits::A), false);
+	subscriptions.publish(makeButtonState(button_bits::A, 0), false);
+	REQUIRE(2 == calls.size());
+	CHECK(button_bits::A == calls[0].pressed());
+	CHECK((button_bits::X | button_bits::A) == calls[0].held());
+	CHECK(button_bits::A == calls[1].released());
+}
+
+TEST_CASE("Subscribers may unsubscribe from their callbacks", "[InputSubscriptions]")
+{
+	InputSubscriptions subscriptions;
+	unsigned int firstCallCount = 0;
+	unsigned int secondCallCount = 0;
+	unsigned int addedCallCount = 0;
+	SubscriptionId second = 0;
+	SubscriptionId first = 0;
+	first = subscriptions.subscribeButtons(button_bits::A, [&](const ButtonEdges&) {
+		++firstCallCount;
+		// Itself, one that wasn't called yet in this report, and one that starts with the next report.
+		subscriptions.unsubscribe(first);
+		subscriptions.unsubscribe(second);
+		subscriptions.subscribeButtons(button_bits::A, [&addedCallCount](const ButtonEdges&) { ++addedCallCount; });
+	});
+	second = subscriptions.subscribeButtons(button_bits::A, [&secondCallCount](const ButtonEdges&) {
+		++secondCallCount;
+	});
+
+	subscriptions.publish(makeButtonState(0, button_bits::A), false);
+	CHECK(1 == firstCallCount);
+	CHECK(0 == secondCallCount);
+	CHECK(0 == addedCallCount);
+
+	subscriptions.publish(makeButtonState(button_bits::A, 0), false);
+	CHECK(1 == firstCallCount);
+	CHECK(0 == secondCallCount);
+	CHECK(1 == addedCallCount);
+
+	// Unknown IDs, and IDs that were already unsubscribed, are ignored.
+	subscriptions.unsubscribe(first);
+	subscriptions.unsubscribe(1000);
+}
+
+TEST_CASE("Stick subscribers are called once a stick moved past the threshold", "[InputSubscriptions]")
+{
+	InputSubscriptions subscriptions;
+	std::vector<AnalogStick> leftSticks;
+	subscriptions.subscribeSticks(0.1f, [&leftSticks](const AnalogStick& leftStick, const AnalogStick&) {
+		leftSticks.push_back(leftStick);
+	});
+
+	// The first movement is reported, whatever its size.
+	subscriptions.publish(makeStickState({0.01f, 0}), false);
+	REQUIRE(1 == leftSticks.size());
+
+	// Small movements aren't, until they add up to more than the threshold from the last call.
+	subscriptions.publish(makeStickState({0.06f, 0}), false);
+	subscriptions.publish(makeStickState({0.10f, 0}), false);
+	CHECK(1 == leftSticks.size());
+	subscriptions.publish(makeStickState({0.12f, 0}), false);
+	REQUIRE(2 == leftSticks.size());
+	CHECK(0.12f == leftSticks[1].x);
+
+	// Either stick counts.
+	subscriptions.publish(makeStickState({0.12f, 0}, {0, -0.5f}), false);
+	CHECK(3 == leftSticks.size());
+
+	CHECK_THROWS_AS(subscriptions.subscribeSticks(-0.1f, [](const AnalogStick&, const AnalogStick&) {}),
+	                std::invalid_argument);
+}
+
+TEST_CASE("IMU subscribers get the samples of their number of reports at once", "[InputSubscriptions]")
+{
+	InputSubscriptions subscriptions;
+	std::vector<std::vector<ImuSample>> singleBatches;
+	std::vector<std::vector<ImuSample>> batches;
+	subscriptions.subscribeImu(1, [&singleBatches](const std::vector<ImuSample>& samples) {
+		singleBatches.push_back(samples);
+	});
+	subscriptions.subscribeImu(4, [&batches](const std::vector<ImuSample>& samples) { batches.push_back(samples); });
+
+	for (size_t report = 0; report < 9; ++report) {
+		subscriptions.publish(makeImuState(report), true);
+		// Reports without IMU samples don't count.
+		subscriptions.publish(makeImuState(100), false);
+	}
+
+	CHECK(9 == singleBatches.size());
+	REQUIRE(2 == batches.size());
+	for (size_t batch = 0; batch < batches.size(); ++batch) {
+		REQUIRE(4 * IMU_SAMPLES_PER_REPORT == batches[batch].size());
+		for (size_t i = 0; i < batches[batch].size(); ++i) {
+			CHECK(static_cast<float>(batch * batches[batch].size() + i) == batches[batch][i].accelerometer.x);
+		}
+	}
+
+	CHECK_THROWS_AS(subscriptions.subscribeImu(0, [](const std::vector<ImuSample>&) {}), std::invalid_argument);
+}
+
+TEST_CASE("Calls posted to an event queue run on its consumer's thread, with the input they were made with",
+          "[InputSubscriptions]")
+{
+	const auto queue = std::make_shared<EventQueue>();
+	InputSubscriptions subscriptions;
+	std::vector<ButtonMask> pressed;
+	subscriptions.subscribeButtons(button_bits::A | button_bits::B, [&pressed](const ButtonEdges& buttonEdges) {
+		pressed.push_back(buttonEdges.pressed());
+	}, queue->getExecutor());
+
+	subscriptions.publish(makeButtonState(0, button_bits::A), false);
+	subscriptions.publish(makeButtonState(button_bits::A, button_bits::A | button_bits::B), false);
+	CHECK(pressed.empty());
+
+	CHECK(2 == queue->runPending());
+	CHECK(std::vector<ButtonMask>{button_bits::A, button_bits::B} == pressed);
+	CHECK(0 == queue->runPending());
+}
+
+TEST_CASE("Work posted to a destroyed event queue is dropped", "[EventQueue]")
+{
+	auto queue = std::make_shared<EventQueue>();
+	const Executor executor = queue->getExecutor();
+	queue.reset();
+
+	bool isRun = false;
+	executor([&isRun]() { isRun = true; });
+	CHECK_FALSE(isRun);
+}
+
+TEST_CASE("Work that throws leaves the work after it queued", "[EventQueue]")
+{
+	EventQueue queue;
+	std::vector<int> runs;
+	queue.post([&runs]() { runs.push_back(1); });
+	queue.post([&runs]() {
+		runs.push_back(2);
+		throw std::runtime_error("Failed");
+	});
+	queue.post([&runs, &queue]() {
+		runs.push_back(3);
+		queue.post([&runs]() { runs.push_back(5); });
+	});
+	queue.post([&runs]() { runs.push_back(4); });
+
+	CHECK_THROWS_AS(queue.runPending(), std::runtime_error);
+	CHECK(std::vector<int>{1, 2} == runs);
+
+	// Work posted since runs after the work that was left.
+	queue.post([&runs]() { runs.push_back(6); });
+	CHECK(3 == queue.runPending());
+	CHECK(std::vector<int>{1, 2, 3, 4, 6} == runs);
+	CHECK(1 == queue.runPending());
+	CHECK(std::vector<int>{1, 2, 3, 4, 6, 5} == runs);
+}
@@ -0,0 +1,110 @@
+/*
+ * Tests of JoyCon and JoyConReader, against a fake JoyCon.
+ */
+#include <array>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <catch2/catch.hpp>
+#include "allocations.h"
+#include "command_ids.h"
+#include "exceptions.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "JoyConReader.h"
+
+using namespace joy_con_bridge;
+using namespace joy_con_bridge::command_ids;
+
+
+TEST_CASE("Steady state polls don't allocate", "[JoyCon]")
+{
+	// A report is always waiting, so every poll applies one.
+	JoyCon joyCon(std::make_shared<FakeJoyCon>(Hand::LEFT, std::chrono::microseconds(0)), Hand::LEFT);
+	for (int i = 0; i < 100; ++i) {
+		joyCon.poll();
+	}
+
+	const size_t allocationsBefore = allocations::getCount();
+	for (int i = 0; i < 1000; ++i) {
+		joyCon.poll();
+	}
+	CHECK(allocationsBefore == allocations::getCount());
+}
+
+TEST_CASE("The fake's factory calibration is read from where a JoyCon keeps it", "[JoyCon]")
+{
+	const JoyCon joyCon(std::make_shared<FakeJoyCon>(Hand::LEFT), Hand::LEFT);
+	const RawCalibrationData& data = joyCon.getRawCalibrationData();
+
+	// The sensors at 0x6020, then the left stick at 0x603D and the right stick at 0x6046.
+	const std::array<uint8_t, SENSOR_CALIBRATION_DATA_SIZE> sensors = {
+		0xD3, 0xFF, 0xD5, 0xFF, 0x55, 0x01, 0x00, 0x40, 0x00, 0x40, 0x00, 0x40,
+		0x19, 0x00, 0xDD, 0xFF, 0xDC, 0xFF, 0x3B, 0x34, 0x3B, 0x34, 0x3B, 0x34
+	};
+	const std::array<uint8_t, STICK_CALIBRATION_DATA_SIZE> leftStick = {
+		0xBA, 0xF5, 0x62, 0x6F, 0xC8, 0x77, 0xED, 0x95, 0x5B
+	};
+	const std::array<uint8_t, STICK_CALIBRATION_DATA_SIZE> rightStick = {
+		0x16, 0xD8, 0x7D, 0xF2, 0xB5, 0x5F, 0x86, 0x65, 0x5E
+	};
+	CHECK(sensors == data.sensors);
+	CHECK(leftStick == data.leftStick);
+	CHECK(rightStick == data.rightStick);
+}
+
+TEST_CASE("A timed poll returns without reports", "[JoyCon]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	JoyCon joyCon(fake, Hand::LEFT);
+	fake->setReportInterval(std::chrono::hours(1));
+
+	const auto start = std::chrono::steady_clock::now();
+	CHECK_FALSE(joyCon.poll(std::chrono::milliseconds(20)));
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+}
+
+TEST_CASE("Timed polls time out subcommands without reports", "[JoyCon]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	JoyCon joyCon(fake, Hand::LEFT);
+	fake->setReportInterval(std::chrono::hours(1));
+	fake->setSubcommandHandler(SUBCOMMAND_SET_PLAYER_LED, [](const Buffer&) { return std::nullopt; });
+
+	auto reply = joyCon.sendSubcommandAsync(SUBCOMMAND_SET_PLAYER_LED, {0x01}, {std::chrono::milliseconds(30), 1});
+	for (int i = 0; i < 10 && std::future_status::ready != reply.wait_for(std::chrono::seconds(0)); ++i) {
+		CHECK_FALSE(joyCon.poll(std::chrono::milliseconds(20)));
+	}
+	REQUIRE(std::future_status::ready == reply.wait_for(std::chrono::seconds(0)));
+	CHECK_THROWS_AS(reply.get(), JoyConNotResponding);
+	CHECK(2 == fake->getSubcommandCount(SUBCOMMAND_SET_PLAYER_LED));
+}
+
+TEST_CASE("The reader publishes the states it polls", "[JoyConReader]")
+{
+	JoyConReader reader(JoyCon(std::make_shared<FakeJoyCon>(Hand::LEFT, std::chrono::milliseconds(1)), Hand::LEFT));
+
+	JoyConState state{};
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!reader.getLatestState(state) && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	CHECK(reader.getLatestState(state));
+	CHECK(reader.drainHistory([](const JoyConState&) {}) > 0);
+}
+
+TEST_CASE("The reader stops without waiting for a silent JoyCon", "[JoyConReader]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	JoyCon joyCon(fake, Hand::LEFT);
+	fake->setReportInterval(std::chrono::hours(1));
+
+	auto reader = std::make_unique<JoyConReader>(joyCon);
+	// Let the reader thread start waiting for a report.
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	const auto start = std::chrono::steady_clock::now();
+	reader.reset();
+	CHECK(std::chrono::steady_clock::now() - start < JoyCon::NOT_RESPONDING_TIMEOUT / 10);
+}
@@ -0,0 +1,3 @@
+// The main of the tests, which Catch2 generates here and only here, since it is slow to compile.
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
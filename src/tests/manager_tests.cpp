@@ -0,0 +1,164 @@
+/*
+ * Tests of JoyConManager, against simulated JoyCons that come and go.
+ */
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "FakeJoyCon.h"
+#include "JoyConManager.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// Long enough that only device changes and refreshes enumerate during a test.
+const std::chrono::milliseconds LONG_ENUMERATION_INTERVAL(10000);
+const std::chrono::milliseconds SLOW_HANDSHAKE(500);
+const std::chrono::milliseconds WAIT_TIMEOUT(2000);
+
+const connect::DeviceDescription LEFT_DEVICE = {"fake0", L"00:00:00:00:00:01", Hand::LEFT};
+const connect::DeviceDescription RIGHT_DEVICE = {"fake1", L"00:00:00:00:00:02", Hand::RIGHT};
+
+/*
+ * The simulated devices that are plugged in, and how often they were enumerated.
+ */
+class SimulatedDevices
+{
+public:
+	explicit SimulatedDevices(std::vector<connect::DeviceDescription> devices)
+		: m_devices(std::move(devices))
+		, m_enumerationCount(0)
+	{}
+
+	void set(std::vector<connect::DeviceDescription> devices)
+	{
+		std::lock_guard<std::mutex> guard(m_lock);
+		m_devices = std::move(devices);
+	}
+
+	size_t getEnumerationCount() const
+	{
+		return m_enumerationCount;
+	}
+
+	JoyConManager::Enumerator getEnumerator()
+	{
+		return [this]() {
+			++m_enumerationCount;
+			std::lock_guard<std::mutex> guard(m_lock);
+			return m_devices;
+		};
+	}
+
+private:
+	std::mutex m_lock;
+	std::vector<connect::DeviceDescription> m_devices;
+	std::atomic<size_t> m_enumerationCount;
+};
+
+JoyCon connectFakeJoyCon(const connect::DeviceDescription& device)
+{
+	return JoyCon(std::make_shared<FakeJoyCon>(device.hand), device.hand);
+}
+
+/**
+	@brief Polls the handles until a condition holds, like an application would.
+
+	@return Whether the condition held before the timeout.
+*/
+bool pollUntil(JoyConManager& manager, const std::function<bool()>& condition)
+{
+	const auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+	while (std::chrono::steady_clock::now() < deadline) {
+		for (const std::shared_ptr<ManagedJoyCon>& joyCon : manager.getJoyCons()) {
+			joyCon->pollAll();
+		}
+		if (condition()) {
+			return true;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return false;
+}
+
+std::shared_ptr<ManagedJoyCon> findJoyCon(const JoyConManager& manager, Hand hand)
+{
+	for (const std::shared_ptr<ManagedJoyCon>& joyCon : manager.getJoyCons()) {
+		if (hand == joyCon->getHand()) {
+			return joyCon;
+		}
+	}
+	return nullptr;
+}
+}
+
+TEST_CASE("A JoyCon that comes back is reconnected to its handle", "[JoyConManager]")
+{
+	SimulatedDevices devices({LEFT_DEVICE});
+	JoyConManager manager(devices.getEnumerator(), connectFakeJoyCon, LONG_ENUMERATION_INTERVAL);
+
+	REQUIRE(pollUntil(manager, [&manager]() {
+		const auto joyCon = findJoyCon(manager, Hand::LEFT);
+		return joyCon && joyCon->isConnected();
+	}));
+	const auto joyCon = findJoyCon(manager, Hand::LEFT);
+
+	devices.set({});
+	manager.refresh();
+	REQUIRE(pollUntil(manager, [&joyCon]() { return !joyCon->isConnected(); }));
+
+	const auto returnedAt = std::chrono::steady_clock::now();
+	devices.set({LEFT_DEVICE});
+	manager.refresh();
+	REQUIRE(pollUntil(manager, [&joyCon]() { return joyCon->isConnected(); }));
+	const auto reconnectTime = std::chrono::steady_clock::now() - returnedAt;
+
+	CHECK(1 == manager.getJoyCons().size());
+	CHECK(1 == joyCon->getReconnectCount());
+	// The latency is measured from the enumeration that found the JoyCon, so it is within the time the test saw.
+	CHECK(joyCon->getLastReconnectLatency() > std::chrono::microseconds(0));
+	CHECK(joyCon->getLastReconnectLatency() <= reconnectTime);
+}
+
+TEST_CASE("A slow handshake doesn't hold up the other JoyCons", "[JoyConManager]")
+{
+	SimulatedDevices devices({LEFT_DEVICE, RIGHT_DEVICE});
+	const auto connector = [](const connect::DeviceDescription& device) {
+		if (Hand::LEFT == device.hand) {
+			std::this_thread::sleep_for(SLOW_HANDSHAKE);
+		}
+		return connectFakeJoyCon(device);
+	};
+	JoyConManager manager(devices.getEnumerator(), connector, LONG_ENUMERATION_INTERVAL);
+
+	const auto start = std::chrono::steady_clock::now();
+	REQUIRE(pollUntil(manager, [&manager]() {
+		const auto joyCon = findJoyCon(manager, Hand::RIGHT);
+		return joyCon && joyCon->isConnected();
+	}));
+	CHECK(std::chrono::steady_clock::now() - start < SLOW_HANDSHAKE);
+	CHECK_FALSE(findJoyCon(manager, Hand::LEFT)->isConnected());
+
+	REQUIRE(pollUntil(manager, [&manager]() { return findJoyCon(manager, Hand::LEFT)->isConnected(); }));
+}
+
+TEST_CASE("Finished handshakes don't make the manager enumerate again", "[JoyConManager]")
+{
+	SimulatedDevices devices({LEFT_DEVICE, RIGHT_DEVICE});
+	JoyConManager manager(devices.getEnumerator(), connectFakeJoyCon, LONG_ENUMERATION_INTERVAL);
+
+	REQUIRE(pollUntil(manager, [&manager]() {
+		const auto joyCons = manager.getJoyCons();
+		return 2 == joyCons.size() && joyCons[0]->isConnected() && joyCons[1]->isConnected();
+	}));
+	CHECK(1 == devices.getEnumerationCount());
+
+	manager.refresh();
+	REQUIRE(pollUntil(manager, [&devices]() { return 2 == devices.getEnumerationCount(); }));
+}
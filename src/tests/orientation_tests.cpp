@@ -0,0 +1,113 @@
+/*
+ * Tests of the orientation estimator, against synthesized IMU samples of a JoyCon whose true orientation is known,
+ * either given straight to the estimator or replayed from a capture.
+ */
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "decode.h"
+#include "orientation_capture.h"
+#include "OrientationEstimator.h"
+#include "ReportCapture.h"
+#include "TemporaryDirectory.h"
+
+using namespace joy_con_bridge;
+using namespace orientation_capture;
+
+
+namespace
+{
+const float PI = 3.14159265358979f;
+}
+
+TEST_CASE("The estimated gravity follows a JoyCon that is waved around", "[OrientationEstimator]")
+{
+	WavedJoyCon joyCon;
+	OrientationEstimator estimator;
+	double errorSum = 0;
+	float maxError = 0;
+	size_t errorCount = 0;
+	const size_t sampleCount = static_cast<size_t>(20 / IMU_SAMPLE_PERIOD);
+	for (size_t i = 0; i < sampleCount; ++i) {
+		estimator.update(joyCon.next(), IMU_SAMPLE_PERIOD);
+
+		if (i >= SETTLE_SAMPLE_COUNT) {
+			const float error = getAngleInDegrees(estimator.getOrientation().gravity, joyCon.getGravity());
+			errorSum += error;
+			maxError = std::max(maxError, error);
+			++errorCount;
+		}
+	}
+
+	CHECK(errorSum / static_cast<double>(errorCount) < 2);
+	CHECK(maxError < 5);
+}
+
+TEST_CASE("The estimated gravity follows a replayed capture of a JoyCon that is waved around", "[OrientationEstimator]")
+{
+	const TemporaryDirectory directory("joyconbridge_orientation");
+	const std::string path = directory.getPath("waved.jccap");
+	// 20 seconds of waving.
+	const std::vector<ThreeAxesSensor> gravity =
+		writeCapture(path, static_cast<size_t>(20 / (IMU_SAMPLES_PER_REPORT * IMU_SAMPLE_PERIOD)));
+
+	// The reports go through the decoding of a JoyCon, with the calibration the capture holds.
+	ReportCaptureReader reader(path);
+	REQUIRE(reader.getCalibrationData());
+	const CalibrationData calibrationData = decode::decodeCalibrationData(*reader.getCalibrationData());
+
+	OrientationEstimator estimator;
+	JoyConState state{};
+	double errorSum = 0;
+	float maxError = 0;
+	size_t errorCount = 0;
+	size_t sample = 0;
+	CaptureRecord record;
+	while (reader.next(record)) {
+		if (CaptureRecordType::INPUT_REPORT != record.type) {
+			continue;
+		}
+		REQUIRE(sizeof(protocol::StandardFullInputReport) == record.size);
+		decode::decodeSensors(*reinterpret_cast<const protocol::StandardFullInputReport*>(record.data), calibrationData,
+		                      state);
+
+		for (const ImuSample& imuSample : state.imuSamples) {
+			estimator.update(imuSample, IMU_SAMPLE_PERIOD);
+			if (sample >= SETTLE_SAMPLE_COUNT) {
+				const float error = getAngleInDegrees(estimator.getOrientation().gravity, gravity[sample]);
+				errorSum += error;
+				maxError = std::max(maxError, error);
+				++errorCount;
+			}
+			++sample;
+		}
+	}
+
+	REQUIRE(gravity.size() == sample);
+	CHECK(errorSum / static_cast<double>(errorCount) < 2);
+	CHECK(maxError < 5);
+}
+
+TEST_CASE("The estimated gravity converges to the tilt the accelerometer measures", "[OrientationEstimator]")
+{
+	OrientationEstimator estimator;
+	estimator.update(makeRestingSample({0, 0, -1}), IMU_SAMPLE_PERIOD);
+	CHECK(getAngleInDegrees(estimator.getOrientation().gravity, {0, 0, -1}) < 0.1f);
+
+	// The JoyCon is tilted by 30 degrees, but the gyroscope missed it. Only the accelerometer tells.
+	const float tilt = 30 * PI / 180;
+	const ThreeAxesSensor gravity = {0, std::sin(tilt), -std::cos(tilt)};
+	float previousError = getAngleInDegrees(estimator.getOrientation().gravity, gravity);
+	for (int second = 0; second < 10; ++second) {
+		for (size_t i = 0; i < static_cast<size_t>(1 / IMU_SAMPLE_PERIOD); ++i) {
+			estimator.update(makeRestingSample(gravity), IMU_SAMPLE_PERIOD);
+		}
+		// Once converged, the error is only the rounding of the angle.
+		const float error = getAngleInDegrees(estimator.getOrientation().gravity, gravity);
+		CHECK((error <= previousError || error < 0.1f));
+		previousError = error;
+	}
+	CHECK(previousError < 0.1f);
+}
@@ -0,0 +1,102 @@
+/*
+ * Tests of JoyConPool, against fake JoyCons that the pool waits for with epoll.
+ */
+#include <chrono>
+#include <fcntl.h>
+#include <future>
+#include <memory>
+#include <unistd.h>
+#include <catch2/catch.hpp>
+#include "command_ids.h"
+#include "exceptions.h"
+#include "FakeJoyCon.h"
+#include "JoyConPool.h"
+
+using namespace joy_con_bridge;
+using namespace joy_con_bridge::command_ids;
+
+
+namespace
+{
+const std::chrono::milliseconds POLL_TIMEOUT(10);
+
+/*
+ * A fake JoyCon with a file descriptor that never becomes readable. The pool waits for it rather than reading it
+ * round-robin, and is never told that it has reports: it is as silent as a JoyCon that went out of range.
+ */
+class WaitedFakeJoyCon : public FakeJoyCon
+{
+public:
+	explicit WaitedFakeJoyCon(Hand hand)
+		: FakeJoyCon(hand)
+		, m_pipe{-1, -1}
+	{
+		REQUIRE(0 == pipe2(m_pipe, O_CLOEXEC));
+	}
+
+	~WaitedFakeJoyCon() override
+	{
+		close(m_pipe[0]);
+		close(m_pipe[1]);
+	}
+
+	int getFileDescriptor() const override
+	{
+		return m_pipe[0];
+	}
+
+private:
+	int m_pipe[2];
+};
+
+/**
+	@brief Polls the pool until the predicate holds, or for a while past the longest timeout of the pool.
+
+	@return The time it took.
+*/
+template <typename Predicate>
+std::chrono::steady_clock::duration pollUntil(JoyConPool& pool, Predicate&& isDone)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const auto deadline = start + 2 * JoyCon::NOT_RESPONDING_TIMEOUT;
+	while (!isDone() && std::chrono::steady_clock::now() < deadline) {
+		pool.poll(POLL_TIMEOUT);
+	}
+	return std::chrono::steady_clock::now() - start;
+}
+}
+
+TEST_CASE("A silent JoyCon in a pool still times out its subcommands", "[JoyConPool]")
+{
+	const auto fake = std::make_shared<WaitedFakeJoyCon>(Hand::LEFT);
+	JoyConPool pool;
+	pool.add(JoyCon(fake, Hand::LEFT));
+	REQUIRE(pool.isWaitingForDevices());
+
+	// The subcommand is never replied to, and no report wakes the pool up.
+	fake->setSubcommandHandler(SUBCOMMAND_SET_PLAYER_LED, [](const Buffer&) { return std::nullopt; });
+	const SubcommandBudget budget = {std::chrono::milliseconds(50), 1};
+	auto reply = pool.getJoyCon(0).sendSubcommandAsync(SUBCOMMAND_SET_PLAYER_LED, {0x01}, budget);
+
+	const auto elapsed = pollUntil(pool, [&reply]() {
+		return std::future_status::ready == reply.wait_for(std::chrono::seconds(0));
+	});
+	REQUIRE(std::future_status::ready == reply.wait_for(std::chrono::seconds(0)));
+	CHECK_THROWS_AS(reply.get(), JoyConNotResponding);
+	CHECK(2 == fake->getSubcommandCount(SUBCOMMAND_SET_PLAYER_LED));
+	CHECK(elapsed < budget.timeout * 2 + 4 * JoyConPool::PENDING_WORK_INTERVAL);
+}
+
+TEST_CASE("A pool stops serving a JoyCon that stalled", "[JoyConPool]")
+{
+	const auto silentFake = std::make_shared<WaitedFakeJoyCon>(Hand::LEFT);
+	JoyConPool pool;
+	const size_t silentIndex = pool.add(JoyCon(silentFake, Hand::LEFT));
+	const size_t healthyIndex = pool.add(JoyCon(std::make_shared<FakeJoyCon>(Hand::RIGHT), Hand::RIGHT));
+
+	const auto elapsed = pollUntil(pool, [&pool, silentIndex]() { return nullptr != pool.getError(silentIndex); });
+	REQUIRE(pool.getError(silentIndex));
+	CHECK_THROWS_AS(std::rethrow_exception(pool.getError(silentIndex)), JoyConNotResponding);
+	CHECK(elapsed >= JoyCon::NOT_RESPONDING_TIMEOUT - JoyConPool::PENDING_WORK_INTERVAL);
+	CHECK_FALSE(pool.getError(healthyIndex));
+}
@@ -0,0 +1,139 @@
+/*
+ * Tests of ReportClock, fed with the timers and receive times of synthetic reports.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <catch2/catch.hpp>
+#include "ReportClock.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// In full report mode, a JoyCon sends a report every 3 ticks.
+const uint64_t REPORT_TICKS = 3;
+const std::chrono::milliseconds LATENCY(2);
+// Starts close to a wrap of the timer, so the first reports wrap it.
+const uint64_t FIRST_TICK = 250;
+
+const std::chrono::steady_clock::time_point START(std::chrono::seconds(1000));
+
+/**
+	@brief Gets when the JoyCon sent the report at the given tick, on the host's clock.
+*/
+std::chrono::steady_clock::time_point getSendTime(uint64_t tick)
+{
+	return START + static_cast<int64_t>(tick) * ReportClock::TICK;
+}
+
+uint8_t getTimer(uint64_t tick)
+{
+	return static_cast<uint8_t>(FIRST_TICK + tick);
+}
+
+int64_t getMicroseconds(std::chrono::steady_clock::duration duration)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+int64_t getMicrosecondsApart(std::chrono::steady_clock::time_point first, std::chrono::steady_clock::time_point second)
+{
+	return std::abs(getMicroseconds(first - second));
+}
+}
+
+TEST_CASE("Reports at a steady cadence are timestamped when they were sent", "[ReportClock]")
+{
+	ReportClock clock;
+	for (uint64_t i = 0; i < 200; ++i) {
+		const uint64_t tick = i * REPORT_TICKS;
+		const ReportTimestamp timestamp = clock.update(getTimer(tick), getSendTime(tick) + LATENCY);
+		REQUIRE(tick == timestamp.deviceTicks);
+		// The latency of the connection can't be told apart from the offset of the clocks.
+		REQUIRE(getSendTime(tick) + LATENCY == timestamp.sampleTime);
+	}
+
+	CHECK(START.time_since_epoch() + LATENCY == clock.getClockOffset());
+	CHECK(0 == clock.getJitter().count());
+}
+
+TEST_CASE("The ticks of reports lost over more than a wrap of the timer are counted", "[ReportClock]")
+{
+	ReportClock clock;
+	uint64_t tick = 0;
+	clock.update(getTimer(tick), getSendTime(tick) + LATENCY);
+
+	// Gaps longer than a wrap, whose reports are received anywhere from early to late.
+	const std::chrono::microseconds latencies[] = {std::chrono::microseconds(0), LATENCY, 4 * ReportClock::TICK};
+	for (uint64_t gap : {300, 256, 259, 513, 3 * 256 + 255}) {
+		for (const std::chrono::microseconds latency : latencies) {
+			tick += gap;
+			INFO("Gap of " << gap << " ticks, latency of " << getMicroseconds(latency) << "us");
+			CHECK(tick == clock.update(getTimer(tick), getSendTime(tick) + latency).deviceTicks);
+
+			// Back to the steady cadence.
+			tick += REPORT_TICKS;
+			CHECK(tick == clock.update(getTimer(tick), getSendTime(tick) + LATENCY).deviceTicks);
+		}
+	}
+
+	// The clock offset is still close to that of the reports that were received without latency: it only creeps up.
+	CHECK(clock.getClockOffset() >= START.time_since_epoch());
+	CHECK(clock.getClockOffset() - START.time_since_epoch() < LATENCY / 2);
+}
+
+TEST_CASE("Bunched reports are timestamped by the one that waited the least", "[ReportClock]")
+{
+	// The reports are received three at a time, with the last of them.
+	const uint64_t bunchSize = 3;
+	ReportClock clock;
+	int64_t largestError = 0;
+	for (uint64_t i = 0; i < 300; ++i) {
+		const uint64_t tick = i * REPORT_TICKS;
+		const uint64_t lastTickOfBunch = (i / bunchSize * bunchSize + bunchSize - 1) * REPORT_TICKS;
+		const ReportTimestamp timestamp = clock.update(getTimer(tick), getSendTime(lastTickOfBunch) + LATENCY);
+		REQUIRE(tick == timestamp.deviceTicks);
+		if (i >= bunchSize) {
+			largestError =
+				std::max(largestError, getMicrosecondsApart(timestamp.sampleTime, getSendTime(tick) + LATENCY));
+		}
+	}
+
+	// Spread out like they were sent, rather than like they were received: 15ms apart, not all at once.
+	CHECK(largestError < 500);
+	CHECK(START.time_since_epoch() + LATENCY == clock.getClockOffset());
+
+	// The first report of a bunch arrives 30ms late, and the others 15ms early: 20ms on average, as in RFC 3550.
+	CHECK(clock.getJitter().count() == Approx(20000).margin(1000));
+}
+
+TEST_CASE("The clock offset follows a JoyCon whose clock runs slow", "[ReportClock]")
+{
+	// 200ppm slower than the host's clock, so the JoyCon falls behind 3us every report: 6ms in all.
+	const int64_t driftPerMillion = 200;
+	const size_t reportCount = 2000;
+	ReportClock clock;
+	int64_t largestError = 0;
+	for (uint64_t i = 0; i < reportCount; ++i) {
+		const uint64_t tick = i * REPORT_TICKS;
+		const auto drift = (getSendTime(tick) - START) * driftPerMillion / 1000000;
+		const auto sendTime = getSendTime(tick) + drift;
+		// Every fifth report waits longer, so the offset has to creep up past the reports that waited the least.
+		const auto latency = 0 == i % 5 ? LATENCY + std::chrono::milliseconds(4) : LATENCY;
+
+		const ReportTimestamp timestamp = clock.update(getTimer(tick), sendTime + latency);
+		REQUIRE(tick == timestamp.deviceTicks);
+		if (i > 100) {
+			largestError = std::max(largestError, getMicrosecondsApart(timestamp.sampleTime, sendTime + LATENCY));
+		}
+	}
+
+	const auto totalDrift = std::chrono::microseconds(
+		static_cast<int64_t>(reportCount - 1) * REPORT_TICKS * ReportClock::TICK.count() * driftPerMillion / 1000000);
+	CHECK(getMicroseconds(clock.getClockOffset() - START.time_since_epoch() - LATENCY) ==
+	      Approx(totalDrift.count()).margin(500));
+	CHECK(largestError < 500);
+}
@@ -0,0 +1,188 @@
+/*
+ * Tests of the rumble encoder, and of streaming rumble to a fake JoyCon.
+ */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <catch2/catch.hpp>
+#include "command_ids.h"
+#include "exceptions.h"
+#include "FakeJoyCon.h"
+#include "rumble.h"
+#include "RumbleStreamer.h"
+#include "SubcommandChannel.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+const std::chrono::milliseconds WAIT_TIMEOUT(2000);
+
+const Rumble STRONG_RUMBLE = {{320, 1}, {160, 1}};
+
+/*
+ * A fake JoyCon whose rumble reports can be made to fail, like a JoyCon that was unplugged.
+ */
+class FailingFakeJoyCon : public FakeJoyCon
+{
+public:
+	FailingFakeJoyCon()
+		: FakeJoyCon(Hand::LEFT)
+		, isFailing(false)
+		, m_failureCount(0)
+	{}
+
+	size_t write(const uint8_t* data, size_t size) override
+	{
+		if (isFailing && command_ids::COMMAND_RUMBLE == data[0]) {
+			++m_failureCount;
+			throw HidError(nullptr);
+		}
+		return FakeJoyCon::write(data, size);
+	}
+
+	unsigned int getFailureCount() const
+	{
+		return m_failureCount;
+	}
+
+	std::atomic<bool> isFailing;
+
+private:
+	std::atomic<unsigned int> m_failureCount;
+};
+
+/**
+	@brief Waits until the predicate holds, or for a while.
+
+	@return true if the predicate holds.
+*/
+template <typename Predicate>
+bool waitUntil(Predicate&& isDone)
+{
+	const auto deadline = std::chrono::steady_clock::now() + WAIT_TIMEOUT;
+	while (!isDone()) {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+}
+
+TEST_CASE("A silent rumble encodes to the neutral rumble data", "[rumble]")
+{
+	const protocol::RumbleData expected = {0x00, 0x01, 0x40, 0x40, 0x00, 0x01, 0x40, 0x40};
+	CHECK(expected == rumble::encodeBoth(SILENT_RUMBLE));
+	CHECK(expected == protocol::NEUTRAL_RUMBLE);
+	CHECK(rumble::isSilent(rumble::encodeBoth(SILENT_RUMBLE)));
+
+	// Whatever the frequencies.
+	CHECK(rumble::isSilent(rumble::encodeBoth({{1000, 0}, {50, 0}})));
+}
+
+TEST_CASE("Any amplitude in either band or actuator is not silent", "[rumble]")
+{
+	// The smallest amplitude of the low band only sets the bit that it shares with the low frequency.
+	const float smallestAmplitude = rumble::getAmplitude(1);
+	CHECK(0 != (rumble::encode({{320, 0}, {160, smallestAmplitude}})[2] & 0x80));
+	CHECK_FALSE(rumble::isSilent(rumble::encodeBoth({{320, 0}, {160, smallestAmplitude}})));
+	CHECK_FALSE(rumble::isSilent(rumble::encodeBoth({{320, smallestAmplitude}, {160, 0}})));
+
+	protocol::RumbleData rumble = protocol::NEUTRAL_RUMBLE;
+	const std::array<uint8_t, 4> strong = rumble::encode(STRONG_RUMBLE);
+	std::copy(strong.begin(), strong.end(), rumble.begin() + 4);
+	CHECK_FALSE(rumble::isSilent(rumble));
+}
+
+TEST_CASE("The maximum amplitude encodes to the top of the amplitude table", "[rumble]")
+{
+	CHECK(rumble::getAmplitude(100) == Approx(1).epsilon(0.01));
+
+	// An amplitude of 100 in both bands: shifted left by 1 in the high band, and halved above 0x40 in the low band.
+	const std::array<uint8_t, 4> expected = {0x00, 0xC9, 0x40, 0x72};
+	CHECK(expected == rumble::encode(STRONG_RUMBLE));
+
+	// Larger amplitudes are clamped, and so are negative ones.
+	CHECK(expected == rumble::encode({{320, 10}, {160, 10}}));
+	CHECK(rumble::encode(SILENT_RUMBLE) == rumble::encode({{320, -1}, {160, -1}}));
+}
+
+TEST_CASE("Frequencies encode up to the edges of their bands, and are clamped there", "[rumble]")
+{
+	CHECK(rumble::getFrequency(true, 0) == Approx(80).epsilon(0.001));
+	CHECK(rumble::getFrequency(true, 0x7F) == Approx(1253).epsilon(0.001));
+	CHECK(rumble::getFrequency(false, 0x01) == Approx(41).epsilon(0.01));
+	CHECK(rumble::getFrequency(false, 0x7F) == Approx(626).epsilon(0.001));
+
+	// The bottom of both bands: 0 in the high band, 1 in the low band.
+	const std::array<uint8_t, 4> bottom = {0x00, 0x00, 0x01, 0x40};
+	CHECK(bottom == rumble::encode({{80, 0}, {41, 0}}));
+	CHECK(bottom == rumble::encode({{10, 0}, {1, 0}}));
+	CHECK(bottom == rumble::encode({{-10, 0}, {0, 0}}));
+
+	// The top of both bands: 0x7F, shifted left by 2 over the first two bytes in the high band.
+	const std::array<uint8_t, 4> top = {0xFC, 0x01, 0x7F, 0x40};
+	CHECK(top == rumble::encode({{1253, 0}, {626, 0}}));
+	CHECK(top == rumble::encode({{20000, 0}, {20000, 0}}));
+
+	// One step inside the edges.
+	CHECK(std::array<uint8_t, 4>{0x04, 0x00, 0x02, 0x40} == rumble::encode({{82, 0}, {42, 0}}));
+	CHECK(std::array<uint8_t, 4>{0xF8, 0x01, 0x7E, 0x40} == rumble::encode({{1226, 0}, {613, 0}}));
+}
+
+TEST_CASE("A silent rumble is written once", "[RumbleStreamer]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	RumbleStreamer streamer(std::make_shared<SubcommandChannel>(fake));
+
+	streamer.set(SILENT_RUMBLE);
+	REQUIRE(waitUntil([&fake]() { return 0 != fake->getRumbleReportCount(); }));
+	std::this_thread::sleep_for(10 * HealthMonitor::DEFAULT_PERIOD);
+	CHECK(1 == fake->getRumbleReportCount());
+	CHECK(protocol::NEUTRAL_RUMBLE == fake->getRumble());
+}
+
+TEST_CASE("A rumble that isn't silent is written every report period, until stopped", "[RumbleStreamer]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	RumbleStreamer streamer(std::make_shared<SubcommandChannel>(fake));
+
+	streamer.set(STRONG_RUMBLE);
+	CHECK(rumble::encodeBoth(STRONG_RUMBLE) == streamer.get());
+	REQUIRE(waitUntil([&fake]() { return 5 <= fake->getRumbleReportCount(); }));
+	CHECK(rumble::encodeBoth(STRONG_RUMBLE) == fake->getRumble());
+
+	streamer.stop();
+	REQUIRE(waitUntil([&fake]() { return rumble::isSilent(fake->getRumble()); }));
+	const unsigned int stoppedCount = fake->getRumbleReportCount();
+	std::this_thread::sleep_for(10 * HealthMonitor::DEFAULT_PERIOD);
+	CHECK(stoppedCount == fake->getRumbleReportCount());
+}
+
+TEST_CASE("Setting a rumble rethrows the error of a failed write, and resumes the streaming", "[RumbleStreamer]")
+{
+	const auto fake = std::make_shared<FailingFakeJoyCon>();
+	RumbleStreamer streamer(std::make_shared<SubcommandChannel>(fake));
+
+	fake->isFailing = true;
+	streamer.set(STRONG_RUMBLE);
+	REQUIRE(waitUntil([&fake]() { return 0 != fake->getFailureCount(); }));
+
+	// The streaming stopped at the failure, and the error waits for the next rumble.
+	std::this_thread::sleep_for(10 * HealthMonitor::DEFAULT_PERIOD);
+	CHECK(1 == fake->getFailureCount());
+	CHECK_THROWS_AS(streamer.set(SILENT_RUMBLE), HidError);
+	CHECK(rumble::encodeBoth(STRONG_RUMBLE) == streamer.get());
+
+	fake->isFailing = false;
+	streamer.set(STRONG_RUMBLE);
+	REQUIRE(waitUntil([&fake]() { return 2 <= fake->getRumbleReportCount(); }));
+	CHECK(rumble::encodeBoth(STRONG_RUMBLE) == fake->getRumble());
+}
@@ -0,0 +1,198 @@
+/*
+ * Tests of reading ranges of the SPI flash, against a fake JoyCon whose replies are dropped or reordered.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <catch2/catch.hpp>
+#include "command_ids.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "protocol.h"
+
+using namespace joy_con_bridge;
+using namespace joy_con_bridge::command_ids;
+
+
+namespace
+{
+// An erased part of the flash, which the tests fill with data that differs at every offset.
+const uint32_t TEST_DATA_OFFSET = 0x1000;
+const size_t TEST_DATA_SIZE = 0x200;
+
+uint8_t getTestByte(uint32_t offset)
+{
+	return static_cast<uint8_t>(offset * 7 + (offset >> 8));
+}
+
+Buffer getTestData(uint32_t offset, size_t size)
+{
+	Buffer data(size);
+	for (size_t i = 0; i < size; ++i) {
+		data[i] = getTestByte(static_cast<uint32_t>(offset + i));
+	}
+	return data;
+}
+
+/*
+ * A fake JoyCon that holds the test data, and records the SPI reads it is sent.
+ */
+class SpiFakeJoyCon
+{
+public:
+	/**
+		@brief Decides how an SPI read is replied to: the delay of its reply, or no reply if empty.
+
+		@param[in] offset The offset of the read.
+		@param[in] attempt The number of times the same offset was read before.
+	*/
+	using ReplyPolicy = std::function<std::optional<std::chrono::microseconds>(uint32_t offset, unsigned int attempt)>;
+
+	SpiFakeJoyCon()
+		: fake(std::make_shared<FakeJoyCon>(Hand::LEFT))
+		, joyCon(fake, Hand::LEFT)
+	{
+		fake->writeSpi(TEST_DATA_OFFSET, getTestData(TEST_DATA_OFFSET, TEST_DATA_SIZE));
+		fake->setSubcommandHandler(SUBCOMMAND_SPI_READ, [this](const Buffer& parameters) {
+			return reply(parameters);
+		});
+	}
+
+	void setReplyPolicy(ReplyPolicy replyPolicy)
+	{
+		m_replyPolicy = std::move(replyPolicy);
+	}
+
+	/**
+		@brief Gets the SPI reads that were sent, as offset and size.
+	*/
+	const std::vector<std::pair<uint32_t, uint8_t>>& getReads() const
+	{
+		return m_reads;
+	}
+
+	unsigned int getReadCount(uint32_t offset) const
+	{
+		return static_cast<unsigned int>(std::count_if(m_reads.begin(), m_reads.end(), [offset](const auto& read) {
+			return offset == read.first;
+		}));
+	}
+
+	const std::shared_ptr<FakeJoyCon> fake;
+	JoyCon joyCon;
+
+private:
+	std::optional<Buffer> reply(const Buffer& parameters)
+	{
+		protocol::SpiReadCommandParameters read{};
+		std::memcpy(&read, parameters.data(), std::min(parameters.size(), sizeof(read)));
+		const unsigned int attempt = getReadCount(read.readOffset);
+		m_reads.emplace_back(read.readOffset, read.readSize);
+
+		const auto delay = m_replyPolicy ? m_replyPolicy(read.readOffset, attempt) : std::chrono::microseconds(0);
+		if (!delay) {
+			return std::nullopt;
+		}
+		// The delay of the reply is taken after the handler returns.
+		fake->setReplyDelay(*delay);
+		return fake->getDefaultReply(SUBCOMMAND_SPI_READ, parameters);
+	}
+
+	ReplyPolicy m_replyPolicy;
+	std::vector<std::pair<uint32_t, uint8_t>> m_reads;
+};
+}
+
+TEST_CASE("Overlapping and touching ranges are read together, and returned in their own order", "[SPI]")
+{
+	SpiFakeJoyCon spi;
+	const std::vector<SpiRange> ranges = {
+		{TEST_DATA_OFFSET + 0x100, 0x05}, // Apart from the others.
+		{TEST_DATA_OFFSET + 0x08, 0x10}, // Overlaps the next one.
+		{TEST_DATA_OFFSET, 0x10},
+		{TEST_DATA_OFFSET + 0x18, 0x08}, // Touches the end of the previous one.
+		{TEST_DATA_OFFSET + 0x02, 0x04} // Within the others.
+	};
+
+	const std::vector<Buffer> data = spi.joyCon.readSpiRanges(ranges);
+	REQUIRE(ranges.size() == data.size());
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		CHECK(getTestData(ranges[i].offset, ranges[i].size) == data[i]);
+	}
+
+	// 0x20 bytes read in as few reads as possible, and the range that is apart on its own.
+	const std::vector<std::pair<uint32_t, uint8_t>> expectedReads = {
+		{TEST_DATA_OFFSET, static_cast<uint8_t>(JoyCon::MAX_SPI_READ_SIZE)},
+		{TEST_DATA_OFFSET + JoyCon::MAX_SPI_READ_SIZE, static_cast<uint8_t>(0x20 - JoyCon::MAX_SPI_READ_SIZE)},
+		{TEST_DATA_OFFSET + 0x100, 0x05}
+	};
+	CHECK(expectedReads == spi.getReads());
+}
+
+TEST_CASE("Several SPI reads are kept in flight at once", "[SPI]")
+{
+	SpiFakeJoyCon spi;
+	const auto replyDelay = std::chrono::milliseconds(40);
+	std::vector<std::chrono::steady_clock::time_point> sendTimes;
+	spi.setReplyPolicy([replyDelay, &sendTimes](uint32_t, unsigned int) {
+		sendTimes.push_back(std::chrono::steady_clock::now());
+		return std::optional<std::chrono::microseconds>(replyDelay);
+	});
+
+	const size_t readCount = 3 * JoyCon::SPI_READS_IN_FLIGHT;
+	const auto start = std::chrono::steady_clock::now();
+	const Buffer data = spi.joyCon.readSpiRange(TEST_DATA_OFFSET, readCount * JoyCon::MAX_SPI_READ_SIZE);
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	CHECK(getTestData(TEST_DATA_OFFSET, data.size()) == data);
+	REQUIRE(readCount == sendTimes.size());
+
+	// The first reads are all sent before any reply arrives, and the next one once the first reply arrived.
+	CHECK(sendTimes[JoyCon::SPI_READS_IN_FLIGHT - 1] - sendTimes[0] < replyDelay / 2);
+	CHECK(sendTimes[JoyCon::SPI_READS_IN_FLIGHT] - sendTimes[0] >= replyDelay);
+	// So reading takes a round trip per batch of reads, rather than per read.
+	CHECK(elapsed < replyDelay * (readCount / 2));
+}
+
+TEST_CASE("SPI replies that come in another order are placed by the range they echo", "[SPI]")
+{
+	SpiFakeJoyCon spi;
+	// The reply to the first read comes after those of the next reads.
+	spi.setReplyPolicy([](uint32_t offset, unsigned int) {
+		return std::optional<std::chrono::microseconds>(
+			TEST_DATA_OFFSET == offset ? std::chrono::milliseconds(30) : std::chrono::milliseconds(0));
+	});
+
+	const size_t readCount = JoyCon::SPI_READS_IN_FLIGHT;
+	const auto start = std::chrono::steady_clock::now();
+	const Buffer data = spi.joyCon.readSpiRange(TEST_DATA_OFFSET, readCount * JoyCon::MAX_SPI_READ_SIZE);
+	CHECK(getTestData(TEST_DATA_OFFSET, data.size()) == data);
+
+	// Without waiting for a read to time out. The first read may be sent again once its read got another reply, but
+	// its own reply still arrives before that.
+	CHECK(std::chrono::steady_clock::now() - start < DEFAULT_SUBCOMMAND_BUDGET.timeout);
+	CHECK(2 >= spi.getReadCount(TEST_DATA_OFFSET));
+	CHECK(1 == spi.getReadCount(TEST_DATA_OFFSET + JoyCon::MAX_SPI_READ_SIZE));
+}
+
+TEST_CASE("An SPI read whose reply was lost is sent again", "[SPI]")
+{
+	SpiFakeJoyCon spi;
+	const uint32_t lostOffset = TEST_DATA_OFFSET + JoyCon::MAX_SPI_READ_SIZE;
+	spi.setReplyPolicy([lostOffset](uint32_t offset, unsigned int attempt) {
+		const bool isLost = lostOffset == offset && 0 == attempt;
+		return isLost ? std::nullopt : std::optional<std::chrono::microseconds>(std::chrono::microseconds(0));
+	});
+
+	// The reads after the lost one take the replies of the reads before them.
+	const size_t readCount = 2 * JoyCon::SPI_READS_IN_FLIGHT;
+	const Buffer data = spi.joyCon.readSpiRange(TEST_DATA_OFFSET, readCount * JoyCon::MAX_SPI_READ_SIZE);
+	CHECK(getTestData(TEST_DATA_OFFSET, data.size()) == data);
+	CHECK(2 <= spi.getReadCount(lostOffset));
+	CHECK(1 == spi.getReadCount(TEST_DATA_OFFSET));
+}
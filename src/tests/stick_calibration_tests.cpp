@@ -0,0 +1,68 @@
+/*
+ * Tests of StickCalibration against decode::getCalibratedStickValues, which it must match with the default profile.
+ */
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <catch2/catch.hpp>
+#include "decode.h"
+#include "FakeJoyCon.h"
+#include "JoyCon.h"
+#include "StickCalibration.h"
+
+using namespace joy_con_bridge;
+
+
+namespace
+{
+// A few ulps of the values around 1, which is what float tables of the same formula may differ by.
+const float MAX_STICK_ERROR = 1e-6f;
+// Covers the whole 12 bit range of both axes, from 0 to 0xFFF.
+const uint16_t RAW_VALUE_STEP = 3;
+
+/**
+	@brief Gets the largest difference between the tables and the formula, over raw values in steps.
+*/
+float getMaxError(const AnalogStickCalibrationData& calibrationData)
+{
+	const StickCalibration stickCalibration(calibrationData);
+	float maxError = 0;
+	for (uint16_t x = 0; x < StickCalibration::AXIS_TABLE_SIZE; x += RAW_VALUE_STEP) {
+		for (uint16_t y = 0; y < StickCalibration::AXIS_TABLE_SIZE; y += RAW_VALUE_STEP) {
+			const AnalogStick expected = decode::getCalibratedStickValues({x, y}, calibrationData);
+			const AnalogStick actual = stickCalibration.apply({x, y});
+			maxError = std::max({maxError, std::abs(expected.x - actual.x), std::abs(expected.y - actual.y)});
+		}
+	}
+	return maxError;
+}
+}
+
+TEST_CASE("The stick tables match the exact calibration", "[StickCalibration]")
+{
+	const JoyCon joyCon(std::make_shared<FakeJoyCon>(Hand::LEFT), Hand::LEFT);
+	const CalibrationData calibrationData = decode::decodeCalibrationData(joyCon.getRawCalibrationData());
+
+	CHECK(getMaxError(calibrationData.leftStick) <= MAX_STICK_ERROR);
+	CHECK(getMaxError(calibrationData.rightStick) <= MAX_STICK_ERROR);
+}
+
+TEST_CASE("The stick tables match the exact calibration at the edges of the range", "[StickCalibration]")
+{
+	const JoyCon joyCon(std::make_shared<FakeJoyCon>(Hand::LEFT), Hand::LEFT);
+	const AnalogStickCalibrationData calibrationData =
+		decode::decodeCalibrationData(joyCon.getRawCalibrationData()).leftStick;
+	const StickCalibration stickCalibration(calibrationData);
+
+	// Raw values beyond the calibrated range are clamped to it, and read as full deflection.
+	const std::array<uint16_t, 2> edges[] = {{0, 0}, {0xFFF, 0xFFF}, {0, 0xFFF}, {0xFFF, 0},
+	                                         {calibrationData.x.center, calibrationData.y.center}};
+	for (const auto& stickValues : edges) {
+		const AnalogStick expected = decode::getCalibratedStickValues(stickValues, calibrationData);
+		const AnalogStick actual = stickCalibration.apply(stickValues);
+		CHECK(std::abs(expected.x - actual.x) <= MAX_STICK_ERROR);
+		CHECK(std::abs(expected.y - actual.y) <= MAX_STICK_ERROR);
+	}
+}
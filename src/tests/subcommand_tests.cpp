@@ -0,0 +1,151 @@
+/*
+ * Tests of SubcommandChannel: resends, timeouts, and the routing of replies, against a fake JoyCon whose replies are
+ * dropped or delayed.
+ */
+#include <chrono>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <catch2/catch.hpp>
+#include "command_ids.h"
+#include "exceptions.h"
+#include "FakeJoyCon.h"
+#include "protocol.h"
+#include "SubcommandChannel.h"
+
+using namespace joy_con_bridge;
+using namespace joy_con_bridge::command_ids;
+
+
+namespace
+{
+const std::chrono::milliseconds WAIT_TIMEOUT(2000);
+
+/**
+	@brief Hands the replies of the fake to the channel, and times out its subcommands, until the reply is ready or
+	for a while at most.
+
+	@return true if the reply is ready.
+*/
+bool pumpUntilReady(FakeJoyCon& fake, SubcommandChannel& channel, std::future<Buffer>& reply,
+                    std::chrono::milliseconds timeout = WAIT_TIMEOUT)
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	while (std::future_status::ready != reply.wait_for(std::chrono::seconds(0))) {
+		if (std::chrono::steady_clock::now() >= deadline) {
+			return false;
+		}
+
+		protocol::StandardInputReport report{};
+		if (0 != fake.tryReadInto(reinterpret_cast<uint8_t*>(&report), sizeof(report))) {
+			channel.handleReply(report);
+		} else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		channel.handleTimeouts();
+	}
+	return true;
+}
+
+Buffer getSpiReadParameters(uint32_t offset, uint8_t size)
+{
+	const protocol::SpiReadCommandParameters parameters = {offset, size};
+	Buffer buffer(sizeof(parameters));
+	std::memcpy(buffer.data(), &parameters, sizeof(parameters));
+	return buffer;
+}
+
+/**
+	@brief Gets the offset that an SPI read reply echoes.
+*/
+uint32_t getEchoedOffset(const Buffer& reply)
+{
+	protocol::SpiReadCommandParameters parameters{};
+	REQUIRE(reply.size() >= sizeof(parameters));
+	std::memcpy(&parameters, reply.data(), sizeof(parameters));
+	return parameters.readOffset;
+}
+}
+
+TEST_CASE("A subcommand whose reply was lost is resent", "[SubcommandChannel]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	SubcommandChannel channel(fake);
+
+	// The first attempt is never replied to.
+	unsigned int attemptCount = 0;
+	fake->setSubcommandHandler(SUBCOMMAND_SET_PLAYER_LED, [&attemptCount](const Buffer&) -> std::optional<Buffer> {
+		return 1 == ++attemptCount ? std::nullopt : std::optional<Buffer>(Buffer());
+	});
+
+	auto reply = channel.send(COMMAND_START_SUBCOMMAND, SUBCOMMAND_SET_PLAYER_LED, {0x01},
+	                          {std::chrono::milliseconds(20), 2});
+	REQUIRE(pumpUntilReady(*fake, channel, reply));
+	CHECK(reply.get().empty());
+	CHECK(2 == fake->getSubcommandCount(SUBCOMMAND_SET_PLAYER_LED));
+	CHECK(0 == channel.getInFlightCount());
+}
+
+TEST_CASE("A subcommand fails once its retries run out", "[SubcommandChannel]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	SubcommandChannel channel(fake);
+	fake->setSubcommandHandler(SUBCOMMAND_SET_PLAYER_LED, [](const Buffer&) { return std::nullopt; });
+
+	const SubcommandBudget budget = {std::chrono::milliseconds(20), 2};
+	const auto start = std::chrono::steady_clock::now();
+	auto reply = channel.send(COMMAND_START_SUBCOMMAND, SUBCOMMAND_SET_PLAYER_LED, {0x01}, budget);
+	REQUIRE(pumpUntilReady(*fake, channel, reply));
+	CHECK_THROWS_AS(reply.get(), JoyConNotResponding);
+	CHECK(std::chrono::steady_clock::now() - start >= budget.timeout * (budget.retries + 1));
+	CHECK(budget.retries + 1 == fake->getSubcommandCount(SUBCOMMAND_SET_PLAYER_LED));
+	CHECK(0 == channel.getInFlightCount());
+}
+
+TEST_CASE("Replies that come in another order reach their own subcommands", "[SubcommandChannel]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	SubcommandChannel channel(fake);
+
+	// The first subcommand is replied to after the second one.
+	fake->setReplyDelay(std::chrono::milliseconds(30));
+	auto first = channel.send(COMMAND_START_SUBCOMMAND, SUBCOMMAND_SPI_READ, getSpiReadParameters(0x6020, 0x10),
+	                          DEFAULT_SUBCOMMAND_BUDGET);
+	fake->setReplyDelay(std::chrono::microseconds(0));
+	auto second = channel.send(COMMAND_START_SUBCOMMAND, SUBCOMMAND_REQUEST_DEVICE_INFO, {}, DEFAULT_SUBCOMMAND_BUDGET);
+
+	REQUIRE(pumpUntilReady(*fake, channel, second));
+	CHECK(std::future_status::ready != first.wait_for(std::chrono::seconds(0)));
+	CHECK(0x03 == second.get().at(0)); // The firmware version, which starts the device info.
+
+	REQUIRE(pumpUntilReady(*fake, channel, first));
+	CHECK(0x6020 == getEchoedOffset(first.get()));
+}
+
+TEST_CASE("A late reply to a resent subcommand doesn't complete the next one", "[SubcommandChannel]")
+{
+	const auto fake = std::make_shared<FakeJoyCon>(Hand::LEFT);
+	SubcommandChannel channel(fake);
+
+	// The first attempt is replied to late, after the resend was replied to.
+	const SubcommandBudget budget = {std::chrono::milliseconds(50), 1};
+	fake->setReplyDelay(std::chrono::milliseconds(70));
+	auto first = channel.send(COMMAND_START_SUBCOMMAND, SUBCOMMAND_SPI_READ, getSpiReadParameters(0x6020, 0x10),
+	                          budget);
+	fake->setReplyDelay(std::chrono::microseconds(0));
+	REQUIRE(pumpUntilReady(*fake, channel, first));
+	CHECK(0x6020 == getEchoedOffset(first.get()));
+	CHECK(2 == fake->getSubcommandCount(SUBCOMMAND_SPI_READ));
+
+	// The next read with the same subcommand ID is replied to after the late reply of the first one.
+	fake->setReplyDelay(std::chrono::milliseconds(150));
+	auto second = channel.send(COMMAND_START_SUBCOMMAND, SUBCOMMAND_SPI_READ, getSpiReadParameters(0x603D, 0x12),
+	                           DEFAULT_SUBCOMMAND_BUDGET);
+	CHECK_FALSE(pumpUntilReady(*fake, channel, second, std::chrono::milliseconds(100)));
+
+	REQUIRE(pumpUntilReady(*fake, channel, second));
+	CHECK(0x603D == getEchoedOffset(second.get()));
+	CHECK(3 == fake->getSubcommandCount(SUBCOMMAND_SPI_READ));
+}